@@ -0,0 +1,575 @@
+/**
+ * Python module for the emulator, built on the C interface in
+ * src/emu8080.h.
+ *
+ *     import emu8080
+ *     cpu = emu8080.Intel8080()
+ *     cpu.memory[0x100:0x100 + len(program)] = program
+ *     cpu.pc = 0x100
+ *     cpu.hook_out(0, lambda port, value: print(chr(value), end=""))
+ *     cycles = cpu.execute()
+ *
+ * memory is a writable memoryview of the CPU's own 64 KB, so reads and
+ * writes through it, or a NumPy array made from it, are never copied.
+ * Registers are properties. Hooks are set per port and ports without one
+ * never enter Python: IN reads open_bus and OUT is ignored. Execution
+ * releases the GIL, which hooks take back while they run, and
+ * execute_batch() runs many CPUs on several threads at once.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "../src/emu8080.h"
+
+namespace {
+
+// run until halted
+constexpr uint64_t forever = std::numeric_limits<uint64_t>::max();
+
+struct Cpu {
+    PyObject_HEAD
+    emu8080_cpu *cpu;
+    PyObject *in_hooks[256];
+    PyObject *out_hooks[256];
+    uint8_t open_bus;
+    bool running;
+
+    // the exception a hook raised, which halted the CPU to end execution
+    bool failed;
+    PyObject *error_type;
+    PyObject *error_value;
+    PyObject *error_traceback;
+};
+
+extern PyTypeObject Intel8080Type;
+extern PyTypeObject Intel8085Type;
+
+// keep the exception for the thread that started execution and halt the
+// CPU, which ends its execute loop after this instruction
+void fail(Cpu *self) {
+    PyErr_Fetch(&self->error_type, &self->error_value,
+                &self->error_traceback);
+    self->failed = true;
+    emu8080_set_register(self->cpu, EMU8080_REG_HALTED, 1);
+}
+
+uint8_t input(void *user, const uint8_t port) {
+    Cpu *self = static_cast<Cpu *>(user);
+    if (!self->in_hooks[port] || self->failed) {
+        return self->open_bus;
+    }
+
+    const PyGILState_STATE gil = PyGILState_Ensure();
+    uint8_t value = self->open_bus;
+    // read again now that hooks cannot change
+    if (PyObject *hook = self->in_hooks[port]) {
+        Py_INCREF(hook);
+        PyObject *result = PyObject_CallFunction(hook, "B", port);
+        Py_DECREF(hook);
+        const long byte = result ? PyLong_AsLong(result) : -1;
+        Py_XDECREF(result);
+        if (PyErr_Occurred()) {
+            fail(self);
+        } else {
+            value = byte & 0xff;
+        }
+    }
+    PyGILState_Release(gil);
+    return value;
+}
+
+void output(void *user, const uint8_t port, const uint8_t value) {
+    Cpu *self = static_cast<Cpu *>(user);
+    if (!self->out_hooks[port] || self->failed) {
+        return;
+    }
+
+    const PyGILState_STATE gil = PyGILState_Ensure();
+    if (PyObject *hook = self->out_hooks[port]) {
+        Py_INCREF(hook);
+        PyObject *result = PyObject_CallFunction(hook, "BB", port, value);
+        Py_DECREF(hook);
+        Py_XDECREF(result);
+        if (!result) {
+            fail(self);
+        }
+    }
+    PyGILState_Release(gil);
+}
+
+/**
+ * Raise the exception of a hook that failed during execution
+ * Returns: True when there was one
+ */
+bool raiseFailure(Cpu *self) {
+    if (!self->failed) {
+        return false;
+    }
+    self->failed = false;
+    emu8080_set_register(self->cpu, EMU8080_REG_HALTED, 0);
+    PyErr_Restore(self->error_type, self->error_value,
+                  self->error_traceback);
+    self->error_type = self->error_value = self->error_traceback = nullptr;
+    return true;
+}
+
+bool parseCycles(PyObject *object, uint64_t &cycles) {
+    if (!object || object == Py_None) {
+        cycles = forever;
+        return true;
+    }
+    cycles = PyLong_AsUnsignedLongLong(object);
+    return !PyErr_Occurred();
+}
+
+bool parsePort(PyObject *object, int &port) {
+    if (object == Py_None) {
+        port = -1;
+        return true;
+    }
+    const long value = PyLong_AsLong(object);
+    if (PyErr_Occurred()) {
+        return false;
+    }
+    if (value < 0 || value > 0xff) {
+        PyErr_SetString(PyExc_ValueError, "port must be 0 to 255");
+        return false;
+    }
+    port = value;
+    return true;
+}
+
+PyObject *Cpu_new(PyTypeObject *type, PyObject *, PyObject *) {
+    Cpu *self = reinterpret_cast<Cpu *>(type->tp_alloc(type, 0));
+    if (!self) {
+        return nullptr;
+    }
+    const bool i8085 = PyType_IsSubtype(type, &Intel8085Type);
+    self->cpu =
+        emu8080_create(i8085 ? EMU8080_MODEL_8085 : EMU8080_MODEL_8080);
+    if (!self->cpu) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    emu8080_set_io(self->cpu, input, output, self);
+    return reinterpret_cast<PyObject *>(self);
+}
+
+int Cpu_traverse(Cpu *self, visitproc visit, void *arg) {
+    for (int port = 0; port < 256; ++port) {
+        Py_VISIT(self->in_hooks[port]);
+        Py_VISIT(self->out_hooks[port]);
+    }
+    return 0;
+}
+
+int Cpu_clear(Cpu *self) {
+    for (int port = 0; port < 256; ++port) {
+        Py_CLEAR(self->in_hooks[port]);
+        Py_CLEAR(self->out_hooks[port]);
+    }
+    return 0;
+}
+
+void Cpu_dealloc(Cpu *self) {
+    PyObject_GC_UnTrack(self);
+    Cpu_clear(self);
+    Py_XDECREF(self->error_type);
+    Py_XDECREF(self->error_value);
+    Py_XDECREF(self->error_traceback);
+    if (self->cpu) {
+        emu8080_destroy(self->cpu);
+    }
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+int Cpu_getbuffer(Cpu *self, Py_buffer *view, int flags) {
+    return PyBuffer_FillInfo(view, reinterpret_cast<PyObject *>(self),
+                             emu8080_memory(self->cpu), 0x10000, 0, flags);
+}
+
+PyObject *Cpu_execute(Cpu *self, PyObject *args) {
+    PyObject *limit = nullptr;
+    uint64_t cycles;
+    if (!PyArg_ParseTuple(args, "|O:execute", &limit) ||
+        !parseCycles(limit, cycles)) {
+        return nullptr;
+    }
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "the CPU is already running");
+        return nullptr;
+    }
+
+    self->running = true;
+    uint64_t executed;
+    Py_BEGIN_ALLOW_THREADS
+    executed = emu8080_run(self->cpu, cycles);
+    Py_END_ALLOW_THREADS
+    self->running = false;
+
+    if (raiseFailure(self)) {
+        return nullptr;
+    }
+    return PyLong_FromUnsignedLongLong(executed);
+}
+
+PyObject *Cpu_reset(Cpu *self, PyObject *) {
+    emu8080_reset(self->cpu);
+    Py_RETURN_NONE;
+}
+
+PyObject *Cpu_interrupt(Cpu *self, PyObject *args) {
+    int isr;
+    if (!PyArg_ParseTuple(args, "i:interrupt", &isr)) {
+        return nullptr;
+    }
+    if (isr < 0 || isr > 7) {
+        PyErr_SetString(PyExc_ValueError, "interrupt must be 0 to 7");
+        return nullptr;
+    }
+    return PyBool_FromLong(emu8080_interrupt(self->cpu, isr));
+}
+
+PyObject *Cpu_load(Cpu *self, PyObject *args) {
+    unsigned int address;
+    Py_buffer data;
+    if (!PyArg_ParseTuple(args, "Iy*:load", &address, &data)) {
+        return nullptr;
+    }
+    const bool loaded = address <= 0xffff &&
+                        emu8080_load(self->cpu, address,
+                                     static_cast<uint8_t *>(data.buf),
+                                     data.len);
+    PyBuffer_Release(&data);
+    if (!loaded) {
+        PyErr_SetString(PyExc_ValueError, "data runs past end of memory");
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *setHook(PyObject **hooks, PyObject *args, const char *format) {
+    PyObject *port_object;
+    PyObject *hook;
+    int port;
+    if (!PyArg_ParseTuple(args, format, &port_object, &hook) ||
+        !parsePort(port_object, port)) {
+        return nullptr;
+    }
+    if (hook != Py_None && !PyCallable_Check(hook)) {
+        PyErr_SetString(PyExc_TypeError, "hook must be callable or None");
+        return nullptr;
+    }
+    // None for the port hooks every port
+    const int first = port < 0 ? 0 : port;
+    const int last = port < 0 ? 255 : port;
+    for (int i = first; i <= last; ++i) {
+        Py_XSETREF(hooks[i], hook == Py_None ? nullptr : Py_NewRef(hook));
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *Cpu_hook_in(Cpu *self, PyObject *args) {
+    return setHook(self->in_hooks, args, "OO:hook_in");
+}
+
+PyObject *Cpu_hook_out(Cpu *self, PyObject *args) {
+    return setHook(self->out_hooks, args, "OO:hook_out");
+}
+
+PyObject *Cpu_get_register(Cpu *self, void *closure) {
+    const auto reg = static_cast<emu8080_register>(
+        reinterpret_cast<intptr_t>(closure));
+    const uint16_t value = emu8080_get_register(self->cpu, reg);
+    if (reg == EMU8080_REG_HALTED || reg == EMU8080_REG_INTERRUPTS_ENABLED) {
+        return PyBool_FromLong(value);
+    }
+    return PyLong_FromLong(value);
+}
+
+int Cpu_set_register(Cpu *self, PyObject *value, void *closure) {
+    const auto reg = static_cast<emu8080_register>(
+        reinterpret_cast<intptr_t>(closure));
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete a register");
+        return -1;
+    }
+    if (reg == EMU8080_REG_HALTED || reg == EMU8080_REG_INTERRUPTS_ENABLED) {
+        const int truth = PyObject_IsTrue(value);
+        if (truth < 0) {
+            return -1;
+        }
+        emu8080_set_register(self->cpu, reg, truth);
+        return 0;
+    }
+    const long limit = reg <= EMU8080_REG_FLAGS ? 0xff : 0xffff;
+    const long number = PyLong_AsLong(value);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    if (number < 0 || number > limit) {
+        PyErr_Format(PyExc_ValueError, "register value must be 0 to %ld",
+                     limit);
+        return -1;
+    }
+    emu8080_set_register(self->cpu, reg, number);
+    return 0;
+}
+
+PyObject *Cpu_get_memory(Cpu *self, void *) {
+    return PyMemoryView_FromObject(reinterpret_cast<PyObject *>(self));
+}
+
+PyObject *Cpu_get_open_bus(Cpu *self, void *) {
+    return PyLong_FromLong(self->open_bus);
+}
+
+int Cpu_set_open_bus(Cpu *self, PyObject *value, void *) {
+    const long number = value ? PyLong_AsLong(value) : -1;
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    if (number < 0 || number > 0xff) {
+        PyErr_SetString(PyExc_ValueError, "open_bus must be 0 to 255");
+        return -1;
+    }
+    self->open_bus = number;
+    return 0;
+}
+
+PyObject *execute_batch(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = {"cpus", "cycles", "threads", nullptr};
+    PyObject *sequence;
+    PyObject *limit = nullptr;
+    unsigned int threads = 0;
+    uint64_t cycles;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OI:execute_batch",
+                                     const_cast<char **>(keywords), &sequence,
+                                     &limit, &threads) ||
+        !parseCycles(limit, cycles)) {
+        return nullptr;
+    }
+
+    PyObject *fast = PySequence_Fast(sequence, "cpus must be a sequence");
+    if (!fast) {
+        return nullptr;
+    }
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+    std::vector<Cpu *> cpus(count);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        if (!PyObject_TypeCheck(item, &Intel8080Type)) {
+            Py_DECREF(fast);
+            PyErr_SetString(PyExc_TypeError, "cpus must be Intel8080s");
+            return nullptr;
+        }
+        cpus[i] = reinterpret_cast<Cpu *>(item);
+    }
+    // a CPU can only run on one thread
+    std::vector<Cpu *> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+    const bool unique =
+        std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end();
+    const bool idle = std::none_of(cpus.begin(), cpus.end(),
+                                   [](Cpu *cpu) { return cpu->running; });
+    if (!unique || !idle) {
+        Py_DECREF(fast);
+        PyErr_SetString(PyExc_RuntimeError,
+                        unique ? "a CPU is already running"
+                               : "a CPU appears more than once");
+        return nullptr;
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<std::size_t>(threads, std::max<Py_ssize_t>(count, 1));
+    for (Cpu *cpu : cpus) {
+        cpu->running = true;
+    }
+
+    // the fast sequence keeps the CPUs alive while the GIL is released
+    std::vector<uint64_t> executed(count);
+    std::atomic<std::size_t> next = 0;
+    Py_BEGIN_ALLOW_THREADS
+    const auto work = [&] {
+        for (std::size_t i = next++; i < cpus.size(); i = next++) {
+            executed[i] = emu8080_run(cpus[i]->cpu, cycles);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    Py_END_ALLOW_THREADS
+
+    // raise the first failure, dropping the others
+    bool raised = false;
+    for (Cpu *cpu : cpus) {
+        cpu->running = false;
+        if (raised && cpu->failed) {
+            PyObject *type, *value, *traceback;
+            PyErr_Fetch(&type, &value, &traceback);
+            raiseFailure(cpu);
+            PyErr_Clear();
+            PyErr_Restore(type, value, traceback);
+        } else {
+            raised |= raiseFailure(cpu);
+        }
+    }
+    Py_DECREF(fast);
+    if (raised) {
+        return nullptr;
+    }
+
+    PyObject *result = PyList_New(count);
+    for (Py_ssize_t i = 0; result && i < count; ++i) {
+        PyList_SET_ITEM(result, i, PyLong_FromUnsignedLongLong(executed[i]));
+    }
+    return result;
+}
+
+#define REGISTER(name, reg, doc)                                             \
+    {                                                                        \
+        name, reinterpret_cast<getter>(Cpu_get_register),                    \
+            reinterpret_cast<setter>(Cpu_set_register), doc,                 \
+            reinterpret_cast<void *>(reg)                                    \
+    }
+
+PyGetSetDef Cpu_getset[] = {
+    REGISTER("a", EMU8080_REG_A, "The accumulator"),
+    REGISTER("b", EMU8080_REG_B, nullptr),
+    REGISTER("c", EMU8080_REG_C, nullptr),
+    REGISTER("d", EMU8080_REG_D, nullptr),
+    REGISTER("e", EMU8080_REG_E, nullptr),
+    REGISTER("h", EMU8080_REG_H, nullptr),
+    REGISTER("l", EMU8080_REG_L, nullptr),
+    REGISTER("flags", EMU8080_REG_FLAGS, "The flags as PUSH PSW stores them"),
+    REGISTER("bc", EMU8080_REG_BC, nullptr),
+    REGISTER("de", EMU8080_REG_DE, nullptr),
+    REGISTER("hl", EMU8080_REG_HL, nullptr),
+    REGISTER("psw", EMU8080_REG_PSW, nullptr),
+    REGISTER("sp", EMU8080_REG_SP, "The stack pointer"),
+    REGISTER("pc", EMU8080_REG_PC, "The program counter"),
+    REGISTER("halted", EMU8080_REG_HALTED, nullptr),
+    REGISTER("interrupts_enabled", EMU8080_REG_INTERRUPTS_ENABLED, nullptr),
+    {"memory", reinterpret_cast<getter>(Cpu_get_memory), nullptr,
+     "Writable view of the 64 KB of memory, shared with the CPU", nullptr},
+    {"open_bus", reinterpret_cast<getter>(Cpu_get_open_bus),
+     reinterpret_cast<setter>(Cpu_set_open_bus),
+     "The byte IN reads from ports without a hook", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+#undef REGISTER
+
+PyMethodDef Cpu_methods[] = {
+    {"execute", reinterpret_cast<PyCFunction>(Cpu_execute), METH_VARARGS,
+     "execute(cycles=None)\n--\n\n"
+     "Execute until the CPU halts or has run at least cycles, returning "
+     "the cycles executed"},
+    {"reset", reinterpret_cast<PyCFunction>(Cpu_reset), METH_NOARGS,
+     "Unhalt, enable interrupts and set PC and SP to 0"},
+    {"interrupt", reinterpret_cast<PyCFunction>(Cpu_interrupt), METH_VARARGS,
+     "interrupt(isr)\n--\n\n"
+     "Call restart routine isr if interrupts are enabled, returning "
+     "whether it was taken"},
+    {"load", reinterpret_cast<PyCFunction>(Cpu_load), METH_VARARGS,
+     "load(address, data)\n--\n\nCopy bytes into memory"},
+    {"hook_in", reinterpret_cast<PyCFunction>(Cpu_hook_in), METH_VARARGS,
+     "hook_in(port, hook)\n--\n\n"
+     "Call hook(port) for IN on the port, or every port when port is "
+     "None, and load the int it returns. None removes the hook."},
+    {"hook_out", reinterpret_cast<PyCFunction>(Cpu_hook_out), METH_VARARGS,
+     "hook_out(port, hook)\n--\n\n"
+     "Call hook(port, value) for OUT on the port, or every port when port "
+     "is None. None removes the hook."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyBufferProcs Cpu_buffer = {
+    reinterpret_cast<getbufferproc>(Cpu_getbuffer),
+    nullptr,
+};
+
+PyTypeObject Intel8080Type = {
+    .ob_base = PyVarObject_HEAD_INIT(nullptr, 0)
+    .tp_name = "emu8080.Intel8080",
+    .tp_basicsize = sizeof(Cpu),
+    .tp_dealloc = reinterpret_cast<destructor>(Cpu_dealloc),
+    .tp_as_buffer = &Cpu_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "Intel 8080 with 64 KB of memory",
+    .tp_traverse = reinterpret_cast<traverseproc>(Cpu_traverse),
+    .tp_clear = reinterpret_cast<inquiry>(Cpu_clear),
+    .tp_methods = Cpu_methods,
+    .tp_getset = Cpu_getset,
+    .tp_new = Cpu_new,
+};
+
+PyTypeObject Intel8085Type = {
+    .ob_base = PyVarObject_HEAD_INIT(nullptr, 0)
+    .tp_name = "emu8080.Intel8085",
+    .tp_basicsize = sizeof(Cpu),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "Intel 8085 with 64 KB of memory",
+    .tp_traverse = reinterpret_cast<traverseproc>(Cpu_traverse),
+    .tp_clear = reinterpret_cast<inquiry>(Cpu_clear),
+    .tp_base = &Intel8080Type,
+    .tp_new = Cpu_new,
+};
+
+PyMethodDef module_methods[] = {
+    // through void (*)() as CPython expects for METH_KEYWORDS
+    {"execute_batch",
+     reinterpret_cast<PyCFunction>(
+         reinterpret_cast<void (*)()>(execute_batch)),
+     METH_VARARGS | METH_KEYWORDS,
+     "execute_batch(cpus, cycles=None, threads=0)\n--\n\n"
+     "Execute each CPU until it halts or has run at least cycles, on up "
+     "to threads threads (0 for one per core) without the GIL, returning "
+     "the cycles each executed"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef module = {
+    .m_base = PyModuleDef_HEAD_INIT,
+    .m_name = "emu8080",
+    .m_doc = "Intel 8080 and 8085 emulator",
+    .m_size = -1,
+    .m_methods = module_methods,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_emu8080() {
+    if (PyType_Ready(&Intel8080Type) < 0 || PyType_Ready(&Intel8085Type) < 0) {
+        return nullptr;
+    }
+    PyObject *result = PyModule_Create(&module);
+    if (!result) {
+        return nullptr;
+    }
+    if (PyModule_AddObjectRef(result, "Intel8080",
+                              reinterpret_cast<PyObject *>(&Intel8080Type)) <
+            0 ||
+        PyModule_AddObjectRef(result, "Intel8085",
+                              reinterpret_cast<PyObject *>(&Intel8085Type)) <
+            0) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    return result;
+}
@@ -0,0 +1,299 @@
+#include "altair.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 88-DCDD status flags
+constexpr uint8_t write_ready = 0x01;
+constexpr uint8_t head_movable = 0x02;
+constexpr uint8_t head_loaded = 0x04;
+constexpr uint8_t drive_enabled = 0x08;
+constexpr uint8_t interrupts_on = 0x20;
+constexpr uint8_t track_zero = 0x40;
+constexpr uint8_t read_ready = 0x80;
+
+// 88-DCDD control bits
+constexpr uint8_t step_in = 0x01;
+constexpr uint8_t step_out = 0x02;
+constexpr uint8_t load_head = 0x04;
+constexpr uint8_t unload_head = 0x08;
+constexpr uint8_t enable_interrupts = 0x10;
+constexpr uint8_t disable_interrupts = 0x20;
+constexpr uint8_t enable_write = 0x80;
+
+// 2SIO status bits
+constexpr uint8_t receive_full = 0x01;
+constexpr uint8_t transmit_empty = 0x02;
+
+// layout of a sector on the boot tracks
+constexpr std::size_t boot_size = 1;
+constexpr std::size_t boot_data = 3;
+constexpr std::size_t boot_stop = 131;
+constexpr std::size_t boot_checksum = 132;
+
+} // namespace
+
+Altair8800::Altair8800() {
+    cpu.memory.fill(0);
+    cpu.in = [this](uint8_t port) { return in(port); };
+    cpu.out = [this](uint8_t port, uint8_t value) { out(port, value); };
+}
+
+Altair8800::~Altair8800() {
+    for (std::size_t drive = 0; drive < drive_count; ++drive) {
+        unmount(drive);
+    }
+}
+
+bool Altair8800::mount(const std::size_t drive, const std::string &path,
+                       const bool read_only) {
+    if (drive >= drive_count) {
+        return false;
+    }
+    unmount(drive);
+
+    bool writable = !read_only;
+    int file = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (file < 0 && writable) {
+        writable = false;
+        file = open(path.c_str(), O_RDONLY);
+    }
+    if (file < 0) {
+        return false;
+    }
+    struct stat status;
+    const std::size_t track_size = sectors * sector_size;
+    if (fstat(file, &status) != 0 || status.st_size == 0 ||
+        status.st_size % track_size != 0) {
+        close(file);
+        return false;
+    }
+    const std::size_t size = status.st_size;
+    const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *mapping = mmap(nullptr, size, protection, MAP_SHARED, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    Drive &mounted = drives[drive];
+    mounted = Drive();
+    mounted.image = static_cast<uint8_t *>(mapping);
+    mounted.size = size;
+    mounted.tracks = size / track_size;
+    mounted.writable = writable;
+    return true;
+}
+
+void Altair8800::unmount(const std::size_t drive) {
+    if (drive >= drive_count || !drives[drive].image) {
+        return;
+    }
+    Drive &mounted = drives[drive];
+    if (mounted.writable) {
+        msync(mounted.image, mounted.size, MS_SYNC);
+    }
+    munmap(mounted.image, mounted.size);
+    mounted = Drive();
+    if (selected == drive) {
+        selected = drive_count;
+    }
+}
+
+bool Altair8800::loadBootRom(const std::string &path) {
+    std::ifstream rom(path, std::ios::in | std::ios::binary);
+    if (rom.fail()) {
+        return false;
+    }
+    rom.read(reinterpret_cast<char *>(&cpu.memory[boot_rom]),
+             cpu.memory.size() - boot_rom);
+    cpu.reset();
+    cpu.program_counter = boot_rom;
+    return true;
+}
+
+bool Altair8800::boot() {
+    const Drive &drive = drives[0];
+    if (!drive.image) {
+        return false;
+    }
+
+    // the first sector holds the length of the code to load at 0, which
+    // is read from the sectors of each track in a 2:1 interleave
+    const std::size_t length =
+        drive.image[boot_size] | drive.image[boot_size + 1] << 8;
+    std::size_t loaded = 0;
+    for (std::size_t track = 0; track < drive.tracks && loaded < length;
+         ++track) {
+        for (std::size_t i = 0; i < sectors && loaded < length; ++i) {
+            const std::size_t sector =
+                i < sectors / 2 ? 2 * i : 2 * (i - sectors / 2) + 1;
+            const uint8_t *data =
+                drive.image + (track * sectors + sector) * sector_size;
+            uint8_t checksum = 0;
+            for (std::size_t j = boot_data; j < boot_stop; ++j) {
+                checksum += data[j];
+            }
+            if (data[boot_stop] != 0xff || data[boot_checksum] != checksum) {
+                return false;
+            }
+            std::copy(data + boot_data, data + boot_stop,
+                      cpu.memory.begin() + loaded);
+            loaded += boot_stop - boot_data;
+        }
+    }
+
+    cpu.reset();
+    return true;
+}
+
+void Altair8800::type(const std::string &text) {
+    input.insert(input.end(), text.begin(), text.end());
+}
+
+uint8_t Altair8800::in(const uint8_t port) {
+    switch (port) {
+    case 0x08:
+        return diskStatus();
+    case 0x09:
+        return sectorPosition();
+    case 0x0a:
+        return readData();
+    case 0x10:
+        return transmit_empty | (input.empty() ? 0 : receive_full);
+    case 0x11: {
+        if (input.empty()) {
+            return 0;
+        }
+        const uint8_t byte = input.front();
+        input.pop_front();
+        return byte;
+    }
+    case 0x12:
+        return transmit_empty;
+    case 0xff:
+        return sense_switches;
+    default:
+        return 0;
+    }
+}
+
+void Altair8800::out(const uint8_t port, const uint8_t value) {
+    switch (port) {
+    case 0x08:
+        selectDrive(value);
+        break;
+    case 0x09:
+        controlDisk(value);
+        break;
+    case 0x0a:
+        writeData(value);
+        break;
+    case 0x11:
+        if (output) {
+            output(value);
+        }
+        break;
+    }
+}
+
+uint8_t Altair8800::diskStatus() const {
+    if (selected == drive_count) {
+        return 0xff;
+    }
+    return ~drives[selected].flags;
+}
+
+uint8_t Altair8800::sectorPosition() {
+    if (selected == drive_count || !(drives[selected].flags & head_loaded)) {
+        return 0xff;
+    }
+    // the disk turns a sector between reads, and each read comes at the
+    // start of the sector, with the sector true bit low
+    Drive &drive = drives[selected];
+    drive.sector = (drive.sector + 1) % sectors;
+    drive.byte = 0;
+    return 0xc0 | drive.sector << 1;
+}
+
+uint8_t Altair8800::readData() {
+    if (selected == drive_count) {
+        return 0;
+    }
+    Drive &drive = drives[selected];
+    if (drive.byte >= sector_size) {
+        drive.byte = 0;
+    }
+    const std::size_t offset =
+        (drive.track * sectors + drive.sector) * sector_size;
+    return drive.image[offset + drive.byte++];
+}
+
+void Altair8800::selectDrive(const uint8_t value) {
+    const std::size_t drive = value & 0x0f;
+    if ((value & 0x80) || !drives[drive].image) {
+        selected = drive_count;
+        return;
+    }
+    selected = drive;
+    Drive &enabled = drives[drive];
+    enabled.flags = head_movable | drive_enabled |
+                    (enabled.track == 0 ? track_zero : 0);
+}
+
+void Altair8800::controlDisk(const uint8_t value) {
+    if (selected == drive_count) {
+        return;
+    }
+    Drive &drive = drives[selected];
+    if ((value & step_in) && drive.track + 1 < drive.tracks) {
+        ++drive.track;
+        drive.byte = sector_size;
+    }
+    if ((value & step_out) && drive.track > 0) {
+        --drive.track;
+        drive.byte = sector_size;
+    }
+    drive.flags = drive.track == 0 ? drive.flags | track_zero
+                                   : drive.flags & ~track_zero;
+    if (value & load_head) {
+        drive.flags |= head_loaded | read_ready;
+    }
+    if (value & unload_head) {
+        drive.flags &= ~(head_loaded | read_ready);
+    }
+    if (value & enable_interrupts) {
+        drive.flags |= interrupts_on;
+    }
+    if (value & disable_interrupts) {
+        drive.flags &= ~interrupts_on;
+    }
+    if (value & enable_write) {
+        drive.byte = 0;
+        drive.flags |= write_ready;
+    }
+}
+
+void Altair8800::writeData(const uint8_t value) {
+    if (selected == drive_count) {
+        return;
+    }
+    Drive &drive = drives[selected];
+    if (!(drive.flags & write_ready) || drive.byte >= sector_size) {
+        return;
+    }
+    const std::size_t offset =
+        (drive.track * sectors + drive.sector) * sector_size;
+    if (drive.writable) {
+        drive.image[offset + drive.byte] = value;
+    }
+    if (++drive.byte == sector_size) {
+        drive.flags &= ~write_ready;
+    }
+}
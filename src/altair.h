@@ -0,0 +1,121 @@
+#ifndef INTEL_8080_ALTAIR_H
+#define INTEL_8080_ALTAIR_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "cpu.h"
+
+/**
+ * MITS Altair 8800 with 64 KB of RAM, an 88-2SIO serial board for the
+ * console and an 88-DCDD floppy disk controller.
+ *
+ * Disk images use the usual Altair layout of 77 tracks of 32 sectors of
+ * 137 bytes, as on altairclone.com, and are mapped into memory: the
+ * controller's data port reads and writes the mapped image directly, so
+ * sector transfers involve no buffers or copies.
+ *
+ * Ports:
+ *     0x08 - Disk drive select (OUT) and status (IN, active low)
+ *     0x09 - Disk control (OUT) and sector position (IN)
+ *     0x0a - Disk data
+ *     0x10 - 2SIO port A status (IN) and control (OUT), the console
+ *     0x11 - 2SIO port A data
+ *     0x12 - 2SIO port B status and control, no device attached
+ *     0x13 - 2SIO port B data
+ *     0xff - Front panel sense switches
+ */
+class Altair8800 {
+  public:
+    static constexpr std::size_t drive_count = 16;
+    static constexpr std::size_t tracks = 77;
+    static constexpr std::size_t sectors = 32;
+    static constexpr std::size_t sector_size = 137;
+    static constexpr std::size_t disk_size = tracks * sectors * sector_size;
+
+    // where the disk boot loader PROM is mapped
+    static constexpr uint16_t boot_rom = 0xff00;
+
+    Intel8080 cpu;
+
+    // Called with each byte the CPU sends to the console
+    std::function<void(uint8_t)> output;
+
+    // The front panel sense switches, read on port 0xff
+    uint8_t sense_switches = 0x00;
+
+    Altair8800();
+    Altair8800(const Altair8800 &) = delete;
+    Altair8800 &operator=(const Altair8800 &) = delete;
+
+    /**
+     * Unmounts all disks, writing back their changes
+     */
+    ~Altair8800();
+
+    /**
+     * Map a disk image into a drive. Writes by the CPU go to the file
+     * unless it is mounted read only or cannot be opened for writing.
+     * Returns: False when the image cannot be mapped or is not a whole
+     *          number of tracks
+     */
+    bool mount(const std::size_t drive, const std::string &path,
+               const bool read_only = false);
+    void unmount(const std::size_t drive);
+
+    /**
+     * Load a disk boot loader PROM image at boot_rom and start the CPU
+     * there
+     * Returns: False when the file cannot be read
+     */
+    bool loadBootRom(const std::string &path);
+
+    /**
+     * Boot from drive 0 without a PROM, loading the boot tracks as the
+     * MITS disk boot loader does and starting the CPU at 0
+     * Returns: False when drive 0 is empty or a sector fails its
+     *          checksum
+     */
+    bool boot();
+
+    /**
+     * Queue bytes typed on the console
+     */
+    void type(const std::string &text);
+
+  private:
+    struct Drive {
+        uint8_t *image = nullptr;
+        std::size_t size = 0;
+        std::size_t tracks = 0;
+        bool writable = false;
+
+        std::size_t track = 0;
+        std::size_t sector = 0;
+        // the next byte of the sector to transfer
+        std::size_t byte = sector_size;
+        // status flags, active high here and inverted on the port
+        uint8_t flags = 0;
+    };
+
+    std::array<Drive, drive_count> drives;
+    // the selected drive, drive_count when none is
+    std::size_t selected = drive_count;
+
+    std::deque<uint8_t> input;
+
+    uint8_t in(const uint8_t port);
+    void out(const uint8_t port, const uint8_t value);
+
+    uint8_t diskStatus() const;
+    uint8_t sectorPosition();
+    uint8_t readData();
+    void selectDrive(const uint8_t value);
+    void controlDisk(const uint8_t value);
+    void writeData(const uint8_t value);
+};
+
+#endif
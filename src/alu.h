@@ -0,0 +1,218 @@
+#ifndef INTEL_8080_ALU_H
+#define INTEL_8080_ALU_H
+
+#include <cstdint>
+
+#include "i8085.h"
+#include "variant.h"
+
+/**
+ * Flag and arithmetic semantics of the instruction set, shared by the
+ * interpreter and by recompiled code. Variant selects the 8085 behaviour:
+ * the V and K flags and the auxiliary carry of AND.
+ */
+namespace alu {
+
+inline void updateZSP(Intel8080 &cpu, const uint8_t result) {
+    cpu.flag_S = result & 0x80;
+    cpu.flag_Z = result == 0;
+    cpu.flag_P = (0x9669 >> ((result ^ (result >> 4)) & 0x0f)) & 1;
+}
+
+template <class Variant = variant::Intel8080>
+void updateOverflow(Intel8080 &cpu, const bool overflow) {
+    if constexpr (Variant::is_8085) {
+        Intel8085 &cpu_8085 = static_cast<Intel8085 &>(cpu);
+        cpu_8085.flag_V = overflow;
+        cpu_8085.flag_K = cpu.flag_S ^ overflow;
+    }
+}
+
+// pack the flags into the low byte of PSW
+template <class Variant = variant::Intel8080> void storeFlags(Intel8080 &cpu) {
+    uint8_t flags = 0x02;
+    flags |= cpu.flag_S << 7;
+    flags |= cpu.flag_Z << 6;
+    flags |= cpu.flag_A << 4;
+    flags |= cpu.flag_P << 2;
+    flags |= cpu.flag_C;
+    if constexpr (Variant::is_8085) {
+        const Intel8085 &cpu_8085 = static_cast<Intel8085 &>(cpu);
+        flags = (flags & ~0x02) | cpu_8085.flag_K << 5 | cpu_8085.flag_V << 1;
+    }
+    cpu.flags = flags;
+}
+
+// unpack the flags from the low byte of PSW
+template <class Variant = variant::Intel8080> void loadFlags(Intel8080 &cpu) {
+    cpu.flag_S = cpu.flags & 0x80;
+    cpu.flag_Z = cpu.flags & 0x40;
+    cpu.flag_A = cpu.flags & 0x10;
+    cpu.flag_P = cpu.flags & 0x04;
+    cpu.flag_C = cpu.flags & 0x01;
+    if constexpr (Variant::is_8085) {
+        Intel8085 &cpu_8085 = static_cast<Intel8085 &>(cpu);
+        cpu_8085.flag_K = cpu.flags & 0x20;
+        cpu_8085.flag_V = cpu.flags & 0x02;
+    }
+}
+
+// register increment and decrement
+template <class Variant = variant::Intel8080>
+uint8_t inr(Intel8080 &cpu, uint8_t value) {
+    value += 1;
+    updateZSP(cpu, value);
+    cpu.flag_A = (value & 0xf) == 0;
+    updateOverflow<Variant>(cpu, value == 0x80);
+    return value;
+}
+
+template <class Variant = variant::Intel8080>
+uint8_t dcr(Intel8080 &cpu, uint8_t value) {
+    value -= 1;
+    updateZSP(cpu, value);
+    cpu.flag_A = (value & 0xf) != 0xf;
+    updateOverflow<Variant>(cpu, value == 0x7f);
+    return value;
+}
+
+template <class Variant = variant::Intel8080>
+uint16_t inx(Intel8080 &cpu, const uint16_t value) {
+    const uint16_t result = value + 1;
+    if constexpr (Variant::is_8085) {
+        static_cast<Intel8085 &>(cpu).flag_K = result == 0x0000;
+    }
+    return result;
+}
+
+template <class Variant = variant::Intel8080>
+uint16_t dcx(Intel8080 &cpu, const uint16_t value) {
+    const uint16_t result = value - 1;
+    if constexpr (Variant::is_8085) {
+        static_cast<Intel8085 &>(cpu).flag_K = result == 0xffff;
+    }
+    return result;
+}
+
+// 8-bit arithmetic
+template <class Variant = variant::Intel8080>
+void add(Intel8080 &cpu, const uint8_t value) {
+    const uint16_t result = cpu.register_A + value;
+    updateZSP(cpu, result);
+    cpu.flag_A = (result ^ cpu.register_A ^ value) & 0x10;
+    cpu.flag_C = result > 0xff;
+    updateOverflow<Variant>(cpu, ~(cpu.register_A ^ value) &
+                                     (cpu.register_A ^ result) & 0x80);
+    cpu.register_A = result;
+}
+
+template <class Variant = variant::Intel8080>
+void adc(Intel8080 &cpu, const uint8_t value) {
+    const uint16_t result = cpu.register_A + value + cpu.flag_C;
+    updateZSP(cpu, result);
+    cpu.flag_A = (result ^ cpu.register_A ^ value) & 0x10;
+    cpu.flag_C = result > 0xff;
+    updateOverflow<Variant>(cpu, ~(cpu.register_A ^ value) &
+                                     (cpu.register_A ^ result) & 0x80);
+    cpu.register_A = result;
+}
+
+template <class Variant = variant::Intel8080>
+void sub(Intel8080 &cpu, const uint8_t value) {
+    const uint16_t result = cpu.register_A - value;
+    updateZSP(cpu, result);
+    cpu.flag_A = ~(result ^ cpu.register_A ^ value) & 0x10;
+    cpu.flag_C = result > 0xff;
+    updateOverflow<Variant>(cpu, (cpu.register_A ^ value) &
+                                     (cpu.register_A ^ result) & 0x80);
+    cpu.register_A = result;
+}
+
+template <class Variant = variant::Intel8080>
+void sbb(Intel8080 &cpu, const uint8_t value) {
+    const uint16_t result = cpu.register_A - value - cpu.flag_C;
+    updateZSP(cpu, result);
+    cpu.flag_A = ~(result ^ cpu.register_A ^ value) & 0x10;
+    cpu.flag_C = result > 0xff;
+    updateOverflow<Variant>(cpu, (cpu.register_A ^ value) &
+                                     (cpu.register_A ^ result) & 0x80);
+    cpu.register_A = result;
+}
+
+template <class Variant = variant::Intel8080>
+void ana(Intel8080 &cpu, const uint8_t value) {
+    // the 8085 always sets the auxiliary carry for AND
+    cpu.flag_A = Variant::is_8085 || ((cpu.register_A | value) & 0x08);
+    cpu.flag_C = false;
+    cpu.register_A &= value;
+    updateZSP(cpu, cpu.register_A);
+}
+
+inline void xra(Intel8080 &cpu, const uint8_t value) {
+    cpu.flag_A = false;
+    cpu.flag_C = false;
+    cpu.register_A ^= value;
+    updateZSP(cpu, cpu.register_A);
+}
+
+inline void ora(Intel8080 &cpu, const uint8_t value) {
+    cpu.flag_A = false;
+    cpu.flag_C = false;
+    cpu.register_A |= value;
+    updateZSP(cpu, cpu.register_A);
+}
+
+template <class Variant = variant::Intel8080>
+void cmp(Intel8080 &cpu, const uint8_t value) {
+    const uint16_t result = cpu.register_A - value;
+    updateZSP(cpu, result);
+    cpu.flag_A = ~(result ^ cpu.register_A ^ value) & 0x10;
+    cpu.flag_C = result > 0xff;
+    updateOverflow<Variant>(cpu, (cpu.register_A ^ value) &
+                                     (cpu.register_A ^ result) & 0x80);
+}
+
+inline void daa(Intel8080 &cpu) {
+    if (cpu.flag_C || cpu.register_A > 0x99) {
+        cpu.flag_C = true;
+        cpu.register_A += 0x60;
+    }
+    if (cpu.flag_A || (cpu.register_A & 0xf) > 0x9) {
+        cpu.flag_A = (cpu.register_A & 0xf) > 0x9;
+        cpu.register_A += 0x06;
+    }
+    updateZSP(cpu, cpu.register_A);
+}
+
+// 16-bit arithmetic
+inline void dad(Intel8080 &cpu, const uint16_t value) {
+    cpu.register_HL += value;
+    cpu.flag_C = cpu.register_HL < value;
+}
+
+// accumulator rotates
+inline void rlc(Intel8080 &cpu) {
+    cpu.flag_C = (cpu.register_A & 0x80) == 0x80;
+    cpu.register_A = (cpu.register_A << 1) | cpu.flag_C;
+}
+
+inline void rrc(Intel8080 &cpu) {
+    cpu.flag_C = (cpu.register_A & 0x01) == 0x01;
+    cpu.register_A = (cpu.register_A >> 1) | (cpu.flag_C << 7);
+}
+
+inline void ral(Intel8080 &cpu) {
+    const uint16_t result = cpu.register_A << 1;
+    cpu.register_A = result | cpu.flag_C;
+    cpu.flag_C = (result & 0x100) == 0x100;
+}
+
+inline void rar(Intel8080 &cpu) {
+    const uint16_t result = cpu.register_A | (cpu.flag_C << 8);
+    cpu.register_A = result >> 1;
+    cpu.flag_C = (result & 0x01) == 0x01;
+}
+
+} // namespace alu
+
+#endif
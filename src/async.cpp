@@ -0,0 +1,119 @@
+#include "async.h"
+
+#include <utility>
+
+AsyncIntel8080::Execution
+AsyncIntel8080::Execution::promise_type::get_return_object() {
+    return Execution(
+        std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+AsyncIntel8080::Execution::Execution(Execution &&other) noexcept
+    : handle(std::exchange(other.handle, nullptr)) {}
+
+AsyncIntel8080::Execution &
+AsyncIntel8080::Execution::operator=(Execution &&other) noexcept {
+    if (this != &other) {
+        if (handle) {
+            handle.destroy();
+        }
+        handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+}
+
+AsyncIntel8080::Execution::~Execution() {
+    if (handle) {
+        handle.destroy();
+    }
+}
+
+std::coroutine_handle<>
+AsyncIntel8080::Execution::await_suspend(std::coroutine_handle<> awaiting) {
+    handle.promise().continuation = awaiting;
+    return handle;
+}
+
+void AsyncIntel8080::Execution::start() {
+    if (handle && !handle.done()) {
+        handle.resume();
+    }
+}
+
+AsyncIntel8080::AsyncIntel8080(Intel8080 &cpu,
+                               std::size_t (*step)(Intel8080 &))
+    : cpu(cpu), step(step), previous_in(std::move(cpu.in)) {
+    // the byte is unknown until the host completes the read, so IN only
+    // records the port here and the accumulator is written on resume
+    cpu.in = [this](uint8_t port) {
+        input_port = port;
+        input_requested_by_step = true;
+        return this->cpu.register_A;
+    };
+}
+
+AsyncIntel8080::~AsyncIntel8080() { cpu.in = std::move(previous_in); }
+
+AsyncIntel8080::Execution AsyncIntel8080::execute() {
+    std::size_t cycles = 0;
+    while (const std::size_t ran = step(cpu)) {
+        cycles += ran;
+        if (input_requested_by_step) {
+            input_requested_by_step = false;
+            cpu.register_A = co_await InputAwaiter{*this};
+        }
+    }
+    co_return cycles;
+}
+
+AsyncIntel8080::Execution
+AsyncIntel8080::execute(std::size_t target_cycles) {
+    std::size_t cycles = 0;
+    while (cycles < target_cycles) {
+        const std::size_t ran = step(cpu);
+        if (!ran) {
+            break;
+        }
+        cycles += ran;
+        if (input_requested_by_step) {
+            input_requested_by_step = false;
+            cpu.register_A = co_await InputAwaiter{*this};
+        }
+    }
+    co_return cycles;
+}
+
+void AsyncIntel8080::completeInput(const uint8_t value) {
+    input_value = value;
+
+    // before the execution suspends, it continues with the value itself
+    State expected = State::requested;
+    if (input_state.compare_exchange_strong(expected, State::ready)) {
+        return;
+    }
+    expected = State::waiting;
+    if (input_state.compare_exchange_strong(expected, State::idle)) {
+        waiting.resume();
+    }
+}
+
+bool AsyncIntel8080::InputAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+    AsyncIntel8080 &async = owner;
+    async.waiting = handle;
+    async.input_state = State::requested;
+    if (async.input_requested) {
+        async.input_requested(async.input_port);
+    }
+
+    // once waiting, another thread may resume the execution at any time,
+    // so nothing in the coroutine frame is touched after this
+    State expected = State::requested;
+    if (async.input_state.compare_exchange_strong(expected, State::waiting)) {
+        return true;
+    }
+
+    // the host answered first, continue without suspending
+    async.input_state = State::idle;
+    return false;
+}
@@ -0,0 +1,170 @@
+#ifndef INTEL_8080_ASYNC_H
+#define INTEL_8080_ASYNC_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+
+#include "cpu.h"
+
+/**
+ * Coroutine interface for running an Intel8080 or Intel8085 inside an
+ * event loop.
+ *
+ * An IN instruction suspends execution until the host supplies the byte
+ * with completeInput(), so a single host thread can drive many CPUs that
+ * are waiting on asynchronous I/O. Execution resumes on the thread that
+ * calls completeInput(), which may be any thread, even while the IN is
+ * still being suspended. The CPU's in callback is owned by this object
+ * while it exists and the previous one is put back when it is destroyed;
+ * out is left to the host.
+ */
+class AsyncIntel8080 {
+  public:
+    /**
+     * Awaitable result of execute(). Execution starts when the task is
+     * awaited or start() is called, and the awaiting coroutine resumes
+     * with the number of clock cycles executed.
+     */
+    class Execution {
+      public:
+        struct promise_type {
+            std::size_t cycles = 0;
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+
+            Execution get_return_object();
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            auto final_suspend() noexcept {
+                struct FinalAwaiter {
+                    bool await_ready() noexcept { return false; }
+                    std::coroutine_handle<>
+                    await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                        return handle.promise().continuation;
+                    }
+                    void await_resume() noexcept {}
+                };
+                return FinalAwaiter{};
+            }
+            void return_value(std::size_t value) { cycles = value; }
+            void unhandled_exception() { throw; }
+        };
+
+        Execution(Execution &&other) noexcept;
+        Execution &operator=(Execution &&other) noexcept;
+        ~Execution();
+
+        bool await_ready() const noexcept { return !handle || handle.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting);
+        std::size_t await_resume() const { return handle.promise().cycles; }
+
+        /**
+         * Begin execution without awaiting it. Runs on the calling thread
+         * until the CPU halts, reaches its target or waits for input.
+         */
+        void start();
+
+        /**
+         * Returns: True once the CPU has halted or reached its target
+         */
+        bool done() const { return !handle || handle.done(); }
+
+        /**
+         * Returns: The cycles executed, valid once done() is true
+         */
+        std::size_t cycles() const { return handle.promise().cycles; }
+
+      private:
+        explicit Execution(std::coroutine_handle<promise_type> handle)
+            : handle(handle) {}
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    Intel8080 &cpu;
+
+    /**
+     * Called when the CPU executes IN. The host starts its asynchronous
+     * read and calls completeInput() with the byte, either immediately or
+     * later from its event loop.
+     */
+    std::function<void(uint8_t port)> input_requested;
+
+    /**
+     * Parameters:
+     *     cpu - An Intel8080 or Intel8085, stepped as its own type
+     */
+    template <class CPU>
+    explicit AsyncIntel8080(CPU &cpu)
+        : AsyncIntel8080(cpu, [](Intel8080 &base) -> std::size_t {
+              CPU &cpu = static_cast<CPU &>(base);
+              // a halted 8085 still takes pending interrupts
+              return cpu.halted && !cpu.interruptPending() ? 0 : cpu.step();
+          }) {}
+    AsyncIntel8080(const AsyncIntel8080 &) = delete;
+    AsyncIntel8080 &operator=(const AsyncIntel8080 &) = delete;
+    ~AsyncIntel8080();
+
+    /**
+     * Execute until the CPU halts, suspending on each IN instruction. A
+     * halted 8085 runs while an interrupt is pending.
+     * Parameters:
+     *     cycles (optional) - The target cycles to execute
+     * Returns: An awaitable producing the number of clock cycles executed
+     */
+    Execution execute();
+    Execution execute(std::size_t target_cycles);
+
+    /**
+     * Supply the byte read by a pending IN instruction and resume the
+     * suspended execution on the calling thread. Input that comes before
+     * the execution has suspended is taken when it does, and input with no
+     * IN pending is dropped.
+     * Parameter:
+     *     value - The byte loaded into the accumulator
+     */
+    void completeInput(const uint8_t value);
+
+    /**
+     * Returns: True while execution is suspended waiting for input
+     */
+    bool waitingForInput() const { return input_state == State::waiting; }
+
+    /**
+     * Returns: The port of the pending or most recent IN instruction
+     */
+    uint8_t inputPort() const { return input_port; }
+
+  private:
+    // steps the CPU as its own type, 0 when it cannot run
+    std::size_t (*step)(Intel8080 &);
+
+    AsyncIntel8080(Intel8080 &cpu, std::size_t (*step)(Intel8080 &));
+
+    struct InputAwaiter {
+        AsyncIntel8080 &owner;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        uint8_t await_resume() const noexcept { return owner.input_value; }
+    };
+
+    // the read of an IN: requested from the host, then either waiting
+    // for completeInput() or ready because it came first; the executing
+    // and completing threads hand it over with compare-exchange
+    enum class State : uint8_t { idle, requested, waiting, ready };
+    std::atomic<State> input_state = State::idle;
+
+    // handle of the execution suspended on IN, valid while waiting
+    std::coroutine_handle<> waiting;
+
+    // the in callback replaced by this object
+    std::function<uint8_t(uint8_t)> previous_in;
+
+    // set by the in callback when the last step executed IN
+    bool input_requested_by_step = false;
+    uint8_t input_port = 0;
+    uint8_t input_value = 0;
+};
+
+#endif
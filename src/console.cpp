@@ -0,0 +1,124 @@
+#include "console.h"
+
+#include <chrono>
+
+namespace {
+
+// counters have a single writer, so a plain load and store suffices
+void increment(std::atomic<uint64_t> &counter, const uint64_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount,
+                  std::memory_order_relaxed);
+}
+
+} // namespace
+
+Console::Console(std::ostream &output)
+    : output(output), flusher(&Console::flushLoop, this) {}
+
+Console::~Console() {
+    running.store(false, std::memory_order_release);
+    flusher.join();
+}
+
+void Console::attach(Intel8080 &cpu, const uint8_t data_port,
+                     const uint8_t status_port) {
+    cpu.in = [this, data_port, status_port,
+              next = std::move(cpu.in)](uint8_t port) -> uint8_t {
+        if (port == data_port) {
+            uint8_t byte = 0;
+            read(byte);
+            return byte;
+        }
+        if (port == status_port) {
+            return status();
+        }
+        return next ? next(port) : 0;
+    };
+    cpu.out = [this, data_port,
+               next = std::move(cpu.out)](uint8_t port, uint8_t byte) {
+        if (port == data_port) {
+            write(byte);
+        } else if (next) {
+            next(port, byte);
+        }
+    };
+}
+
+void Console::write(const uint8_t byte) {
+    if (!output_queue.push(byte)) {
+        increment(output_stalls);
+        while (!output_queue.push(byte)) {
+            std::this_thread::yield();
+        }
+    }
+    increment(output_bytes);
+}
+
+bool Console::read(uint8_t &byte) {
+    if (!input_queue.pop(byte)) {
+        increment(input_underruns);
+        return false;
+    }
+    increment(input_bytes);
+    return true;
+}
+
+uint8_t Console::status() const {
+    uint8_t value = 0;
+    if (!input_queue.empty()) {
+        value |= input_ready;
+    }
+    if (!output_queue.full()) {
+        value |= output_ready;
+    }
+    return value;
+}
+
+std::size_t Console::type(const char *data, const std::size_t count) {
+    std::size_t queued = 0;
+    while (queued < count && input_queue.push(data[queued])) {
+        ++queued;
+    }
+    if (queued < count) {
+        increment(input_drops, count - queued);
+    }
+    return queued;
+}
+
+void Console::flush() {
+    while (output_written.load(std::memory_order_acquire) !=
+           output_bytes.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+Console::Counters Console::counters() const {
+    return {
+        output_bytes.load(std::memory_order_relaxed),
+        output_stalls.load(std::memory_order_relaxed),
+        flushes.load(std::memory_order_relaxed),
+        input_bytes.load(std::memory_order_relaxed),
+        input_underruns.load(std::memory_order_relaxed),
+        input_drops.load(std::memory_order_relaxed),
+    };
+}
+
+void Console::flushLoop() {
+    std::array<uint8_t, queue_size> batch;
+    for (;;) {
+        // read the flag first so output queued before shutdown is written
+        const bool stopping = !running.load(std::memory_order_acquire);
+        const std::size_t count = output_queue.pop(batch.data(), batch.size());
+
+        if (count > 0) {
+            output.write(reinterpret_cast<const char *>(batch.data()), count);
+            output.flush();
+            increment(flushes);
+            increment(output_written, count);
+        } else if (stopping) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
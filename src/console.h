@@ -0,0 +1,207 @@
+#ifndef INTEL_8080_CONSOLE_H
+#define INTEL_8080_CONSOLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "cpu.h"
+
+/**
+ * Lock-free single-producer/single-consumer byte queue.
+ * One thread may push and one other thread may pop concurrently.
+ */
+template <std::size_t Capacity> class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "ring capacity must be a power of two");
+
+  public:
+    /**
+     * Returns: False when the ring is full
+     */
+    bool push(const uint8_t byte) {
+        const std::size_t tail = write_index.load(std::memory_order_relaxed);
+        if (tail - cached_read_index == Capacity) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            if (tail - cached_read_index == Capacity) {
+                return false;
+            }
+        }
+        buffer[tail & (Capacity - 1)] = byte;
+        write_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns: False when the ring is empty
+     */
+    bool pop(uint8_t &byte) {
+        const std::size_t head = read_index.load(std::memory_order_relaxed);
+        if (head == cached_write_index) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            if (head == cached_write_index) {
+                return false;
+            }
+        }
+        byte = buffer[head & (Capacity - 1)];
+        read_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pop up to count bytes at once
+     * Returns: The number of bytes copied into data
+     */
+    std::size_t pop(uint8_t *data, const std::size_t count) {
+        const std::size_t head = read_index.load(std::memory_order_relaxed);
+        cached_write_index = write_index.load(std::memory_order_acquire);
+        std::size_t available = cached_write_index - head;
+        if (available > count) {
+            available = count;
+        }
+        for (std::size_t i = 0; i < available; ++i) {
+            data[i] = buffer[(head + i) & (Capacity - 1)];
+        }
+        read_index.store(head + available, std::memory_order_release);
+        return available;
+    }
+
+    /**
+     * Returns: True when there is no room to push, may be stale. Call it
+     *          from the producer thread.
+     */
+    bool full() const {
+        return write_index.load(std::memory_order_relaxed) -
+                   read_index.load(std::memory_order_acquire) ==
+               Capacity;
+    }
+
+    /**
+     * Returns: True when there is nothing to pop, may be stale
+     */
+    bool empty() const {
+        return read_index.load(std::memory_order_acquire) ==
+               write_index.load(std::memory_order_acquire);
+    }
+
+  private:
+    // consumer and producer state live on separate cache lines
+    alignas(64) std::atomic<std::size_t> read_index{0};
+    std::size_t cached_write_index = 0;
+    alignas(64) std::atomic<std::size_t> write_index{0};
+    std::size_t cached_read_index = 0;
+    alignas(64) std::array<uint8_t, Capacity> buffer;
+};
+
+/**
+ * Serial console device decoupling the emulation thread from host I/O.
+ *
+ * Bytes written by OUT are queued and written to the output stream in
+ * batches by a flusher thread. Bytes typed by the host are queued for IN.
+ * Ports:
+ *     data   - OUT queues a byte, IN reads the next typed byte (0 if none)
+ *     status - IN returns bit 0 set when input is ready and bit 1 set
+ *              when output can be queued
+ */
+class Console {
+  public:
+    static constexpr std::size_t queue_size = 4096;
+
+    // The status port bits
+    static constexpr uint8_t input_ready = 0x01;
+    static constexpr uint8_t output_ready = 0x02;
+
+    struct Counters {
+        uint64_t output_bytes;
+        // OUT found the output queue full and waited for the flusher
+        uint64_t output_stalls;
+        // batched writes made to the output stream
+        uint64_t flushes;
+        uint64_t input_bytes;
+        // IN on the data port with no typed byte available
+        uint64_t input_underruns;
+        // typed bytes dropped because the input queue was full
+        uint64_t input_drops;
+    };
+
+    explicit Console(std::ostream &output = std::cout);
+    Console(const Console &) = delete;
+    Console &operator=(const Console &) = delete;
+
+    /**
+     * Stops the flusher thread after writing all queued output
+     */
+    ~Console();
+
+    /**
+     * Connects the console to a CPU's I/O ports. Accesses to other ports
+     * are passed to the callbacks the CPU had before attaching.
+     * Parameters:
+     *     cpu - The CPU to attach to
+     *     data_port - Port for reading and writing characters
+     *     status_port - Port for reading the console status
+     */
+    void attach(Intel8080 &cpu, const uint8_t data_port = 0,
+                const uint8_t status_port = 1);
+
+    /**
+     * Queue a byte of output (emulation thread). Waits for the flusher
+     * when the queue is full instead of dropping output.
+     */
+    void write(const uint8_t byte);
+
+    /**
+     * Take the next typed byte (emulation thread)
+     * Returns: False when no input is available
+     */
+    bool read(uint8_t &byte);
+
+    /**
+     * Returns: The value of the status port (emulation thread)
+     */
+    uint8_t status() const;
+
+    /**
+     * Queue bytes of input for the CPU (host thread)
+     * Returns: The number of bytes queued, the rest are dropped
+     */
+    std::size_t type(const char *data, const std::size_t count);
+
+    /**
+     * Block until all queued output has been written to the stream
+     */
+    void flush();
+
+    /**
+     * Returns: The current counter values, readable from any thread
+     */
+    Counters counters() const;
+
+  private:
+    void flushLoop();
+
+    std::ostream &output;
+
+    SpscRing<queue_size> output_queue;
+    SpscRing<queue_size> input_queue;
+
+    // written by the emulation thread
+    alignas(64) std::atomic<uint64_t> output_bytes{0};
+    std::atomic<uint64_t> output_stalls{0};
+    std::atomic<uint64_t> input_bytes{0};
+    std::atomic<uint64_t> input_underruns{0};
+
+    // written by the flusher thread
+    alignas(64) std::atomic<uint64_t> flushes{0};
+    std::atomic<uint64_t> output_written{0};
+
+    // written by the host thread
+    alignas(64) std::atomic<uint64_t> input_drops{0};
+
+    std::atomic<bool> running{true};
+    std::thread flusher;
+};
+
+#endif
@@ -1,61 +1,121 @@
 #include "cpu.h"
+#include "alu.h"
+#include "i8085.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef EMU8080_HEATMAP
+#include "heatmap.h"
+#endif
+
+#ifdef EMU8080_STATS
+namespace {
+
+// counters have a single writer, so a relaxed load and store is enough
+// for concurrent readers and avoids a locked instruction
+inline void increment(uint64_t &counter, const uint64_t amount = 1) {
+    std::atomic_ref<uint64_t> value(counter);
+    value.store(value.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+inline uint64_t snapshot(const uint64_t &counter) {
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t &>(counter))
+        .load(std::memory_order_relaxed);
+}
+
+int64_t hostNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+#endif
 
 const std::array<uint16_t, 8> Intel8080::interrupt_vector = {
     0x0, 0x8, 0x10, 0x18, 0x20, 0x28, 0x30, 0x38
 };
 
-/**
- * Number of clock cycles needed to execute each instruction.
- * Special cases handled in conditional jmp, call, and ret
- */
-const std::array<std::size_t, 256> Intel8080::instruction_timing = {
-    4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,
-    4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,
-    4, 10, 16,  5,  5,  5,  7,  4,  4, 10, 16,  5,  5,  5,  7,  4,
-    4, 10, 13,  5, 10, 10, 10,  4,  4, 10, 13,  5,  5,  5,  7,  4,
-    5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
-    5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
-    5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
-    7,  7,  7,  7,  7,  7,  7,  7,  5,  5,  5,  5,  5,  5,  7,  5,
-    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
-    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
-    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
-    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
-    5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,
-    5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,
-    5, 10, 10, 18, 11, 11,  7, 11,  5,  5, 10,  5, 11, 17,  7, 11,
-    5, 10, 10,  4, 11, 11,  7, 11,  5,  5, 10,  4, 11, 17,  7, 11,
-};
+bool Intel8080::interrupt(const int isr) {
+    return interruptCall(interrupt_vector[isr]);
+}
 
-void Intel8080::interrupt(const int isr) {
+bool Intel8080::interruptCall(const uint16_t address) {
+    if (!interrupts_enabled) {
+        return false;
+    }
+    countInterrupt();
+    haltEnded();
+    halted = false;
+    interrupts_enabled = false;
     push(program_counter);
-    program_counter = interrupt_vector[isr];
+    program_counter = address;
+    recordEdge();
+    return true;
 }
 
 void Intel8080::reset() {
+    haltEnded();
     halted = false;
     interrupts_enabled = true;
     program_counter = 0x0000;
     stack_pointer = 0x0000;
 }
 
-std::size_t Intel8080::execute() {
-    std::size_t cycles = 0;
-    while (!halted)
-        cycles += step();
-    return cycles;
-}
+std::size_t Intel8080::execute() { return runUntil(UINT64_MAX); }
 
 std::size_t Intel8080::execute(std::size_t target_cycles) {
-    std::size_t cycles = 0;
-    while (!halted && cycles < target_cycles)
-        cycles += step();
-    return cycles;
+    return runUntil(deadlineAfter(target_cycles));
+}
+
+std::size_t Intel8080::runUntil(const uint64_t deadline) {
+    const uint64_t start = cycle_count;
+    if (beginRun(deadline)) {
+        while (!halted && cycle_count < runDeadline())
+            step();
+    }
+    endRun();
+    return cycle_count - start;
+}
+
+void Intel8080::requestExit() {
+    // the flag covers a run that has not started, the deadline ends one
+    // that has without another check per instruction
+    std::atomic_ref<bool>(exit_requested).store(true);
+    std::atomic_ref<uint64_t>(run_deadline).store(0);
+}
+
+bool Intel8080::beginRun(const uint64_t deadline) {
+    std::atomic_ref<uint64_t>(run_deadline).store(deadline);
+    return !std::atomic_ref<bool>(exit_requested).exchange(false);
 }
 
-std::size_t Intel8080::step() {
+void Intel8080::endRun() {
+    std::atomic_ref<bool>(exit_requested).store(false);
+    std::atomic_ref<uint64_t>(run_deadline).store(UINT64_MAX);
+}
+
+uint64_t Intel8080::runDeadline() const {
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t &>(run_deadline))
+        .load(std::memory_order_relaxed);
+}
+
+uint64_t Intel8080::deadlineAfter(const std::size_t target_cycles) const {
+    if (target_cycles >= UINT64_MAX - cycle_count) {
+        return UINT64_MAX;
+    }
+    return cycle_count + target_cycles;
+}
+
+std::size_t Intel8080::step() { return dispatch<variant::Intel8080>(); }
+
+template <class Variant> std::size_t Intel8080::dispatch() {
+    recordInstruction();
     const uint8_t instruction = memory[program_counter++];
-    std::size_t cycles = instruction_timing[instruction];
+    std::size_t cycles = Variant::instruction_timing[instruction];
 
     switch (instruction) {
     case 0x00: // NOP
@@ -64,105 +124,113 @@ std::size_t Intel8080::step() {
         register_BC = nextWord();
         break;
     case 0x02: // STAX B
-        memory[register_BC] = register_A;
+        writeByte(register_BC, register_A);
         break;
     case 0x03: // INX B
-        ++register_BC;
+        register_BC = alu::inx<Variant>(*this, register_BC);
         break;
     case 0x04: // INR B
-        register_B = inr(register_B);
+        register_B = alu::inr<Variant>(*this, register_B);
         break;
     case 0x05: // DCR B
-        register_B = dcr(register_B);
+        register_B = alu::dcr<Variant>(*this, register_B);
         break;
     case 0x06: // MVI B, d8
         register_B = nextByte();
         break;
     case 0x07: // RLC
-        flag_C = (register_A & 0x80) == 0x80;
-        register_A = (register_A << 1) | flag_C;
+        alu::rlc(*this);
         break;
 
-    case 0x08: // NOP
+    case 0x08: // NOP, DSUB on the 8085
+        if constexpr (Variant::is_8085) {
+            static_cast<Intel8085 &>(*this).dsub();
+        }
         break;
     case 0x09: // DAD B
-        dad(register_BC);
+        alu::dad(*this, register_BC);
         break;
     case 0x0a: // LDAX B
-        register_A = memory[register_BC];
+        register_A = readByte(register_BC);
         break;
     case 0x0b: // DCX B
-        --register_BC;
+        register_BC = alu::dcx<Variant>(*this, register_BC);
         break;
     case 0x0c: // INR C
-        register_C = inr(register_C);
+        register_C = alu::inr<Variant>(*this, register_C);
         break;
     case 0x0d: // DCR C
-        register_C = dcr(register_C);
+        register_C = alu::dcr<Variant>(*this, register_C);
         break;
     case 0x0e: // MVI C, d8
         register_C = nextByte();
         break;
     case 0x0f: // RRC
-        flag_C = (register_A & 0x01) == 0x01;
-        register_A = (register_A >> 1) | (flag_C << 7);
+        alu::rrc(*this);
         break;
 
-    case 0x10: // NOP
+    case 0x10: // NOP, ARHL on the 8085
+        if constexpr (Variant::is_8085) {
+            static_cast<Intel8085 &>(*this).arhl();
+        }
         break;
     case 0x11: // LXI D, d16
         register_DE = nextWord();
         break;
     case 0x12: // STAX D
-        memory[register_DE] = register_A;
+        writeByte(register_DE, register_A);
         break;
     case 0x13: // INX D
-        ++register_DE;
+        register_DE = alu::inx<Variant>(*this, register_DE);
         break;
     case 0x14: // INR D
-        register_D = inr(register_D);
+        register_D = alu::inr<Variant>(*this, register_D);
         break;
     case 0x15: // DCR D
-        register_D = dcr(register_D);
+        register_D = alu::dcr<Variant>(*this, register_D);
         break;
     case 0x16: // MVI D, d8
         register_D = nextByte();
         break;
     case 0x17: // RAL
-    {
-        uint16_t result = register_A << 1;
-        register_A = result | flag_C;
-        flag_C = (result & 0x100) == 0x100;
-    } break;
+        alu::ral(*this);
+        break;
 
-    case 0x18: // NOP
+    case 0x18: // NOP, RDEL on the 8085
+        if constexpr (Variant::is_8085) {
+            static_cast<Intel8085 &>(*this).rdel();
+        }
         break;
     case 0x19: // DAD D
-        dad(register_DE);
+        alu::dad(*this, register_DE);
         break;
     case 0x1a: // LDAX D
-        register_A = memory[register_DE];
+        if (std::size_t loop_cycles = blockTransfer<Variant>()) {
+            cycles = loop_cycles;
+            break;
+        }
+        register_A = readByte(register_DE);
         break;
     case 0x1b: // DCX D
-        --register_DE;
+        register_DE = alu::dcx<Variant>(*this, register_DE);
         break;
     case 0x1c: // INR E
-        register_E = inr(register_E);
+        register_E = alu::inr<Variant>(*this, register_E);
         break;
     case 0x1d: // DCR E
-        register_E = dcr(register_E);
+        register_E = alu::dcr<Variant>(*this, register_E);
         break;
     case 0x1e: // MVI E, d8
         register_E = nextByte();
         break;
     case 0x1f: // RAR
-    {
-        uint16_t result = register_A | (flag_C << 8);
-        register_A = (result >> 1);
-        flag_C = (result & 0x01) == 0x01;
-    } break;
+        alu::rar(*this);
+        break;
 
-    case 0x20: // NOP
+    case 0x20: // NOP, RIM on the 8085
+        if constexpr (Variant::is_8085) {
+            static_cast<Intel8085 &>(*this).rim();
+        }
         break;
     case 0x21: // LXI H, d16
         register_HL = nextWord();
@@ -170,52 +238,47 @@ std::size_t Intel8080::step() {
     case 0x22: // SHLD
     {
         uint16_t address = nextWord();
-        memory[address] = register_HL;
-        memory[++address] = register_HL >> 8;
+        writeByte(address, register_HL);
+        writeByte(++address, register_HL >> 8);
     } break;
     case 0x23: // INX H
-        ++register_HL;
+        register_HL = alu::inx<Variant>(*this, register_HL);
         break;
     case 0x24: // INR H
-        register_H = inr(register_H);
+        register_H = alu::inr<Variant>(*this, register_H);
         break;
     case 0x25: // DCR H
-        register_H = dcr(register_H);
+        register_H = alu::dcr<Variant>(*this, register_H);
         break;
     case 0x26: // MVI H, d8
         register_H = nextByte();
         break;
     case 0x27: // DAA
-        if (flag_C || register_A > 0x99) {
-            flag_C = true;
-            register_A += 0x60;
-        }
-        if (flag_A || (register_A & 0xf) > 0x9) {
-            flag_A = (register_A & 0xf) > 0x9;
-            register_A += 0x06;
-        }
-        updateZSP(register_A);
+        alu::daa(*this);
         break;
 
-    case 0x28: // NOP
+    case 0x28: // NOP, LDHI d8 on the 8085
+        if constexpr (Variant::is_8085) {
+            register_DE = register_HL + nextByte();
+        }
         break;
     case 0x29: // DAD H
-        dad(register_HL);
+        alu::dad(*this, register_HL);
         break;
     case 0x2a: // LHLD
     {
         uint16_t address = nextWord();
-        register_L = memory[address];
-        register_H = memory[++address];
+        register_L = readByte(address);
+        register_H = readByte(++address);
     } break;
     case 0x2b: // DCX H
-        --register_HL;
+        register_HL = alu::dcx<Variant>(*this, register_HL);
         break;
     case 0x2c: // INR L
-        register_L = inr(register_L);
+        register_L = alu::inr<Variant>(*this, register_L);
         break;
     case 0x2d: // DCR L
-        register_L = dcr(register_L);
+        register_L = alu::dcr<Variant>(*this, register_L);
         break;
     case 0x2e: // MVI L, d8
         register_L = nextByte();
@@ -224,46 +287,56 @@ std::size_t Intel8080::step() {
         register_A = ~register_A;
         break;
 
-    case 0x30: // NOP
+    case 0x30: // NOP, SIM on the 8085
+        if constexpr (Variant::is_8085) {
+            static_cast<Intel8085 &>(*this).sim();
+        }
         break;
     case 0x31: // LXI SP, d16
         stack_pointer = nextWord();
         break;
     case 0x32: // STA d16
-        memory[nextWord()] = register_A;
+        writeByte(nextWord(), register_A);
         break;
     case 0x33: // INX SP
-        ++stack_pointer;
+        stack_pointer = alu::inx<Variant>(*this, stack_pointer);
         break;
     case 0x34: // INR H
-        memory[register_HL] = inr(memory[register_HL]);
+        writeByte(register_HL, alu::inr<Variant>(*this, readByte(register_HL)));
         break;
     case 0x35: // DCR H
-        memory[register_HL] = dcr(memory[register_HL]);
+        writeByte(register_HL, alu::dcr<Variant>(*this, readByte(register_HL)));
         break;
     case 0x36: // MVI M, d8
-        memory[register_HL] = nextByte();
+        if (std::size_t loop_cycles = blockTransfer<Variant>()) {
+            cycles = loop_cycles;
+            break;
+        }
+        writeByte(register_HL, nextByte());
         break;
     case 0x37: // STC
         flag_C = true;
         break;
 
-    case 0x38: // NOP
+    case 0x38: // NOP, LDSI d8 on the 8085
+        if constexpr (Variant::is_8085) {
+            register_DE = stack_pointer + nextByte();
+        }
         break;
     case 0x39: // DAD SP
-        dad(stack_pointer);
+        alu::dad(*this, stack_pointer);
         break;
     case 0x3a: // LDA d16
-        register_A = memory[nextWord()];
+        register_A = readByte(nextWord());
         break;
     case 0x3b: // DCX SP
-        --stack_pointer;
+        stack_pointer = alu::dcx<Variant>(*this, stack_pointer);
         break;
     case 0x3c: // INR A
-        register_A = inr(register_A);
+        register_A = alu::inr<Variant>(*this, register_A);
         break;
     case 0x3d: // DCR A
-        register_A = dcr(register_A);
+        register_A = alu::dcr<Variant>(*this, register_A);
         break;
     case 0x3e: // MVI C, d8
         register_A = nextByte();
@@ -272,641 +345,381 @@ std::size_t Intel8080::step() {
         flag_C = !flag_C;
         break;
 
-    case 0x40: // MOV B, B
-        register_B = register_B;
-        break;
-    case 0x41: // MOV B, C
-        register_B = register_C;
-        break;
-    case 0x42: // MOV B, D
-        register_B = register_D;
-        break;
-    case 0x43: // MOV B, E
-        register_B = register_E;
-        break;
-    case 0x44: // MOV B, H
-        register_B = register_H;
-        break;
-    case 0x45: // MOV B, L
-        register_B = register_L;
-        break;
-    case 0x46: // MOV B, M
-        register_B = memory[register_HL];
-        break;
-    case 0x47: // MOV B, A
-        register_B = register_A;
-        break;
-
-    case 0x48: // MOV C, B
-        register_C = register_B;
-        break;
-    case 0x49: // MOV C, C
-        register_C = register_C;
-        break;
-    case 0x4a: // MOV C, D
-        register_C = register_D;
-        break;
-    case 0x4b: // MOV C, E
-        register_C = register_E;
-        break;
-    case 0x4c: // MOV C, H
-        register_C = register_H;
-        break;
-    case 0x4d: // MOV C, L
-        register_C = register_L;
-        break;
-    case 0x4e: // MOV C, M
-        register_C = memory[register_HL];
-        break;
-    case 0x4f: // MOV C, A
-        register_C = register_A;
-        break;
-
-    case 0x50: // MOV D, B
-        register_D = register_B;
-        break;
-    case 0x51: // MOV D, C
-        register_D = register_C;
-        break;
-    case 0x52: // MOV D, D
-        register_D = register_D;
-        break;
-    case 0x53: // MOV D, E
-        register_D = register_E;
-        break;
-    case 0x54: // MOV D, H
-        register_D = register_H;
-        break;
-    case 0x55: // MOV D, L
-        register_D = register_L;
-        break;
-    case 0x56: // MOV D, M
-        register_D = memory[register_HL];
-        break;
-    case 0x57: // MOV D, A
-        register_D = register_A;
-        break;
-
-    case 0x58: // MOV E, B
-        register_E = register_B;
-        break;
-    case 0x59: // MOV E, C
-        register_E = register_C;
-        break;
-    case 0x5a: // MOV E, D
-        register_E = register_D;
-        break;
-    case 0x5b: // MOV E, E
-        register_E = register_E;
-        break;
-    case 0x5c: // MOV E, H
-        register_E = register_H;
-        break;
-    case 0x5d: // MOV E, L
-        register_E = register_L;
-        break;
-    case 0x5e: // MOV E, M
-        register_E = memory[register_HL];
-        break;
-    case 0x5f: // MOV E, A
-        register_E = register_A;
-        break;
-
-    case 0x60: // MOV H, B
-        register_H = register_B;
-        break;
-    case 0x61: // MOV H, C
-        register_H = register_C;
-        break;
-    case 0x62: // MOV H, D
-        register_H = register_D;
-        break;
-    case 0x63: // MOV H, E
-        register_H = register_E;
-        break;
-    case 0x64: // MOV H, H
-        register_H = register_H;
-        break;
-    case 0x65: // MOV H, L
-        register_H = register_L;
-        break;
-    case 0x66: // MOV H, M
-        register_H = memory[register_HL];
-        break;
-    case 0x67: // MOV H, A
-        register_H = register_A;
-        break;
-
-    case 0x68: // MOV L, B
-        register_L = register_B;
-        break;
-    case 0x69: // MOV L, C
-        register_L = register_C;
-        break;
-    case 0x6a: // MOV L, D
-        register_L = register_D;
-        break;
-    case 0x6b: // MOV L, E
-        register_L = register_E;
-        break;
-    case 0x6c: // MOV L, H
-        register_L = register_H;
-        break;
-    case 0x6d: // MOV L, L
-        register_L = register_L;
-        break;
-    case 0x6e: // MOV L, M
-        register_L = memory[register_HL];
-        break;
-    case 0x6f: // MOV L, A
-        register_L = register_A;
-        break;
-
-    case 0x70: // MOV M, B
-        memory[register_HL] = register_B;
-        break;
-    case 0x71: // MOV M, C
-        memory[register_HL] = register_C;
-        break;
-    case 0x72: // MOV M, D
-        memory[register_HL] = register_D;
-        break;
-    case 0x73: // MOV M, E
-        memory[register_HL] = register_E;
-        break;
-    case 0x74: // MOV M, H
-        memory[register_HL] = register_H;
-        break;
-    case 0x75: // MOV M, L
-        memory[register_HL] = register_L;
-        break;
-    case 0x76: // HLT
-        halted = true;
-        break;
-    case 0x77: // MOV M, A
-        memory[register_HL] = register_A;
-        break;
-
-    case 0x78: // MOV A, B
-        register_A = register_B;
-        break;
-    case 0x79: // MOV A, C
-        register_A = register_C;
-        break;
-    case 0x7a: // MOV A, D
-        register_A = register_D;
-        break;
-    case 0x7b: // MOV A, E
-        register_A = register_E;
-        break;
-    case 0x7c: // MOV A, H
-        register_A = register_H;
-        break;
-    case 0x7d: // MOV A, L
-        register_A = register_L;
-        break;
-    case 0x7e: // MOV A, M
-        register_A = memory[register_HL];
-        break;
-    case 0x7f: // MOV A, A
-        register_A = register_A;
-        break;
-
-    case 0x80: // ADD B
-        add(register_B);
-        break;
-    case 0x81: // ADD C
-        add(register_C);
-        break;
-    case 0x82: // ADD D
-        add(register_D);
-        break;
-    case 0x83: // ADD E
-        add(register_E);
-        break;
-    case 0x84: // ADD H
-        add(register_H);
-        break;
-    case 0x85: // ADD L
-        add(register_L);
-        break;
-    case 0x86: // ADD M
-        add(memory[register_HL]);
-        break;
-    case 0x87: // ADD A
-        add(register_A);
-        break;
-
-    case 0x88: // ADC B
-        adc(register_B);
-        break;
-    case 0x89: // ADC C
-        adc(register_C);
-        break;
-    case 0x8a: // ADC D
-        adc(register_D);
-        break;
-    case 0x8b: // ADC E
-        adc(register_E);
-        break;
-    case 0x8c: // ADC H
-        adc(register_H);
-        break;
-    case 0x8d: // ADC L
-        adc(register_L);
-        break;
-    case 0x8e: // ADC M
-        adc(memory[register_HL]);
-        break;
-    case 0x8f: // ADC A
-        adc(register_A);
-        break;
-
-    case 0x90: // SUB B
-        sub(register_B);
-        break;
-    case 0x91: // SUB C
-        sub(register_C);
-        break;
-    case 0x92: // SUB D
-        sub(register_D);
-        break;
-    case 0x93: // SUB E
-        sub(register_E);
-        break;
-    case 0x94: // SUB H
-        sub(register_H);
-        break;
-    case 0x95: // SUB L
-        sub(register_L);
-        break;
-    case 0x96: // SUB M
-        sub(memory[register_HL]);
-        break;
-    case 0x97: // SUB A
-        sub(register_A);
-        break;
-
-    case 0x98: // SBB B
-        sbb(register_B);
-        break;
-    case 0x99: // SBB C
-        sbb(register_C);
-        break;
-    case 0x9a: // SBB D
-        sbb(register_D);
-        break;
-    case 0x9b: // SBB E
-        sbb(register_E);
-        break;
-    case 0x9c: // SBB H
-        sbb(register_H);
-        break;
-    case 0x9d: // SBB L
-        sbb(register_L);
-        break;
-    case 0x9e: // SBB M
-        sbb(memory[register_HL]);
-        break;
-    case 0x9f: // SBB A
-        sbb(register_A);
-        break;
-
-    case 0xa0: // AND B
-        ana(register_B);
-        break;
-    case 0xa1: // AND C
-        ana(register_C);
-        break;
-    case 0xa2: // AND D
-        ana(register_D);
-        break;
-    case 0xa3: // AND E
-        ana(register_E);
-        break;
-    case 0xa4: // AND H
-        ana(register_H);
-        break;
-    case 0xa5: // AND L
-        ana(register_L);
-        break;
-    case 0xa6: // AND M
-        ana(memory[register_HL]);
-        break;
-    case 0xa7: // AND A
-        ana(register_A);
-        break;
-
-    case 0xa8: // XRA B
-        xra(register_B);
-        break;
-    case 0xa9: // XRA C
-        xra(register_C);
-        break;
-    case 0xaa: // XRA D
-        xra(register_D);
-        break;
-    case 0xab: // XRA E
-        xra(register_E);
-        break;
-    case 0xac: // XRA H
-        xra(register_H);
-        break;
-    case 0xad: // XRA L
-        xra(register_L);
-        break;
-    case 0xae: // XRA M
-        xra(memory[register_HL]);
-        break;
-    case 0xaf: // XRA A
-        xra(register_A);
-        break;
-
-    case 0xb0: // ORA B
-        ora(register_B);
-        break;
-    case 0xb1: // ORA C
-        ora(register_C);
-        break;
-    case 0xb2: // ORA D
-        ora(register_D);
-        break;
-    case 0xb3: // ORA E
-        ora(register_E);
-        break;
-    case 0xb4: // ORA H
-        ora(register_H);
-        break;
-    case 0xb5: // ORA L
-        ora(register_L);
-        break;
-    case 0xb6: // ORA M
-        ora(memory[register_HL]);
-        break;
-    case 0xb7: // ORA A
-        ora(register_A);
-        break;
-
-    case 0xb8: // CMP B
-        cmp(register_B);
-        break;
-    case 0xb9: // CMP C
-        cmp(register_C);
-        break;
-    case 0xba: // CMP D
-        cmp(register_D);
-        break;
-    case 0xbb: // CMP E
-        cmp(register_E);
-        break;
-    case 0xbc: // CMP H
-        cmp(register_H);
-        break;
-    case 0xbd: // CMP L
-        cmp(register_L);
-        break;
-    case 0xbe: // CMP M
-        cmp(memory[register_HL]);
-        break;
-    case 0xbf: // CMP A
-        cmp(register_A);
-        break;
+    // MOV r, r, HLT and the ALU operations on registers, 16 opcodes per row
+#define REGISTER_OPERATION(opcode)                                             \
+    case opcode:                                                               \
+        cycles = registerOperation<Variant, opcode>();                         \
+        break;
+#define REGISTER_OPERATIONS(row)                                               \
+    REGISTER_OPERATION(row + 0x0) REGISTER_OPERATION(row + 0x1)                \
+    REGISTER_OPERATION(row + 0x2) REGISTER_OPERATION(row + 0x3)                \
+    REGISTER_OPERATION(row + 0x4) REGISTER_OPERATION(row + 0x5)                \
+    REGISTER_OPERATION(row + 0x6) REGISTER_OPERATION(row + 0x7)                \
+    REGISTER_OPERATION(row + 0x8) REGISTER_OPERATION(row + 0x9)                \
+    REGISTER_OPERATION(row + 0xa) REGISTER_OPERATION(row + 0xb)                \
+    REGISTER_OPERATION(row + 0xc) REGISTER_OPERATION(row + 0xd)                \
+    REGISTER_OPERATION(row + 0xe) REGISTER_OPERATION(row + 0xf)
+    REGISTER_OPERATIONS(0x40)
+    REGISTER_OPERATIONS(0x50)
+    REGISTER_OPERATIONS(0x60)
+    REGISTER_OPERATIONS(0x70)
+    REGISTER_OPERATIONS(0x80)
+    REGISTER_OPERATIONS(0x90)
+    REGISTER_OPERATIONS(0xa0)
+    REGISTER_OPERATIONS(0xb0)
+#undef REGISTER_OPERATIONS
+#undef REGISTER_OPERATION
 
     case 0xc0: // RNZ
         ret(!flag_Z);
-        cycles += !flag_Z ? 6 : 0;
+        cycles += !flag_Z ? Variant::return_taken_cycles : 0;
         break;
     case 0xc1: // POP B
         register_BC = pop();
         break;
     case 0xc2: // JNZ a16
         jmp(!flag_Z);
+        cycles += !flag_Z ? Variant::jump_taken_cycles : 0;
         break;
     case 0xc3: // JMP a16
         jmp(true);
         break;
     case 0xc4: // CNZ a16
         call(!flag_Z);
-        cycles += !flag_Z ? 6 : 0;
+        cycles += !flag_Z ? Variant::call_taken_cycles : 0;
         break;
     case 0xc5: // PUSH B
         push(register_BC);
         break;
     case 0xc6: // ADI d8
-        add(nextByte());
+        alu::add<Variant>(*this, nextByte());
         break;
     case 0xc7: // RST 0
         push(program_counter);
         program_counter = interrupt_vector[0];
+        recordEdge();
         break;
 
     case 0xc8: // RZ
         ret(flag_Z);
-        cycles += flag_Z ? 6 : 0;
+        cycles += flag_Z ? Variant::return_taken_cycles : 0;
         break;
     case 0xc9: // RET
         ret(true);
         break;
     case 0xca: // JZ a16
         jmp(flag_Z);
+        cycles += flag_Z ? Variant::jump_taken_cycles : 0;
         break;
-    case 0xcb: // *JMP a16
-        jmp(true);
+    case 0xcb: // *JMP a16, RSTV on the 8085
+        if constexpr (Variant::is_8085) {
+            cycles += static_cast<Intel8085 &>(*this).rstv() ? 6 : 0;
+        } else {
+            jmp(true);
+        }
         break;
     case 0xcc: // CZ a16
         call(flag_Z);
-        cycles += flag_Z ? 6 : 0;
+        cycles += flag_Z ? Variant::call_taken_cycles : 0;
         break;
     case 0xcd: // CALL a16
         call(true);
         break;
     case 0xce: // ACI d8
-        adc(nextByte());
+        alu::adc<Variant>(*this, nextByte());
         break;
     case 0xcf: // RST 1
         push(program_counter);
         program_counter = interrupt_vector[1];
+        recordEdge();
         break;
 
     case 0xd0: // RNC
         ret(!flag_C);
-        cycles += !flag_C ? 6 : 0;
+        cycles += !flag_C ? Variant::return_taken_cycles : 0;
         break;
     case 0xd1: // POP D
         register_DE = pop();
         break;
     case 0xd2: // JNC a16
         jmp(!flag_C);
+        cycles += !flag_C ? Variant::jump_taken_cycles : 0;
         break;
     case 0xd3: // OUT d8
-        out(nextByte(), register_A);
-        break;
+    {
+        const uint8_t port = nextByte();
+        countOut(port);
+        out(port, register_A);
+    } break;
     case 0xd4: // CNC a16
         call(!flag_C);
-        cycles += !flag_C ? 6 : 0;
+        cycles += !flag_C ? Variant::call_taken_cycles : 0;
         break;
     case 0xd5: // PUSH D
         push(register_DE);
         break;
     case 0xd6: // SUI d8
-        sub(nextByte());
+        alu::sub<Variant>(*this, nextByte());
         break;
     case 0xd7: // RST 2
         push(program_counter);
         program_counter = interrupt_vector[2];
+        recordEdge();
         break;
 
     case 0xd8: // RC a16
         ret(flag_C);
-        cycles += flag_C ? 6 : 0;
-        break;
-    case 0xd9: // *RET
-        ret(true);
+        cycles += flag_C ? Variant::return_taken_cycles : 0;
+        break;
+    case 0xd9: // *RET, SHLX on the 8085
+        if constexpr (Variant::is_8085) {
+            writeByte(register_DE, register_L);
+            writeByte(register_DE + 1, register_H);
+        } else {
+            ret(true);
+        }
         break;
     case 0xda: // JC a16
         jmp(flag_C);
+        cycles += flag_C ? Variant::jump_taken_cycles : 0;
         break;
     case 0xdb: // IN d8
-        register_A = in(nextByte());
-        break;
+    {
+        const uint8_t port = nextByte();
+        countIn(port);
+        register_A = in(port);
+    } break;
     case 0xdc: // CC a16
         call(flag_C);
-        cycles += flag_C ? 6 : 0;
-        break;
-    case 0xdd: // *CALL a16
-        call(true);
+        cycles += flag_C ? Variant::call_taken_cycles : 0;
+        break;
+    case 0xdd: // *CALL a16, JNK a16 on the 8085
+        if constexpr (Variant::is_8085) {
+            const bool condition = !static_cast<Intel8085 &>(*this).flag_K;
+            jmp(condition);
+            cycles += condition ? Variant::jump_taken_cycles : 0;
+        } else {
+            call(true);
+        }
         break;
     case 0xde: // SBI d8
-        sbb(nextByte());
+        alu::sbb<Variant>(*this, nextByte());
         break;
     case 0xdf: // RST 3
         push(program_counter);
         program_counter = interrupt_vector[3];
+        recordEdge();
         break;
 
     case 0xe0: // RPO
         ret(!flag_P);
-        cycles += !flag_P ? 6 : 0;
+        cycles += !flag_P ? Variant::return_taken_cycles : 0;
         break;
     case 0xe1: // POP H
         register_HL = pop();
         break;
     case 0xe2: // JPE a16
         jmp(!flag_P);
+        cycles += !flag_P ? Variant::jump_taken_cycles : 0;
         break;
     case 0xe3: // XTHL
-        std::swap(register_L, memory[stack_pointer++]);
-        std::swap(register_H, memory[stack_pointer--]);
-        break;
+    {
+        uint16_t address = stack_pointer;
+        const uint8_t low = readByte(address);
+        writeByte(address, register_L);
+        const uint8_t high = readByte(++address);
+        writeByte(address, register_H);
+        register_L = low;
+        register_H = high;
+    } break;
     case 0xe4: // CPO a16
         call(!flag_P);
-        cycles += !flag_P ? 6 : 0;
+        cycles += !flag_P ? Variant::call_taken_cycles : 0;
         break;
     case 0xe5: // PUSH H
         push(register_HL);
         break;
     case 0xe6: // ANI d8
-        ana(nextByte());
+        alu::ana<Variant>(*this, nextByte());
         break;
     case 0xe7: // RST 4
         push(program_counter);
         program_counter = interrupt_vector[4];
+        recordEdge();
         break;
 
     case 0xe8: // RPE
         ret(flag_P);
-        cycles += flag_P ? 6 : 0;
+        cycles += flag_P ? Variant::return_taken_cycles : 0;
         break;
     case 0xe9: // PCHL
         program_counter = register_HL;
+        recordEdge();
         break;
     case 0xea: // JPE a16
         jmp(flag_P);
+        cycles += flag_P ? Variant::jump_taken_cycles : 0;
         break;
     case 0xeb: // XCHG
         std::swap(register_HL, register_DE);
         break;
     case 0xec: // CPE a16
         call(flag_P);
-        cycles += flag_P ? 6 : 0;
-        break;
-    case 0xed: // *CALL a16
-        call(true);
+        cycles += flag_P ? Variant::call_taken_cycles : 0;
+        break;
+    case 0xed: // *CALL a16, LHLX on the 8085
+        if constexpr (Variant::is_8085) {
+            register_L = readByte(register_DE);
+            register_H = readByte(static_cast<uint16_t>(register_DE + 1));
+        } else {
+            call(true);
+        }
         break;
     case 0xee: // XRI d8
-        xra(nextByte());
+        alu::xra(*this, nextByte());
         break;
     case 0xef: // RST 5
         push(program_counter);
         program_counter = interrupt_vector[5];
+        recordEdge();
         break;
 
     case 0xf0: // RP
         ret(!flag_S);
-        cycles += !flag_S ? 6 : 0;
+        cycles += !flag_S ? Variant::return_taken_cycles : 0;
         break;
     case 0xf1: // POP PSW
         register_PSW = pop();
-        loadFlags();
+        alu::loadFlags<Variant>(*this);
         break;
     case 0xf2: // JPE a16
         jmp(!flag_S);
+        cycles += !flag_S ? Variant::jump_taken_cycles : 0;
         break;
     case 0xf3: // DI
         interrupts_enabled = false;
         break;
     case 0xf4: // CP a16
         call(!flag_S);
-        cycles += !flag_S ? 6 : 0;
+        cycles += !flag_S ? Variant::call_taken_cycles : 0;
         break;
     case 0xf5: // PUSH PSW
-        storeFlags();
+        alu::storeFlags<Variant>(*this);
         push(register_PSW);
         break;
     case 0xf6: // ORI d8
-        ora(nextByte());
+        alu::ora(*this, nextByte());
         break;
     case 0xf7: // RST 6
         push(program_counter);
         program_counter = interrupt_vector[6];
+        recordEdge();
         break;
 
     case 0xf8: // RM
         ret(flag_S);
-        cycles += flag_S ? 6 : 0;
+        cycles += flag_S ? Variant::return_taken_cycles : 0;
         break;
     case 0xf9: // SPHL
         stack_pointer = register_HL;
         break;
     case 0xfa: // JM a16
         jmp(flag_S);
+        cycles += flag_S ? Variant::jump_taken_cycles : 0;
         break;
     case 0xfb: // EI
         interrupts_enabled = true;
         break;
     case 0xfc: // CM a16
         call(flag_S);
-        cycles += flag_S ? 6 : 0;
-        break;
-    case 0xfd: // *CALL a16
-        call(true);
+        cycles += flag_S ? Variant::call_taken_cycles : 0;
+        break;
+    case 0xfd: // *CALL a16, JK a16 on the 8085
+        if constexpr (Variant::is_8085) {
+            const bool condition = static_cast<Intel8085 &>(*this).flag_K;
+            jmp(condition);
+            cycles += condition ? Variant::jump_taken_cycles : 0;
+        } else {
+            call(true);
+        }
         break;
     case 0xfe: // CPI d8
-        cmp(nextByte());
+        alu::cmp<Variant>(*this, nextByte());
         break;
     case 0xff: // RST 7
         push(program_counter);
         program_counter = interrupt_vector[7];
+        recordEdge();
         break;
 
     default: // not reachable
         break;
     }
 
+    cycle_count += cycles;
+    countStep(cycles);
+    recordCycles(cycles);
     return cycles;
 }
 
-uint8_t Intel8080::nextByte() { return memory[program_counter++]; }
+template <int Field> uint8_t Intel8080::operand() const {
+    static_assert(Field >= 0 && Field < 8, "register fields are 3 bits");
+    if constexpr (Field == 0) return register_B;
+    if constexpr (Field == 1) return register_C;
+    if constexpr (Field == 2) return register_D;
+    if constexpr (Field == 3) return register_E;
+    if constexpr (Field == 4) return register_H;
+    if constexpr (Field == 5) return register_L;
+    if constexpr (Field == 6) return readByte(register_HL);
+    if constexpr (Field == 7) return register_A;
+}
+
+template <int Field> void Intel8080::assign(const uint8_t value) {
+    static_assert(Field >= 0 && Field < 8, "register fields are 3 bits");
+    if constexpr (Field == 0) register_B = value;
+    if constexpr (Field == 1) register_C = value;
+    if constexpr (Field == 2) register_D = value;
+    if constexpr (Field == 3) register_E = value;
+    if constexpr (Field == 4) register_H = value;
+    if constexpr (Field == 5) register_L = value;
+    if constexpr (Field == 6) writeByte(register_HL, value);
+    if constexpr (Field == 7) register_A = value;
+}
+
+template <class Variant, uint8_t Opcode>
+std::size_t Intel8080::registerOperation() {
+    constexpr int destination = (Opcode >> 3) & 7;
+    constexpr int source = Opcode & 7;
+
+    if constexpr (Opcode == 0x76) { // HLT
+        halted = true;
+        haltStarted();
+    } else if constexpr (Opcode < 0x80) {
+        // MOV M, D, MOV M, E and MOV A, M may open a block transfer loop
+        if constexpr (Opcode == 0x72 || Opcode == 0x73 || Opcode == 0x7e) {
+            if (std::size_t loop_cycles = blockTransfer<Variant>()) {
+                return loop_cycles;
+            }
+        }
+        assign<destination>(operand<source>());
+    } else {
+        const uint8_t value = operand<source>();
+        if constexpr (destination == 0) alu::add<Variant>(*this, value);
+        if constexpr (destination == 1) alu::adc<Variant>(*this, value);
+        if constexpr (destination == 2) alu::sub<Variant>(*this, value);
+        if constexpr (destination == 3) alu::sbb<Variant>(*this, value);
+        if constexpr (destination == 4) alu::ana<Variant>(*this, value);
+        if constexpr (destination == 5) alu::xra(*this, value);
+        if constexpr (destination == 6) alu::ora(*this, value);
+        if constexpr (destination == 7) alu::cmp<Variant>(*this, value);
+    }
+    return Variant::instruction_timing[Opcode];
+}
+
+uint8_t Intel8080::nextByte() {
+    recordFetch(program_counter, 1, 1);
+    return memory[program_counter++];
+}
 
 uint16_t Intel8080::nextWord() {
     uint8_t low = nextByte();
@@ -914,136 +727,337 @@ uint16_t Intel8080::nextWord() {
     return (high << 8) | low;
 }
 
+uint8_t Intel8080::readByte(const uint16_t address) const {
+    recordRead(address, 1);
+    return memory[address];
+}
+
+void Intel8080::writeByte(const uint16_t address, const uint8_t value) {
+    countWrites(address, 1);
+    recordWrite(address, 1);
+    memory[address] = value;
+}
+
 void Intel8080::push(uint16_t word) {
-    memory[--stack_pointer] = word >> 8;
-    memory[--stack_pointer] = word;
+    writeByte(--stack_pointer, word >> 8);
+    writeByte(--stack_pointer, word);
 }
 
 uint16_t Intel8080::pop() {
-    uint8_t low = memory[stack_pointer++];
-    uint8_t high = memory[stack_pointer++];
+    uint8_t low = readByte(stack_pointer++);
+    uint8_t high = readByte(stack_pointer++);
     return (high << 8) | low;
 }
 
-void Intel8080::updateZSP(const uint8_t result) {
-    flag_S = result & 0x80;
-    flag_Z = result == 0;
-    flag_P = (0x9669 >> ((result ^ (result >> 4)) & 0x0f)) & 1;
+void Intel8080::jmp(const bool condition) {
+    countBranch(condition);
+    uint16_t jump_target = nextWord();
+    if (condition) {
+        program_counter = jump_target;
+    }
+    recordEdge();
 }
 
-void Intel8080::storeFlags() {
-    flags = 0x02;
-    flags |= flag_S << 7;
-    flags |= flag_Z << 6;
-    flags |= flag_A << 4;
-    flags |= flag_P << 2;
-    flags |= flag_C;
+void Intel8080::call(const bool condition) {
+    countBranch(condition);
+    uint16_t jump_target = nextWord();
+    if (condition) {
+        push(program_counter);
+        program_counter = jump_target;
+    }
+    recordEdge();
 }
 
-void Intel8080::loadFlags() {
-    flag_S = flags & 0x80;
-    flag_Z = flags & 0x40;
-    flag_A = flags & 0x10;
-    flag_P = flags & 0x04;
-    flag_C = flags & 0x01;
+void Intel8080::ret(const bool condition) {
+    countBranch(condition);
+    if (condition) {
+        program_counter = pop();
+    }
+    recordEdge();
+}
+template <class Variant> std::size_t Intel8080::blockTransfer() {
+    const uint16_t head = program_counter - 1;
+
+    // longest recognized loop is 10 bytes, ignore loops that wrap memory
+    if (head > memory.size() - 10) {
+        return 0;
+    }
+
+    const uint8_t *code = &memory[head];
+    bool copy = true;
+    uint16_t source = 0;
+    uint16_t destination = 0;
+    uint8_t value = 0;
+    std::size_t body = 0;
+
+    switch (code[0]) {
+    case 0x7e: // MOV A, M; STAX D; INX H; INX D
+        if (code[1] != 0x12) {
+            return 0;
+        }
+        source = register_HL;
+        destination = register_DE;
+        body = 4;
+        break;
+    case 0x1a: // LDAX D; MOV M, A; INX H; INX D
+        if (code[1] != 0x77) {
+            return 0;
+        }
+        source = register_DE;
+        destination = register_HL;
+        body = 4;
+        break;
+    case 0x36: // MVI M, d8; INX H
+        copy = false;
+        value = code[1];
+        destination = register_HL;
+        body = 3;
+        break;
+    case 0x72: // MOV M, D; INX H
+    case 0x73: // MOV M, E; INX H
+        copy = false;
+        value = code[0] == 0x72 ? register_D : register_E;
+        destination = register_HL;
+        body = 2;
+        break;
+    default:
+        return 0;
+    }
+
+    // both pointers are incremented in either order when copying
+    if (copy && !((code[2] == 0x23 && code[3] == 0x13) ||
+                  (code[2] == 0x13 && code[3] == 0x23))) {
+        return 0;
+    }
+    if (!copy && code[body - 1] != 0x23) {
+        return 0;
+    }
+
+    // DCX B; MOV A, B; ORA C; JNZ head
+    const uint8_t *tail = code + body;
+    if (tail[0] != 0x0b || tail[1] != 0x78 || tail[2] != 0xb1 ||
+        tail[3] != 0xc2 || ((tail[5] << 8) | tail[4]) != head) {
+        return 0;
+    }
+    const std::size_t length = body + 6;
+
+    // the immediate operand of MVI M is skipped when summing timings
+    std::size_t iteration_cycles = Variant::instruction_timing[code[0]];
+    for (std::size_t i = code[0] == 0x36 ? 2 : 1; i < length - 2; ++i) {
+        iteration_cycles += Variant::instruction_timing[code[i]];
+    }
+
+    // the table has the not taken timing of JNZ, which jumps back to the
+    // head on every iteration but the last
+    const std::size_t repeat_cycles =
+        iteration_cycles + Variant::jump_taken_cycles;
+
+    // DCX B on zero wraps, so the loop runs 65536 times. Stop at the
+    // iteration that reaches the deadline, as interpreting would.
+    const std::size_t remaining = register_BC ? register_BC : 0x10000;
+    const uint64_t deadline = runDeadline();
+    const std::size_t budget =
+        deadline > cycle_count
+            ? (deadline - cycle_count - 1) / repeat_cycles + 1
+            : 1;
+    const std::size_t count =
+        std::min({remaining, block_transfer_limit, budget});
+    const bool exits = count == remaining;
+
+    // fall back to the interpreter for anything memmove cannot reproduce:
+    // ranges that wrap memory, copies where the destination trails the
+    // source (the loop replicates bytes), and writes over the loop itself
+    if (destination + count > memory.size()) {
+        return 0;
+    }
+    if (copy && (source + count > memory.size() ||
+                 (destination > source && destination < source + count))) {
+        return 0;
+    }
+    if (destination < head + length && head < destination + count) {
+        return 0;
+    }
+
+    countWrites(destination, count);
+    // copies run MOV A, M or LDAX D, the store and two INX, fills the
+    // store and INX H, and both then DCX B; MOV A, B; ORA C; JNZ
+    countBlockTransfer(count, copy ? 8 : 6, exits);
+    // the loop's code, less the opcode dispatch fetched, and its data
+    recordFetch(head + 1, length - 1, 1);
+    recordFetch(head, length, count - 1);
+    recordWrite(destination, count);
+    if (copy) {
+        recordRead(source, count);
+        std::memmove(&memory[destination], &memory[source], count);
+        register_HL += count;
+        register_DE += count;
+    } else {
+        std::memset(&memory[destination], value, count);
+        register_HL += count;
+    }
+
+    // the JNZ of every iteration is an edge: the first taken one from the
+    // branch before the loop, the rest from the head to itself, and the
+    // exit from the head to the code after the loop
+    const std::size_t taken = count - exits;
+    if (taken) {
+        program_counter = head;
+        recordEdge();
+        if (taken > 1) {
+            recordEdge(taken - 1);
+        }
+    }
+    if (exits) {
+        program_counter = head + length;
+        recordEdge();
+    }
+
+    register_BC -= count;
+    register_A = register_B;
+    alu::ora(*this, register_C);
+    if constexpr (Variant::is_8085) {
+        // K is left as the last DCX B set it
+        static_cast<Intel8085 &>(*this).flag_K = register_BC == 0xffff;
+    }
+    program_counter = register_BC ? head : head + length;
+    return count * repeat_cycles - exits * Variant::jump_taken_cycles;
 }
 
-uint8_t Intel8080::inr(uint8_t value) {
-    value += 1;
-    updateZSP(value);
-    flag_A = (value & 0xf) == 0;
-    return value;
+// the 8080 core is instantiated by step(), the 8085 core by Intel8085
+template std::size_t Intel8080::dispatch<variant::Intel8085>();
+
+Intel8080::Statistics Intel8080::statistics() const {
+    Statistics copy;
+#ifdef EMU8080_STATS
+    copy.instructions = snapshot(counters.instructions);
+    copy.cycles = snapshot(counters.cycles);
+    copy.branches_taken = snapshot(counters.branches_taken);
+    copy.branches_not_taken = snapshot(counters.branches_not_taken);
+    copy.interrupts = snapshot(counters.interrupts);
+    copy.halted_nanoseconds = snapshot(counters.halted_nanoseconds);
+    for (std::size_t i = 0; i < 256; ++i) {
+        copy.in_per_port[i] = snapshot(counters.in_per_port[i]);
+        copy.out_per_port[i] = snapshot(counters.out_per_port[i]);
+        copy.writes_per_page[i] = snapshot(counters.writes_per_page[i]);
+    }
+#endif
+    return copy;
 }
 
-uint8_t Intel8080::dcr(uint8_t value) {
-    value -= 1;
-    updateZSP(value);
-    flag_A = (value & 0xf) != 0xf;
-    return value;
+#ifdef EMU8080_STATS
+void Intel8080::countStep(const std::size_t cycles) {
+    increment(counters.instructions);
+    increment(counters.cycles, cycles);
 }
 
-void Intel8080::add(const uint8_t value) {
-    uint16_t result = register_A + value;
-    updateZSP(result);
-    flag_A = (result ^ register_A ^ value) & 0x10;
-    flag_C = result > 0xff;
-    register_A = result;
+void Intel8080::countBranch(const bool taken) {
+    increment(taken ? counters.branches_taken : counters.branches_not_taken);
 }
 
-void Intel8080::adc(const uint8_t value) {
-    uint16_t result = register_A + value + flag_C;
-    updateZSP(result);
-    flag_A = (result ^ register_A ^ value) & 0x10;
-    flag_C = result > 0xff;
-    register_A = result;
+void Intel8080::countIn(const uint8_t port) {
+    increment(counters.in_per_port[port]);
 }
 
-void Intel8080::sub(const uint8_t value) {
-    uint16_t result = register_A - value;
-    updateZSP(result);
-    flag_A = ~(result ^ register_A ^ value) & 0x10;
-    flag_C = result > 0xff;
-    register_A = result;
+void Intel8080::countOut(const uint8_t port) {
+    increment(counters.out_per_port[port]);
 }
 
-void Intel8080::sbb(const uint8_t value) {
-    uint16_t result = register_A - value - flag_C;
-    updateZSP(result);
-    flag_A = ~(result ^ register_A ^ value) & 0x10;
-    flag_C = result > 0xff;
-    register_A = result;
+void Intel8080::countWrites(const uint16_t address, const std::size_t length) {
+    // block transfers may span several pages
+    std::size_t first = address;
+    const std::size_t end = address + length;
+    while (first < end) {
+        const std::size_t page_end = std::min(end, (first | 0xff) + 1);
+        increment(counters.writes_per_page[first >> 8], page_end - first);
+        first = page_end;
+    }
 }
 
-void Intel8080::ana(const uint8_t value) {
-    flag_A = (register_A | value) & 0x08;
-    flag_C = 0;
-    register_A &= value;
-    updateZSP(register_A);
+void Intel8080::countBlockTransfer(const std::size_t iterations,
+                                   const std::size_t loop_instructions,
+                                   const bool exited) {
+    // dispatch counts the first instruction with countStep()
+    increment(counters.instructions, iterations * loop_instructions - 1);
+    increment(counters.branches_taken, iterations - exited);
+    increment(counters.branches_not_taken, exited);
 }
 
-void Intel8080::xra(const uint8_t value) {
-    flag_A = 0;
-    flag_C = 0;
-    register_A ^= value;
-    updateZSP(register_A);
+void Intel8080::countInterrupt() { increment(counters.interrupts); }
+
+void Intel8080::haltStarted() { halted_since = hostNanoseconds(); }
+
+void Intel8080::haltEnded() {
+    if (halted_since != 0) {
+        increment(counters.halted_nanoseconds,
+                  hostNanoseconds() - halted_since);
+        halted_since = 0;
+    }
 }
+#else
+void Intel8080::countStep(const std::size_t) {}
+void Intel8080::countBranch(const bool) {}
+void Intel8080::countIn(const uint8_t) {}
+void Intel8080::countOut(const uint8_t) {}
+void Intel8080::countWrites(const uint16_t, const std::size_t) {}
+void Intel8080::countBlockTransfer(const std::size_t, const std::size_t,
+                                   const bool) {}
+void Intel8080::countInterrupt() {}
+void Intel8080::haltStarted() {}
+void Intel8080::haltEnded() {}
+#endif
 
-void Intel8080::ora(const uint8_t value) {
-    flag_A = 0;
-    flag_C = 0;
-    register_A |= value;
-    updateZSP(register_A);
+#ifdef EMU8080_COVERAGE
+void Intel8080::recordEdge(const std::size_t times) {
+    if (coverage_map) {
+        // spread nearby addresses over the map; hit counts wrap as they
+        // would counting one branch at a time
+        const uint16_t location = (program_counter * 0x9e3779b1u) >> 16;
+        coverage_map[location ^ previous_location] += times;
+        previous_location = location >> 1;
+    }
 }
+#else
+void Intel8080::recordEdge(const std::size_t) {}
+#endif
 
-void Intel8080::cmp(const uint8_t value) {
-    uint16_t result = register_A - value;
-    updateZSP(result);
-    flag_A = ~(result ^ register_A ^ value) & 0x10;
-    flag_C = result > 0xff;
+#ifdef EMU8080_HEATMAP
+void Intel8080::recordInstruction() const {
+    if (heatmap) {
+        heatmap->instruction(program_counter);
+    }
 }
 
-void Intel8080::dad(const uint16_t value) {
-    register_HL += value;
-    flag_C = register_HL < value;
+void Intel8080::recordFetch(const uint16_t address, const std::size_t length,
+                            const std::size_t times) const {
+    if (heatmap && times) {
+        heatmap->fetch(address, length, times);
+    }
 }
 
-void Intel8080::jmp(const bool condition) {
-    uint16_t jump_target = nextWord();
-    if (condition) {
-        program_counter = jump_target;
+void Intel8080::recordRead(const uint16_t address,
+                           const std::size_t length) const {
+    if (heatmap) {
+        heatmap->load(address, length);
     }
 }
 
-void Intel8080::call(const bool condition) {
-    uint16_t jump_target = nextWord();
-    if (condition) {
-        push(program_counter);
-        program_counter = jump_target;
+void Intel8080::recordWrite(const uint16_t address,
+                            const std::size_t length) const {
+    if (heatmap) {
+        heatmap->store(address, length);
     }
 }
 
-void Intel8080::ret(const bool condition) {
-    if (condition) {
-        program_counter = pop();
+void Intel8080::recordCycles(const std::size_t cycles) const {
+    if (heatmap) {
+        heatmap->step(cycles);
     }
-}
\ No newline at end of file
+}
+#else
+void Intel8080::recordInstruction() const {}
+void Intel8080::recordFetch(const uint16_t, const std::size_t,
+                            const std::size_t) const {}
+void Intel8080::recordRead(const uint16_t, const std::size_t) const {}
+void Intel8080::recordWrite(const uint16_t, const std::size_t) const {}
+void Intel8080::recordCycles(const std::size_t) const {}
+#endif
@@ -2,12 +2,54 @@
 #define INTEL_8080_H
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <string>
 
+#include "variant.h"
+
+class MemoryHeatmap;
+
 class Intel8080 {
   public:
+#ifdef EMU8080_STATS
+    static constexpr bool stats_enabled = true;
+#else
+    static constexpr bool stats_enabled = false;
+#endif
+#ifdef EMU8080_COVERAGE
+    static constexpr bool coverage_enabled = true;
+#else
+    static constexpr bool coverage_enabled = false;
+#endif
+#ifdef EMU8080_HEATMAP
+    static constexpr bool heatmap_enabled = true;
+#else
+    static constexpr bool heatmap_enabled = false;
+#endif
+
+    // The number of bytes in a coverage map
+    static constexpr std::size_t coverage_size = 0x10000;
+
+    /**
+     * Hot path performance counters, see statistics()
+     */
+    struct Statistics {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+        // conditional and unconditional jmp, call and ret
+        uint64_t branches_taken = 0;
+        uint64_t branches_not_taken = 0;
+        uint64_t interrupts = 0;
+        // host time between HLT and the next interrupt or reset
+        uint64_t halted_nanoseconds = 0;
+        std::array<uint64_t, 256> in_per_port = {};
+        std::array<uint64_t, 256> out_per_port = {};
+        // bytes written to each 256 byte page of memory
+        std::array<uint64_t, 256> writes_per_page = {};
+    };
+
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
     union {
         struct {
@@ -79,7 +121,13 @@ class Intel8080 {
     uint16_t stack_pointer = 0x0000;
     uint16_t program_counter = 0x0000;
 
+#ifdef EMU8080_PAGE_ALIGNED
+    // page aligned, so host pages can be protected or mapped, see
+    // DirtyPageTracker, SharedPages and Multiprocessor
+    alignas(4096) std::array<uint8_t, 0x10000> memory;
+#else
     std::array<uint8_t, 0x10000> memory;
+#endif
 
     // Callbacks for interacting with I/O devices
     std::function<uint8_t(uint8_t)> in;
@@ -89,7 +137,30 @@ class Intel8080 {
     bool interrupts_enabled = true;
 
     /**
-     * Execute until the CPU halts
+     * Clock cycles since construction: those executed by every step(),
+     * and any a machine adds for time spent halted. The deadlines given
+     * to runUntil() are values of this count.
+     */
+    uint64_t cycle_count = 0;
+
+    /**
+     * AFL-style edge coverage for fuzzing: jumps, calls, returns, PCHL,
+     * restarts and interrupts count the edge from the previous branch
+     * target to the new one in a byte of this coverage_size map, indexed
+     * by hashes of the two addresses. Only updated when built with
+     * EMU8080_COVERAGE and not null.
+     */
+    uint8_t *coverage_map = nullptr;
+
+    /**
+     * Records every read, write and instruction fetch of memory, see
+     * src/heatmap.h. Only updated when built with EMU8080_HEATMAP and not
+     * null.
+     */
+    MemoryHeatmap *heatmap = nullptr;
+
+    /**
+     * Execute until the CPU halts or an exit is requested
      * Parameters:
      *     cycles (optional) - The target cycles to execute
      * Returns: The number of clock cycles executed
@@ -97,12 +168,49 @@ class Intel8080 {
     std::size_t execute();
     std::size_t execute(std::size_t target_cycles);
 
+    /**
+     * Execute until cycle_count reaches the deadline, the CPU halts or an
+     * exit is requested. The last instruction runs to completion and may
+     * pass the deadline, and the overshoot stays in cycle_count: a caller
+     * that advances its deadline by a fixed slice each time runs the next
+     * slice that much shorter, so its slices never drift.
+     * Parameters:
+     *     deadline - The value of cycle_count to stop at
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t runUntil(const uint64_t deadline);
+
+    /**
+     * Make a running execute() or runUntil() return after the current
+     * instruction. Safe to call from any thread and from I/O callbacks. A
+     * request made while the CPU is not running ends the next run at once.
+     */
+    void requestExit();
+
 	/**
-	 * Calls the given interrupt service routines
+	 * Calls the given interrupt service routine if interrupts are enabled
+	 * - Unhalts CPU
+	 * - Disables interrupts
 	 * Parameter:
 	 *     isr - The number of the given ISR (0-7)
+	 * Returns: True if the interrupt was accepted
 	 */
-	void interrupt(const int isr);
+	bool interrupt(const int isr);
+
+    /**
+     * Calls the given address as an interrupt service routine, as when an
+     * interrupt controller such as the 8259 supplies a CALL instruction
+     * - Unhalts CPU
+     * - Disables interrupts
+     * Parameter:
+     *     address - The address of the service routine
+     * Returns: True if the interrupt was accepted
+     */
+    bool interruptCall(const uint16_t address);
+
+    // clock cycles of the CALL an interrupt controller supplies, for the
+    // machine to add when interruptCall() accepts it
+    static constexpr std::size_t interrupt_call_cycles = 17;
 
     /**
      * Reset the CPU's state
@@ -119,47 +227,130 @@ class Intel8080 {
      */
     std::size_t step();
 
-  private:
+    /**
+     * Returns: True if step() would take an interrupt that is waiting,
+     *          which a halted CPU still does. Always false on the 8080,
+     *          which takes interrupts in interrupt().
+     */
+    bool interruptPending() const { return false; }
+
+    /**
+     * Copy the performance counters. Safe to call from any thread while
+     * the CPU executes; each counter is read atomically.
+     * Returns: The counters, all zero unless built with EMU8080_STATS
+     */
+    Statistics statistics() const;
+
+  protected:
+#ifdef EMU8080_STATS
+    // kept on its own cache lines, away from the registers
+    alignas(64) Statistics counters;
+
+    // host time of the last HLT, zero while running
+    int64_t halted_since = 0;
+#endif
+#ifdef EMU8080_COVERAGE
+    // hash of the last branch target, shifted so edges are directed
+    uint16_t previous_location = 0;
+#endif
+
+    // the deadline of the current run, which block transfers stop at, and
+    // whether an exit was requested; only accessed atomically
+    uint64_t run_deadline = UINT64_MAX;
+    bool exit_requested = false;
+
 	// interrupt service routine vector
 	static const std::array<uint16_t, 8> interrupt_vector;
 
-	// instruction timings
-	static const std::array<std::size_t, 256> instruction_timing;
+	// maximum iterations of a block transfer loop run by a single step
+	static constexpr std::size_t block_transfer_limit = 128;
+
+    /**
+     * Interpreter core, instantiated once per variant policy
+     * Returns: How many clock cycles the CPU executed
+     */
+    template <class Variant> std::size_t dispatch();
+
+    /**
+     * MOV r, r, HLT and the ALU operations on registers (0x40 to 0xbf),
+     * specialized per opcode so the register fields are resolved at
+     * compile time
+     * Returns: How many clock cycles the CPU executed
+     */
+    template <class Variant, uint8_t Opcode> std::size_t registerOperation();
+
+    // register access by opcode field: B, C, D, E, H, L, M, A
+    template <int Field> uint8_t operand() const;
+    template <int Field> void assign(const uint8_t value);
 
     // immediate data operations
     uint8_t nextByte();
     uint16_t nextWord();
 
-    // stack operations
-    void push(const uint16_t word);
-    uint16_t pop();
+    // memory loads and stores of data
+    uint8_t readByte(const uint16_t address) const;
+    void writeByte(const uint16_t address, const uint8_t value);
 
-    // flag operations
-    void updateZSP(const uint8_t result);
-    void storeFlags();
-    void loadFlags();
+    /**
+     * Start a run to the deadline, see runUntil()
+     * Returns: False if an exit was requested before it started
+     */
+    bool beginRun(const uint64_t deadline);
+    void endRun();
 
-    // register inrrement and decrement
-    uint8_t inr(uint8_t value);
-    uint8_t dcr(uint8_t value);
+    /**
+     * Returns: The deadline of the current run, 0 once an exit is
+     *          requested
+     */
+    uint64_t runDeadline() const;
 
-    // 8-bit arithmetic
-    void add(const uint8_t value);
-    void adc(const uint8_t value);
-    void sub(const uint8_t value);
-    void sbb(const uint8_t value);
-    void ana(const uint8_t value);
-    void xra(const uint8_t value);
-    void ora(const uint8_t value);
-    void cmp(const uint8_t value);
+    /**
+     * Returns: The cycle_count to stop a run of target_cycles at
+     */
+    uint64_t deadlineAfter(const std::size_t target_cycles) const;
 
-    // 16-bit arithmetic
-    void dad(const uint16_t src);
+    // performance counters, no-ops unless built with EMU8080_STATS
+    void countStep(const std::size_t cycles);
+    void countBranch(const bool taken);
+    void countIn(const uint8_t port);
+    void countOut(const uint8_t port);
+    void countWrites(const uint16_t address, const std::size_t length);
+    void countBlockTransfer(const std::size_t iterations,
+                            const std::size_t loop_instructions,
+                            const bool exited);
+    void countInterrupt();
+    void haltStarted();
+    void haltEnded();
+
+    // coverage of the branch to program_counter, taken the given number of
+    // times in a row, no-op unless built with EMU8080_COVERAGE
+    void recordEdge(const std::size_t times = 1);
+
+    // memory accesses and time for the heatmap, no-ops unless built with
+    // EMU8080_HEATMAP
+    void recordInstruction() const;
+    void recordFetch(const uint16_t address, const std::size_t length,
+                     const std::size_t times) const;
+    void recordRead(const uint16_t address, const std::size_t length) const;
+    void recordWrite(const uint16_t address, const std::size_t length) const;
+    void recordCycles(const std::size_t cycles) const;
+
+    // stack operations
+    void push(const uint16_t word);
+    uint16_t pop();
 
     // branching instructions
     void jmp(const bool condition);
     void call(const bool condition);
     void ret(const bool condition);
+
+    /**
+     * Runs a recognized memory copy or fill loop starting at the current
+     * instruction natively, as if the loop had been interpreted
+     * Returns: The clock cycles of the iterations run, or 0 when the code
+     *          is not a recognized loop and must be interpreted
+     */
+    template <class Variant> std::size_t blockTransfer();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "dirty_pages.h"
+
+#include <array>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// trackers the signal handler checks faults against
+std::array<std::atomic<DirtyPageTracker *>, DirtyPageTracker::max_trackers>
+    trackers{};
+
+// guards adding and removing trackers and the handler
+std::mutex registry;
+std::size_t active_trackers = 0;
+struct sigaction previous_action;
+
+// passes a fault that is not a tracked write to the previous handler
+void forward(const int signal, siginfo_t *info, void *context) {
+    if (previous_action.sa_flags & SA_SIGINFO) {
+        previous_action.sa_sigaction(signal, info, context);
+    } else if (previous_action.sa_handler != SIG_DFL &&
+               previous_action.sa_handler != SIG_IGN) {
+        previous_action.sa_handler(signal);
+    } else {
+        // the faulting instruction runs again and takes the default action
+        std::signal(signal, SIG_DFL);
+    }
+}
+
+} // namespace
+
+DirtyPageTracker::DirtyPageTracker(Intel8080 &cpu)
+    : memory(cpu.memory.data()) {
+    const long host_page = sysconf(_SC_PAGESIZE);
+    // dirtyPages() has a bit per page
+    if (host_page <= 0 || 0x10000 % host_page != 0 ||
+        0x10000 / host_page > 32) {
+        return;
+    }
+    page_size = host_page;
+
+    // the host pages wholly inside memory
+    const std::size_t pages = 0x10000 / page_size;
+    const uintptr_t base = reinterpret_cast<uintptr_t>(memory);
+    protected_start = (page_size - base % page_size) % page_size;
+    protected_end = protected_start +
+                    (0x10000 - protected_start) / page_size * page_size;
+    if (protected_start != 0) {
+        untracked = 1 | uint32_t(1) << (pages - 1);
+    }
+
+    std::lock_guard<std::mutex> lock(registry);
+    std::size_t free_slot = max_trackers;
+    for (std::size_t i = 0; i < max_trackers; ++i) {
+        const DirtyPageTracker *tracker = trackers[i].load();
+        if (tracker && tracker->memory == memory) {
+            // the first tracker would miss faults the other one handles
+            return;
+        }
+        if (!tracker && free_slot == max_trackers) {
+            free_slot = i;
+        }
+    }
+    if (free_slot == max_trackers || !installHandler()) {
+        return;
+    }
+    slot = free_slot;
+    trackers[slot].store(this, std::memory_order_release);
+    if (mprotect(memory + protected_start, protected_end - protected_start,
+                 PROT_READ) != 0) {
+        trackers[slot].store(nullptr);
+        if (active_trackers == 0) {
+            restoreHandler();
+        }
+        return;
+    }
+    ++active_trackers;
+    active = true;
+}
+
+DirtyPageTracker::~DirtyPageTracker() {
+    if (!active) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(registry);
+    mprotect(memory + protected_start, protected_end - protected_start,
+             PROT_READ | PROT_WRITE);
+    trackers[slot].store(nullptr);
+    if (--active_trackers == 0) {
+        restoreHandler();
+    }
+}
+
+uint32_t DirtyPageTracker::dirtyPages() const {
+    if (!active) {
+        return ~uint32_t(0);
+    }
+    return dirty.load(std::memory_order_acquire) | untracked;
+}
+
+bool DirtyPageTracker::isDirty(const uint16_t address) const {
+    if (!active) {
+        return true;
+    }
+    return dirtyPages() >> (address / page_size) & 1;
+}
+
+uint32_t DirtyPageTracker::reset() {
+    if (!active) {
+        return dirtyPages();
+    }
+    const uint32_t pages = dirty.exchange(0, std::memory_order_acq_rel);
+    for (std::size_t offset = protected_start; offset < protected_end;
+         offset += page_size) {
+        if (pagesAt(offset) & pages) {
+            mprotect(memory + offset, page_size, PROT_READ);
+        }
+    }
+    return pages | untracked;
+}
+
+bool DirtyPageTracker::isTracked(const Intel8080 &cpu) {
+    std::lock_guard<std::mutex> lock(registry);
+    for (const std::atomic<DirtyPageTracker *> &entry : trackers) {
+        const DirtyPageTracker *tracker = entry.load();
+        if (tracker && tracker->memory == cpu.memory.data()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t DirtyPageTracker::pagesAt(const std::size_t offset) const {
+    const std::size_t first = offset / page_size;
+    const std::size_t last = (offset + page_size - 1) / page_size;
+    return uint32_t(1) << first | uint32_t(1) << last;
+}
+
+bool DirtyPageTracker::installHandler() {
+    if (handlerInstalled()) {
+        return true;
+    }
+    struct sigaction action = {};
+    action.sa_sigaction = handleFault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGSEGV, &action, &previous_action) == 0;
+}
+
+void DirtyPageTracker::restoreHandler() {
+    // a handler installed over this one may still pass faults to it
+    if (handlerInstalled()) {
+        sigaction(SIGSEGV, &previous_action, nullptr);
+    }
+}
+
+bool DirtyPageTracker::handlerInstalled() {
+    struct sigaction current;
+    return sigaction(SIGSEGV, nullptr, &current) == 0 &&
+           (current.sa_flags & SA_SIGINFO) &&
+           current.sa_sigaction == handleFault;
+}
+
+void DirtyPageTracker::handleFault(int signal, siginfo_t *info,
+                                   void *context) {
+    uint8_t *const address = static_cast<uint8_t *>(info->si_addr);
+    for (std::atomic<DirtyPageTracker *> &entry : trackers) {
+        DirtyPageTracker *tracker = entry.load(std::memory_order_acquire);
+        if (!tracker || address < tracker->memory + tracker->protected_start ||
+            address >= tracker->memory + tracker->protected_end) {
+            continue;
+        }
+        const std::size_t page_size = tracker->page_size;
+        const std::size_t start = tracker->protected_start;
+        const std::size_t offset =
+            start + (address - tracker->memory - start) / page_size * page_size;
+        if (mprotect(tracker->memory + offset, page_size,
+                     PROT_READ | PROT_WRITE) != 0) {
+            break;
+        }
+        tracker->dirty.fetch_or(tracker->pagesAt(offset),
+                                std::memory_order_release);
+        return;
+    }
+    forward(signal, info, context);
+}
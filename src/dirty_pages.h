@@ -0,0 +1,112 @@
+#ifndef INTEL_8080_DIRTY_PAGES_H
+#define INTEL_8080_DIRTY_PAGES_H
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+
+#include "cpu.h"
+
+/**
+ * Tracks which pages of a CPU's memory have been written, using the host
+ * MMU instead of a check on every store.
+ *
+ * Tracked pages are write protected. The first write to one faults, the
+ * SIGSEGV handler marks the page dirty and makes it writable again, and
+ * the write is retried. Later writes to the page cost nothing until the
+ * next reset().
+ *
+ * Pages are the size of a host page, page n starting at address
+ * n * pageSize(). Only host pages wholly inside Intel8080::memory are
+ * protected. When memory is not page aligned (built without
+ * EMU8080_PAGE_ALIGNED), each page spans two host pages, a write marks
+ * both pages that share its host page dirty, and the first and last pages
+ * are always reported dirty. On hosts with larger pages, with more than
+ * max_trackers trackers, a second tracker of the same memory, or where
+ * mprotect fails, the tracker is inactive and reports every page dirty.
+ *
+ * The SIGSEGV handler is installed with the first active tracker and the
+ * one it replaced is restored after the last, unless another handler has
+ * been installed over it since. Faults the trackers do not own go to the
+ * replaced handler. Writes to tracked memory by the kernel, such as read()
+ * into it, fail with EFAULT instead of faulting, so load files into memory
+ * before tracking or after resetting. Trackers may be created and
+ * destroyed on any thread, but reset() and the destructor must not run
+ * while another thread writes to the memory.
+ */
+class DirtyPageTracker {
+  public:
+    // The most trackers that can be active at once
+    static constexpr std::size_t max_trackers = 64;
+
+    /**
+     * Write protect memory and start tracking with every page clean
+     */
+    explicit DirtyPageTracker(Intel8080 &cpu);
+    DirtyPageTracker(const DirtyPageTracker &) = delete;
+    DirtyPageTracker &operator=(const DirtyPageTracker &) = delete;
+
+    /**
+     * Stop tracking and make all of memory writable again
+     */
+    ~DirtyPageTracker();
+
+    /**
+     * Returns: True when writes are being tracked
+     */
+    bool isActive() const { return active; }
+
+    /**
+     * Returns: The size of a page in bytes
+     */
+    std::size_t pageSize() const { return page_size; }
+
+    /**
+     * Returns: A bitmap with bit n set when page n, starting at address
+     *          n * pageSize(), was written since tracking started or the
+     *          last reset
+     */
+    uint32_t dirtyPages() const;
+
+    /**
+     * Returns: True when the page containing address was written
+     */
+    bool isDirty(const uint16_t address) const;
+
+    /**
+     * Mark every page clean and write protect the pages that were dirty
+     * Returns: The dirty pages before the reset, as dirtyPages()
+     */
+    uint32_t reset();
+
+    /**
+     * Returns: True when an active tracker tracks the CPU's memory
+     */
+    static bool isTracked(const Intel8080 &cpu);
+
+  private:
+    uint8_t *const memory;
+    std::size_t page_size = 0;
+    bool active = false;
+    std::atomic<uint32_t> dirty{0};
+
+    // the host pages protected, as offsets in memory
+    std::size_t protected_start = 0;
+    std::size_t protected_end = 0;
+    // pages partly outside them, always reported dirty
+    uint32_t untracked = 0;
+
+    // index in the signal handler's table of active trackers
+    std::size_t slot = 0;
+
+    // the pages sharing the host page at an offset in memory
+    uint32_t pagesAt(const std::size_t offset) const;
+
+    // install the SIGSEGV handler, or put back the one it replaced
+    static bool installHandler();
+    static void restoreHandler();
+    static bool handlerInstalled();
+    static void handleFault(int signal, siginfo_t *info, void *context);
+};
+
+#endif
@@ -0,0 +1,327 @@
+#include "emu8080.h"
+
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "i8085.h"
+
+struct emu8080_cpu {
+    // one of the two, as the model, and cpu pointing to it
+    std::unique_ptr<Intel8080> i8080;
+    std::unique_ptr<Intel8085> i8085;
+    Intel8080 *cpu = nullptr;
+
+    emu8080_in_fn in = nullptr;
+    emu8080_out_fn out = nullptr;
+    void *user = nullptr;
+};
+
+namespace {
+
+constexpr std::size_t memory_size = 0x10000;
+
+bool inMemory(const uint16_t address, const std::size_t length) {
+    return length <= memory_size - address;
+}
+
+uint8_t flagsOf(const emu8080_cpu &state) {
+    const Intel8080 &cpu = *state.cpu;
+    uint8_t flags = cpu.flag_S << 7 | cpu.flag_Z << 6 | cpu.flag_A << 4 |
+                    cpu.flag_P << 2 | cpu.flag_C;
+    if (state.i8085) {
+        return flags | state.i8085->flag_K << 5 | state.i8085->flag_V << 1;
+    }
+    return flags | 0x02;
+}
+
+void setFlags(emu8080_cpu &state, const uint8_t flags) {
+    Intel8080 &cpu = *state.cpu;
+    cpu.flags = flags;
+    cpu.flag_S = flags & 0x80;
+    cpu.flag_Z = flags & 0x40;
+    cpu.flag_A = flags & 0x10;
+    cpu.flag_P = flags & 0x04;
+    cpu.flag_C = flags & 0x01;
+    if (state.i8085) {
+        state.i8085->flag_K = flags & 0x20;
+        state.i8085->flag_V = flags & 0x02;
+    }
+}
+
+uint16_t getRegister(const emu8080_cpu &state, const emu8080_register reg) {
+    const Intel8080 &cpu = *state.cpu;
+    switch (reg) {
+    case EMU8080_REG_A:
+        return cpu.register_A;
+    case EMU8080_REG_B:
+        return cpu.register_B;
+    case EMU8080_REG_C:
+        return cpu.register_C;
+    case EMU8080_REG_D:
+        return cpu.register_D;
+    case EMU8080_REG_E:
+        return cpu.register_E;
+    case EMU8080_REG_H:
+        return cpu.register_H;
+    case EMU8080_REG_L:
+        return cpu.register_L;
+    case EMU8080_REG_FLAGS:
+        return flagsOf(state);
+    case EMU8080_REG_BC:
+        return cpu.register_BC;
+    case EMU8080_REG_DE:
+        return cpu.register_DE;
+    case EMU8080_REG_HL:
+        return cpu.register_HL;
+    case EMU8080_REG_PSW:
+        return cpu.register_A << 8 | flagsOf(state);
+    case EMU8080_REG_SP:
+        return cpu.stack_pointer;
+    case EMU8080_REG_PC:
+        return cpu.program_counter;
+    case EMU8080_REG_HALTED:
+        return cpu.halted;
+    case EMU8080_REG_INTERRUPTS_ENABLED:
+        return cpu.interrupts_enabled;
+    }
+    return 0;
+}
+
+void setRegister(emu8080_cpu &state, const emu8080_register reg,
+                 const uint16_t value) {
+    Intel8080 &cpu = *state.cpu;
+    switch (reg) {
+    case EMU8080_REG_A:
+        cpu.register_A = value;
+        break;
+    case EMU8080_REG_B:
+        cpu.register_B = value;
+        break;
+    case EMU8080_REG_C:
+        cpu.register_C = value;
+        break;
+    case EMU8080_REG_D:
+        cpu.register_D = value;
+        break;
+    case EMU8080_REG_E:
+        cpu.register_E = value;
+        break;
+    case EMU8080_REG_H:
+        cpu.register_H = value;
+        break;
+    case EMU8080_REG_L:
+        cpu.register_L = value;
+        break;
+    case EMU8080_REG_FLAGS:
+        setFlags(state, value);
+        break;
+    case EMU8080_REG_BC:
+        cpu.register_BC = value;
+        break;
+    case EMU8080_REG_DE:
+        cpu.register_DE = value;
+        break;
+    case EMU8080_REG_HL:
+        cpu.register_HL = value;
+        break;
+    case EMU8080_REG_PSW:
+        cpu.register_A = value >> 8;
+        setFlags(state, value);
+        break;
+    case EMU8080_REG_SP:
+        cpu.stack_pointer = value;
+        break;
+    case EMU8080_REG_PC:
+        cpu.program_counter = value;
+        break;
+    case EMU8080_REG_HALTED:
+        cpu.halted = value;
+        break;
+    case EMU8080_REG_INTERRUPTS_ENABLED:
+        cpu.interrupts_enabled = value;
+        break;
+    }
+}
+
+uint64_t run(emu8080_cpu &state, const uint64_t cycles) {
+    return state.i8085 ? state.i8085->execute(cycles)
+                       : state.cpu->execute(cycles);
+}
+
+} // namespace
+
+uint32_t emu8080_abi_version(void) { return EMU8080_ABI_VERSION; }
+
+emu8080_cpu *emu8080_create(const emu8080_model model) {
+    if (model != EMU8080_MODEL_8080 && model != EMU8080_MODEL_8085) {
+        return nullptr;
+    }
+    // the C caller cannot catch an exception, so allocation failures
+    // become NULL
+    std::unique_ptr<emu8080_cpu> state(new (std::nothrow) emu8080_cpu);
+    if (!state) {
+        return nullptr;
+    }
+    if (model == EMU8080_MODEL_8085) {
+        state->i8085.reset(new (std::nothrow) Intel8085());
+        state->cpu = state->i8085.get();
+    } else {
+        state->i8080.reset(new (std::nothrow) Intel8080());
+        state->cpu = state->i8080.get();
+    }
+    if (!state->cpu) {
+        return nullptr;
+    }
+
+    Intel8080 &cpu = *state->cpu;
+    cpu.memory.fill(0);
+    cpu.register_PSW = cpu.register_BC = 0;
+    cpu.register_DE = cpu.register_HL = 0;
+    setFlags(*state, 0);
+    emu8080_reset(state.get());
+
+    emu8080_cpu *raw = state.get();
+    cpu.in = [raw](uint8_t port) {
+        return raw->in ? raw->in(raw->user, port) : uint8_t(0);
+    };
+    cpu.out = [raw](uint8_t port, uint8_t value) {
+        if (raw->out) {
+            raw->out(raw->user, port, value);
+        }
+    };
+    return state.release();
+}
+
+void emu8080_destroy(emu8080_cpu *cpu) { delete cpu; }
+
+void emu8080_reset(emu8080_cpu *cpu) {
+    if (cpu->i8085) {
+        cpu->i8085->reset();
+    } else {
+        cpu->cpu->reset();
+    }
+}
+
+void emu8080_set_io(emu8080_cpu *cpu, const emu8080_in_fn in,
+                    const emu8080_out_fn out, void *user) {
+    cpu->in = in;
+    cpu->out = out;
+    cpu->user = user;
+}
+
+bool emu8080_load(emu8080_cpu *cpu, const uint16_t address,
+                  const uint8_t *data, const size_t length) {
+    if (!inMemory(address, length)) {
+        return false;
+    }
+    std::memcpy(cpu->cpu->memory.data() + address, data, length);
+    return true;
+}
+
+bool emu8080_store(const emu8080_cpu *cpu, const uint16_t address,
+                   uint8_t *data, const size_t length) {
+    if (!inMemory(address, length)) {
+        return false;
+    }
+    std::memcpy(data, cpu->cpu->memory.data() + address, length);
+    return true;
+}
+
+uint8_t *emu8080_memory(emu8080_cpu *cpu) { return cpu->cpu->memory.data(); }
+
+uint16_t emu8080_get_register(const emu8080_cpu *cpu,
+                              const emu8080_register reg) {
+    return getRegister(*cpu, reg);
+}
+
+void emu8080_set_register(emu8080_cpu *cpu, const emu8080_register reg,
+                          const uint16_t value) {
+    setRegister(*cpu, reg, value);
+}
+
+uint64_t emu8080_run(emu8080_cpu *cpu, const uint64_t cycles) {
+    return run(*cpu, cycles);
+}
+
+bool emu8080_interrupt(emu8080_cpu *cpu, const int isr) {
+    if (isr < 0 || isr > 7) {
+        return false;
+    }
+    return cpu->cpu->interrupt(isr);
+}
+
+bool emu8080_interrupt_call(emu8080_cpu *cpu, const uint16_t address) {
+    return cpu->cpu->interruptCall(address);
+}
+
+size_t emu8080_run_batch(emu8080_cpu *const *cpus, const size_t count,
+                         const uint64_t cycles, uint64_t *executed) {
+    size_t running = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t ran = cpus[i] ? run(*cpus[i], cycles) : 0;
+        if (executed) {
+            executed[i] = ran;
+        }
+        running += cpus[i] && !cpus[i]->cpu->halted;
+    }
+    return running;
+}
+
+void emu8080_get_registers(const emu8080_cpu *cpu,
+                           const emu8080_register *registers,
+                           uint16_t *values, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = getRegister(*cpu, registers[i]);
+    }
+}
+
+void emu8080_set_registers(emu8080_cpu *cpu,
+                           const emu8080_register *registers,
+                           const uint16_t *values, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        setRegister(*cpu, registers[i], values[i]);
+    }
+}
+
+void emu8080_gather_registers(emu8080_cpu *const *cpus, const size_t cpu_count,
+                              const emu8080_register *registers,
+                              const size_t register_count, uint16_t *values) {
+    for (size_t i = 0; i < cpu_count; ++i) {
+        emu8080_get_registers(cpus[i], registers, values + i * register_count,
+                              register_count);
+    }
+}
+
+void emu8080_scatter_registers(emu8080_cpu *const *cpus,
+                               const size_t cpu_count,
+                               const emu8080_register *registers,
+                               const size_t register_count,
+                               const uint16_t *values) {
+    for (size_t i = 0; i < cpu_count; ++i) {
+        emu8080_set_registers(cpus[i], registers, values + i * register_count,
+                              register_count);
+    }
+}
+
+size_t emu8080_read_regions(const emu8080_cpu *cpu,
+                            const emu8080_region *regions, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!emu8080_store(cpu, regions[i].address, regions[i].data,
+                           regions[i].length)) {
+            return i;
+        }
+    }
+    return count;
+}
+
+size_t emu8080_write_regions(emu8080_cpu *cpu, const emu8080_region *regions,
+                             const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!emu8080_load(cpu, regions[i].address, regions[i].data,
+                          regions[i].length)) {
+            return i;
+        }
+    }
+    return count;
+}
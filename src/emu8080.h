@@ -0,0 +1,189 @@
+#ifndef INTEL_8080_EMU8080_H
+#define INTEL_8080_EMU8080_H
+
+/**
+ * C interface of the emulator, built as the libemu8080 shared library.
+ *
+ * The interface only grows: functions and enum values are never changed
+ * or removed, and EMU8080_ABI_VERSION is raised when any are added.
+ *
+ * Each call across a foreign function interface costs far more than a
+ * few emulated instructions, so the batch functions run many CPUs, or
+ * move many registers or memory regions, in one call.
+ *
+ * A CPU may only be used by one thread at a time.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define EMU8080_API __attribute__((visibility("default")))
+#else
+#define EMU8080_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMU8080_ABI_VERSION 1
+
+typedef struct emu8080_cpu emu8080_cpu;
+
+typedef enum emu8080_model {
+    EMU8080_MODEL_8080 = 0,
+    EMU8080_MODEL_8085 = 1,
+} emu8080_model;
+
+// Registers, read and written as 16 bit values
+typedef enum emu8080_register {
+    EMU8080_REG_A = 0,
+    EMU8080_REG_B = 1,
+    EMU8080_REG_C = 2,
+    EMU8080_REG_D = 3,
+    EMU8080_REG_E = 4,
+    EMU8080_REG_H = 5,
+    EMU8080_REG_L = 6,
+    // the flags as PUSH PSW stores them
+    EMU8080_REG_FLAGS = 7,
+    EMU8080_REG_BC = 8,
+    EMU8080_REG_DE = 9,
+    EMU8080_REG_HL = 10,
+    EMU8080_REG_PSW = 11,
+    EMU8080_REG_SP = 12,
+    EMU8080_REG_PC = 13,
+    // 1 when halted or interrupts are enabled, 0 otherwise
+    EMU8080_REG_HALTED = 14,
+    EMU8080_REG_INTERRUPTS_ENABLED = 15,
+} emu8080_register;
+
+// A range of a CPU's memory and the host buffer it is copied to or from
+typedef struct emu8080_region {
+    uint16_t address;
+    uint32_t length;
+    uint8_t *data;
+} emu8080_region;
+
+/**
+ * Called when the CPU executes IN or OUT, with the user pointer given to
+ * emu8080_set_io(). Without them IN reads 0 and OUT is ignored.
+ */
+typedef uint8_t (*emu8080_in_fn)(void *user, uint8_t port);
+typedef void (*emu8080_out_fn)(void *user, uint8_t port, uint8_t value);
+
+/**
+ * Returns: The EMU8080_ABI_VERSION the library was built with
+ */
+EMU8080_API uint32_t emu8080_abi_version(void);
+
+/**
+ * Create a CPU with zeroed memory and registers, reset to address 0
+ * Returns: The CPU, or NULL for an unknown model or when out of memory
+ */
+EMU8080_API emu8080_cpu *emu8080_create(emu8080_model model);
+EMU8080_API void emu8080_destroy(emu8080_cpu *cpu);
+
+/**
+ * Reset as the RESET pin: unhalts, enables interrupts and sets PC and SP
+ * to 0, leaving the other registers and memory
+ */
+EMU8080_API void emu8080_reset(emu8080_cpu *cpu);
+
+EMU8080_API void emu8080_set_io(emu8080_cpu *cpu, emu8080_in_fn in,
+                                emu8080_out_fn out, void *user);
+
+/**
+ * Copy bytes into or out of memory
+ * Returns: False when the range runs past the end of memory
+ */
+EMU8080_API bool emu8080_load(emu8080_cpu *cpu, uint16_t address,
+                              const uint8_t *data, size_t length);
+EMU8080_API bool emu8080_store(const emu8080_cpu *cpu, uint16_t address,
+                               uint8_t *data, size_t length);
+
+/**
+ * Returns: A pointer to the CPU's 64 KB of memory, valid until it is
+ *          destroyed
+ */
+EMU8080_API uint8_t *emu8080_memory(emu8080_cpu *cpu);
+
+EMU8080_API uint16_t emu8080_get_register(const emu8080_cpu *cpu,
+                                          emu8080_register reg);
+EMU8080_API void emu8080_set_register(emu8080_cpu *cpu, emu8080_register reg,
+                                      uint16_t value);
+
+/**
+ * Execute until the CPU halts or has run at least the given cycles
+ * Returns: The number of clock cycles executed
+ */
+EMU8080_API uint64_t emu8080_run(emu8080_cpu *cpu, uint64_t cycles);
+
+/**
+ * Call the restart routine of the interrupt (0-7), or any address as an
+ * 8259 does, if interrupts are enabled
+ * Returns: True when the interrupt was taken
+ */
+EMU8080_API bool emu8080_interrupt(emu8080_cpu *cpu, int isr);
+EMU8080_API bool emu8080_interrupt_call(emu8080_cpu *cpu, uint16_t address);
+
+/**
+ * Run each CPU for the given cycles, one after another
+ * Parameters:
+ *     cpus - The CPUs, NULL entries are skipped
+ *     count - The number of CPUs
+ *     cycles - The cycles to run each for
+ *     executed (optional) - count entries receiving each CPU's cycles
+ * Returns: The number of CPUs still running, not halted
+ */
+EMU8080_API size_t emu8080_run_batch(emu8080_cpu *const *cpus, size_t count,
+                                     uint64_t cycles, uint64_t *executed);
+
+/**
+ * Read or write several registers of one CPU
+ * Parameters:
+ *     registers - The registers
+ *     values - One value per register
+ *     count - The number of registers
+ */
+EMU8080_API void emu8080_get_registers(const emu8080_cpu *cpu,
+                                       const emu8080_register *registers,
+                                       uint16_t *values, size_t count);
+EMU8080_API void emu8080_set_registers(emu8080_cpu *cpu,
+                                       const emu8080_register *registers,
+                                       const uint16_t *values, size_t count);
+
+/**
+ * Read or write the same registers of several CPUs
+ * Parameters:
+ *     values - register_count values per CPU, one CPU after another
+ */
+EMU8080_API void emu8080_gather_registers(emu8080_cpu *const *cpus,
+                                          size_t cpu_count,
+                                          const emu8080_register *registers,
+                                          size_t register_count,
+                                          uint16_t *values);
+EMU8080_API void emu8080_scatter_registers(emu8080_cpu *const *cpus,
+                                           size_t cpu_count,
+                                           const emu8080_register *registers,
+                                           size_t register_count,
+                                           const uint16_t *values);
+
+/**
+ * Copy several regions of one CPU's memory out or in
+ * Returns: The number of regions copied, stopping at the first that runs
+ *          past the end of memory
+ */
+EMU8080_API size_t emu8080_read_regions(const emu8080_cpu *cpu,
+                                        const emu8080_region *regions,
+                                        size_t count);
+EMU8080_API size_t emu8080_write_regions(emu8080_cpu *cpu,
+                                         const emu8080_region *regions,
+                                         size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+std::size_t count(const std::array<uint64_t, 4> &set) {
+    std::size_t total = 0;
+    for (const uint64_t word : set) {
+        total += std::popcount(word);
+    }
+    return total;
+}
+
+} // namespace
+
+MemoryHeatmap::MemoryHeatmap(const bool per_byte,
+                             const uint64_t window_cycles)
+    : per_byte(per_byte), window_cycles(std::max<uint64_t>(window_cycles, 1)) {
+    reset();
+}
+
+void MemoryHeatmap::store(const uint16_t address, const std::size_t length) {
+    record(write, address, length, 1);
+    for (std::size_t i = 0; i < length; ++i) {
+        const uint16_t byte = address + i;
+        const uint64_t bit = uint64_t(1) << (byte % 64);
+        written[byte / 64] |= bit;
+        if (executed[byte / 64] & bit) {
+            ModifiedCode &site =
+                modified.try_emplace(byte, ModifiedCode{byte, 0, 0})
+                    .first->second;
+            site.instruction = current_instruction;
+            ++site.writes;
+        }
+    }
+}
+
+void MemoryHeatmap::reset() {
+    page_counts = {};
+    for (std::vector<uint32_t> &counts : byte_counts) {
+        counts.assign(per_byte ? 0x10000 : 0, 0);
+    }
+    executed.assign(0x10000 / 64, 0);
+    written.assign(0x10000 / 64, 0);
+    modified.clear();
+    current_instruction = 0;
+    now = 0;
+    window_end = window_cycles;
+    window_pages = {};
+    windows.clear();
+}
+
+std::size_t MemoryHeatmap::overlapBytes() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < executed.size(); ++i) {
+        total += std::popcount(executed[i] & written[i]);
+    }
+    return total;
+}
+
+std::vector<MemoryHeatmap::ModifiedCode> MemoryHeatmap::modifiedCode() const {
+    std::vector<ModifiedCode> sites;
+    for (const auto &[address, site] : modified) {
+        sites.push_back(site);
+    }
+    return sites;
+}
+
+MemoryHeatmap::WorkingSet MemoryHeatmap::currentWindow() const {
+    PageSet touched;
+    for (std::size_t i = 0; i < touched.size(); ++i) {
+        touched[i] = window_pages[read][i] | window_pages[write][i] |
+                     window_pages[execute][i];
+    }
+    return {now,
+            uint16_t(count(window_pages[read])),
+            uint16_t(count(window_pages[write])),
+            uint16_t(count(window_pages[execute])),
+            uint16_t(count(touched))};
+}
+
+void MemoryHeatmap::closeWindow() {
+    windows.push_back(currentWindow());
+    window_pages = {};
+    // an instruction longer than a window still ends just one
+    window_end = (now / window_cycles + 1) * window_cycles;
+}
+
+std::vector<MemoryHeatmap::WorkingSet> MemoryHeatmap::workingSet() const {
+    std::vector<WorkingSet> result = windows;
+    if (now > (windows.empty() ? 0 : windows.back().cycles)) {
+        result.push_back(currentWindow());
+    }
+    return result;
+}
+
+void MemoryHeatmap::writePages(std::ostream &output) const {
+    output << "page,address,reads,writes,executes\n";
+    for (std::size_t page = 0; page < pages; ++page) {
+        const Page &counts = page_counts[page];
+        output << page << ',' << page * page_size << ',' << counts.reads
+               << ',' << counts.writes << ',' << counts.executes << '\n';
+    }
+}
+
+void MemoryHeatmap::writeBytes(std::ostream &output) const {
+    output << "address,reads,writes,executes\n";
+    if (!per_byte) {
+        return;
+    }
+    for (std::size_t address = 0; address < 0x10000; ++address) {
+        const uint32_t reads = byte_counts[read][address];
+        const uint32_t writes = byte_counts[write][address];
+        const uint32_t executes = byte_counts[execute][address];
+        if (reads || writes || executes) {
+            output << address << ',' << reads << ',' << writes << ','
+                   << executes << '\n';
+        }
+    }
+}
+
+void MemoryHeatmap::writeWorkingSet(std::ostream &output) const {
+    output << "cycles,read,written,executed,touched\n";
+    for (const WorkingSet &window : workingSet()) {
+        output << window.cycles << ',' << window.read << ','
+               << window.written << ',' << window.executed << ','
+               << window.touched << '\n';
+    }
+}
+
+void MemoryHeatmap::writeImage(std::ostream &output) const {
+    // the count of an access to a byte, from its page without byte counts
+    const auto countOf = [&](const Access access, const std::size_t byte) {
+        if (per_byte) {
+            return uint64_t(byte_counts[access][byte]);
+        }
+        const Page &page = page_counts[byte / page_size];
+        return access == read    ? page.reads
+               : access == write ? page.writes
+                                 : page.executes;
+    };
+
+    // scale each colour so its largest count is full brightness
+    std::array<double, 3> scale = {};
+    for (const Access access : {read, write, execute}) {
+        uint64_t most = 0;
+        for (std::size_t byte = 0; byte < 0x10000; ++byte) {
+            most = std::max(most, countOf(access, byte));
+        }
+        scale[access] = most ? 255 / std::log1p(double(most)) : 0;
+    }
+
+    output << "P6\n256 256\n255\n";
+    for (std::size_t byte = 0; byte < 0x10000; ++byte) {
+        for (const Access access : {write, read, execute}) {
+            output.put(char(std::lround(
+                std::log1p(double(countOf(access, byte))) * scale[access])));
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#ifndef INTEL_8080_HEATMAP_H
+#define INTEL_8080_HEATMAP_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+/**
+ * Records how a CPU touches its memory: reads, writes and instruction
+ * fetches per 256 byte page, and optionally per byte, over a run.
+ *
+ * Bytes that are both executed and written are code/data overlap. A
+ * store to a byte that was already executed is self-modifying code, and
+ * each such address is kept with the instruction that last stored to it.
+ *
+ * Time is the CPU's clock cycles. The pages touched in each window of
+ * window_cycles make up the working set over time.
+ *
+ * Only fed by a CPU built with EMU8080_HEATMAP, see Intel8080::heatmap.
+ */
+class MemoryHeatmap {
+  public:
+    static constexpr std::size_t pages = 256;
+    static constexpr std::size_t page_size = 256;
+
+    enum Access { read = 0, write = 1, execute = 2 };
+
+    struct Page {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        uint64_t executes = 0;
+    };
+
+    // A store to a byte that had been executed
+    struct ModifiedCode {
+        uint16_t address;
+        // the instruction that made the last such store
+        uint16_t instruction;
+        uint64_t writes;
+    };
+
+    // The pages touched in one window of time
+    struct WorkingSet {
+        // the cycles at the end of the window
+        uint64_t cycles;
+        uint16_t read;
+        uint16_t written;
+        uint16_t executed;
+        uint16_t touched;
+    };
+
+    /**
+     * Parameters:
+     *     per_byte - Also count each access per byte
+     *     window_cycles - The length of a working set window
+     */
+    explicit MemoryHeatmap(const bool per_byte = false,
+                           const uint64_t window_cycles = 100000);
+
+    /**
+     * Record the opcode fetch of an instruction
+     */
+    void instruction(const uint16_t address) {
+        current_instruction = address;
+        record(execute, address, 1, 1);
+        markExecuted(address, 1);
+    }
+
+    /**
+     * Record accesses of length bytes from address, times times over
+     */
+    void fetch(const uint16_t address, const std::size_t length,
+               const uint64_t times = 1) {
+        record(execute, address, length, times);
+        markExecuted(address, length);
+    }
+    void load(const uint16_t address, const std::size_t length,
+              const uint64_t times = 1) {
+        record(read, address, length, times);
+    }
+    void store(const uint16_t address, const std::size_t length);
+
+    /**
+     * Advance time by the cycles of an instruction
+     */
+    void step(const std::size_t cycles) {
+        now += cycles;
+        if (now >= window_end) {
+            closeWindow();
+        }
+    }
+
+    /**
+     * Clear every count and start again at cycle 0
+     */
+    void reset();
+
+    const std::array<Page, pages> &pageCounts() const { return page_counts; }
+
+    /**
+     * Returns: The count of one kind of access to each byte, empty
+     *          unless counting per byte
+     */
+    const std::vector<uint32_t> &byteCounts(const Access access) const {
+        return byte_counts[access];
+    }
+
+    /**
+     * Returns: The number of bytes both executed and written
+     */
+    std::size_t overlapBytes() const;
+
+    std::vector<ModifiedCode> modifiedCode() const;
+
+    /**
+     * Returns: The working set of every window so far, including the
+     *          current one
+     */
+    std::vector<WorkingSet> workingSet() const;
+
+    uint64_t cycles() const { return now; }
+
+    /**
+     * Write the page counts, the byte counts of touched bytes, or the
+     * working set, as CSV
+     */
+    void writePages(std::ostream &output) const;
+    void writeBytes(std::ostream &output) const;
+    void writeWorkingSet(std::ostream &output) const;
+
+    /**
+     * Write a 256x256 PPM image with a row per page and a pixel per byte:
+     * red for writes, green for reads and blue for execution, on a log
+     * scale. Without byte counts every byte of a page has its page count.
+     */
+    void writeImage(std::ostream &output) const;
+
+  private:
+    using PageSet = std::array<uint64_t, pages / 64>;
+
+    const bool per_byte;
+    const uint64_t window_cycles;
+
+    std::array<Page, pages> page_counts;
+    std::array<std::vector<uint32_t>, 3> byte_counts;
+
+    // one bit per byte
+    std::vector<uint64_t> executed;
+    std::vector<uint64_t> written;
+    std::map<uint16_t, ModifiedCode> modified;
+    uint16_t current_instruction = 0;
+
+    uint64_t now = 0;
+    uint64_t window_end;
+    std::array<PageSet, 3> window_pages;
+    std::vector<WorkingSet> windows;
+
+    void record(const Access access, const uint16_t address,
+                const std::size_t length, const uint64_t times) {
+        // accesses wrap around memory as the address does
+        for (std::size_t i = 0; i < length; ++i) {
+            const uint16_t byte = address + i;
+            const std::size_t page = byte >> 8;
+            uint64_t &count = access == read    ? page_counts[page].reads
+                              : access == write ? page_counts[page].writes
+                                                : page_counts[page].executes;
+            count += times;
+            window_pages[access][page / 64] |= uint64_t(1) << (page % 64);
+            if (per_byte) {
+                byte_counts[access][byte] += times;
+            }
+        }
+    }
+
+    void markExecuted(const uint16_t address, const std::size_t length) {
+        for (std::size_t i = 0; i < length; ++i) {
+            const uint16_t byte = address + i;
+            executed[byte / 64] |= uint64_t(1) << (byte % 64);
+        }
+    }
+
+    WorkingSet currentWindow() const;
+    void closeWindow();
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "i8085.h"
+#include "alu.h"
+
+std::size_t Intel8085::execute() { return runUntil(UINT64_MAX); }
+
+std::size_t Intel8085::execute(std::size_t target_cycles) {
+    return runUntil(deadlineAfter(target_cycles));
+}
+
+std::size_t Intel8085::runUntil(const uint64_t deadline) {
+    const uint64_t start = cycle_count;
+    if (beginRun(deadline)) {
+        while ((!halted || interruptPending()) && cycle_count < runDeadline())
+            step();
+    }
+    endRun();
+    return cycle_count - start;
+}
+
+void Intel8085::trap() { trap_pending = true; }
+
+void Intel8085::rst75() { pending |= rst75_bit; }
+
+void Intel8085::setRst65(const bool level) {
+    pending = level ? pending | rst65_bit : pending & ~rst65_bit;
+}
+
+void Intel8085::setRst55(const bool level) {
+    pending = level ? pending | rst55_bit : pending & ~rst55_bit;
+}
+
+void Intel8085::reset() {
+    Intel8080::reset();
+    interrupts_enabled = false;
+    interrupt_masks = rst55_bit | rst65_bit | rst75_bit;
+    pending &= ~rst75_bit;
+    trap_pending = false;
+    serial_output = false;
+}
+
+std::size_t Intel8085::step() {
+    if (interruptPending()) {
+        return takeInterrupt();
+    }
+    return dispatch<variant::Intel8085>();
+}
+
+bool Intel8085::interruptPending() const {
+    return trap_pending || (interrupts_enabled && (pending & ~interrupt_masks));
+}
+
+std::size_t Intel8085::takeInterrupt() {
+    uint16_t vector;
+    if (trap_pending) {
+        trap_pending = false;
+        vector = 0x24;
+    } else {
+        const uint8_t unmasked = pending & ~interrupt_masks;
+        if (unmasked & rst75_bit) {
+            pending &= ~rst75_bit;
+            vector = 0x3c;
+        } else if (unmasked & rst65_bit) {
+            vector = 0x34;
+        } else {
+            vector = 0x2c;
+        }
+    }
+
+    countInterrupt();
+    haltEnded();
+    halted = false;
+    interrupts_enabled = false;
+    push(program_counter);
+    program_counter = vector;
+    recordEdge();
+    cycle_count += 12;
+    return 12;
+}
+
+void Intel8085::rim() {
+    register_A = serial_input << 7;
+    register_A |= (pending & (rst55_bit | rst65_bit | rst75_bit)) << 4;
+    register_A |= interrupts_enabled << 3;
+    register_A |= interrupt_masks;
+}
+
+void Intel8085::sim() {
+    // mask set enable
+    if (register_A & 0x08) {
+        interrupt_masks = register_A & 0x07;
+    }
+    // reset RST 7.5
+    if (register_A & 0x10) {
+        pending &= ~rst75_bit;
+    }
+    // serial output enable
+    if (register_A & 0x40) {
+        serial_output = register_A & 0x80;
+    }
+}
+
+void Intel8085::dsub() {
+    const uint32_t result = register_HL - register_BC;
+    const uint8_t high = result >> 8;
+    alu::updateZSP(*this, high);
+    flag_Z = (result & 0xffff) == 0;
+    flag_A = ~(high ^ register_H ^ register_B) & 0x10;
+    flag_C = result > 0xffff;
+    flag_V = (register_HL ^ register_BC) & (register_HL ^ result) & 0x8000;
+    flag_K = flag_S ^ flag_V;
+    register_HL = result;
+}
+
+void Intel8085::arhl() {
+    flag_C = register_HL & 0x0001;
+    register_HL = (register_HL >> 1) | (register_HL & 0x8000);
+}
+
+void Intel8085::rdel() {
+    const bool carry = register_DE & 0x8000;
+    register_DE = (register_DE << 1) | flag_C;
+    flag_C = carry;
+    flag_V = ((register_DE >> 15) & 1) ^ flag_C;
+}
+
+bool Intel8085::rstv() {
+    countBranch(flag_V);
+    if (flag_V) {
+        push(program_counter);
+        program_counter = 0x40;
+    }
+    recordEdge();
+    return flag_V;
+}
@@ -0,0 +1,102 @@
+#ifndef INTEL_8080_I8085_H
+#define INTEL_8080_I8085_H
+
+#include <cstdint>
+
+#include "cpu.h"
+
+/**
+ * Intel 8085, the 8080 interpreter instantiated with the 8085 policy.
+ *
+ * Adds RIM and SIM, the serial pins, the TRAP/RST 7.5/6.5/5.5 interrupt
+ * inputs, 8085 instruction timing and the undocumented instructions with
+ * their V (overflow) and K (sign xor overflow, INX/DCX wrap) flags.
+ */
+class Intel8085 : public Intel8080 {
+    friend class Intel8080;
+
+  public:
+    bool flag_V = false;
+    bool flag_K = false;
+
+    // The SID input pin, read by RIM, and the SOD output latch set by SIM
+    bool serial_input = false;
+    bool serial_output = false;
+
+    /**
+     * Execute until the CPU halts and no unmasked interrupt is pending,
+     * or an exit is requested
+     * Parameters:
+     *     cycles (optional) - The target cycles to execute
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t execute();
+    std::size_t execute(std::size_t target_cycles);
+
+    /**
+     * Execute until cycle_count reaches the deadline, the CPU halts with
+     * no unmasked interrupt pending or an exit is requested, see
+     * Intel8080::runUntil()
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t runUntil(const uint64_t deadline);
+
+    // the CALL supplied on INTA takes a cycle more than on the 8080
+    static constexpr std::size_t interrupt_call_cycles = 18;
+
+    /**
+     * Raise the non-maskable TRAP input, taken before the next instruction
+     */
+    void trap();
+
+    /**
+     * Latch a rising edge on RST 7.5, held until taken or reset by SIM
+     */
+    void rst75();
+
+    /**
+     * Set the level of the RST 6.5 and RST 5.5 inputs
+     */
+    void setRst65(const bool level);
+    void setRst55(const bool level);
+
+    /**
+     * Reset the CPU's state
+     * - As Intel8080::reset(), but disables interrupts as RESET IN does
+     * - Masks RST 7.5, 6.5 and 5.5 and clears pending interrupts
+     */
+    void reset();
+
+    /**
+     * Take a pending interrupt or execute the next instruction
+     * Returns: How many clock cycles the CPU executed
+     */
+    std::size_t step();
+
+    /**
+     * Returns: True if TRAP or an unmasked RST is waiting to be taken
+     */
+    bool interruptPending() const;
+
+  private:
+    // bits of pending and interrupt_masks, in the order RIM and SIM use
+    static constexpr uint8_t rst55_bit = 0x01;
+    static constexpr uint8_t rst65_bit = 0x02;
+    static constexpr uint8_t rst75_bit = 0x04;
+
+    uint8_t interrupt_masks = rst55_bit | rst65_bit | rst75_bit;
+    uint8_t pending = 0;
+    bool trap_pending = false;
+
+    std::size_t takeInterrupt();
+
+    // 8085 only instructions, called from dispatch<variant::Intel8085>
+    void rim();
+    void sim();
+    void dsub();
+    void arhl();
+    void rdel();
+    bool rstv();
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "invaders.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr uint32_t rgba(const uint8_t red, const uint8_t green,
+                        const uint8_t blue) {
+    return std::bit_cast<uint32_t>(
+        std::array<uint8_t, 4>{red, green, blue, 0xff});
+}
+
+constexpr uint32_t black = rgba(0x00, 0x00, 0x00);
+constexpr uint32_t white = rgba(0xff, 0xff, 0xff);
+constexpr uint32_t red = rgba(0xff, 0x20, 0x20);
+constexpr uint32_t green = rgba(0x20, 0xff, 0x20);
+
+// the cellophane strips: red over the saucer, green over the shields and
+// the player, and the green strip at the bottom stops short of the credits
+constexpr std::size_t bottom_strip = 240;
+constexpr std::size_t bottom_strip_start = 16;
+constexpr std::size_t bottom_strip_end = 134;
+
+uint32_t lineColor(const std::size_t line) {
+    if (line >= 32 && line < 64) {
+        return red;
+    }
+    if (line >= 184 && line < 240) {
+        return green;
+    }
+    return white;
+}
+
+} // namespace
+
+SpaceInvaders::SpaceInvaders() {
+    cpu.memory.fill(0);
+    cpu.in = [this](uint8_t port) { return in(port); };
+    cpu.out = [this](uint8_t port, uint8_t value) { out(port, value); };
+}
+
+bool SpaceInvaders::loadRom(const std::string &path) {
+    std::vector<std::string> files = {path};
+    if (std::filesystem::is_directory(path)) {
+        files.clear();
+        for (const char *name :
+             {"invaders.h", "invaders.g", "invaders.f", "invaders.e"}) {
+            files.push_back((std::filesystem::path(path) / name).string());
+        }
+    }
+
+    std::size_t loaded = 0;
+    for (const std::string &file : files) {
+        std::ifstream input(file, std::ios::in | std::ios::binary);
+        input.read(reinterpret_cast<char *>(&cpu.memory[loaded]),
+                   rom_size - loaded);
+        loaded += input.gcount();
+    }
+    if (loaded != rom_size) {
+        return false;
+    }
+
+    cpu.reset();
+    frame_end = cpu.cycle_count + cycles_per_frame;
+    return true;
+}
+
+void SpaceInvaders::setInput(const Input input, const bool pressed) {
+    // the bit of port 1 or 2 for each input, in Input order
+    static constexpr uint8_t bits[] = {0x01, 0x04, 0x02, 0x10, 0x20,
+                                       0x40, 0x10, 0x20, 0x40, 0x04};
+    uint8_t &port = input < player_2_shot ? port_1 : port_2;
+    port = pressed ? port | bits[input] : port & ~bits[input];
+}
+
+std::size_t SpaceInvaders::runFrame() {
+    const uint64_t start = cpu.cycle_count;
+    runUntil(frame_end - cycles_per_frame / 2);
+    cpu.interrupt(1);
+    runUntil(frame_end);
+    cpu.interrupt(2);
+    frame_end += cycles_per_frame;
+    return cpu.cycle_count - start;
+}
+
+void SpaceInvaders::runUntil(const uint64_t deadline) {
+    cpu.runUntil(deadline);
+    // a halted CPU waits for the next interrupt
+    if (cpu.halted) {
+        cpu.cycle_count = std::max(cpu.cycle_count, deadline);
+    }
+}
+
+uint8_t SpaceInvaders::in(const uint8_t port) {
+    switch (port) {
+    case 0:
+        return 0x0e;
+    case 1:
+        return port_1;
+    case 2:
+        return (port_2 & 0x74) | (dip_switches & 0x8b);
+    case 3:
+        return shift_register >> (8 - shift_offset);
+    default:
+        return 0;
+    }
+}
+
+void SpaceInvaders::out(const uint8_t port, const uint8_t value) {
+    switch (port) {
+    case 2:
+        shift_offset = value & 0x07;
+        break;
+    case 3:
+        sound_1 = value;
+        break;
+    case 4:
+        shift_register = (value << 8) | (shift_register >> 8);
+        break;
+    case 5:
+        sound_2 = value;
+        break;
+    }
+}
+
+InvadersRenderer::InvadersRenderer()
+    : pixels(width * height, black), previous{}, dirty{} {}
+
+std::size_t InvadersRenderer::render(const uint8_t *video_ram) {
+    // bit b of byte k set when bit b of byte k of any column changed,
+    // which is line 255 - (8k + b) of the rotated screen
+    alignas(32) std::array<uint8_t, 32> changed;
+    if (!drawn) {
+        changed.fill(0xff);
+        drawn = true;
+    } else {
+#ifdef __AVX2__
+        __m256i any = _mm256_setzero_si256();
+        for (std::size_t i = 0; i < previous.size(); i += 32) {
+            const __m256i now = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(video_ram + i));
+            const __m256i before = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(&previous[i]));
+            any = _mm256_or_si256(any, _mm256_xor_si256(now, before));
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i *>(changed.data()), any);
+#else
+        changed.fill(0);
+        for (std::size_t i = 0; i < previous.size(); ++i) {
+            changed[i % 32] |= video_ram[i] ^ previous[i];
+        }
+#endif
+    }
+    std::memcpy(previous.data(), video_ram, previous.size());
+
+    dirty.fill(0);
+    std::size_t lines = 0;
+    std::array<uint8_t, width> columns;
+    for (std::size_t k = 0; k < 32; ++k) {
+        if (!changed[k]) {
+            continue;
+        }
+        for (std::size_t x = 0; x < width; ++x) {
+            columns[x] = video_ram[x * 32 + k];
+        }
+        for (int bit = 0; bit < 8; ++bit) {
+            if (changed[k] >> bit & 1) {
+                const std::size_t line = height - 1 - (k * 8 + bit);
+                renderLine(line, columns.data(), bit);
+                dirty[line / 64] |= uint64_t(1) << (line % 64);
+                ++lines;
+            }
+        }
+    }
+    return lines;
+}
+
+void InvadersRenderer::renderLine(const std::size_t line,
+                                  const uint8_t *columns, const int bit) {
+    uint32_t *row = &pixels[line * width];
+    const uint32_t color = lineColor(line);
+#ifdef __AVX2__
+    const __m256i mask = _mm256_set1_epi32(1 << bit);
+    const __m256i lit = _mm256_set1_epi32(color);
+    const __m256i unlit = _mm256_set1_epi32(black);
+    for (std::size_t x = 0; x < width; x += 8) {
+        const __m256i bytes = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(columns + x)));
+        const __m256i on =
+            _mm256_cmpeq_epi32(_mm256_and_si256(bytes, mask), mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + x),
+                            _mm256_blendv_epi8(unlit, lit, on));
+    }
+#else
+    for (std::size_t x = 0; x < width; ++x) {
+        row[x] = columns[x] >> bit & 1 ? color : black;
+    }
+#endif
+    if (line >= bottom_strip) {
+        for (std::size_t x = bottom_strip_start; x < bottom_strip_end; ++x) {
+            row[x] = row[x] == black ? black : green;
+        }
+    }
+}
+
+bool InvadersRenderer::writePpm(const std::string &path) const {
+    std::ofstream output(path, std::ios::out | std::ios::binary);
+    output << "P6\n" << width << " " << height << "\n255\n";
+    const uint8_t *pixel = frame();
+    for (std::size_t i = 0; i < width * height; ++i, pixel += 4) {
+        output.write(reinterpret_cast<const char *>(pixel), 3);
+    }
+    return output.good();
+}
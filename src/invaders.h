@@ -0,0 +1,157 @@
+#ifndef INTEL_8080_INVADERS_H
+#define INTEL_8080_INVADERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+
+/**
+ * Midway's Space Invaders arcade machine.
+ *
+ * An 8080 at 2 MHz with 8 KB of ROM at 0x0000, RAM from 0x2000 and 1 bit
+ * per pixel video RAM at 0x2400. The video hardware interrupts twice a
+ * frame at 60 Hz: RST 1 when the beam reaches the middle of the screen
+ * and RST 2 at the start of vertical blank. A shift register on the I/O
+ * ports shifts sprites into place.
+ *
+ * Ports:
+ *     IN 0, 1, 2 - Controls and DIP switches, see setInput()
+ *     IN 3       - The shift register's result
+ *     OUT 2      - The shift register's result offset
+ *     OUT 4      - Shifts a byte into the shift register
+ *     OUT 3, 5   - Sound latches, see sound_1 and sound_2
+ *     OUT 6      - Watchdog, ignored
+ */
+class SpaceInvaders {
+  public:
+    static constexpr std::size_t clock_rate = 2000000;
+    static constexpr std::size_t frame_rate = 60;
+    static constexpr std::size_t cycles_per_frame = clock_rate / frame_rate;
+
+    static constexpr std::size_t rom_size = 0x2000;
+    static constexpr uint16_t video_ram = 0x2400;
+    static constexpr std::size_t video_ram_size = 0x1c00;
+
+    enum Input {
+        coin,
+        player_1_start,
+        player_2_start,
+        player_1_shot,
+        player_1_left,
+        player_1_right,
+        player_2_shot,
+        player_2_left,
+        player_2_right,
+        tilt,
+    };
+
+    Intel8080 cpu;
+
+    // The last values written to the sound ports, one bit per sound
+    uint8_t sound_1 = 0;
+    uint8_t sound_2 = 0;
+
+    /**
+     * DIP switches, as read on IN 2: bits 0 and 1 add ships, bit 3 gives
+     * the extra ship at 1000 points instead of 1500 and bit 7 hides the
+     * coin information
+     */
+    uint8_t dip_switches = 0x00;
+
+    SpaceInvaders();
+
+    /**
+     * Load the ROM from either a single 8 KB file or a directory with
+     * the four 2 KB files invaders.h, invaders.g, invaders.f and
+     * invaders.e, and reset the machine
+     * Returns: False when the ROM could not be read
+     */
+    bool loadRom(const std::string &path);
+
+    /**
+     * Press or release a control
+     */
+    void setInput(const Input input, const bool pressed);
+
+    /**
+     * Run one frame, interrupting the CPU at mid-screen and at vertical
+     * blank. Cycles run past the end of a frame are taken off the next.
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t runFrame();
+
+    /**
+     * Returns: The video RAM, 224 lines of 32 bytes from the bottom left
+     *          of the screen, least significant bit first
+     */
+    const uint8_t *videoRam() const { return &cpu.memory[video_ram]; }
+
+  private:
+    uint8_t port_1 = 0x08;
+    uint8_t port_2 = 0x00;
+    uint16_t shift_register = 0;
+    uint8_t shift_offset = 0;
+
+    // the cpu.cycle_count the current frame ends at
+    uint64_t frame_end = cycles_per_frame;
+
+    uint8_t in(const uint8_t port);
+    void out(const uint8_t port, const uint8_t value);
+    void runUntil(const uint64_t deadline);
+};
+
+/**
+ * Renders the video RAM of SpaceInvaders to RGBA frames as the monitor,
+ * which is mounted on its side, shows them, with the colored cellophane
+ * strips of the cabinet.
+ *
+ * Only the lines that changed since the last render are converted.
+ */
+class InvadersRenderer {
+  public:
+    static constexpr std::size_t width = 224;
+    static constexpr std::size_t height = 256;
+
+    InvadersRenderer();
+
+    /**
+     * Convert the lines of video RAM that changed since the last render
+     * Returns: The number of lines redrawn
+     */
+    std::size_t render(const uint8_t *video_ram);
+
+    /**
+     * Returns: The frame, width * height pixels from the top left, each
+     *          four bytes in the order red, green, blue, alpha
+     */
+    const uint8_t *frame() const {
+        return reinterpret_cast<const uint8_t *>(pixels.data());
+    }
+
+    /**
+     * Returns: True when the line was redrawn by the last render
+     */
+    bool isDirty(const std::size_t line) const {
+        return dirty[line / 64] >> (line % 64) & 1;
+    }
+
+    /**
+     * Write the frame as a binary PPM image
+     * Returns: False when the file could not be written
+     */
+    bool writePpm(const std::string &path) const;
+
+  private:
+    std::vector<uint32_t> pixels;
+    std::array<uint8_t, SpaceInvaders::video_ram_size> previous;
+    std::array<uint64_t, height / 64> dirty;
+    bool drawn = false;
+
+    void renderLine(const std::size_t line, const uint8_t *columns,
+                    const int bit);
+};
+
+#endif
@@ -0,0 +1,815 @@
+#include "lockstep.h"
+#include "opcodes.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// register fields of the opcode
+constexpr int field_H = 4;
+constexpr int field_L = 5;
+constexpr int field_M = 6;
+constexpr int field_A = 7;
+
+// register pair fields of the opcode
+constexpr int pair_BC = 0;
+constexpr int pair_DE = 1;
+constexpr int pair_HL = 2;
+constexpr int pair_SP = 3;
+
+constexpr std::size_t memory_size = 0x10000;
+
+// lanes are padded by a cache line so the same address in each lane maps
+// to a different cache set instead of all aliasing on 64K boundaries
+constexpr std::size_t lane_stride = memory_size + 64;
+
+inline uint8_t parity(const uint8_t value) {
+    return (0x9669 >> ((value ^ (value >> 4)) & 0x0f)) & 1;
+}
+
+} // namespace
+
+template <std::size_t Lanes>
+LockstepIntel8080<Lanes>::LockstepIntel8080()
+    : memory_block(new uint8_t[Lanes * lane_stride]()) {
+    for (Bytes &reg : registers) {
+        reg.fill(0);
+    }
+    flag_S.fill(0);
+    flag_Z.fill(0);
+    flag_A.fill(0);
+    flag_P.fill(0);
+    flag_C.fill(0);
+    stack_pointer.fill(0);
+    program_counter.fill(0);
+    halted.fill(false);
+    interrupts_enabled.fill(true);
+    cycles.fill(0);
+    active.fill(0);
+    uniform.fill(0);
+}
+
+template <std::size_t Lanes>
+uint8_t *LockstepIntel8080<Lanes>::memory(const std::size_t lane) {
+    // the caller may change code, so every byte must be compared again
+    uniform.fill(0);
+    return laneMemory(lane);
+}
+
+template <std::size_t Lanes>
+const uint8_t *LockstepIntel8080<Lanes>::memory(const std::size_t lane) const {
+    return laneMemory(lane);
+}
+
+template <std::size_t Lanes>
+uint8_t *LockstepIntel8080<Lanes>::laneMemory(const std::size_t lane) const {
+    return memory_block.get() + lane * lane_stride;
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::write(const std::size_t lane,
+                                     const uint16_t address,
+                                     const uint8_t value) {
+    laneMemory(lane)[address] = value;
+    uniform[address] = 0;
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::load(const std::size_t lane,
+                                    const Intel8080 &cpu) {
+    registers[0][lane] = cpu.register_B;
+    registers[1][lane] = cpu.register_C;
+    registers[2][lane] = cpu.register_D;
+    registers[3][lane] = cpu.register_E;
+    registers[field_H][lane] = cpu.register_H;
+    registers[field_L][lane] = cpu.register_L;
+    registers[field_A][lane] = cpu.register_A;
+    flag_S[lane] = cpu.flag_S;
+    flag_Z[lane] = cpu.flag_Z;
+    flag_A[lane] = cpu.flag_A;
+    flag_P[lane] = cpu.flag_P;
+    flag_C[lane] = cpu.flag_C;
+    stack_pointer[lane] = cpu.stack_pointer;
+    program_counter[lane] = cpu.program_counter;
+    halted[lane] = cpu.halted;
+    interrupts_enabled[lane] = cpu.interrupts_enabled;
+    cycles[lane] = 0;
+    std::memcpy(memory(lane), cpu.memory.data(), memory_size);
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::store(const std::size_t lane,
+                                     Intel8080 &cpu) const {
+    cpu.register_B = registers[0][lane];
+    cpu.register_C = registers[1][lane];
+    cpu.register_D = registers[2][lane];
+    cpu.register_E = registers[3][lane];
+    cpu.register_H = registers[field_H][lane];
+    cpu.register_L = registers[field_L][lane];
+    cpu.register_A = registers[field_A][lane];
+    cpu.flags = packFlags(lane);
+    cpu.flag_S = flag_S[lane];
+    cpu.flag_Z = flag_Z[lane];
+    cpu.flag_A = flag_A[lane];
+    cpu.flag_P = flag_P[lane];
+    cpu.flag_C = flag_C[lane];
+    cpu.stack_pointer = stack_pointer[lane];
+    cpu.program_counter = program_counter[lane];
+    cpu.halted = halted[lane];
+    cpu.interrupts_enabled = interrupts_enabled[lane];
+    std::memcpy(cpu.memory.data(), laneMemory(lane), memory_size);
+}
+
+template <std::size_t Lanes> std::size_t LockstepIntel8080<Lanes>::execute() {
+    return execute(SIZE_MAX);
+}
+
+template <std::size_t Lanes>
+std::size_t LockstepIntel8080<Lanes>::execute(std::size_t target_cycles) {
+    target = target_cycles;
+    std::size_t issued = 0;
+    while (issue()) {
+        ++issued;
+    }
+    target = SIZE_MAX;
+    converged = false;
+    return issued;
+}
+
+template <std::size_t Lanes> std::size_t LockstepIntel8080<Lanes>::step() {
+    // registers may have been changed since the last call
+    converged = false;
+    const std::size_t count = issue();
+    converged = false;
+    return count;
+}
+
+template <std::size_t Lanes> std::size_t LockstepIntel8080<Lanes>::issue() {
+    std::size_t leader = group_leader;
+    if (!converged) {
+        leader = selectGroup();
+        if (leader == Lanes) {
+            return 0;
+        }
+    } else if (!matchCode(leader)) {
+        converged = false;
+    }
+
+    const uint16_t pc = program_counter[leader];
+    const uint8_t *code = laneMemory(leader);
+    const uint8_t opcode = code[pc];
+    const uint8_t operands[2] = {code[uint16_t(pc + 1)],
+                                 code[uint16_t(pc + 2)]};
+    const opcodes::Descriptor &descriptor = opcodes::descriptors[opcode];
+    const uint16_t next = pc + descriptor.length;
+    const std::size_t timing = descriptor.cycles;
+
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        program_counter[i] = active[i] ? next : program_counter[i];
+        cycles[i] += active[i] ? timing : 0;
+        count += active[i];
+    }
+
+    dispatch(opcode, operands);
+
+    // a fully converged group stays together unless a conditional or
+    // computed branch sent its lanes to different places, or HLT ran
+    constexpr uint16_t diverging =
+        opcodes::conditional | opcodes::ret | opcodes::indirect;
+    if (converged && (descriptor.effects & diverging)) {
+        const uint16_t target_pc = program_counter[leader];
+        uint8_t together = 1;
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            together &= !active[i] | (program_counter[i] == target_pc);
+        }
+        converged = together;
+    }
+    if (descriptor.effects & opcodes::halt) {
+        converged = false;
+    }
+    return count;
+}
+
+template <std::size_t Lanes>
+std::size_t LockstepIntel8080<Lanes>::selectGroup() {
+    // reductions over the lanes still running, written to vectorize
+    Bytes runnable;
+    uint8_t any = 0;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        runnable[i] = uint8_t(!halted[i]) & uint8_t(cycles[i] < target);
+        any |= runnable[i];
+    }
+    if (!any) {
+        return Lanes;
+    }
+
+    uint16_t lowest_pc = 0xffff;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        const uint16_t pc = runnable[i] ? program_counter[i] : 0xffff;
+        lowest_pc = pc < lowest_pc ? pc : lowest_pc;
+    }
+
+    std::size_t fewest_cycles = SIZE_MAX;
+    std::size_t most_cycles = 0;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        const std::size_t low = runnable[i] ? cycles[i] : SIZE_MAX;
+        const std::size_t high = runnable[i] ? cycles[i] : 0;
+        fewest_cycles = low < fewest_cycles ? low : fewest_cycles;
+        most_cycles = high > most_cycles ? high : most_cycles;
+    }
+
+    std::size_t leader = 0;
+    if (most_cycles - fewest_cycles > divergence_window) {
+        while (!runnable[leader] || cycles[leader] != fewest_cycles) {
+            ++leader;
+        }
+    } else {
+        while (!runnable[leader] || program_counter[leader] != lowest_pc) {
+            ++leader;
+        }
+    }
+
+    const uint16_t pc = program_counter[leader];
+    uint8_t everyone = 1;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        active[i] = runnable[i] & (program_counter[i] == pc);
+        everyone &= active[i] == runnable[i];
+    }
+
+    // with no cycle target, a group holding every running lane stays
+    // together until the next branch and need not be selected again
+    converged = matchCode(leader) && everyone && target == SIZE_MAX;
+    group_leader = leader;
+    return leader;
+}
+
+template <std::size_t Lanes>
+bool LockstepIntel8080<Lanes>::matchCode(const std::size_t leader) {
+    // lanes only join the group when they decode the same instruction,
+    // which needs no comparison for bytes already known to be uniform
+    const uint16_t pc = program_counter[leader];
+    const uint8_t *code = laneMemory(leader);
+    const std::size_t length = opcodes::descriptors[code[pc]].length;
+    bool known = true;
+    for (std::size_t j = 0; j < length; ++j) {
+        known = known && uniform[uint16_t(pc + j)];
+    }
+    if (known) {
+        return true;
+    }
+
+    bool kept = true;
+    for (std::size_t j = 0; j < length; ++j) {
+        const uint16_t address = pc + j;
+        uint8_t same_everywhere = 1;
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            const bool same = laneMemory(i)[address] == code[address];
+            kept = kept && (same || !active[i]);
+            active[i] = active[i] && same;
+            same_everywhere &= same;
+        }
+        uniform[address] = same_everywhere;
+    }
+    return kept;
+}
+
+template <std::size_t Lanes>
+typename LockstepIntel8080<Lanes>::Bytes
+LockstepIntel8080<Lanes>::operand(const int field) const {
+    if (field != field_M) {
+        return registers[field];
+    }
+    Bytes value;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        value[i] = active[i] ? laneMemory(i)[pair(pair_HL, i)] : 0;
+    }
+    return value;
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::assign(const int field, const Bytes &value) {
+    if (field == field_M) {
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            if (active[i]) {
+                write(i, pair(pair_HL, i), value[i]);
+            }
+        }
+        return;
+    }
+    Bytes &reg = registers[field];
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        reg[i] = active[i] ? value[i] : reg[i];
+    }
+}
+
+template <std::size_t Lanes>
+uint16_t LockstepIntel8080<Lanes>::pair(const int field,
+                                        const std::size_t lane) const {
+    if (field == pair_SP) {
+        return stack_pointer[lane];
+    }
+    return (registers[field * 2][lane] << 8) | registers[field * 2 + 1][lane];
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::setPair(const int field, const std::size_t lane,
+                                       const uint16_t value) {
+    if (field == pair_SP) {
+        stack_pointer[lane] = value;
+        return;
+    }
+    registers[field * 2][lane] = value >> 8;
+    registers[field * 2 + 1][lane] = value;
+}
+
+template <std::size_t Lanes>
+typename LockstepIntel8080<Lanes>::Words
+LockstepIntel8080<Lanes>::pairs(const int field) const {
+    if (field == pair_SP) {
+        return stack_pointer;
+    }
+    const Bytes &high = registers[field * 2];
+    const Bytes &low = registers[field * 2 + 1];
+    Words value;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        value[i] = (high[i] << 8) | low[i];
+    }
+    return value;
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::assignPair(const int field, const Words &value) {
+    if (field == pair_SP) {
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            stack_pointer[i] = active[i] ? value[i] : stack_pointer[i];
+        }
+        return;
+    }
+    Bytes &high = registers[field * 2];
+    Bytes &low = registers[field * 2 + 1];
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        high[i] = active[i] ? value[i] >> 8 : high[i];
+        low[i] = active[i] ? value[i] & 0xff : low[i];
+    }
+}
+
+template <std::size_t Lanes>
+typename LockstepIntel8080<Lanes>::Bytes
+LockstepIntel8080<Lanes>::condition(const int field) const {
+    // NZ, Z, NC, C, PO, PE, P, M test a flag for clear (even) or set (odd)
+    const Bytes *flags[] = {&flag_Z, &flag_C, &flag_P, &flag_S};
+    const Bytes &flag = *flags[field >> 1];
+    const uint8_t expected = field & 1;
+
+    Bytes taken;
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        taken[i] = active[i] & (flag[i] == expected);
+    }
+    return taken;
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::updateZSP(const std::size_t lane,
+                                         const uint8_t result) {
+    flag_S[lane] = result >> 7;
+    flag_Z[lane] = result == 0;
+    flag_P[lane] = parity(result);
+}
+
+template <std::size_t Lanes>
+uint8_t LockstepIntel8080<Lanes>::packFlags(const std::size_t lane) const {
+    return 0x02 | (flag_S[lane] << 7) | (flag_Z[lane] << 6) |
+           (flag_A[lane] << 4) | (flag_P[lane] << 2) | flag_C[lane];
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::unpackFlags(const std::size_t lane,
+                                           const uint8_t flags) {
+    flag_S[lane] = (flags >> 7) & 1;
+    flag_Z[lane] = (flags >> 6) & 1;
+    flag_A[lane] = (flags >> 4) & 1;
+    flag_P[lane] = (flags >> 2) & 1;
+    flag_C[lane] = flags & 1;
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::push(const std::size_t lane,
+                                    const uint16_t word) {
+    write(lane, --stack_pointer[lane], word >> 8);
+    write(lane, --stack_pointer[lane], word);
+}
+
+template <std::size_t Lanes>
+uint16_t LockstepIntel8080<Lanes>::pop(const std::size_t lane) {
+    const uint8_t *mem = laneMemory(lane);
+    const uint8_t low = mem[stack_pointer[lane]++];
+    const uint8_t high = mem[stack_pointer[lane]++];
+    return (high << 8) | low;
+}
+
+/**
+ * ADD, ADC, SUB, SBB, ANA, XRA, ORA and CMP over all active lanes
+ */
+template <std::size_t Lanes>
+template <int Operation>
+void LockstepIntel8080<Lanes>::alu(const Bytes &value) {
+    Bytes &a = registers[field_A];
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        const uint8_t v = value[i];
+        uint16_t result;
+        uint8_t aux;
+        uint8_t carry;
+
+        if constexpr (Operation == 0 || Operation == 1) { // ADD, ADC
+            result = a[i] + v + (Operation == 1 ? flag_C[i] : 0);
+            aux = ((result ^ a[i] ^ v) >> 4) & 1;
+            carry = result > 0xff;
+        } else if constexpr (Operation == 2 || Operation == 3 ||
+                             Operation == 7) { // SUB, SBB, CMP
+            result = a[i] - v - (Operation == 3 ? flag_C[i] : 0);
+            aux = (~(result ^ a[i] ^ v) >> 4) & 1;
+            carry = result > 0xff;
+        } else if constexpr (Operation == 4) { // ANA
+            result = a[i] & v;
+            aux = ((a[i] | v) >> 3) & 1;
+            carry = 0;
+        } else { // XRA, ORA
+            result = Operation == 5 ? a[i] ^ v : a[i] | v;
+            aux = 0;
+            carry = 0;
+        }
+
+        const uint8_t low = result;
+        const bool m = active[i];
+        flag_S[i] = m ? low >> 7 : flag_S[i];
+        flag_Z[i] = m ? low == 0 : flag_Z[i];
+        flag_P[i] = m ? parity(low) : flag_P[i];
+        flag_A[i] = m ? aux : flag_A[i];
+        flag_C[i] = m ? carry : flag_C[i];
+        if constexpr (Operation != 7) {
+            a[i] = m ? low : a[i];
+        }
+    }
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::alu(const int operation, const Bytes &value) {
+    switch (operation) {
+    case 0:
+        alu<0>(value);
+        break;
+    case 1:
+        alu<1>(value);
+        break;
+    case 2:
+        alu<2>(value);
+        break;
+    case 3:
+        alu<3>(value);
+        break;
+    case 4:
+        alu<4>(value);
+        break;
+    case 5:
+        alu<5>(value);
+        break;
+    case 6:
+        alu<6>(value);
+        break;
+    default:
+        alu<7>(value);
+        break;
+    }
+}
+
+/**
+ * INR and DCR over all active lanes
+ */
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::increment(const int field,
+                                         const bool decrement) {
+    Bytes value = operand(field);
+    for (std::size_t i = 0; i < Lanes; ++i) {
+        const uint8_t result = decrement ? value[i] - 1 : value[i] + 1;
+        const uint8_t aux = decrement ? (result & 0xf) != 0xf
+                                      : (result & 0xf) == 0;
+        const bool m = active[i];
+        flag_S[i] = m ? result >> 7 : flag_S[i];
+        flag_Z[i] = m ? result == 0 : flag_Z[i];
+        flag_P[i] = m ? parity(result) : flag_P[i];
+        flag_A[i] = m ? aux : flag_A[i];
+        value[i] = result;
+    }
+    assign(field, value);
+}
+
+template <std::size_t Lanes>
+void LockstepIntel8080<Lanes>::dispatch(const uint8_t opcode,
+                                        const uint8_t *operands) {
+    const uint8_t data = operands[0];
+    const uint16_t address = (operands[1] << 8) | operands[0];
+    const int field = (opcode >> 3) & 7;
+    const int source = opcode & 7;
+    const int rp = (opcode >> 4) & 3;
+    Bytes &a = registers[field_A];
+
+    // runs a statement for every lane in the group
+    auto each = [this](auto &&body) {
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            if (active[i]) {
+                body(i);
+            }
+        }
+    };
+
+    if (opcode == 0x76) { // HLT
+        each([&](std::size_t i) { halted[i] = true; });
+        return;
+    }
+    if ((opcode & 0xc0) == 0x40) { // MOV r, r
+        assign(field, operand(source));
+        return;
+    }
+    if ((opcode & 0xc0) == 0x80) { // ALU r
+        alu(field, operand(source));
+        return;
+    }
+
+    switch (opcode & 0xc7) {
+    case 0x00: // NOP
+        return;
+    case 0x04: // INR r
+        increment(field, false);
+        return;
+    case 0x05: // DCR r
+        increment(field, true);
+        return;
+    case 0x06: // MVI r, d8
+    {
+        Bytes value;
+        value.fill(data);
+        assign(field, value);
+    }
+        return;
+    case 0xc6: // ALU d8
+    {
+        Bytes value;
+        value.fill(data);
+        alu(field, value);
+    }
+        return;
+    case 0xc0: // Rcc
+    {
+        const Bytes taken = condition(field);
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            if (taken[i]) {
+                program_counter[i] = pop(i);
+                cycles[i] += variant::Intel8080::return_taken_cycles;
+            }
+        }
+    }
+        return;
+    case 0xc2: // Jcc a16
+    {
+        const Bytes taken = condition(field);
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            program_counter[i] = taken[i] ? address : program_counter[i];
+        }
+    }
+        return;
+    case 0xc4: // Ccc a16
+    {
+        const Bytes taken = condition(field);
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            if (taken[i]) {
+                push(i, program_counter[i]);
+                program_counter[i] = address;
+                cycles[i] += variant::Intel8080::call_taken_cycles;
+            }
+        }
+    }
+        return;
+    case 0xc7: // RST n
+        each([&](std::size_t i) {
+            push(i, program_counter[i]);
+            program_counter[i] = opcode & 0x38;
+        });
+        return;
+    default:
+        break;
+    }
+
+    switch (opcode & 0xcf) {
+    case 0x01: // LXI rp, d16
+    {
+        Words value;
+        value.fill(address);
+        assignPair(rp, value);
+    }
+        return;
+    case 0x03: // INX rp
+    {
+        Words value = pairs(rp);
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            ++value[i];
+        }
+        assignPair(rp, value);
+    }
+        return;
+    case 0x09: // DAD rp
+    {
+        const Words value = pairs(rp);
+        Words result = pairs(pair_HL);
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            result[i] += value[i];
+            flag_C[i] = active[i] ? result[i] < value[i] : flag_C[i];
+        }
+        assignPair(pair_HL, result);
+    }
+        return;
+    case 0x0b: // DCX rp
+    {
+        Words value = pairs(rp);
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            --value[i];
+        }
+        assignPair(rp, value);
+    }
+        return;
+    case 0xc1: // POP rp
+        each([&](std::size_t i) {
+            const uint16_t value = pop(i);
+            if (rp == pair_SP) { // PSW
+                a[i] = value >> 8;
+                unpackFlags(i, value);
+            } else {
+                setPair(rp, i, value);
+            }
+        });
+        return;
+    case 0xc5: // PUSH rp
+        each([&](std::size_t i) {
+            push(i, rp == pair_SP ? (a[i] << 8) | packFlags(i)
+                                  : pair(rp, i));
+        });
+        return;
+    default:
+        break;
+    }
+
+    switch (opcode) {
+    case 0x02: // STAX B
+    case 0x12: // STAX D
+        each([&](std::size_t i) { write(i, pair(rp, i), a[i]); });
+        break;
+    case 0x0a: // LDAX B
+    case 0x1a: // LDAX D
+        each([&](std::size_t i) { a[i] = laneMemory(i)[pair(rp, i)]; });
+        break;
+    case 0x22: // SHLD a16
+        each([&](std::size_t i) {
+            write(i, address, registers[field_L][i]);
+            write(i, address + 1, registers[field_H][i]);
+        });
+        break;
+    case 0x2a: // LHLD a16
+        each([&](std::size_t i) {
+            registers[field_L][i] = laneMemory(i)[address];
+            registers[field_H][i] = laneMemory(i)[uint16_t(address + 1)];
+        });
+        break;
+    case 0x32: // STA a16
+        each([&](std::size_t i) { write(i, address, a[i]); });
+        break;
+    case 0x3a: // LDA a16
+        each([&](std::size_t i) { a[i] = laneMemory(i)[address]; });
+        break;
+
+    case 0x07: // RLC
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            const uint8_t carry = a[i] >> 7;
+            flag_C[i] = active[i] ? carry : flag_C[i];
+            a[i] = active[i] ? (a[i] << 1) | carry : a[i];
+        }
+        break;
+    case 0x0f: // RRC
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            const uint8_t carry = a[i] & 1;
+            flag_C[i] = active[i] ? carry : flag_C[i];
+            a[i] = active[i] ? (a[i] >> 1) | (carry << 7) : a[i];
+        }
+        break;
+    case 0x17: // RAL
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            const uint8_t result = (a[i] << 1) | flag_C[i];
+            flag_C[i] = active[i] ? a[i] >> 7 : flag_C[i];
+            a[i] = active[i] ? result : a[i];
+        }
+        break;
+    case 0x1f: // RAR
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            const uint8_t result = (a[i] >> 1) | (flag_C[i] << 7);
+            flag_C[i] = active[i] ? a[i] & 1 : flag_C[i];
+            a[i] = active[i] ? result : a[i];
+        }
+        break;
+    case 0x27: // DAA
+        each([&](std::size_t i) {
+            if (flag_C[i] || a[i] > 0x99) {
+                flag_C[i] = true;
+                a[i] += 0x60;
+            }
+            if (flag_A[i] || (a[i] & 0xf) > 0x9) {
+                flag_A[i] = (a[i] & 0xf) > 0x9;
+                a[i] += 0x06;
+            }
+            updateZSP(i, a[i]);
+        });
+        break;
+    case 0x2f: // CMA
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            a[i] = active[i] ? ~a[i] : a[i];
+        }
+        break;
+    case 0x37: // STC
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            flag_C[i] = active[i] ? 1 : flag_C[i];
+        }
+        break;
+    case 0x3f: // CMC
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            flag_C[i] = active[i] ? !flag_C[i] : flag_C[i];
+        }
+        break;
+
+    case 0xc3: // JMP a16
+    case 0xcb: // *JMP a16
+        each([&](std::size_t i) { program_counter[i] = address; });
+        break;
+    case 0xc9: // RET
+    case 0xd9: // *RET
+        each([&](std::size_t i) { program_counter[i] = pop(i); });
+        break;
+    case 0xcd: // CALL a16
+    case 0xdd: // *CALL a16
+    case 0xed: // *CALL a16
+    case 0xfd: // *CALL a16
+        each([&](std::size_t i) {
+            push(i, program_counter[i]);
+            program_counter[i] = address;
+        });
+        break;
+
+    case 0xd3: // OUT d8
+        each([&](std::size_t i) { out(i, data, a[i]); });
+        break;
+    case 0xdb: // IN d8
+        each([&](std::size_t i) { a[i] = in(i, data); });
+        break;
+
+    case 0xe3: // XTHL
+        each([&](std::size_t i) {
+            const uint8_t *mem = laneMemory(i);
+            const uint16_t sp = stack_pointer[i];
+            const uint8_t low = mem[sp];
+            const uint8_t high = mem[uint16_t(sp + 1)];
+            write(i, sp, registers[field_L][i]);
+            write(i, sp + 1, registers[field_H][i]);
+            registers[field_L][i] = low;
+            registers[field_H][i] = high;
+        });
+        break;
+    case 0xe9: // PCHL
+        each([&](std::size_t i) { program_counter[i] = pair(pair_HL, i); });
+        break;
+    case 0xeb: // XCHG
+        for (int r = 0; r < 2; ++r) {
+            Bytes &hl = registers[field_H + r];
+            Bytes &de = registers[2 + r];
+            for (std::size_t i = 0; i < Lanes; ++i) {
+                const uint8_t swapped = hl[i];
+                hl[i] = active[i] ? de[i] : hl[i];
+                de[i] = active[i] ? swapped : de[i];
+            }
+        }
+        break;
+    case 0xf9: // SPHL
+        each([&](std::size_t i) { stack_pointer[i] = pair(pair_HL, i); });
+        break;
+    case 0xf3: // DI
+        each([&](std::size_t i) { interrupts_enabled[i] = false; });
+        break;
+    case 0xfb: // EI
+        each([&](std::size_t i) { interrupts_enabled[i] = true; });
+        break;
+
+    default: // not reachable
+        break;
+    }
+}
+
+template class LockstepIntel8080<8>;
+template class LockstepIntel8080<16>;
+template class LockstepIntel8080<32>;
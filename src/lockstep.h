@@ -0,0 +1,141 @@
+#ifndef INTEL_8080_LOCKSTEP_H
+#define INTEL_8080_LOCKSTEP_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "cpu.h"
+
+/**
+ * Runs several independent 8080 states ("lanes") in lockstep.
+ *
+ * Registers are stored as structure-of-arrays, one array entry per lane,
+ * so an instruction is decoded once and applied to every lane whose PC
+ * and instruction bytes agree with simple loops the compiler vectorizes.
+ * Lanes that take different branches are split and run as separate
+ * groups, lowest PC first, which lets them meet again at join points.
+ *
+ * Each lane has its own 64K of memory. Lanes must be 8, 16 or 32.
+ */
+template <std::size_t Lanes> class LockstepIntel8080 {
+    static_assert(Lanes == 8 || Lanes == 16 || Lanes == 32,
+                  "lockstep engine supports 8, 16 or 32 lanes");
+
+  public:
+    using Bytes = std::array<uint8_t, Lanes>;
+    using Words = std::array<uint16_t, Lanes>;
+
+    // 8-bit registers indexed by the opcode register field:
+    // B, C, D, E, H, L, (unused for M), A
+    alignas(64) std::array<Bytes, 8> registers;
+
+    alignas(64) Bytes flag_S;
+    alignas(64) Bytes flag_Z;
+    alignas(64) Bytes flag_A;
+    alignas(64) Bytes flag_P;
+    alignas(64) Bytes flag_C;
+
+    alignas(64) Words stack_pointer;
+    alignas(64) Words program_counter;
+
+    std::array<bool, Lanes> halted;
+    std::array<bool, Lanes> interrupts_enabled;
+
+    // clock cycles executed by each lane
+    std::array<std::size_t, Lanes> cycles;
+
+    // Callbacks for interacting with I/O devices, called once per lane
+    std::function<uint8_t(std::size_t lane, uint8_t port)> in;
+    std::function<void(std::size_t lane, uint8_t port, uint8_t byte)> out;
+
+    LockstepIntel8080();
+
+    /**
+     * Returns: The 64K of memory belonging to a lane. Use the const
+     *          overload for reading, writable access is meant for setup
+     *          and makes the engine compare every instruction again.
+     */
+    uint8_t *memory(const std::size_t lane);
+    const uint8_t *memory(const std::size_t lane) const;
+
+    /**
+     * Copy the state of a CPU into a lane, resetting its cycle count
+     */
+    void load(const std::size_t lane, const Intel8080 &cpu);
+
+    /**
+     * Copy the state of a lane back into a CPU
+     */
+    void store(const std::size_t lane, Intel8080 &cpu) const;
+
+    /**
+     * Execute until every lane halts
+     * Parameters:
+     *     cycles (optional) - The target cycles for each lane
+     * Returns: The number of instructions issued across all groups
+     */
+    std::size_t execute();
+    std::size_t execute(std::size_t target_cycles);
+
+    /**
+     * Execute the next instruction of one group of agreeing lanes
+     * Returns: The number of lanes that executed, 0 once all are done
+     */
+    std::size_t step();
+
+  private:
+    // lanes further apart than this in cycles are scheduled by cycles
+    // rather than by lowest PC so a spinning lane cannot starve others
+    static constexpr std::size_t divergence_window = 4096;
+
+    std::unique_ptr<uint8_t[]> memory_block;
+
+    // 1 for addresses known to hold the same byte in every lane
+    std::array<uint8_t, 0x10000> uniform;
+
+    // 1 for lanes executing the current instruction, 0 otherwise
+    alignas(64) Bytes active;
+
+    std::size_t target = SIZE_MAX;
+
+    // every running lane is in the current group, led by group_leader
+    bool converged = false;
+    std::size_t group_leader = 0;
+
+    uint8_t *laneMemory(const std::size_t lane) const;
+    void write(const std::size_t lane, const uint16_t address,
+               const uint8_t value);
+
+    std::size_t issue();
+    std::size_t selectGroup();
+    bool matchCode(const std::size_t leader);
+    void dispatch(const uint8_t opcode, const uint8_t *operands);
+
+    // register access by opcode field, 6 addresses memory through HL
+    Bytes operand(const int field) const;
+    void assign(const int field, const Bytes &value);
+
+    // register pairs by opcode field: BC, DE, HL, SP
+    uint16_t pair(const int field, const std::size_t lane) const;
+    void setPair(const int field, const std::size_t lane, const uint16_t value);
+    Words pairs(const int field) const;
+    void assignPair(const int field, const Words &value);
+
+    // lanes of the group for which a branch condition holds
+    Bytes condition(const int field) const;
+
+    void updateZSP(const std::size_t lane, const uint8_t result);
+    uint8_t packFlags(const std::size_t lane) const;
+    void unpackFlags(const std::size_t lane, const uint8_t flags);
+
+    void push(const std::size_t lane, const uint16_t word);
+    uint16_t pop(const std::size_t lane);
+
+    template <int Operation> void alu(const Bytes &value);
+    void alu(const int operation, const Bytes &value);
+    void increment(const int field, const bool decrement);
+};
+
+#endif
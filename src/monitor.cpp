@@ -0,0 +1,137 @@
+#include "monitor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// the flags of an 8080 as PUSH PSW stores them
+uint8_t flagsOf(const Intel8080 &cpu) {
+    return cpu.flag_S << 7 | cpu.flag_Z << 6 | cpu.flag_A << 4 |
+           cpu.flag_P << 2 | cpu.flag_C;
+}
+
+} // namespace
+
+StatePublisher::StatePublisher(std::vector<Region> regions)
+    : watched(std::move(regions)) {
+    for (const Region &region : watched) {
+        watched_bytes += region.length;
+    }
+    const std::size_t words = (watched_bytes + 7) / 8;
+    memory = std::make_unique<std::atomic<uint64_t>[]>(words);
+    for (auto &word : registers) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+void StatePublisher::publish(const Intel8080 &cpu, const uint64_t cycles) {
+    store(cpu, flagsOf(cpu) | 0x02, cycles);
+}
+
+void StatePublisher::publish(const Intel8085 &cpu, const uint64_t cycles) {
+    store(cpu, flagsOf(cpu) | cpu.flag_K << 5 | cpu.flag_V << 1, cycles);
+}
+
+void StatePublisher::store(const Intel8080 &cpu, const uint8_t flags,
+                           const uint64_t cycles) {
+    // only this thread writes the sequence, so it is read relaxed
+    const uint64_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // pack the registers, see tryRead()
+    const uint64_t bytes =
+        uint64_t(cpu.register_A) | uint64_t(cpu.register_B) << 8 |
+        uint64_t(cpu.register_C) << 16 | uint64_t(cpu.register_D) << 24 |
+        uint64_t(cpu.register_E) << 32 | uint64_t(cpu.register_H) << 40 |
+        uint64_t(cpu.register_L) << 48 | uint64_t(flags) << 56;
+    const uint64_t pointers =
+        uint64_t(cpu.stack_pointer) | uint64_t(cpu.program_counter) << 16 |
+        uint64_t(cpu.halted) << 32 | uint64_t(cpu.interrupts_enabled) << 33;
+    registers[0].store(bytes, std::memory_order_relaxed);
+    registers[1].store(pointers, std::memory_order_relaxed);
+    registers[2].store(cycles, std::memory_order_relaxed);
+    registers[3].store(++publishes, std::memory_order_relaxed);
+
+    // copy the regions back to back, eight bytes to a word
+    std::size_t offset = 0;
+    uint64_t word = 0;
+    for (const Region &region : watched) {
+        const uint8_t *source = cpu.memory.data() + region.address;
+        uint32_t i = 0;
+        // whole words while the output is aligned
+        for (; offset % 8 == 0 && i + 8 <= region.length; i += 8) {
+            std::memcpy(&word, source + i, 8);
+            memory[offset / 8].store(word, std::memory_order_relaxed);
+            offset += 8;
+            word = 0;
+        }
+        for (; i < region.length; ++i, ++offset) {
+            reinterpret_cast<uint8_t *>(&word)[offset % 8] = source[i];
+            if (offset % 8 == 7) {
+                memory[offset / 8].store(word, std::memory_order_relaxed);
+                word = 0;
+            }
+        }
+    }
+    if (offset % 8) {
+        memory[offset / 8].store(word, std::memory_order_relaxed);
+    }
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+bool StatePublisher::tryRead(Registers &result, uint8_t *bytes) const {
+    const uint64_t start = sequence.load(std::memory_order_acquire);
+    if (start & 1) {
+        return false;
+    }
+
+    uint64_t words[register_words];
+    for (std::size_t i = 0; i < register_words; ++i) {
+        words[i] = registers[i].load(std::memory_order_relaxed);
+    }
+    if (bytes) {
+        for (std::size_t i = 0; i < watched_bytes; i += 8) {
+            const uint64_t word =
+                memory[i / 8].load(std::memory_order_relaxed);
+            std::memcpy(bytes + i, &word,
+                        std::min<std::size_t>(8, watched_bytes - i));
+        }
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != start) {
+        return false;
+    }
+
+    result.A = words[0];
+    result.B = words[0] >> 8;
+    result.C = words[0] >> 16;
+    result.D = words[0] >> 24;
+    result.E = words[0] >> 32;
+    result.H = words[0] >> 40;
+    result.L = words[0] >> 48;
+    result.flags = words[0] >> 56;
+    result.stack_pointer = words[1];
+    result.program_counter = words[1] >> 16;
+    result.halted = words[1] >> 32 & 1;
+    result.interrupts_enabled = words[1] >> 33 & 1;
+    result.cycles = words[2];
+    result.publishes = words[3];
+    return true;
+}
+
+StatePublisher::Registers StatePublisher::read(uint8_t *bytes) const {
+    Registers result;
+    // publishes are short, so yield only if one is slow to finish
+    for (int attempt = 1; !tryRead(result, bytes); ++attempt) {
+        if (attempt % 64 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    return result;
+}
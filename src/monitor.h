@@ -0,0 +1,111 @@
+#ifndef INTEL_8080_MONITOR_H
+#define INTEL_8080_MONITOR_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpu.h"
+#include "i8085.h"
+
+/**
+ * Publishes the state of a running CPU to monitoring threads.
+ *
+ * The thread executing the CPU calls publish() between slices, such as
+ * from the Pacer's slice_done callback. It copies the registers and the
+ * watched memory regions under a sequence lock. Monitoring threads read
+ * the copy without locks and without pausing the CPU. A read that
+ * overlaps a publish sees the sequence change and retries, so every read
+ * returns the state of one instruction boundary.
+ *
+ * Nothing runs per instruction. A publish costs a few stores plus one
+ * copy of the watched bytes. The copy is held in atomic words, so reading
+ * it while it is written is not a data race.
+ *
+ * Only one thread may publish. Any number may read.
+ */
+class StatePublisher {
+  public:
+    // A range of memory copied with each publish
+    struct Region {
+        uint16_t address;
+        uint32_t length;
+    };
+
+    // The registers at one instruction boundary
+    struct Registers {
+        uint8_t A = 0;
+        uint8_t B = 0;
+        uint8_t C = 0;
+        uint8_t D = 0;
+        uint8_t E = 0;
+        uint8_t H = 0;
+        uint8_t L = 0;
+        // the flags as PUSH PSW stores them
+        uint8_t flags = 0;
+        uint16_t stack_pointer = 0;
+        uint16_t program_counter = 0;
+        bool halted = false;
+        bool interrupts_enabled = false;
+        // the cycles given to publish()
+        uint64_t cycles = 0;
+        // the number of publishes so far, 0 before the first
+        uint64_t publishes = 0;
+    };
+
+    /**
+     * Parameters:
+     *     regions - The memory copied with each publish, which must not
+     *               run past the end of memory
+     */
+    explicit StatePublisher(std::vector<Region> regions = {});
+    StatePublisher(const StatePublisher &) = delete;
+    StatePublisher &operator=(const StatePublisher &) = delete;
+
+    /**
+     * Publish the CPU's state, from the thread executing it
+     * Parameters:
+     *     cycles - The cycles executed so far, passed on to readers
+     */
+    void publish(const Intel8080 &cpu, const uint64_t cycles);
+    void publish(const Intel8085 &cpu, const uint64_t cycles);
+
+    /**
+     * Read the last published state, without waiting
+     * Parameters:
+     *     registers - Receives the registers
+     *     memory (optional) - Receives watchedBytes() bytes, the regions
+     *                         one after another
+     * Returns: False when a publish was in progress and nothing was read
+     */
+    bool tryRead(Registers &registers, uint8_t *memory = nullptr) const;
+
+    /**
+     * Read the last published state, retrying while publishes overlap
+     */
+    Registers read(uint8_t *memory = nullptr) const;
+
+    const std::vector<Region> &regions() const { return watched; }
+    std::size_t watchedBytes() const { return watched_bytes; }
+
+  private:
+    // registers packed into words, see pack()
+    static constexpr std::size_t register_words = 4;
+
+    std::vector<Region> watched;
+    std::size_t watched_bytes = 0;
+
+    // odd while a publish is in progress
+    alignas(64) std::atomic<uint64_t> sequence = 0;
+    std::array<std::atomic<uint64_t>, register_words> registers;
+    std::unique_ptr<std::atomic<uint64_t>[]> memory;
+
+    uint64_t publishes = 0;
+
+    void store(const Intel8080 &cpu, const uint8_t flags,
+               const uint64_t cycles);
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "multiprocessor.h"
+
+#include <algorithm>
+#include <barrier>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// the heap expects anonymous memory back, not a mapping of the file
+void unmapShared(uint8_t *const memory, const std::size_t length) {
+    mmap(memory, length, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+}
+
+} // namespace
+
+Multiprocessor::Multiprocessor(const std::size_t count,
+                               std::vector<Region> regions)
+    : cores(count), shared(std::move(regions)) {
+    for (Core &core : cores) {
+        core.cpu = std::make_unique<Intel8080>();
+        core.cpu->memory.fill(0);
+    }
+
+    const long page_size = sysconf(_SC_PAGESIZE);
+    std::size_t length = 0;
+    for (const Region &region : shared) {
+        if (page_size <= 0 || region.address % page_size != 0 ||
+            region.length % page_size != 0 ||
+            region.address + region.length > 0x10000) {
+            return;
+        }
+        length += region.length;
+    }
+    file = memfd_create("emu8080-multiprocessor", MFD_CLOEXEC);
+    if (file >= 0 && ftruncate(file, length) != 0) {
+        close(file);
+        file = -1;
+    }
+    if (file < 0) {
+        return;
+    }
+
+    // the same file offset in every core, zeroed by the file
+    for (std::size_t i = 0; i < cores.size(); ++i) {
+        uint8_t *const memory = cores[i].cpu->memory.data();
+        off_t offset = 0;
+        for (const Region &region : shared) {
+            if (mmap(memory + region.address, region.length,
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file,
+                     offset) == MAP_FAILED) {
+                unmapCores(i + 1);
+                return;
+            }
+            offset += region.length;
+        }
+    }
+}
+
+Multiprocessor::~Multiprocessor() {
+    unmapCores(cores.size());
+}
+
+void Multiprocessor::unmapCores(const std::size_t count) {
+    if (file < 0) {
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        for (const Region &region : shared) {
+            unmapShared(cores[i].cpu->memory.data() + region.address,
+                        region.length);
+        }
+    }
+    close(file);
+    file = -1;
+}
+
+void Multiprocessor::advance(Core &core, const uint64_t boundary) {
+    while (core.cycles < boundary) {
+        if (core.cpu->halted) {
+            core.cycles = boundary;
+            break;
+        }
+        core.cycles += core.cpu->execute(boundary - core.cycles);
+    }
+}
+
+uint64_t Multiprocessor::nextBoundary(const uint64_t end) const {
+    if (quantum == 0 || end - system_clock < quantum) {
+        return end;
+    }
+    return system_clock + quantum;
+}
+
+uint64_t Multiprocessor::runParallel(const uint64_t cycles,
+                                     unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<std::size_t>(threads, std::max<std::size_t>(size(), 1));
+    const uint64_t start = system_clock;
+    const uint64_t end = start + cycles;
+
+    // the last thread to arrive ends the quantum while the others wait
+    uint64_t boundary = nextBoundary(end);
+    const auto finish = [&]() noexcept {
+        system_clock = boundary;
+        if (quantum_done) {
+            quantum_done(system_clock);
+        }
+        boundary = nextBoundary(end);
+    };
+    std::barrier sync(threads, finish);
+
+    // each thread keeps the same cores, and so their caches
+    const auto work = [&](const std::size_t first) {
+        while (system_clock < end) {
+            for (std::size_t i = first; i < cores.size(); i += threads) {
+                advance(cores[i], boundary);
+            }
+            sync.arrive_and_wait();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; ++i) {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return system_clock - start;
+}
+
+uint64_t Multiprocessor::runInterleaved(const uint64_t cycles) {
+    const uint64_t start = system_clock;
+    const uint64_t end = start + cycles;
+    while (system_clock < end) {
+        const uint64_t boundary = nextBoundary(end);
+        for (Core &core : cores) {
+            advance(core, boundary);
+        }
+        system_clock = boundary;
+        if (quantum_done) {
+            quantum_done(system_clock);
+        }
+    }
+    return system_clock - start;
+}
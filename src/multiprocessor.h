@@ -0,0 +1,130 @@
+#ifndef INTEL_8080_MULTIPROCESSOR_H
+#define INTEL_8080_MULTIPROCESSOR_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cpu.h"
+
+/**
+ * Several 8080 cores sharing part of their address space, as on MP/M
+ * and multiprocessor controller boards.
+ *
+ * Every core has its own 64 KB of memory. The shared regions are mapped
+ * over the same pages of each core's memory with the host MMU, so a
+ * store by one core is seen by every other with no cost on the store
+ * path. Regions must start and end on host page boundaries.
+ *
+ * Cores run in quanta of a number of clock cycles. At the end of each
+ * quantum every core has reached the same system clock, within the
+ * length of one instruction, and quantum_done is called with all of them
+ * stopped, where the host can exchange I/O or raise interrupts. A halted
+ * core lets the rest of the quantum pass.
+ *
+ * runParallel() runs the cores on several host threads, which meet at
+ * the end of each quantum. Within a quantum the order in which cores see
+ * each other's stores depends on the host. runInterleaved() runs every
+ * core on the calling thread, one after another in core order each
+ * quantum, so the result depends only on the programs and the quantum.
+ * A shorter quantum couples the cores more tightly and costs more
+ * synchronization.
+ *
+ * In and out callbacks of the cores are called on the thread running
+ * that core.
+ */
+class Multiprocessor {
+  public:
+    // A range of the address space shared by every core
+    struct Region {
+        uint16_t address;
+        uint32_t length;
+    };
+
+    // clock cycles in each quantum, 0 to run each call as one quantum
+    uint64_t quantum = 1000;
+
+    // Called at the end of each quantum with the system clock
+    std::function<void(uint64_t)> quantum_done;
+
+    /**
+     * Create the cores with zeroed memory, mapping the shared regions
+     * Parameters:
+     *     cores - The number of cores
+     *     shared - The shared regions, page aligned and not overlapping
+     */
+    Multiprocessor(const std::size_t cores, std::vector<Region> shared);
+    Multiprocessor(const Multiprocessor &) = delete;
+    Multiprocessor &operator=(const Multiprocessor &) = delete;
+    ~Multiprocessor();
+
+    /**
+     * Returns: True when the shared regions could be mapped
+     */
+    bool isOpen() const { return file >= 0; }
+
+    std::size_t size() const { return cores.size(); }
+    Intel8080 &core(const std::size_t index) { return *cores[index].cpu; }
+
+    /**
+     * Returns: The clock cycles executed by a core, which run past the
+     *          system clock by up to one instruction
+     */
+    uint64_t coreCycles(const std::size_t index) const {
+        return cores[index].cycles;
+    }
+
+    /**
+     * Returns: The cycles run since creation, at the end of the last
+     *          quantum
+     */
+    uint64_t clock() const { return system_clock; }
+
+    /**
+     * Run every core for the given cycles of the system clock, on up to
+     * threads host threads
+     * Parameters:
+     *     threads (optional) - 0 for one per host core
+     * Returns: The cycles the system clock advanced
+     */
+    uint64_t runParallel(const uint64_t cycles, unsigned int threads = 0);
+
+    /**
+     * Run every core for the given cycles on the calling thread,
+     * deterministically
+     * Returns: The cycles the system clock advanced
+     */
+    uint64_t runInterleaved(const uint64_t cycles);
+
+  private:
+    // kept on their own cache lines, as threads update them side by side
+    struct alignas(64) Core {
+        std::unique_ptr<Intel8080> cpu;
+        uint64_t cycles = 0;
+    };
+
+    std::vector<Core> cores;
+    std::vector<Region> shared;
+    int file = -1;
+
+    uint64_t system_clock = 0;
+
+    /**
+     * Give the first count cores private memory in the shared regions
+     * again and close the file
+     */
+    void unmapCores(const std::size_t count);
+
+    /**
+     * Run a core until its clock reaches the boundary
+     */
+    void advance(Core &core, const uint64_t boundary);
+
+    /**
+     * Returns: The end of the quantum starting at the system clock
+     */
+    uint64_t nextBoundary(const uint64_t end) const;
+};
+
+#endif
@@ -0,0 +1,397 @@
+#ifndef INTEL_8080_OPCODES_H
+#define INTEL_8080_OPCODES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "variant.h"
+
+/**
+ * Static description of every 8080 opcode, for code that analyses
+ * programs rather than running them: disassemblers, block builders,
+ * instruction fusion and recompilers. Flag masks allow data-flow analysis
+ * such as finding flags that are written but never read.
+ */
+namespace opcodes {
+
+// Flag bits, in their PSW positions
+enum Flag : uint8_t {
+    S = 0x80,
+    Z = 0x40,
+    A = 0x10,
+    P = 0x04,
+    C = 0x01,
+};
+
+enum Effect : uint16_t {
+    none = 0,
+    // reads or writes memory, including through the stack
+    load = 1 << 0,
+    store = 1 << 1,
+    // uses or changes the stack pointer's memory
+    stack = 1 << 2,
+    // IN or OUT
+    io = 1 << 3,
+    // changes the program counter
+    jump = 1 << 4,
+    // pushes the return address, also RST
+    call = 1 << 5,
+    // pops the program counter from the stack
+    ret = 1 << 6,
+    // the branch depends on flags_read
+    conditional = 1 << 7,
+    // the target comes from a register (PCHL)
+    indirect = 1 << 8,
+    halt = 1 << 9,
+    // EI or DI
+    interrupt_control = 1 << 10,
+};
+
+struct Descriptor {
+    // operands are written d8, d16 and a16 for immediate data and addresses
+    const char *mnemonic;
+    uint8_t length;
+    // clock cycles when not taken, and when a conditional branch is taken
+    uint8_t cycles;
+    uint8_t taken_cycles;
+    uint8_t flags_read;
+    uint8_t flags_written;
+    uint16_t effects;
+};
+
+// Undocumented opcodes are marked with *
+inline constexpr std::array<Descriptor, 256> descriptors = {{
+    // 0x00
+    {"NOP",        1,  4,  4, 0, 0, none},
+    {"LXI B, d16", 3, 10, 10, 0, 0, none},
+    {"STAX B",     1,  7,  7, 0, 0, store},
+    {"INX B",      1,  5,  5, 0, 0, none},
+    {"INR B",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR B",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI B, d8",  2,  7,  7, 0, 0, none},
+    {"RLC",        1,  4,  4, 0, C, none},
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"DAD B",      1, 10, 10, 0, C, none},
+    {"LDAX B",     1,  7,  7, 0, 0, load},
+    {"DCX B",      1,  5,  5, 0, 0, none},
+    {"INR C",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR C",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI C, d8",  2,  7,  7, 0, 0, none},
+    {"RRC",        1,  4,  4, 0, C, none},
+    // 0x10
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"LXI D, d16", 3, 10, 10, 0, 0, none},
+    {"STAX D",     1,  7,  7, 0, 0, store},
+    {"INX D",      1,  5,  5, 0, 0, none},
+    {"INR D",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR D",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI D, d8",  2,  7,  7, 0, 0, none},
+    {"RAL",        1,  4,  4, C, C, none},
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"DAD D",      1, 10, 10, 0, C, none},
+    {"LDAX D",     1,  7,  7, 0, 0, load},
+    {"DCX D",      1,  5,  5, 0, 0, none},
+    {"INR E",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR E",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI E, d8",  2,  7,  7, 0, 0, none},
+    {"RAR",        1,  4,  4, C, C, none},
+    // 0x20
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"LXI H, d16", 3, 10, 10, 0, 0, none},
+    {"SHLD a16",   3, 16, 16, 0, 0, store},
+    {"INX H",      1,  5,  5, 0, 0, none},
+    {"INR H",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR H",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI H, d8",  2,  7,  7, 0, 0, none},
+    {"DAA",        1,  4,  4, A | C, S | Z | A | P | C, none},
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"DAD H",      1, 10, 10, 0, C, none},
+    {"LHLD a16",   3, 16, 16, 0, 0, load},
+    {"DCX H",      1,  5,  5, 0, 0, none},
+    {"INR L",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR L",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI L, d8",  2,  7,  7, 0, 0, none},
+    {"CMA",        1,  4,  4, 0, 0, none},
+    // 0x30
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"LXI SP, d16", 3, 10, 10, 0, 0, none},
+    {"STA a16",    3, 13, 13, 0, 0, store},
+    {"INX SP",     1,  5,  5, 0, 0, none},
+    {"INR M",      1, 10, 10, 0, S | Z | A | P, load | store},
+    {"DCR M",      1, 10, 10, 0, S | Z | A | P, load | store},
+    {"MVI M, d8",  2, 10, 10, 0, 0, store},
+    {"STC",        1,  4,  4, 0, C, none},
+    {"*NOP",       1,  4,  4, 0, 0, none},
+    {"DAD SP",     1, 10, 10, 0, C, none},
+    {"LDA a16",    3, 13, 13, 0, 0, load},
+    {"DCX SP",     1,  5,  5, 0, 0, none},
+    {"INR A",      1,  5,  5, 0, S | Z | A | P, none},
+    {"DCR A",      1,  5,  5, 0, S | Z | A | P, none},
+    {"MVI A, d8",  2,  7,  7, 0, 0, none},
+    {"CMC",        1,  4,  4, C, C, none},
+    // 0x40
+    {"MOV B, B",   1,  5,  5, 0, 0, none},
+    {"MOV B, C",   1,  5,  5, 0, 0, none},
+    {"MOV B, D",   1,  5,  5, 0, 0, none},
+    {"MOV B, E",   1,  5,  5, 0, 0, none},
+    {"MOV B, H",   1,  5,  5, 0, 0, none},
+    {"MOV B, L",   1,  5,  5, 0, 0, none},
+    {"MOV B, M",   1,  7,  7, 0, 0, load},
+    {"MOV B, A",   1,  5,  5, 0, 0, none},
+    {"MOV C, B",   1,  5,  5, 0, 0, none},
+    {"MOV C, C",   1,  5,  5, 0, 0, none},
+    {"MOV C, D",   1,  5,  5, 0, 0, none},
+    {"MOV C, E",   1,  5,  5, 0, 0, none},
+    {"MOV C, H",   1,  5,  5, 0, 0, none},
+    {"MOV C, L",   1,  5,  5, 0, 0, none},
+    {"MOV C, M",   1,  7,  7, 0, 0, load},
+    {"MOV C, A",   1,  5,  5, 0, 0, none},
+    // 0x50
+    {"MOV D, B",   1,  5,  5, 0, 0, none},
+    {"MOV D, C",   1,  5,  5, 0, 0, none},
+    {"MOV D, D",   1,  5,  5, 0, 0, none},
+    {"MOV D, E",   1,  5,  5, 0, 0, none},
+    {"MOV D, H",   1,  5,  5, 0, 0, none},
+    {"MOV D, L",   1,  5,  5, 0, 0, none},
+    {"MOV D, M",   1,  7,  7, 0, 0, load},
+    {"MOV D, A",   1,  5,  5, 0, 0, none},
+    {"MOV E, B",   1,  5,  5, 0, 0, none},
+    {"MOV E, C",   1,  5,  5, 0, 0, none},
+    {"MOV E, D",   1,  5,  5, 0, 0, none},
+    {"MOV E, E",   1,  5,  5, 0, 0, none},
+    {"MOV E, H",   1,  5,  5, 0, 0, none},
+    {"MOV E, L",   1,  5,  5, 0, 0, none},
+    {"MOV E, M",   1,  7,  7, 0, 0, load},
+    {"MOV E, A",   1,  5,  5, 0, 0, none},
+    // 0x60
+    {"MOV H, B",   1,  5,  5, 0, 0, none},
+    {"MOV H, C",   1,  5,  5, 0, 0, none},
+    {"MOV H, D",   1,  5,  5, 0, 0, none},
+    {"MOV H, E",   1,  5,  5, 0, 0, none},
+    {"MOV H, H",   1,  5,  5, 0, 0, none},
+    {"MOV H, L",   1,  5,  5, 0, 0, none},
+    {"MOV H, M",   1,  7,  7, 0, 0, load},
+    {"MOV H, A",   1,  5,  5, 0, 0, none},
+    {"MOV L, B",   1,  5,  5, 0, 0, none},
+    {"MOV L, C",   1,  5,  5, 0, 0, none},
+    {"MOV L, D",   1,  5,  5, 0, 0, none},
+    {"MOV L, E",   1,  5,  5, 0, 0, none},
+    {"MOV L, H",   1,  5,  5, 0, 0, none},
+    {"MOV L, L",   1,  5,  5, 0, 0, none},
+    {"MOV L, M",   1,  7,  7, 0, 0, load},
+    {"MOV L, A",   1,  5,  5, 0, 0, none},
+    // 0x70
+    {"MOV M, B",   1,  7,  7, 0, 0, store},
+    {"MOV M, C",   1,  7,  7, 0, 0, store},
+    {"MOV M, D",   1,  7,  7, 0, 0, store},
+    {"MOV M, E",   1,  7,  7, 0, 0, store},
+    {"MOV M, H",   1,  7,  7, 0, 0, store},
+    {"MOV M, L",   1,  7,  7, 0, 0, store},
+    {"HLT",        1,  7,  7, 0, 0, halt},
+    {"MOV M, A",   1,  7,  7, 0, 0, store},
+    {"MOV A, B",   1,  5,  5, 0, 0, none},
+    {"MOV A, C",   1,  5,  5, 0, 0, none},
+    {"MOV A, D",   1,  5,  5, 0, 0, none},
+    {"MOV A, E",   1,  5,  5, 0, 0, none},
+    {"MOV A, H",   1,  5,  5, 0, 0, none},
+    {"MOV A, L",   1,  5,  5, 0, 0, none},
+    {"MOV A, M",   1,  7,  7, 0, 0, load},
+    {"MOV A, A",   1,  5,  5, 0, 0, none},
+    // 0x80
+    {"ADD B",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADD C",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADD D",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADD E",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADD H",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADD L",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADD M",      1,  7,  7, 0, S | Z | A | P | C, load},
+    {"ADD A",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ADC B",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"ADC C",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"ADC D",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"ADC E",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"ADC H",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"ADC L",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"ADC M",      1,  7,  7, C, S | Z | A | P | C, load},
+    {"ADC A",      1,  4,  4, C, S | Z | A | P | C, none},
+    // 0x90
+    {"SUB B",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SUB C",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SUB D",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SUB E",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SUB H",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SUB L",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SUB M",      1,  7,  7, 0, S | Z | A | P | C, load},
+    {"SUB A",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"SBB B",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"SBB C",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"SBB D",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"SBB E",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"SBB H",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"SBB L",      1,  4,  4, C, S | Z | A | P | C, none},
+    {"SBB M",      1,  7,  7, C, S | Z | A | P | C, load},
+    {"SBB A",      1,  4,  4, C, S | Z | A | P | C, none},
+    // 0xa0
+    {"ANA B",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ANA C",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ANA D",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ANA E",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ANA H",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ANA L",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ANA M",      1,  7,  7, 0, S | Z | A | P | C, load},
+    {"ANA A",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA B",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA C",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA D",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA E",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA H",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA L",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"XRA M",      1,  7,  7, 0, S | Z | A | P | C, load},
+    {"XRA A",      1,  4,  4, 0, S | Z | A | P | C, none},
+    // 0xb0
+    {"ORA B",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ORA C",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ORA D",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ORA E",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ORA H",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ORA L",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"ORA M",      1,  7,  7, 0, S | Z | A | P | C, load},
+    {"ORA A",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP B",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP C",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP D",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP E",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP H",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP L",      1,  4,  4, 0, S | Z | A | P | C, none},
+    {"CMP M",      1,  7,  7, 0, S | Z | A | P | C, load},
+    {"CMP A",      1,  4,  4, 0, S | Z | A | P | C, none},
+    // 0xc0
+    {"RNZ",        1,  5, 11, Z, 0, load | stack | ret | conditional},
+    {"POP B",      1, 10, 10, 0, 0, load | stack},
+    {"JNZ a16",    3, 10, 10, Z, 0, jump | conditional},
+    {"JMP a16",    3, 10, 10, 0, 0, jump},
+    {"CNZ a16",    3, 11, 17, Z, 0, store | stack | call | conditional},
+    {"PUSH B",     1, 11, 11, 0, 0, store | stack},
+    {"ADI d8",     2,  7,  7, 0, S | Z | A | P | C, none},
+    {"RST 0",      1, 11, 11, 0, 0, store | stack | call},
+    {"RZ",         1,  5, 11, Z, 0, load | stack | ret | conditional},
+    {"RET",        1, 10, 10, 0, 0, load | stack | ret},
+    {"JZ a16",     3, 10, 10, Z, 0, jump | conditional},
+    {"*JMP a16",   3, 10, 10, 0, 0, jump},
+    {"CZ a16",     3, 11, 17, Z, 0, store | stack | call | conditional},
+    {"CALL a16",   3, 17, 17, 0, 0, store | stack | call},
+    {"ACI d8",     2,  7,  7, C, S | Z | A | P | C, none},
+    {"RST 1",      1, 11, 11, 0, 0, store | stack | call},
+    // 0xd0
+    {"RNC",        1,  5, 11, C, 0, load | stack | ret | conditional},
+    {"POP D",      1, 10, 10, 0, 0, load | stack},
+    {"JNC a16",    3, 10, 10, C, 0, jump | conditional},
+    {"OUT d8",     2, 10, 10, 0, 0, io},
+    {"CNC a16",    3, 11, 17, C, 0, store | stack | call | conditional},
+    {"PUSH D",     1, 11, 11, 0, 0, store | stack},
+    {"SUI d8",     2,  7,  7, 0, S | Z | A | P | C, none},
+    {"RST 2",      1, 11, 11, 0, 0, store | stack | call},
+    {"RC",         1,  5, 11, C, 0, load | stack | ret | conditional},
+    {"*RET",       1, 10, 10, 0, 0, load | stack | ret},
+    {"JC a16",     3, 10, 10, C, 0, jump | conditional},
+    {"IN d8",      2, 10, 10, 0, 0, io},
+    {"CC a16",     3, 11, 17, C, 0, store | stack | call | conditional},
+    {"*CALL a16",  3, 17, 17, 0, 0, store | stack | call},
+    {"SBI d8",     2,  7,  7, C, S | Z | A | P | C, none},
+    {"RST 3",      1, 11, 11, 0, 0, store | stack | call},
+    // 0xe0
+    {"RPO",        1,  5, 11, P, 0, load | stack | ret | conditional},
+    {"POP H",      1, 10, 10, 0, 0, load | stack},
+    {"JPO a16",    3, 10, 10, P, 0, jump | conditional},
+    {"XTHL",       1, 18, 18, 0, 0, load | store | stack},
+    {"CPO a16",    3, 11, 17, P, 0, store | stack | call | conditional},
+    {"PUSH H",     1, 11, 11, 0, 0, store | stack},
+    {"ANI d8",     2,  7,  7, 0, S | Z | A | P | C, none},
+    {"RST 4",      1, 11, 11, 0, 0, store | stack | call},
+    {"RPE",        1,  5, 11, P, 0, load | stack | ret | conditional},
+    {"PCHL",       1,  5,  5, 0, 0, jump | indirect},
+    {"JPE a16",    3, 10, 10, P, 0, jump | conditional},
+    {"XCHG",       1,  5,  5, 0, 0, none},
+    {"CPE a16",    3, 11, 17, P, 0, store | stack | call | conditional},
+    {"*CALL a16",  3, 17, 17, 0, 0, store | stack | call},
+    {"XRI d8",     2,  7,  7, 0, S | Z | A | P | C, none},
+    {"RST 5",      1, 11, 11, 0, 0, store | stack | call},
+    // 0xf0
+    {"RP",         1,  5, 11, S, 0, load | stack | ret | conditional},
+    {"POP PSW",    1, 10, 10, 0, S | Z | A | P | C, load | stack},
+    {"JP a16",     3, 10, 10, S, 0, jump | conditional},
+    {"DI",         1,  4,  4, 0, 0, interrupt_control},
+    {"CP a16",     3, 11, 17, S, 0, store | stack | call | conditional},
+    {"PUSH PSW",   1, 11, 11, S | Z | A | P | C, 0, store | stack},
+    {"ORI d8",     2,  7,  7, 0, S | Z | A | P | C, none},
+    {"RST 6",      1, 11, 11, 0, 0, store | stack | call},
+    {"RM",         1,  5, 11, S, 0, load | stack | ret | conditional},
+    {"SPHL",       1,  5,  5, 0, 0, none},
+    {"JM a16",     3, 10, 10, S, 0, jump | conditional},
+    {"EI",         1,  4,  4, 0, 0, interrupt_control},
+    {"CM a16",     3, 11, 17, S, 0, store | stack | call | conditional},
+    {"*CALL a16",  3, 17, 17, 0, 0, store | stack | call},
+    {"CPI d8",     2,  7,  7, 0, S | Z | A | P | C, none},
+    {"RST 7",      1, 11, 11, 0, 0, store | stack | call},
+}};
+
+namespace detail {
+
+constexpr bool contains(const char *text, const char *pattern) {
+    for (; *text; ++text) {
+        std::size_t i = 0;
+        while (pattern[i] && text[i] == pattern[i]) {
+            ++i;
+        }
+        if (!pattern[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr std::size_t operandLength(const char *mnemonic) {
+    if (contains(mnemonic, "d16") || contains(mnemonic, "a16")) {
+        return 3;
+    }
+    return contains(mnemonic, "d8") ? 2 : 1;
+}
+
+constexpr bool lengthsMatchOperands() {
+    for (const Descriptor &descriptor : descriptors) {
+        if (descriptor.length != operandLength(descriptor.mnemonic)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool cyclesMatchTiming() {
+    using Timing = variant::Intel8080;
+    for (std::size_t i = 0; i < descriptors.size(); ++i) {
+        const Descriptor &descriptor = descriptors[i];
+        std::size_t taken = descriptor.cycles;
+        if (descriptor.effects & conditional) {
+            taken += descriptor.effects & call   ? Timing::call_taken_cycles
+                     : descriptor.effects & ret ? Timing::return_taken_cycles
+                                                : Timing::jump_taken_cycles;
+        }
+        if (descriptor.cycles != Timing::instruction_timing[i] ||
+            descriptor.taken_cycles != taken) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+static_assert(detail::lengthsMatchOperands(),
+              "instruction length disagrees with the mnemonic's operands");
+static_assert(detail::cyclesMatchTiming(),
+              "descriptor cycles disagree with the interpreter's timing");
+
+} // namespace opcodes
+
+#endif
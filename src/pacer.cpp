@@ -0,0 +1,172 @@
+#include "pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Nanoseconds = std::chrono::duration<double, std::nano>;
+
+// spin margins outside this range are not worth learning
+constexpr double min_margin_ns = 10000;
+constexpr double max_margin_ns = 2000000;
+
+void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+} // namespace
+
+std::size_t Pacer::run(const std::size_t cycles) {
+    const double ns_per_cycle = 1e9 / frequency;
+    Clock::time_point epoch = Clock::now();
+    // cycles since the epoch, whose end is the next deadline
+    uint64_t scheduled = 0;
+    const auto timeOf = [&](const uint64_t cycle) {
+        return epoch + std::chrono::duration_cast<Clock::duration>(
+                           Nanoseconds(cycle * ns_per_cycle));
+    };
+
+    std::size_t ran = 0;
+    while (ran < cycles && !stop_requested.load(std::memory_order_relaxed)) {
+        // one slice, plus the cycles owed when the host is behind
+        double wanted = slice.count() / ns_per_cycle;
+        const Clock::duration behind = Clock::now() - timeOf(scheduled);
+        if (behind > Clock::duration::zero()) {
+            wanted += Nanoseconds(behind).count() / ns_per_cycle;
+        }
+        wanted = std::min(wanted, max_slice.count() / ns_per_cycle);
+        const std::size_t target =
+            std::clamp<std::size_t>(wanted, 1, cycles - ran);
+
+        polls = 0;
+        std::size_t executed = execute(cpu, target);
+        bool idle = polls >= idle_polls;
+        if (cpu.halted) {
+            // the rest of the slice passes waiting for an interrupt
+            executed = std::max(executed, target);
+            idle = true;
+        }
+        ran += executed;
+        scheduled += executed;
+        ++counters.slices;
+        counters.cycles += executed;
+        counters.idle_slices += idle;
+        if (slice_done) {
+            slice_done(executed);
+        }
+
+        const Clock::time_point deadline = timeOf(scheduled);
+        const Clock::duration lag = Clock::now() - deadline;
+        if (lag > max_lag) {
+            // the host stalled, restart the schedule instead of racing
+            epoch += lag;
+            ++counters.resyncs;
+            continue;
+        }
+        const double late = Nanoseconds(wait(deadline, idle)).count();
+        if (!idle) {
+            recordJitter(late);
+            adaptSlice(late);
+        }
+    }
+    stop_requested.store(false, std::memory_order_relaxed);
+    return ran;
+}
+
+std::size_t Pacer::runFor(const std::chrono::nanoseconds duration) {
+    return run(duration.count() * frequency / 1e9);
+}
+
+void Pacer::stop() { stop_requested.store(true, std::memory_order_relaxed); }
+
+Pacer::Statistics Pacer::statistics() const {
+    Statistics copy = counters;
+    if (jitter_samples) {
+        copy.jitter_stddev_ns = std::sqrt(jitter_m2 / jitter_samples);
+    }
+    copy.slice_ns = slice.count();
+    return copy;
+}
+
+void Pacer::resetStatistics() {
+    counters = Statistics();
+    jitter_samples = 0;
+    jitter_m2 = 0;
+}
+
+void Pacer::watchPolling() {
+    cpu.in = [this, in = std::move(cpu.in)](uint8_t port) {
+        const uint8_t value = in ? in(port) : 0;
+        if (port == poll_port && value == poll_value) {
+            ++polls;
+        } else {
+            poll_port = port;
+            poll_value = value;
+            polls = 0;
+        }
+        return value;
+    };
+    cpu.out = [this, out = std::move(cpu.out)](uint8_t port, uint8_t value) {
+        polls = 0;
+        if (out) {
+            out(port, value);
+        }
+    };
+}
+
+Pacer::Clock::duration Pacer::wait(const Clock::time_point deadline,
+                                   const bool idle) {
+    Clock::time_point now = Clock::now();
+
+    // sleep until the margin the sleep is likely to overshoot by
+    const Clock::duration margin =
+        idle ? Clock::duration::zero()
+             : std::chrono::duration_cast<Clock::duration>(Nanoseconds(
+                   std::clamp(2 * oversleep_average_ns, min_margin_ns,
+                              max_margin_ns)));
+    if (deadline - now > margin) {
+        const Clock::time_point target = deadline - margin;
+        std::this_thread::sleep_until(target);
+        const Clock::time_point woke = Clock::now();
+        oversleep_average_ns +=
+            (Nanoseconds(woke - target).count() - oversleep_average_ns) / 16;
+        counters.sleep_ns += Nanoseconds(woke - now).count();
+        now = woke;
+    }
+
+    if (!idle && now < deadline) {
+        const Clock::time_point spin_start = now;
+        while ((now = Clock::now()) < deadline) {
+            relax();
+        }
+        counters.spin_ns += Nanoseconds(now - spin_start).count();
+    }
+    return std::max(now - deadline, Clock::duration::zero());
+}
+
+void Pacer::recordJitter(const double late_ns) {
+    // Welford's running mean and variance
+    ++jitter_samples;
+    const double delta = late_ns - counters.jitter_mean_ns;
+    counters.jitter_mean_ns += delta / jitter_samples;
+    jitter_m2 += delta * (late_ns - counters.jitter_mean_ns);
+    counters.jitter_max_ns = std::max(counters.jitter_max_ns, late_ns);
+}
+
+void Pacer::adaptSlice(const double late_ns) {
+    // longer slices wait less often when wakeups cannot be on time
+    late_average_ns += (late_ns - late_average_ns) / 8;
+    if (late_average_ns > slice.count() / 4.0) {
+        slice = std::min(slice * 2, max_slice);
+    } else if (late_average_ns < slice.count() / 16.0) {
+        slice = std::max(slice / 2, min_slice);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef INTEL_8080_PACER_H
+#define INTEL_8080_PACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "cpu.h"
+
+/**
+ * Runs a CPU at the speed of the real chip, for hardware in the loop.
+ *
+ * The CPU executes in slices with execute(target_cycles). After each
+ * slice the pacer waits for the host's monotonic clock to reach the time
+ * the slice ends at. Every deadline is taken from the start of the run,
+ * so errors do not accumulate. Waits sleep until shortly before the
+ * deadline and spin the rest of the way. The margin is learned from how
+ * late sleeps wake up.
+ *
+ * Slices start at min_slice. They grow when wakeups are late and the
+ * host cannot keep the schedule, and shrink again when it can. A host
+ * behind schedule runs the owed cycles in the next slice. When it falls
+ * more than max_lag behind, the schedule restarts from the current time.
+ *
+ * Slices the CPU spends halted, or polling one input port that keeps
+ * returning the same value, are idle. Their wait sleeps without spinning
+ * and a halted CPU returns from its execute() at once, so an idle machine
+ * uses almost no host CPU time. Each slice still starts in the CPU's own
+ * execute(), so a halted 8085 wakes for an interrupt raised in
+ * slice_done.
+ *
+ * The pacer wraps the CPU's in and out callbacks to notice polling, so
+ * they must be set before it is created.
+ */
+class Pacer {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Counters for the runs since creation or resetStatistics()
+     */
+    struct Statistics {
+        uint64_t slices = 0;
+        uint64_t cycles = 0;
+        uint64_t idle_slices = 0;
+        // times the host fell more than max_lag behind
+        uint64_t resyncs = 0;
+        // how late the waits after busy slices woke past their deadline
+        double jitter_mean_ns = 0;
+        double jitter_stddev_ns = 0;
+        double jitter_max_ns = 0;
+        // host time spent waiting
+        uint64_t sleep_ns = 0;
+        uint64_t spin_ns = 0;
+        // the current length of a slice
+        uint64_t slice_ns = 0;
+    };
+
+    // CPU clock frequency in Hz, 2 MHz for an 8080 and 3.125 MHz for an
+    // 8085 with a 6.25 MHz crystal
+    double frequency;
+
+    std::chrono::nanoseconds min_slice = std::chrono::microseconds(500);
+    std::chrono::nanoseconds max_slice = std::chrono::milliseconds(16);
+    std::chrono::nanoseconds max_lag = std::chrono::milliseconds(50);
+
+    // reads of one port returning the same value in a slice before it is
+    // idle, with no output in between
+    std::size_t idle_polls = 16;
+
+    // Called after each slice with its cycles, before the wait, where the
+    // host can raise interrupts or exchange I/O
+    std::function<void(std::size_t)> slice_done;
+
+    template <class CPU>
+    explicit Pacer(CPU &cpu, const double frequency = 2e6)
+        : frequency(frequency), cpu(cpu),
+          execute([](Intel8080 &base, std::size_t cycles) {
+              return static_cast<CPU &>(base).execute(cycles);
+          }) {
+        watchPolling();
+    }
+    Pacer(const Pacer &) = delete;
+    Pacer &operator=(const Pacer &) = delete;
+
+    /**
+     * Execute in real time. A halted CPU lets the time pass idle until it
+     * takes an interrupt.
+     * Parameters:
+     *     cycles - The cycles to execute
+     * Returns: The number of clock cycles executed, less when stopped
+     */
+    std::size_t run(const std::size_t cycles);
+
+    /**
+     * Execute in real time for the given host time
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t runFor(const std::chrono::nanoseconds duration);
+
+    /**
+     * Stop the run after the current slice. Safe to call from any thread.
+     */
+    void stop();
+
+    /**
+     * Copy the counters, from the running thread or between runs
+     */
+    Statistics statistics() const;
+    void resetStatistics();
+
+  private:
+    Intel8080 &cpu;
+    std::size_t (*execute)(Intel8080 &, std::size_t);
+
+    std::atomic<bool> stop_requested = false;
+
+    Statistics counters;
+    // samples and sum of squared differences from the mean of the jitter
+    uint64_t jitter_samples = 0;
+    double jitter_m2 = 0;
+
+    std::chrono::nanoseconds slice = min_slice;
+    // average lateness of waits and of sleeps
+    double late_average_ns = 0;
+    double oversleep_average_ns = 50000;
+
+    // the port polled and the value it returned, and how many times
+    uint8_t poll_port = 0;
+    uint8_t poll_value = 0;
+    std::size_t polls = 0;
+
+    void watchPolling();
+
+    /**
+     * Wait for the deadline, sleeping then spinning unless idle
+     * Returns: How late the wait woke
+     */
+    Clock::duration wait(const Clock::time_point deadline, const bool idle);
+
+    void recordJitter(const double late_ns);
+    void adaptSlice(const double late_ns);
+};
+
+#endif
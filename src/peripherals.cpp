@@ -0,0 +1,883 @@
+#include "peripherals.h"
+
+#include <algorithm>
+
+namespace {
+
+// 8251 command bits
+constexpr uint8_t transmit_enable = 0x01;
+constexpr uint8_t receive_enable = 0x04;
+constexpr uint8_t error_reset = 0x10;
+constexpr uint8_t internal_reset = 0x40;
+
+// 8259 ICW1 bits
+constexpr uint8_t icw4_needed = 0x01;
+constexpr uint8_t single = 0x02;
+constexpr uint8_t interval_4 = 0x04;
+constexpr uint8_t level_triggered = 0x08;
+constexpr uint8_t initialize = 0x10;
+
+// the line of the 8259 with no request pending
+constexpr std::size_t none = 8;
+
+uint16_t fromBcd(const uint16_t value) {
+    return (value >> 12 & 0xf) * 1000 + (value >> 8 & 0xf) * 100 +
+           (value >> 4 & 0xf) * 10 + (value & 0xf);
+}
+
+uint16_t toBcd(const uint32_t value) {
+    return (value / 1000 % 10) << 12 | (value / 100 % 10) << 8 |
+           (value / 10 % 10) << 4 | value % 10;
+}
+
+} // namespace
+
+uint64_t Peripheral::advance(const uint64_t) { return never; }
+
+uint64_t Peripheral::now() const { return bus ? bus->now() : 0; }
+
+void Peripheral::changed() {
+    if (bus) {
+        bus->changed(*this);
+    }
+}
+
+void Intel8251::receive(const uint8_t byte) {
+    line.push_back(byte);
+    startReceive(now());
+    changed();
+}
+
+bool Intel8251::receiving() const {
+    return !line.empty() || (status & rx_ready);
+}
+
+void Intel8251::reset() {
+    expect = Expect::mode;
+    command = 0;
+    status = 0;
+    tx_buffered = false;
+    tx_shifting = false;
+    tx_done = never;
+    rx_arrival = never;
+    rx_held = false;
+    changed();
+}
+
+uint8_t Intel8251::read(const uint8_t reg) {
+    if (reg & 1) {
+        uint8_t value = status;
+        value |= tx_buffered ? 0 : tx_ready;
+        value |= tx_buffered || tx_shifting ? 0 : tx_empty;
+        value |= data_set_ready_pin ? data_set_ready : 0;
+        return value;
+    }
+
+    const uint8_t value = rx_buffer;
+    status &= ~rx_ready;
+    if (rx_held) {
+        // the next character was waiting in the shift register
+        rx_held = false;
+        arrive(now());
+    }
+    return value;
+}
+
+void Intel8251::write(const uint8_t reg, const uint8_t value) {
+    const uint64_t time = now();
+    if (!(reg & 1)) {
+        // a character written before the last left the buffer replaces it
+        tx_buffer = value;
+        tx_buffered = true;
+        startTransmit(time);
+        return;
+    }
+
+    switch (expect) {
+    case Expect::mode:
+        mode = value;
+        expect = (value & 0x03) == 0 ? Expect::sync_1 : Expect::command;
+        break;
+    case Expect::sync_1:
+        // one sync character or two
+        expect = mode & 0x80 ? Expect::command : Expect::sync_2;
+        break;
+    case Expect::sync_2:
+        expect = Expect::command;
+        break;
+    case Expect::command:
+        if (value & internal_reset) {
+            reset();
+            return;
+        }
+        command = value;
+        if (value & error_reset) {
+            status &= ~(parity_error | overrun_error | framing_error);
+        }
+        startTransmit(time);
+        startReceive(time);
+        break;
+    }
+}
+
+uint64_t Intel8251::advance(const uint64_t now) {
+    while (tx_shifting && tx_done <= now) {
+        const uint64_t done = tx_done;
+        tx_shifting = false;
+        tx_done = never;
+        if (transmit) {
+            transmit(tx_shift);
+        }
+        startTransmit(done);
+    }
+    while (rx_arrival <= now) {
+        const uint64_t arrival = rx_arrival;
+        rx_arrival = never;
+        if (flow_control && (status & rx_ready)) {
+            rx_held = true;
+        } else {
+            arrive(arrival);
+        }
+    }
+    updatePins();
+    return std::min(tx_done, rx_arrival);
+}
+
+uint64_t Intel8251::frameCycles() const {
+    const uint64_t bits = 5 + (mode >> 2 & 0x03) + (mode & 0x10 ? 1 : 0);
+    const uint8_t factor = mode & 0x03;
+    if (factor == 0) {
+        // synchronous, with no start or stop bits
+        return std::max<uint64_t>(1, bits * cycles_per_clock);
+    }
+    // in half bits, for 1.5 stop bits
+    const uint64_t stop = 1 + (mode >> 6 & 0x03);
+    const uint64_t clocks[] = {0, 1, 16, 64};
+    return std::max<uint64_t>(
+        1, (2 * (1 + bits) + stop) * clocks[factor] * cycles_per_clock / 2);
+}
+
+void Intel8251::startTransmit(const uint64_t now) {
+    if (tx_shifting || !tx_buffered || !(command & transmit_enable) ||
+        !clear_to_send) {
+        return;
+    }
+    tx_shift = tx_buffer;
+    tx_buffered = false;
+    tx_shifting = true;
+    tx_done = now + frameCycles();
+}
+
+void Intel8251::startReceive(const uint64_t now) {
+    if (rx_arrival != never || rx_held || line.empty() ||
+        !(command & receive_enable)) {
+        return;
+    }
+    rx_arrival = now + frameCycles();
+}
+
+void Intel8251::arrive(const uint64_t now) {
+    if (line.empty()) {
+        return;
+    }
+    rx_buffer = line.front();
+    line.pop_front();
+    if (status & rx_ready) {
+        status |= overrun_error;
+    }
+    status |= rx_ready;
+    // the next character starts as this one ends
+    startReceive(now);
+}
+
+void Intel8251::updatePins() {
+    const bool tx =
+        !tx_buffered && (command & transmit_enable) && clear_to_send;
+    if (tx != tx_ready_pin) {
+        tx_ready_pin = tx;
+        if (tx_ready_changed) {
+            tx_ready_changed(tx);
+        }
+    }
+    const bool rx = status & rx_ready;
+    if (rx != rx_ready_pin) {
+        rx_ready_pin = rx;
+        if (rx_ready_changed) {
+            rx_ready_changed(rx);
+        }
+    }
+}
+
+void Intel8253::setGate(const std::size_t index, const bool level) {
+    const uint64_t time = now();
+    advance(time);
+    Counter &counter = counters[index];
+    if (counter.gate == level) {
+        return;
+    }
+    counter.gate = level;
+    if (counter.loaded) {
+        switch (counter.mode) {
+        case 0:
+        case 4:
+            // counting is suspended while GATE is low
+            level ? resume(counter, time) : pause(counter, time);
+            break;
+        case 2:
+        case 3:
+            // a rising edge starts a new period
+            level ? start(counter, ticks(time) + 1) : pause(counter, time);
+            break;
+        default:
+            // a rising edge triggers the counter
+            if (level) {
+                counter.triggered = true;
+                start(counter, ticks(time) + 1);
+            }
+            break;
+        }
+    }
+    settle(index, time);
+}
+
+bool Intel8253::out(const std::size_t index) {
+    const uint64_t time = now();
+    advance(time);
+    const Counter &counter = counters[index];
+    return outAt(counter, elapsedTicks(counter, time));
+}
+
+uint8_t Intel8253::read(const uint8_t reg) {
+    if (reg >= 3) {
+        return 0xff;
+    }
+    Counter &counter = counters[reg];
+    if (counter.status_latched) {
+        counter.status_latched = false;
+        return counter.status;
+    }
+
+    const uint16_t value =
+        counter.latched ? counter.latch : readCount(counter, now());
+    const uint8_t access = counter.control >> 4 & 0x03;
+    const bool msb = access == 2 || (access == 3 && counter.read_msb);
+    if (access != 3 || counter.read_msb) {
+        counter.latched = false;
+    }
+    if (access == 3) {
+        counter.read_msb = !counter.read_msb;
+    }
+    return msb ? value >> 8 : value & 0xff;
+}
+
+void Intel8253::write(const uint8_t reg, const uint8_t value) {
+    const uint64_t time = now();
+    if (reg < 3) {
+        load(counters[reg], value, time);
+        settle(reg, time);
+        return;
+    }
+
+    const std::size_t index = value >> 6;
+    if (index == 3) {
+        readBack(value, time);
+        return;
+    }
+    Counter &counter = counters[index];
+    if ((value & 0x30) == 0) {
+        // the counter latch command
+        if (!counter.latched) {
+            counter.latch = readCount(counter, time);
+            counter.latched = true;
+        }
+        return;
+    }
+
+    // a control word stops the counter until a count is written
+    counter.control = value;
+    counter.mode = value >> 1 & 0x07;
+    if (counter.mode > 5) {
+        counter.mode -= 4;
+    }
+    counter.bcd = value & 0x01;
+    counter.loaded = false;
+    counter.triggered = false;
+    counter.counting = false;
+    counter.elapsed = 0;
+    counter.write_msb = false;
+    counter.read_msb = false;
+    counter.latched = false;
+    counter.status_latched = false;
+    settle(index, time);
+}
+
+uint64_t Intel8253::advance(const uint64_t now) {
+    uint64_t next = never;
+    for (std::size_t i = 0; i < counters.size(); ++i) {
+        Counter &counter = counters[i];
+        const int64_t elapsed = elapsedTicks(counter, now);
+        if (!output[i]) {
+            counter.level = outAt(counter, elapsed);
+            counter.checked = elapsed;
+            continue;
+        }
+
+        // pass on every change since the counter was last checked, so
+        // short pulses are not lost when advanced late
+        for (int64_t change = nextChange(counter, counter.checked);
+             change >= 0 && change <= elapsed;
+             change = nextChange(counter, change)) {
+            const bool level = outAt(counter, change);
+            if (level != counter.level) {
+                counter.level = level;
+                output[i](level);
+            }
+        }
+        counter.checked = elapsed;
+
+        const int64_t change = nextChange(counter, elapsed);
+        if (counter.counting && change >= 0) {
+            const uint64_t tick = counter.resumed + (change - counter.elapsed);
+            next = std::min(next, tick * cycles_per_clock);
+        }
+    }
+    return next;
+}
+
+uint64_t Intel8253::ticks(const uint64_t cycles) const {
+    return cycles / cycles_per_clock;
+}
+
+int64_t Intel8253::elapsedTicks(const Counter &counter,
+                                const uint64_t now) const {
+    if (!counter.counting) {
+        return counter.elapsed;
+    }
+    return counter.elapsed + int64_t(ticks(now)) - int64_t(counter.resumed);
+}
+
+uint32_t Intel8253::countAt(const Counter &counter,
+                            const int64_t elapsed) const {
+    if (!counter.loaded) {
+        return 0;
+    }
+    const int64_t initial = counter.initial;
+    if (elapsed < 0) {
+        return initial;
+    }
+    switch (counter.mode) {
+    case 2:
+        return initial - elapsed % initial;
+    case 3: {
+        // counts down by two through each half of the period
+        const int64_t phase = elapsed % initial;
+        const int64_t high = (initial + 1) / 2;
+        return 2 * ((phase < high ? high : initial) - phase);
+    }
+    default: {
+        // one-shot counters wrap around and keep counting
+        const int64_t modulus = counter.bcd ? 10000 : 0x10000;
+        return ((initial - elapsed) % modulus + modulus) % modulus;
+    }
+    }
+}
+
+bool Intel8253::outAt(const Counter &counter, const int64_t elapsed) const {
+    if (!counter.loaded) {
+        return counter.mode != 0;
+    }
+    const int64_t initial = counter.initial;
+    switch (counter.mode) {
+    case 0:
+        return elapsed >= initial;
+    case 1:
+        return !counter.triggered || elapsed < 0 || elapsed >= initial;
+    case 2:
+        return !counter.gate || elapsed < 0 ||
+               elapsed % initial != initial - 1;
+    case 3:
+        return !counter.gate || elapsed < 0 ||
+               elapsed % initial < (initial + 1) / 2;
+    default:
+        return (counter.mode == 5 && !counter.triggered) ||
+               elapsed != initial;
+    }
+}
+
+int64_t Intel8253::nextChange(const Counter &counter,
+                              const int64_t elapsed) const {
+    const bool triggered = counter.mode != 1 && counter.mode != 5;
+    if (!counter.loaded || !(triggered || counter.triggered)) {
+        return -1;
+    }
+    const int64_t initial = counter.initial;
+    switch (counter.mode) {
+    case 0:
+        return elapsed < initial ? initial : -1;
+    case 1:
+        return elapsed < 0 ? 0 : elapsed < initial ? initial : -1;
+    case 2: {
+        if (!counter.gate) {
+            return -1;
+        }
+        if (elapsed < 0) {
+            return initial - 1;
+        }
+        const int64_t phase = elapsed % initial;
+        return phase < initial - 1 ? elapsed + initial - 1 - phase
+                                   : elapsed + 1;
+    }
+    case 3: {
+        if (!counter.gate) {
+            return -1;
+        }
+        const int64_t high = (initial + 1) / 2;
+        if (elapsed < 0) {
+            return high;
+        }
+        const int64_t phase = elapsed % initial;
+        return elapsed + (phase < high ? high : initial) - phase;
+    }
+    default:
+        return elapsed < initial ? initial
+               : elapsed == initial ? initial + 1
+                                    : -1;
+    }
+}
+
+void Intel8253::load(Counter &counter, const uint8_t value,
+                     const uint64_t now) {
+    uint16_t count = value;
+    switch (counter.control >> 4 & 0x03) {
+    case 2:
+        count = value << 8;
+        break;
+    case 3:
+        if (!counter.write_msb) {
+            counter.write_lsb = value;
+            counter.write_msb = true;
+            // mode 0 stops counting until the second byte
+            if (counter.mode == 0 && counter.loaded) {
+                pause(counter, now);
+            }
+            return;
+        }
+        count = counter.write_lsb | value << 8;
+        counter.write_msb = false;
+        break;
+    }
+
+    uint32_t initial = counter.bcd ? fromBcd(count) : count;
+    if (initial == 0) {
+        initial = counter.bcd ? 10000 : 0x10000;
+    }
+    // a period of one is not allowed in modes 2 and 3
+    if (counter.mode == 2 || counter.mode == 3) {
+        initial = std::max<uint32_t>(initial, 2);
+    }
+    counter.initial = initial;
+    counter.loaded = true;
+
+    // the count is loaded on the next clock, except that mode 1 and 5
+    // counters wait for GATE; a new count restarts a running counter
+    if (counter.mode != 1 && counter.mode != 5) {
+        start(counter, ticks(now) + 1);
+    }
+}
+
+void Intel8253::start(Counter &counter, const uint64_t tick) {
+    counter.elapsed = 0;
+    counter.checked = -1;
+    counter.resumed = tick;
+    counter.counting =
+        counter.gate || counter.mode == 1 || counter.mode == 5;
+}
+
+void Intel8253::pause(Counter &counter, const uint64_t now) {
+    counter.elapsed = elapsedTicks(counter, now);
+    counter.counting = false;
+}
+
+void Intel8253::resume(Counter &counter, const uint64_t now) {
+    counter.resumed = ticks(now);
+    counter.counting = true;
+}
+
+void Intel8253::settle(const std::size_t index, const uint64_t now) {
+    Counter &counter = counters[index];
+    const int64_t elapsed = elapsedTicks(counter, now);
+    const bool level = outAt(counter, elapsed);
+    counter.checked = elapsed;
+    if (level != counter.level) {
+        counter.level = level;
+        if (output[index]) {
+            output[index](level);
+        }
+    }
+    changed();
+}
+
+uint16_t Intel8253::readCount(Counter &counter, const uint64_t now) {
+    const uint32_t count = countAt(counter, elapsedTicks(counter, now));
+    return counter.bcd ? toBcd(count % 10000) : count & 0xffff;
+}
+
+void Intel8253::readBack(const uint8_t value, const uint64_t now) {
+    for (std::size_t i = 0; i < counters.size(); ++i) {
+        if (!(value & 2 << i)) {
+            continue;
+        }
+        Counter &counter = counters[i];
+        if (!(value & 0x20) && !counter.latched) {
+            counter.latch = readCount(counter, now);
+            counter.latched = true;
+        }
+        if (!(value & 0x10) && !counter.status_latched) {
+            const bool out = outAt(counter, elapsedTicks(counter, now));
+            counter.status = (out ? 0x80 : 0) |
+                             (counter.loaded ? 0 : 0x40) |
+                             (counter.control & 0x3f);
+            counter.status_latched = true;
+        }
+    }
+}
+
+uint8_t Intel8255::latch(const std::size_t port) const {
+    return latches[port];
+}
+
+uint8_t Intel8255::read(const uint8_t reg) {
+    if (reg >= 3) {
+        return control;
+    }
+    const uint8_t mask = outputMask(reg);
+    const uint8_t pins = input[reg] ? input[reg]() : 0xff;
+    return (latches[reg] & mask) | (pins & ~mask);
+}
+
+void Intel8255::write(const uint8_t reg, const uint8_t value) {
+    if (reg < 3) {
+        writePort(reg, value);
+        return;
+    }
+    if (value & 0x80) {
+        // setting the mode clears every output
+        control = value;
+        for (std::size_t port = 0; port < latches.size(); ++port) {
+            writePort(port, 0);
+        }
+        return;
+    }
+    // set or reset one bit of port C
+    const uint8_t bit = 1 << (value >> 1 & 0x07);
+    writePort(2, value & 0x01 ? latches[2] | bit : latches[2] & ~bit);
+}
+
+uint8_t Intel8255::outputMask(const std::size_t port) const {
+    switch (port) {
+    case 0:
+        return control & 0x10 ? 0x00 : 0xff;
+    case 1:
+        return control & 0x02 ? 0x00 : 0xff;
+    default:
+        return (control & 0x08 ? 0x00 : 0xf0) | (control & 0x01 ? 0x00 : 0x0f);
+    }
+}
+
+void Intel8255::writePort(const std::size_t port, const uint8_t value) {
+    latches[port] = value;
+    if (outputMask(port) && output[port]) {
+        output[port](value);
+    }
+}
+
+void Intel8259::setInput(const std::size_t line, const bool level) {
+    const uint8_t bit = 1 << line;
+    const bool rising = level && !(levels & bit);
+    levels = level ? levels | bit : levels & ~bit;
+    if (icw1 & level_triggered) {
+        irr = level ? irr | bit : irr & ~bit;
+    } else if (rising) {
+        irr |= bit;
+    }
+    changed();
+}
+
+bool Intel8259::interruptRequested() const {
+    return expect == Expect::ready && pendingRequest() != none;
+}
+
+uint16_t Intel8259::acknowledge() {
+    const std::size_t line = take();
+    // with the request gone by the time it is acknowledged, IR7 is
+    // supplied without being put in service
+    return callAddress(line == none ? 7 : line);
+}
+
+uint8_t Intel8259::read(const uint8_t reg) {
+    if (poll) {
+        // the poll command acknowledges the request by reading it
+        poll = false;
+        const std::size_t line = take();
+        return line == none ? 0x00 : 0x80 | line;
+    }
+    if (reg & 1) {
+        return imr;
+    }
+    return read_isr ? isr : irr;
+}
+
+void Intel8259::write(const uint8_t reg, const uint8_t value) {
+    if (!(reg & 1) && (value & initialize)) {
+        icw1 = value;
+        irr = 0;
+        isr = 0;
+        imr = 0;
+        lowest = 7;
+        auto_eoi = false;
+        rotate_on_auto_eoi = false;
+        special_mask = false;
+        read_isr = false;
+        poll = false;
+        expect = Expect::icw2;
+        changed();
+        return;
+    }
+
+    if (reg & 1) {
+        switch (expect) {
+        case Expect::icw2:
+            icw2 = value;
+            expect = !(icw1 & single)        ? Expect::icw3
+                     : (icw1 & icw4_needed) ? Expect::icw4
+                                            : Expect::ready;
+            break;
+        case Expect::icw3:
+            expect = icw1 & icw4_needed ? Expect::icw4 : Expect::ready;
+            break;
+        case Expect::icw4:
+            auto_eoi = value & 0x02;
+            expect = Expect::ready;
+            break;
+        case Expect::ready:
+            imr = value;
+            break;
+        }
+        changed();
+        return;
+    }
+
+    if (value & 0x08) {
+        // OCW3
+        if (value & 0x40) {
+            special_mask = value & 0x20;
+        }
+        if (value & 0x02) {
+            read_isr = value & 0x01;
+        }
+        poll = value & 0x04;
+        changed();
+        return;
+    }
+
+    // OCW2
+    const std::size_t level = value & 0x07;
+    switch (value >> 5) {
+    case 0b001:
+        endOfInterrupt(highest(isr), false);
+        break;
+    case 0b011:
+        endOfInterrupt(level, false);
+        break;
+    case 0b101:
+        endOfInterrupt(highest(isr), true);
+        break;
+    case 0b100:
+        rotate_on_auto_eoi = true;
+        break;
+    case 0b000:
+        rotate_on_auto_eoi = false;
+        break;
+    case 0b111:
+        endOfInterrupt(level, true);
+        break;
+    case 0b110:
+        lowest = level;
+        break;
+    }
+    changed();
+}
+
+std::size_t Intel8259::highest(const uint8_t bits) const {
+    for (std::size_t i = 1; i <= 8; ++i) {
+        const std::size_t line = (lowest + i) & 0x07;
+        if (bits >> line & 1) {
+            return line;
+        }
+    }
+    return none;
+}
+
+std::size_t Intel8259::pendingRequest() const {
+    const std::size_t line = highest(irr & ~imr);
+    if (line == none) {
+        return none;
+    }
+    // in special mask mode masked lines in service do not block others
+    const std::size_t serving = highest(special_mask ? isr & ~imr : isr);
+    const auto priority = [this](const std::size_t bit) {
+        return (bit - lowest - 1) & 0x07;
+    };
+    return serving == none || priority(line) < priority(serving) ? line
+                                                                 : none;
+}
+
+std::size_t Intel8259::take() {
+    const std::size_t line = pendingRequest();
+    if (line == none) {
+        return none;
+    }
+    const uint8_t bit = 1 << line;
+    if (!(icw1 & level_triggered)) {
+        irr &= ~bit;
+    }
+    if (!auto_eoi) {
+        isr |= bit;
+    } else if (rotate_on_auto_eoi) {
+        lowest = line;
+    }
+    return line;
+}
+
+void Intel8259::endOfInterrupt(const std::size_t line, const bool rotate) {
+    if (line == none) {
+        return;
+    }
+    isr &= ~(1 << line);
+    if (rotate) {
+        lowest = line;
+    }
+}
+
+uint16_t Intel8259::callAddress(const std::size_t line) const {
+    const uint16_t page = icw2 << 8;
+    if (icw1 & interval_4) {
+        return page | (icw1 & 0xe0) | line << 2;
+    }
+    return page | (icw1 & 0xc0) | line << 3;
+}
+
+void PeripheralBus::attach(Peripheral &peripheral, const uint8_t port,
+                           const std::size_t registers) {
+    auto found = std::find_if(
+        attached.begin(), attached.end(),
+        [&peripheral](const Attached &device) {
+            return device.peripheral == &peripheral;
+        });
+    const std::size_t index = found - attached.begin();
+    if (found == attached.end()) {
+        attached.push_back({&peripheral, clock});
+    }
+    peripheral.bus = this;
+    for (std::size_t i = 0; i < registers && port + i < ports.size(); ++i) {
+        ports[port + i] = {index, uint8_t(i)};
+    }
+    changed(peripheral);
+}
+
+void PeripheralBus::setInterruptController(Intel8259 &controller) {
+    interrupt_controller = &controller;
+    static_cast<Peripheral &>(controller).bus = this;
+}
+
+std::size_t PeripheralBus::run(const std::size_t cycles) {
+    const uint64_t start = clock;
+    const uint64_t end = clock + cycles;
+    while (clock < end) {
+        if (next_event <= clock) {
+            advanceDue();
+        }
+
+        bool requested = interrupt_controller &&
+                         interrupt_controller->interruptRequested();
+        if (requested && cpu.interrupts_enabled) {
+            cpu.interruptCall(interrupt_controller->acknowledge());
+            cpu.cycle_count += interrupt_call_cycles;
+            clock += interrupt_call_cycles;
+            requested = false;
+        }
+
+        if (cpu.halted && !interrupt_pending(cpu)) {
+            clock = std::max(clock, std::min(end, next_event));
+        } else if (requested) {
+            // wait for the program to enable interrupts
+            clock += step(cpu);
+        } else {
+            // peripherals lower next_event when they change, ending the
+            // loop before the next instruction; a HLT ends it too, so the
+            // clock waits for the next event rather than stepping on
+            while (clock < end && clock < next_event) {
+                clock += step(cpu);
+                if (cpu.halted) {
+                    break;
+                }
+            }
+        }
+    }
+    return clock - start;
+}
+
+uint64_t PeripheralBus::now() const { return clock; }
+
+void PeripheralBus::connect() {
+    cpu.in = [this](uint8_t port) { return input(port); };
+    cpu.out = [this](uint8_t port, uint8_t value) { output(port, value); };
+}
+
+uint8_t PeripheralBus::input(const uint8_t port) {
+    const Mapping &mapping = ports[port];
+    if (mapping.attached == unmapped) {
+        return in ? in(port) : 0xff;
+    }
+    Peripheral &peripheral = *attached[mapping.attached].peripheral;
+    peripheral.advance(clock);
+    const uint8_t value = peripheral.read(mapping.reg);
+    changed(peripheral);
+    return value;
+}
+
+void PeripheralBus::output(const uint8_t port, const uint8_t value) {
+    const Mapping &mapping = ports[port];
+    if (mapping.attached == unmapped) {
+        if (out) {
+            out(port, value);
+        }
+        return;
+    }
+    Peripheral &peripheral = *attached[mapping.attached].peripheral;
+    peripheral.advance(clock);
+    peripheral.write(mapping.reg, value);
+    changed(peripheral);
+}
+
+void PeripheralBus::advanceDue() {
+    // callbacks may change other peripherals, which are then due again
+    next_event = Peripheral::never;
+    for (Attached &device : attached) {
+        if (device.due <= clock) {
+            device.due = device.peripheral->advance(clock);
+        }
+    }
+    for (const Attached &device : attached) {
+        next_event = std::min(next_event, device.due);
+    }
+}
+
+void PeripheralBus::changed(Peripheral &peripheral) {
+    for (Attached &device : attached) {
+        if (device.peripheral == &peripheral) {
+            device.due = clock;
+        }
+    }
+    next_event = clock;
+}
@@ -0,0 +1,452 @@
+#ifndef INTEL_8080_PERIPHERALS_H
+#define INTEL_8080_PERIPHERALS_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "cpu.h"
+
+class PeripheralBus;
+
+/**
+ * A chip on the I/O ports of a PeripheralBus.
+ *
+ * Chips are not ticked. They keep the cycle their state was last brought
+ * up to date and catch up in advance(), which the bus calls before every
+ * access and when the cycle a chip asked to be woken at arrives.
+ */
+class Peripheral {
+  public:
+    // no event pending
+    static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+    virtual ~Peripheral() = default;
+
+    /**
+     * Read or write one of the chip's registers, by offset from the first
+     * port it is attached at
+     */
+    virtual uint8_t read(const uint8_t reg) = 0;
+    virtual void write(const uint8_t reg, const uint8_t value) = 0;
+
+    /**
+     * Bring the chip up to date with the bus clock, firing any output
+     * changes due by then
+     * Parameters:
+     *     now - The current bus cycle
+     * Returns: The cycle the chip next changes an output without being
+     *          accessed, after now, or never
+     */
+    virtual uint64_t advance(const uint64_t now);
+
+  protected:
+    friend class PeripheralBus;
+
+    PeripheralBus *bus = nullptr;
+
+    /**
+     * Returns: The current bus cycle, 0 when not attached
+     */
+    uint64_t now() const;
+
+    /**
+     * Tell the bus the chip changed outside of an access, such as when
+     * an input pin changes, so it is advanced again and interrupts are
+     * checked before the next instruction
+     */
+    void changed();
+};
+
+/**
+ * Intel 8251 USART.
+ *
+ * Characters take the time of their frame on the serial line: start bit,
+ * data bits, parity and stop bits in asynchronous mode, times the baud
+ * rate factor and the CPU cycles per transmit or receive clock. Sent
+ * characters are passed to transmit when their last bit is shifted out.
+ * Received characters arrive one frame apart and, unless flow control is
+ * off, wait for the previous character to be read rather than overrun.
+ *
+ * Registers: 0 - data, 1 - mode and command (write) or status (read)
+ */
+class Intel8251 : public Peripheral {
+  public:
+    // status bits
+    static constexpr uint8_t tx_ready = 0x01;
+    static constexpr uint8_t rx_ready = 0x02;
+    static constexpr uint8_t tx_empty = 0x04;
+    static constexpr uint8_t parity_error = 0x08;
+    static constexpr uint8_t overrun_error = 0x10;
+    static constexpr uint8_t framing_error = 0x20;
+    static constexpr uint8_t sync_detect = 0x40;
+    static constexpr uint8_t data_set_ready = 0x80;
+
+    // CPU cycles per cycle of the TxC and RxC clock inputs
+    uint64_t cycles_per_clock = 1;
+
+    // when false, received characters overrun unread ones
+    bool flow_control = true;
+
+    // the CTS and DSR input pins, active
+    bool clear_to_send = true;
+    bool data_set_ready_pin = true;
+
+    // Called with each character when it has been sent
+    std::function<void(uint8_t)> transmit;
+
+    // Called when the TxRDY and RxRDY output pins change
+    std::function<void(bool)> tx_ready_changed;
+    std::function<void(bool)> rx_ready_changed;
+
+    /**
+     * Queue characters arriving on the serial line
+     */
+    void receive(const uint8_t byte);
+
+    /**
+     * Returns: True while received characters have not been read
+     */
+    bool receiving() const;
+
+    /**
+     * Reset the chip, as the RESET pin, to wait for a mode instruction
+     */
+    void reset();
+
+    uint8_t read(const uint8_t reg) override;
+    void write(const uint8_t reg, const uint8_t value) override;
+    uint64_t advance(const uint64_t now) override;
+
+  private:
+    enum class Expect { mode, sync_1, sync_2, command };
+
+    Expect expect = Expect::mode;
+    uint8_t mode = 0;
+    uint8_t command = 0;
+    uint8_t status = 0;
+
+    // the transmit buffer and shift register
+    bool tx_buffered = false;
+    uint8_t tx_buffer = 0;
+    bool tx_shifting = false;
+    uint8_t tx_shift = 0;
+    uint64_t tx_done = never;
+
+    // characters on the line, the first arriving at rx_arrival or held
+    // until the last is read
+    std::deque<uint8_t> line;
+    uint64_t rx_arrival = never;
+    bool rx_held = false;
+    uint8_t rx_buffer = 0;
+
+    bool tx_ready_pin = false;
+    bool rx_ready_pin = false;
+
+    // CPU cycles to send or receive one character
+    uint64_t frameCycles() const;
+
+    void startTransmit(const uint64_t now);
+    void startReceive(const uint64_t now);
+    void arrive(const uint64_t now);
+    void updatePins();
+};
+
+/**
+ * Intel 8253 and 8254 programmable interval timer.
+ *
+ * Each counter keeps the tick it was loaded or last resumed at and works
+ * out its count and output from the ticks since, so counters run without
+ * being ticked. Output changes are only scheduled for counters with an
+ * output callback. Supports modes 0 to 5, binary and BCD counts, the
+ * counter latch command and the 8254 read-back command.
+ *
+ * Registers: 0 to 2 - counters, 3 - control word
+ */
+class Intel8253 : public Peripheral {
+  public:
+    // CPU cycles per cycle of the counters' CLK inputs
+    uint64_t cycles_per_clock = 1;
+
+    // Called when a counter's OUT pin changes
+    std::array<std::function<void(bool)>, 3> output;
+
+    /**
+     * Set the level of a counter's GATE input
+     */
+    void setGate(const std::size_t counter, const bool level);
+
+    /**
+     * Returns: The level of a counter's OUT pin
+     */
+    bool out(const std::size_t counter);
+
+    uint8_t read(const uint8_t reg) override;
+    void write(const uint8_t reg, const uint8_t value) override;
+    uint64_t advance(const uint64_t now) override;
+
+  private:
+    struct Counter {
+        uint8_t control = 0;
+        uint8_t mode = 0;
+        bool bcd = false;
+
+        // the initial count, 1 to 65536 (10000 in BCD)
+        uint32_t initial = 0;
+        bool loaded = false;
+        // mode 1 and 5 counters wait for a rising edge on GATE
+        bool triggered = false;
+        bool gate = true;
+
+        // ticks counted before the counter last resumed, and the tick it
+        // resumed at while it is counting
+        int64_t elapsed = 0;
+        bool counting = false;
+        uint64_t resumed = 0;
+
+        // the OUT level and the elapsed ticks it was last worked out at
+        bool level = true;
+        int64_t checked = 0;
+
+        // byte order state of reads and writes of two byte counts
+        bool write_msb = false;
+        bool read_msb = false;
+        uint8_t write_lsb = 0;
+        bool latched = false;
+        uint16_t latch = 0;
+        bool status_latched = false;
+        uint8_t status = 0;
+    };
+
+    std::array<Counter, 3> counters;
+
+    uint64_t ticks(const uint64_t cycles) const;
+    int64_t elapsedTicks(const Counter &counter, const uint64_t now) const;
+
+    // the count and OUT level after the given ticks
+    uint32_t countAt(const Counter &counter, const int64_t elapsed) const;
+    bool outAt(const Counter &counter, const int64_t elapsed) const;
+    // the ticks after which OUT next changes, or -1
+    int64_t nextChange(const Counter &counter, const int64_t elapsed) const;
+
+    void load(Counter &counter, const uint8_t value, const uint64_t now);
+    void start(Counter &counter, const uint64_t tick);
+    void pause(Counter &counter, const uint64_t now);
+    void resume(Counter &counter, const uint64_t now);
+    // pass a change of OUT after the counter was changed to the callback
+    void settle(const std::size_t index, const uint64_t now);
+    uint16_t readCount(Counter &counter, const uint64_t now);
+    void readBack(const uint8_t value, const uint64_t now);
+};
+
+/**
+ * Intel 8255 programmable peripheral interface.
+ *
+ * Ports A, B and the two halves of C are inputs or outputs as set by the
+ * mode word. Outputs are passed to the output callbacks when written and
+ * inputs are read from the input callbacks. Modes 1 and 2 are accepted
+ * and their ports act as in mode 0, without the handshaking lines.
+ *
+ * Registers: 0 to 2 - ports A, B and C, 3 - control word
+ */
+class Intel8255 : public Peripheral {
+  public:
+    // Called to read ports A, B and C, returning 0xff when not set
+    std::array<std::function<uint8_t()>, 3> input;
+
+    // Called with ports A, B and C when their outputs change
+    std::array<std::function<void(uint8_t)>, 3> output;
+
+    /**
+     * Returns: The latched output of a port, as driven on its pins
+     */
+    uint8_t latch(const std::size_t port) const;
+
+    uint8_t read(const uint8_t reg) override;
+    void write(const uint8_t reg, const uint8_t value) override;
+
+  private:
+    uint8_t control = 0x9b;
+    std::array<uint8_t, 3> latches = {};
+
+    // the bits of each port that are outputs
+    uint8_t outputMask(const std::size_t port) const;
+    void writePort(const std::size_t port, const uint8_t value);
+};
+
+/**
+ * Intel 8259A programmable interrupt controller, in 8080 mode.
+ *
+ * Requests are edge or level triggered as set by ICW1 and resolved with
+ * fully nested or rotating priorities, special mask mode and automatic
+ * end of interrupt. On acknowledge the controller supplies the address of
+ * a CALL, spaced 4 or 8 bytes apart. Cascading is accepted but slaves are
+ * not modeled.
+ *
+ * Registers: 0 - ICW1, OCW2 and OCW3 (write) or IRR and ISR (read),
+ *            1 - ICW2 to ICW4 and OCW1 (write) or IMR (read)
+ */
+class Intel8259 : public Peripheral {
+  public:
+    /**
+     * Set the level of an IR input
+     */
+    void setInput(const std::size_t line, const bool level);
+
+    /**
+     * Returns: True while the INT output is raised
+     */
+    bool interruptRequested() const;
+
+    /**
+     * Acknowledge the highest priority request, as the CPU's INTA cycles
+     * Returns: The address of the service routine to call
+     */
+    uint16_t acknowledge();
+
+    uint8_t read(const uint8_t reg) override;
+    void write(const uint8_t reg, const uint8_t value) override;
+
+  private:
+    enum class Expect { icw2, icw3, icw4, ready };
+
+    Expect expect = Expect::ready;
+    uint8_t icw1 = 0;
+    uint8_t icw2 = 0;
+    bool auto_eoi = false;
+
+    uint8_t irr = 0;
+    uint8_t isr = 0;
+    uint8_t imr = 0xff;
+    uint8_t levels = 0;
+
+    // the line with the lowest priority
+    uint8_t lowest = 7;
+    bool rotate_on_auto_eoi = false;
+    bool special_mask = false;
+    bool read_isr = false;
+    bool poll = false;
+
+    // the highest priority line in bits, or 8 when none is set
+    std::size_t highest(const uint8_t bits) const;
+    // the request to acknowledge, or 8 when none is
+    std::size_t pendingRequest() const;
+    // move a request in service, returning its line or 8 when none is
+    std::size_t take();
+    void endOfInterrupt(const std::size_t line, const bool rotate);
+    uint16_t callAddress(const std::size_t line) const;
+};
+
+/**
+ * Connects peripherals to the I/O ports of a CPU and keeps the clock
+ * they are advanced by.
+ *
+ * The bus runs the CPU an instruction at a time, counting cycles, up to
+ * the earliest cycle any chip asked to be woken at. Chips are only
+ * advanced then and when they are accessed, so the cost of a chip does
+ * not grow with the instructions executed. Accesses see the cycle at the
+ * start of the instruction that made them.
+ *
+ * When an Intel8259 is set as the interrupt controller, its requests are
+ * taken as soon as interrupts are enabled.
+ */
+class PeripheralBus {
+  public:
+    // Called for ports without a peripheral, unmapped reads return 0xff
+    std::function<uint8_t(uint8_t)> in;
+    std::function<void(uint8_t, uint8_t)> out;
+
+    /**
+     * Take over the CPU's in and out callbacks
+     */
+    template <class CPU>
+    explicit PeripheralBus(CPU &cpu)
+        : cpu(cpu), step([](Intel8080 &base) {
+              return static_cast<CPU &>(base).step();
+          }),
+          interrupt_pending([](const Intel8080 &base) {
+              return static_cast<const CPU &>(base).interruptPending();
+          }),
+          interrupt_call_cycles(CPU::interrupt_call_cycles) {
+        connect();
+    }
+    PeripheralBus(const PeripheralBus &) = delete;
+    PeripheralBus &operator=(const PeripheralBus &) = delete;
+
+    /**
+     * Attach a peripheral to consecutive ports, one per register
+     * Parameters:
+     *     peripheral - The chip, which must outlive the bus
+     *     port - The port of register 0
+     *     registers - The number of ports to map
+     */
+    void attach(Peripheral &peripheral, const uint8_t port,
+                const std::size_t registers);
+
+    /**
+     * Take interrupts from an 8259, which must also be attached
+     */
+    void setInterruptController(Intel8259 &controller);
+
+    /**
+     * Run the CPU and its peripherals. A halted CPU waits for the next
+     * interrupt, with the clock moving to the next peripheral event; a
+     * halted 8085 runs again as soon as TRAP or an unmasked RST input is
+     * pending. An interrupt from the 8259 adds the cycles of its CALL.
+     * Parameters:
+     *     cycles - The cycles to run for
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t run(const std::size_t cycles);
+
+    /**
+     * Returns: The cycles the bus has run for
+     */
+    uint64_t now() const;
+
+  private:
+    friend class Peripheral;
+
+    struct Attached {
+        Peripheral *peripheral;
+        uint64_t due;
+    };
+
+    // the attached index of an unmapped port
+    static constexpr std::size_t unmapped =
+        std::numeric_limits<std::size_t>::max();
+
+    // the peripheral and register at each port
+    struct Mapping {
+        std::size_t attached = unmapped;
+        uint8_t reg = 0;
+    };
+
+    Intel8080 &cpu;
+    // step the CPU and check its interrupt inputs as its own type
+    std::size_t (*step)(Intel8080 &);
+    bool (*interrupt_pending)(const Intel8080 &);
+    const std::size_t interrupt_call_cycles;
+
+    std::vector<Attached> attached;
+    std::array<Mapping, 256> ports;
+    Intel8259 *interrupt_controller = nullptr;
+
+    uint64_t clock = 0;
+    // the earliest due cycle of the peripherals
+    uint64_t next_event = Peripheral::never;
+
+    void connect();
+    uint8_t input(const uint8_t port);
+    void output(const uint8_t port, const uint8_t value);
+
+    // advance one peripheral and recompute the next event
+    void advance(Attached &device);
+    void advanceDue();
+    void changed(Peripheral &peripheral);
+};
+
+#endif
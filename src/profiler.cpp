@@ -0,0 +1,80 @@
+#include "profiler.h"
+
+#include <cstdio>
+
+std::size_t Profiler::execute() { return execute(SIZE_MAX); }
+
+std::size_t Profiler::execute(std::size_t target_cycles) {
+    std::size_t cycles = 0;
+    // a halted 8085 may still have an interrupt to take, so the CPU's own
+    // execute() decides whether a slice runs
+    while (cycles < target_cycles) {
+        const std::size_t slice = std::min(period, target_cycles - cycles);
+        const std::size_t executed = execute_slice(cpu, slice);
+        if (!executed) {
+            break;
+        }
+        cycles += executed;
+        sample();
+        if (executed < slice) {
+            // the CPU halted or an exit was requested
+            break;
+        }
+    }
+    return cycles;
+}
+
+void Profiler::sample() {
+    Stack stack = {};
+    stack.addresses[0] = cpu.program_counter;
+
+    uint16_t address = cpu.stack_pointer;
+    for (std::size_t i = 0; i < max_scan && stack.depth < depth; ++i) {
+        const uint16_t word =
+            cpu.memory[address] | cpu.memory[uint16_t(address + 1)] << 8;
+        address += 2;
+
+        // the stack holds the address after the call, credit the callee
+        const uint8_t call = cpu.memory[uint16_t(word - 3)];
+        const uint8_t restart = cpu.memory[uint16_t(word - 1)];
+        uint16_t target;
+        if (call == 0xcd || (call & 0xc7) == 0xc4) {
+            target = cpu.memory[uint16_t(word - 2)] |
+                     cpu.memory[uint16_t(word - 1)] << 8;
+        } else if ((restart & 0xc7) == 0xc7) {
+            target = restart & 0x38;
+        } else {
+            continue;
+        }
+        stack.addresses[++stack.depth] = target;
+    }
+
+    ++histogram[stack];
+    ++sample_count;
+}
+
+void Profiler::writeFolded(std::ostream &output) const {
+    char name[8];
+    for (const auto &[stack, count] : histogram) {
+        for (std::size_t i = stack.depth; i > 0; --i) {
+            std::snprintf(name, sizeof(name), "0x%04x;", stack.addresses[i]);
+            output << name;
+        }
+        std::snprintf(name, sizeof(name), "0x%04x", stack.addresses[0]);
+        output << name << " " << count << "\n";
+    }
+}
+
+void Profiler::clear() {
+    histogram.clear();
+    sample_count = 0;
+}
+
+std::size_t Profiler::StackHash::operator()(const Stack &stack) const {
+    // FNV-1a over the recorded addresses
+    std::size_t value = 0xcbf29ce484222325;
+    for (std::size_t i = 0; i <= stack.depth; ++i) {
+        value = (value ^ stack.addresses[i]) * 0x100000001b3;
+    }
+    return value;
+}
@@ -0,0 +1,107 @@
+#ifndef INTEL_8080_PROFILER_H
+#define INTEL_8080_PROFILER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "cpu.h"
+
+/**
+ * Sampling profiler for guest code.
+ *
+ * execute() runs the CPU in slices of period cycles and samples the
+ * program counter and the calls on the stack between slices, so the
+ * interpreter runs at full speed in between. The samples are kept as a
+ * histogram of distinct stacks.
+ *
+ * The 8080 has no frame pointer, so the stack walk looks at the words
+ * above the stack pointer and takes those that point just after a CALL or
+ * RST as return addresses. Pushed data that looks like a return address
+ * can add a frame; the walk stops after max_scan words.
+ *
+ * The slices run through the execute() of the type the profiler was
+ * created with, so an Intel8085 or a RecompiledIntel8080 runs as it
+ * would on its own.
+ */
+class Profiler {
+  public:
+    // The most calls recorded per sample
+    static constexpr std::size_t max_depth = 8;
+    // The most stack words examined per sample
+    static constexpr std::size_t max_scan = 16;
+
+    Intel8080 &cpu;
+
+    /**
+     * Parameters:
+     *     cpu - The CPU to profile
+     *     period - Clock cycles between samples, a prime avoids sampling
+     *              a loop at the same point each time
+     *     depth - The calls to record per sample, up to max_depth
+     */
+    template <class CPU>
+    explicit Profiler(CPU &cpu, const std::size_t period = 10007,
+                      const std::size_t depth = 4)
+        : cpu(cpu), period(std::max<std::size_t>(period, 1)),
+          depth(std::min(depth, max_depth)),
+          execute_slice([](Intel8080 &base, std::size_t cycles) {
+              return static_cast<CPU &>(base).execute(cycles);
+          }) {}
+
+    /**
+     * Execute until the CPU halts with no interrupt to take or an exit is
+     * requested, sampling every period cycles
+     * Parameters:
+     *     cycles (optional) - The target cycles to execute
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t execute();
+    std::size_t execute(std::size_t target_cycles);
+
+    /**
+     * Record a sample of the CPU's current state, for hosts that run the
+     * CPU themselves
+     */
+    void sample();
+
+    /**
+     * Returns: The number of samples recorded
+     */
+    std::size_t samples() const { return sample_count; }
+
+    /**
+     * Write the histogram as folded stacks, one line per distinct stack:
+     * the called functions from the outermost in, then the program
+     * counter, separated by semicolons, followed by the sample count.
+     * This is the input format of flamegraph.pl.
+     */
+    void writeFolded(std::ostream &output) const;
+
+    /**
+     * Discard all samples
+     */
+    void clear();
+
+  private:
+    // call targets from the innermost out, then the program counter
+    struct Stack {
+        std::array<uint16_t, max_depth + 1> addresses;
+        uint8_t depth;
+
+        bool operator==(const Stack &other) const = default;
+    };
+    struct StackHash {
+        std::size_t operator()(const Stack &stack) const;
+    };
+
+    const std::size_t period;
+    const std::size_t depth;
+    std::size_t (*execute_slice)(Intel8080 &, std::size_t);
+    std::size_t sample_count = 0;
+    std::unordered_map<Stack, uint64_t, StackHash> histogram;
+};
+
+#endif
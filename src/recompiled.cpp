@@ -0,0 +1,102 @@
+#include "recompiled.h"
+#include "opcodes.h"
+
+#include <cstring>
+
+RecompiledIntel8080::RecompiledIntel8080(const RecompiledProgram &program)
+    : program(program), block_starting(0x10000, -1), block_owning(0x10000, -1),
+      stale(program.block_count, 0) {
+    for (std::size_t i = 0; i < program.block_count; ++i) {
+        const RecompiledProgram::Block &block = program.blocks[i];
+        block_starting[block.start] = i;
+        for (std::size_t j = 0; j < block.length; ++j) {
+            block_owning[uint16_t(block.start + j)] = i;
+        }
+    }
+}
+
+std::size_t RecompiledIntel8080::execute() { return runUntil(UINT64_MAX); }
+
+std::size_t RecompiledIntel8080::execute(std::size_t target_cycles) {
+    return runUntil(deadlineAfter(target_cycles));
+}
+
+std::size_t RecompiledIntel8080::runUntil(const uint64_t deadline) {
+    const uint64_t start = cycle_count;
+    if (beginRun(deadline)) {
+        while (!halted && cycle_count < runDeadline()) {
+            const int32_t block = block_starting[program_counter];
+            if (block >= 0 && isCurrent(block)) {
+                // translated code checks the deadline at each block
+                const std::size_t ran = program.run(*this);
+                code_written = false;
+                translated_cycles += ran;
+                // translated code does not go through step()
+                cycle_count += ran;
+            } else {
+                interpreted_cycles += interpret();
+            }
+        }
+    }
+    endRun();
+    return cycle_count - start;
+}
+
+bool RecompiledIntel8080::isCurrent(const std::size_t block) {
+    if (!stale[block]) {
+        return true;
+    }
+    // translations are only used while the code matches the image
+    const RecompiledProgram::Block &range = program.blocks[block];
+    const std::size_t offset = range.start - program.origin;
+    if (std::memcmp(&memory[range.start], program.image + offset,
+                    range.length) == 0) {
+        stale[block] = 0;
+        return true;
+    }
+    return false;
+}
+
+std::size_t RecompiledIntel8080::interpret() {
+    const uint16_t pc = program_counter;
+    const opcodes::Descriptor &descriptor = opcodes::descriptors[memory[pc]];
+    const uint16_t hl = register_HL;
+    const uint16_t de = register_DE;
+
+    // the interpreter's stores bypass store(), so invalidate every
+    // translation the instruction could have written to
+    if (descriptor.effects & opcodes::store) {
+        const uint16_t address = memory[uint16_t(pc + 1)] |
+                                 memory[uint16_t(pc + 2)] << 8;
+        invalidate(hl, 1);
+        invalidate(register_BC, 1);
+        invalidate(de, 1);
+        invalidate(stack_pointer - 2, 4);
+        if (descriptor.length == 3) {
+            invalidate(address, 2);
+        }
+    }
+
+    const std::size_t cycles = step();
+
+    // a block transfer loop, which may start at a load such as LDAX D or
+    // MOV A, M, leaves the program counter at its head or past its end
+    // and has written the range one of the pointers moved over
+    constexpr uint16_t branches = opcodes::jump | opcodes::call | opcodes::ret;
+    if (!(descriptor.effects & branches) &&
+        program_counter != uint16_t(pc + descriptor.length)) {
+        invalidate(hl, uint16_t(register_HL - hl));
+        invalidate(de, uint16_t(register_DE - de));
+    }
+    return cycles;
+}
+
+void RecompiledIntel8080::invalidate(const uint16_t address,
+                                     const std::size_t length) {
+    for (std::size_t i = 0; i < length; ++i) {
+        const int32_t block = block_owning[uint16_t(address + i)];
+        if (block >= 0) {
+            stale[block] = 1;
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#ifndef INTEL_8080_RECOMPILED_H
+#define INTEL_8080_RECOMPILED_H
+
+#include <cstdint>
+#include <vector>
+
+#include "alu.h"
+#include "cpu.h"
+
+class RecompiledIntel8080;
+
+/**
+ * A COM image translated to C++ by tools/recompile.
+ *
+ * Translated code is split into blocks, each starting at an address the
+ * program can jump, call or return to. run() executes blocks from the
+ * program counter until it reaches code it has no translation for, a
+ * store hits translated code, the CPU halts or the run's deadline passes.
+ * Each block rereads the deadline, so an exit request ends a translated
+ * loop at its next block, or after the IN or OUT that made it.
+ */
+struct RecompiledProgram {
+    struct Block {
+        uint16_t start;
+        uint16_t length;
+    };
+
+    // the image as translated, loaded at origin
+    uint16_t origin;
+    const uint8_t *image;
+    std::size_t image_size;
+
+    const Block *blocks;
+    std::size_t block_count;
+
+    /**
+     * Returns: The clock cycles executed, not yet added to cycle_count
+     */
+    std::size_t (*run)(RecompiledIntel8080 &cpu);
+};
+
+/**
+ * Runs a recompiled program, interpreting whatever was not translated:
+ * code outside the image, targets of PCHL and computed RET that are not
+ * block starts, and blocks whose bytes no longer match the image.
+ *
+ * Translated code does not update statistics().
+ */
+class RecompiledIntel8080 : public Intel8080 {
+  public:
+    explicit RecompiledIntel8080(const RecompiledProgram &program);
+
+    // Clock cycles run by translated code and by the interpreter
+    std::size_t translated_cycles = 0;
+    std::size_t interpreted_cycles = 0;
+
+    /**
+     * Execute until the CPU halts or an exit is requested
+     * Parameters:
+     *     cycles (optional) - The target cycles to execute
+     * Returns: The number of clock cycles executed
+     */
+    std::size_t execute();
+    std::size_t execute(std::size_t target_cycles);
+
+    /**
+     * Execute translated and interpreted code as execute() does, see
+     * Intel8080::runUntil(). Translated code stops at the first block
+     * start past the deadline, so it may overshoot by a whole block.
+     */
+    std::size_t runUntil(const uint64_t deadline);
+
+    /**
+     * Make a running execute() or runUntil() return, see
+     * Intel8080::requestExit(). Translated code returns at its next block
+     * or after the IN or OUT whose callback made the request.
+     */
+    void requestExit() { Intel8080::requestExit(); }
+
+    /**
+     * Returns: True when translated code that has run the given cycles
+     *          since run() was called has reached the run's deadline,
+     *          which an exit request sets to 0
+     */
+    bool pastDeadline(const std::size_t cycles) const {
+        return cycle_count + cycles >= runDeadline();
+    }
+
+    /**
+     * Store a byte from translated code, noting when it lands on a
+     * translated block
+     */
+    void store(const uint16_t address, const uint8_t value) {
+        memory[address] = value;
+        const int32_t block = block_owning[address];
+        if (block >= 0) {
+            stale[block] = 1;
+            code_written = true;
+        }
+    }
+
+    /**
+     * Returns: True when a block may have been modified since it was
+     *          last checked against the image
+     */
+    bool isStale(const std::size_t block) const { return stale[block]; }
+
+    // set by store() so translated code can leave after the instruction
+    bool code_written = false;
+
+  private:
+    const RecompiledProgram &program;
+
+    // index of the block starting or containing each address, -1 if none
+    std::vector<int32_t> block_starting;
+    std::vector<int32_t> block_owning;
+    std::vector<uint8_t> stale;
+
+    bool isCurrent(const std::size_t block);
+    std::size_t interpret();
+    void invalidate(const uint16_t address, const std::size_t length);
+};
+
+/**
+ * Instruction semantics used by translated code: the interpreter's from
+ * alu.h, and memory and stack access that stores through
+ * RecompiledIntel8080::store()
+ */
+namespace recompiled {
+
+using alu::adc;
+using alu::add;
+using alu::ana;
+using alu::cmp;
+using alu::daa;
+using alu::dad;
+using alu::dcr;
+using alu::inr;
+using alu::loadFlags;
+using alu::ora;
+using alu::ral;
+using alu::rar;
+using alu::rlc;
+using alu::rrc;
+using alu::sbb;
+using alu::storeFlags;
+using alu::sub;
+using alu::xra;
+
+inline void push(RecompiledIntel8080 &cpu, const uint16_t word) {
+    cpu.store(--cpu.stack_pointer, word >> 8);
+    cpu.store(--cpu.stack_pointer, word);
+}
+
+inline uint16_t pop(Intel8080 &cpu) {
+    const uint8_t low = cpu.memory[cpu.stack_pointer++];
+    const uint8_t high = cpu.memory[cpu.stack_pointer++];
+    return (high << 8) | low;
+}
+
+inline uint16_t load16(Intel8080 &cpu, uint16_t address) {
+    const uint8_t low = cpu.memory[address];
+    const uint8_t high = cpu.memory[++address];
+    return (high << 8) | low;
+}
+
+inline void store16(RecompiledIntel8080 &cpu, uint16_t address,
+                    const uint16_t word) {
+    cpu.store(address, word);
+    cpu.store(++address, word >> 8);
+}
+
+} // namespace recompiled
+
+#endif
@@ -0,0 +1,669 @@
+#include "session_server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+namespace {
+
+// where the BDOS entry jumps to, the top of the program's memory
+constexpr uint16_t bdos_address = 0xfe00;
+// the port the BDOS traps to the host on
+constexpr uint8_t bdos_port = 0xff;
+
+constexpr std::size_t read_size = 4096;
+
+} // namespace
+
+struct SessionServer::Session {
+    enum class State { Queued, Running, WaitingInput, WaitingOutput, Finished };
+
+    const int socket;
+    const std::size_t idle_polls;
+    Intel8080 cpu;
+
+    // shared with the I/O thread
+    std::mutex mutex;
+    std::deque<uint8_t> input;
+    std::string output;
+    State state = State::Queued;
+    // the client disconnected or the socket failed
+    bool closed = false;
+    // the socket is watched for input, unless the input is full, and for
+    // room to send output
+    bool watching_input = true;
+    bool watching_output = false;
+
+    // only used by the thread running the session
+    std::string console;
+    bool waiting_input = false;
+    std::size_t polls = 0;
+    // a read line call (BDOS 10) is waiting for the rest of the line
+    bool reading_line = false;
+
+    Session(const int socket, const std::vector<uint8_t> &program,
+            const std::size_t idle_polls);
+    ~Session() { ::close(socket); }
+
+    /**
+     * Carry out the BDOS call in register C
+     */
+    void bdos();
+
+  private:
+    bool hasInput();
+    bool nextInput(uint8_t &byte);
+
+    // return an 8 or 16 bit result in A and L, and B and H
+    void result(const uint16_t value);
+
+    /**
+     * Wait for input by halting with the BDOS trap to be executed again
+     */
+    void wait();
+
+    /**
+     * Count a console poll that found no input, waiting after idle_polls
+     */
+    void poll();
+
+    void readLine();
+};
+
+SessionServer::Session::Session(const int socket,
+                                const std::vector<uint8_t> &program,
+                                const std::size_t idle_polls)
+    : socket(socket), idle_polls(idle_polls) {
+    cpu.memory.fill(0);
+    std::copy(program.begin(), program.end(), cpu.memory.begin() + 0x100);
+
+    // warm boot halts, ending the session
+    cpu.memory[0x0000] = 0x76;
+    // JMP BDOS, which gives programs the top of their memory at 0x0006
+    cpu.memory[0x0005] = 0xc3;
+    cpu.memory[0x0006] = bdos_address & 0xff;
+    cpu.memory[0x0007] = bdos_address >> 8;
+    // OUT FFh, RET
+    cpu.memory[bdos_address] = 0xd3;
+    cpu.memory[bdos_address + 1] = bdos_port;
+    cpu.memory[bdos_address + 2] = 0xc9;
+
+    // returning from the program warm boots
+    cpu.stack_pointer = bdos_address - 2;
+    cpu.program_counter = 0x100;
+    cpu.out = [this](uint8_t port, uint8_t) {
+        if (port == bdos_port) {
+            bdos();
+        }
+    };
+    cpu.in = [](uint8_t) -> uint8_t { return 0xff; };
+}
+
+bool SessionServer::Session::hasInput() {
+    std::lock_guard lock(mutex);
+    return !input.empty();
+}
+
+bool SessionServer::Session::nextInput(uint8_t &byte) {
+    std::lock_guard lock(mutex);
+    if (input.empty()) {
+        return false;
+    }
+    byte = input.front();
+    input.pop_front();
+    return true;
+}
+
+void SessionServer::Session::result(const uint16_t value) {
+    cpu.register_HL = value;
+    cpu.register_A = cpu.register_L;
+    cpu.register_B = cpu.register_H;
+}
+
+void SessionServer::Session::wait() {
+    cpu.halted = true;
+    cpu.program_counter = bdos_address;
+    waiting_input = true;
+    polls = 0;
+}
+
+void SessionServer::Session::poll() {
+    if (++polls >= idle_polls) {
+        wait();
+    }
+}
+
+void SessionServer::Session::bdos() {
+    const uint8_t function = cpu.register_C;
+    if (function != 11 && !(function == 6 && cpu.register_E >= 0xfe)) {
+        polls = 0;
+    }
+
+    uint8_t byte;
+    switch (function) {
+    case 0: // system reset
+        cpu.halted = true;
+        break;
+    case 1: // console input
+        if (!nextInput(byte)) {
+            wait();
+            break;
+        }
+        console.push_back(byte);
+        result(byte);
+        break;
+    case 2: // console output
+        console.push_back(cpu.register_E);
+        break;
+    case 6: // direct console I/O
+        if (cpu.register_E == 0xff) {
+            if (nextInput(byte)) {
+                result(byte);
+            } else {
+                result(0);
+                poll();
+            }
+        } else if (cpu.register_E == 0xfe) {
+            const bool ready = hasInput();
+            result(ready ? 0xff : 0);
+            if (!ready) {
+                poll();
+            }
+        } else {
+            console.push_back(cpu.register_E);
+        }
+        break;
+    case 9: // print string
+        for (uint16_t address = cpu.register_DE, i = 0;
+             cpu.memory[address] != '$' && i < 0xffff; ++address, ++i) {
+            console.push_back(cpu.memory[address]);
+        }
+        break;
+    case 10: // read console buffer
+        readLine();
+        break;
+    case 11: // console status
+        if (hasInput()) {
+            result(0xff);
+        } else {
+            result(0);
+            poll();
+        }
+        break;
+    case 12: // version, CP/M 2.2
+        result(0x0022);
+        break;
+    default:
+        result(0xff);
+        break;
+    }
+}
+
+void SessionServer::Session::readLine() {
+    // the buffer's size, the length read so far and the characters
+    const uint16_t buffer = cpu.register_DE;
+    const uint8_t size = cpu.memory[buffer];
+    uint8_t &length = cpu.memory[uint16_t(buffer + 1)];
+    if (!reading_line) {
+        reading_line = true;
+        length = 0;
+    }
+
+    uint8_t byte;
+    while (length < size) {
+        if (!nextInput(byte)) {
+            wait();
+            return;
+        }
+        if (byte == '\r' || byte == '\n') {
+            console.push_back('\r');
+            break;
+        }
+        if (byte == 0x08 || byte == 0x7f) {
+            if (length > 0) {
+                --length;
+                console.append("\b \b");
+            }
+            continue;
+        }
+        cpu.memory[uint16_t(buffer + 2 + length)] = byte;
+        ++length;
+        console.push_back(byte);
+    }
+    reading_line = false;
+}
+
+SessionServer::SessionServer(std::vector<uint8_t> program,
+                             const Settings &settings)
+    : program(std::move(program)), settings(settings) {
+    // leave room for the BDOS
+    this->program.resize(
+        std::min<std::size_t>(this->program.size(), bdos_address - 0x100));
+    if (this->settings.threads == 0) {
+        this->settings.threads =
+            std::max(1u, std::thread::hardware_concurrency());
+    }
+    this->settings.quota = std::max<std::size_t>(this->settings.quota, 1);
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll >= 0 && wakeup >= 0) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = wakeup;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event);
+    }
+}
+
+SessionServer::~SessionServer() {
+    if (listener >= 0) {
+        ::close(listener);
+        unlink(socket_path.c_str());
+    }
+    if (wakeup >= 0) {
+        ::close(wakeup);
+    }
+    if (epoll >= 0) {
+        ::close(epoll);
+    }
+}
+
+bool SessionServer::listen(const std::string &path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (epoll < 0 || wakeup < 0 || listener >= 0 ||
+        path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    path.copy(address.sun_path, path.size());
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        if (listener >= 0) {
+            ::close(listener);
+            listener = -1;
+        }
+        return false;
+    }
+    socket_path = path;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    return true;
+}
+
+bool SessionServer::run() {
+    if (listener < 0) {
+        return false;
+    }
+    stopping = false;
+    workers_stopping = false;
+    for (unsigned int i = 0; i < settings.threads; ++i) {
+        workers.emplace_back(&SessionServer::work, this);
+    }
+
+    epoll_event events[64];
+    while (!stopping) {
+        const int count = epoll_wait(epoll, events, 64, -1);
+        for (int i = 0; i < count && !stopping; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listener) {
+                accept();
+            } else if (fd == wakeup) {
+                uint64_t value;
+                while (read(wakeup, &value, sizeof(value)) > 0) {
+                }
+                closeFinished();
+            } else if (const auto found = sessions.find(fd);
+                       found != sessions.end()) {
+                const SessionPointer session = found->second;
+                if (events[i].events & EPOLLOUT) {
+                    sendPending(session);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    receive(session,
+                            events[i].events & (EPOLLHUP | EPOLLERR));
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard lock(queue_mutex);
+        workers_stopping = true;
+        run_queue.clear();
+    }
+    queue_ready.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    while (!sessions.empty()) {
+        close(sessions.begin()->second);
+    }
+    finished.clear();
+    return true;
+}
+
+void SessionServer::stop() {
+    // only async signal safe calls, so signal handlers can stop the server
+    stopping = true;
+    const uint64_t value = 1;
+    if (write(wakeup, &value, sizeof(value)) < 0) {
+        // the counter is already raised
+    }
+}
+
+SessionServer::Statistics SessionServer::statistics() const {
+    Statistics result;
+    result.sessions = session_count.load(std::memory_order_relaxed);
+    result.open_sessions = open_count.load(std::memory_order_relaxed);
+    result.slices = slices.load(std::memory_order_relaxed);
+    result.cycles = cycles.load(std::memory_order_relaxed);
+    result.parks = parks.load(std::memory_order_relaxed);
+    result.wakeups = wakeups.load(std::memory_order_relaxed);
+    result.busy_ns = busy_ns.load(std::memory_order_relaxed);
+    return result;
+}
+
+void SessionServer::accept() {
+    for (;;) {
+        const int fd = accept4(listener, nullptr, nullptr,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        if (sessions.size() >= settings.max_sessions) {
+            ::close(fd);
+            continue;
+        }
+
+        const auto session =
+            std::make_shared<Session>(fd, program, settings.idle_polls);
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            continue;
+        }
+        sessions.emplace(fd, session);
+        session_count.fetch_add(1, std::memory_order_relaxed);
+        open_count.fetch_add(1, std::memory_order_relaxed);
+        schedule(session, false);
+    }
+}
+
+void SessionServer::receive(const SessionPointer &session,
+                            const bool hung_up) {
+    uint8_t buffer[read_size];
+    bool woken = false;
+    for (;;) {
+        std::size_t room;
+        {
+            std::lock_guard lock(session->mutex);
+            room = settings.max_input -
+                   std::min(settings.max_input, session->input.size());
+            if (!room && session->watching_input) {
+                // runSlice() watches again once half the input is taken
+                session->watching_input = false;
+                watchSocket(epoll, *session);
+            }
+        }
+        if (!room) {
+            // with nothing read, a hang up would be reported again at once
+            if (hung_up) {
+                close(session);
+                return;
+            }
+            break;
+        }
+        const ssize_t size = read(session->socket, buffer,
+                                  std::min(room, sizeof(buffer)));
+        if (size == 0 || (size < 0 && errno != EAGAIN && errno != EINTR)) {
+            close(session);
+            return;
+        }
+        if (size < 0) {
+            break;
+        }
+        std::lock_guard lock(session->mutex);
+        session->input.insert(session->input.end(), buffer, buffer + size);
+        if (session->state == Session::State::WaitingInput) {
+            session->state = Session::State::Queued;
+            woken = true;
+        }
+    }
+    if (woken) {
+        wakeups.fetch_add(1, std::memory_order_relaxed);
+        schedule(session, true);
+    }
+}
+
+namespace {
+
+/**
+ * Send as much of the output as the socket takes without blocking
+ * Returns: False when the socket failed
+ */
+bool sendOutput(const int socket, std::string &output) {
+    std::size_t sent = 0;
+    while (sent < output.size()) {
+        const ssize_t size = send(socket, output.data() + sent,
+                                  output.size() - sent,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            output.erase(0, sent);
+            return errno == EAGAIN;
+        }
+        sent += size;
+    }
+    output.clear();
+    return true;
+}
+
+} // namespace
+
+void SessionServer::watchSocket(const int epoll, const Session &session) {
+    epoll_event event = {};
+    event.events =
+        (session.watching_input ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0) |
+        (session.watching_output ? uint32_t(EPOLLOUT) : 0);
+    event.data.fd = session.socket;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, session.socket, &event);
+}
+
+void SessionServer::sendPending(const SessionPointer &session) {
+    bool resume = false;
+    bool finished = false;
+    {
+        std::lock_guard lock(session->mutex);
+        if (!sendOutput(session->socket, session->output)) {
+            session->closed = true;
+        } else if (session->output.empty()) {
+            session->watching_output = false;
+            watchSocket(epoll, *session);
+        }
+        if (session->state == Session::State::WaitingOutput &&
+            session->output.size() <= settings.max_output / 2) {
+            session->state = Session::State::Queued;
+            resume = true;
+        }
+        finished = session->closed ||
+                   (session->state == Session::State::Finished &&
+                    session->output.empty());
+    }
+    if (finished) {
+        close(session);
+    } else if (resume) {
+        wakeups.fetch_add(1, std::memory_order_relaxed);
+        schedule(session, true);
+    }
+}
+
+void SessionServer::close(const SessionPointer &session) {
+    {
+        std::lock_guard lock(session->mutex);
+        session->closed = true;
+    }
+    // the socket itself is closed with the last reference to the session
+    if (sessions.erase(session->socket)) {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, session->socket, nullptr);
+        open_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void SessionServer::closeFinished() {
+    std::vector<SessionPointer> ended;
+    {
+        std::lock_guard lock(finished_mutex);
+        ended.swap(finished);
+    }
+    for (const SessionPointer &session : ended) {
+        // sessions with output left close once it is sent
+        sendPending(session);
+    }
+}
+
+void SessionServer::schedule(const SessionPointer &session,
+                             const bool woken) {
+    {
+        std::lock_guard lock(queue_mutex);
+        if (workers_stopping) {
+            return;
+        }
+        if (woken) {
+            run_queue.push_front(session);
+        } else {
+            run_queue.push_back(session);
+        }
+    }
+    queue_ready.notify_one();
+}
+
+void SessionServer::work() {
+    for (;;) {
+        SessionPointer session;
+        {
+            std::unique_lock lock(queue_mutex);
+            queue_ready.wait(lock, [this] {
+                return workers_stopping || !run_queue.empty();
+            });
+            if (workers_stopping) {
+                return;
+            }
+            session = std::move(run_queue.front());
+            run_queue.pop_front();
+        }
+        runSlice(session);
+    }
+}
+
+void SessionServer::runSlice(const SessionPointer &session) {
+    {
+        std::lock_guard lock(session->mutex);
+        if (session->closed) {
+            return;
+        }
+        session->state = Session::State::Running;
+    }
+    Intel8080 &cpu = session->cpu;
+    if (session->waiting_input) {
+        // execute the BDOS call again, now that there is input
+        session->waiting_input = false;
+        cpu.halted = false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t executed = cpu.execute(settings.quota);
+    const auto end = std::chrono::steady_clock::now();
+    slices.fetch_add(1, std::memory_order_relaxed);
+    cycles.fetch_add(executed, std::memory_order_relaxed);
+    busy_ns.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count(),
+        std::memory_order_relaxed);
+
+    enum { Requeue, Wake, Park, Finish } next = Requeue;
+    {
+        std::lock_guard lock(session->mutex);
+        session->output.append(session->console);
+        session->console.clear();
+        if (!session->closed &&
+            !sendOutput(session->socket, session->output)) {
+            session->closed = true;
+        }
+
+        if (session->closed) {
+            // the I/O thread has already dropped it
+            session->state = Session::State::Finished;
+            return;
+        }
+        if (cpu.halted && !session->waiting_input) {
+            session->state = Session::State::Finished;
+            next = Finish;
+        } else if (session->output.size() > settings.max_output) {
+            session->state = Session::State::WaitingOutput;
+            next = Park;
+        } else if (session->waiting_input) {
+            if (session->input.empty()) {
+                session->state = Session::State::WaitingInput;
+                next = Park;
+            } else {
+                session->state = Session::State::Queued;
+                next = Wake;
+            }
+        } else {
+            session->state = Session::State::Queued;
+        }
+        bool watch = false;
+        if (!session->output.empty() && !session->watching_output) {
+            session->watching_output = true;
+            watch = true;
+        }
+        if (!session->watching_input &&
+            session->input.size() <= settings.max_input / 2) {
+            session->watching_input = true;
+            watch = true;
+        }
+        if (watch) {
+            watchSocket(epoll, *session);
+        }
+    }
+
+    switch (next) {
+    case Requeue:
+        schedule(session, false);
+        break;
+    case Wake:
+        schedule(session, true);
+        break;
+    case Park:
+        parks.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Finish: {
+        {
+            std::lock_guard lock(finished_mutex);
+            finished.push_back(session);
+        }
+        const uint64_t value = 1;
+        if (write(wakeup, &value, sizeof(value)) < 0) {
+            // the counter is already raised
+        }
+        break;
+    }
+    }
+}
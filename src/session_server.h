@@ -0,0 +1,156 @@
+#ifndef INTEL_8080_SESSION_SERVER_H
+#define INTEL_8080_SESSION_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Serves independent CP/M sessions to clients of a Unix domain socket.
+ *
+ * Each connection gets its own Intel8080 running the same COM program,
+ * with the bytes the client sends as console input and the console
+ * output sent back. The BDOS is implemented natively and supports the
+ * console functions: 1 (input), 2 (output), 6 (direct I/O), 9 (print
+ * string), 10 (read line), 11 (status) and 12 (version). Other functions
+ * return 0xff. The session ends, and the connection is closed, when the
+ * program returns to CP/M, halts or the client disconnects.
+ *
+ * A fixed pool of threads runs the sessions. A runnable session executes
+ * for a quota of cycles and then goes to the back of the run queue, so
+ * busy sessions share the threads fairly. Sessions waiting for console
+ * input, polling the console status without input, or with too much
+ * unsent output are parked: they leave the queue and use no CPU until
+ * the client sends input or the output drains. Woken sessions go to the
+ * front of the queue, so interactive sessions respond quickly beside
+ * busy ones. A session holding max_input bytes of unread input is not
+ * read from until it has taken half of them, leaving the client blocked
+ * on its socket.
+ *
+ * One thread, the one calling run(), accepts connections and moves bytes
+ * between the sockets and the sessions.
+ */
+class SessionServer {
+  public:
+    struct Settings {
+        // threads running sessions, 0 for one per host core
+        unsigned int threads = 0;
+        // cycles a session runs before the next gets a turn
+        std::size_t quota = 200000;
+        // unsent output, in bytes, before a session waits for the client
+        std::size_t max_output = 65536;
+        // unread input, in bytes, before the client waits for the session
+        std::size_t max_input = 65536;
+        // console status polls without input before a session is parked
+        std::size_t idle_polls = 16;
+        // connections beyond this are refused
+        std::size_t max_sessions = 4096;
+    };
+
+    /**
+     * Counters since the server was created
+     */
+    struct Statistics {
+        uint64_t sessions = 0;
+        uint64_t open_sessions = 0;
+        uint64_t slices = 0;
+        uint64_t cycles = 0;
+        // times a session was parked and woken again
+        uint64_t parks = 0;
+        uint64_t wakeups = 0;
+        // host time the pool spent executing sessions
+        uint64_t busy_ns = 0;
+    };
+
+    /**
+     * Parameters:
+     *     program - The COM program each session runs, loaded at 0x100
+     */
+    explicit SessionServer(std::vector<uint8_t> program,
+                           const Settings &settings);
+    explicit SessionServer(std::vector<uint8_t> program)
+        : SessionServer(std::move(program), Settings()) {}
+    SessionServer(const SessionServer &) = delete;
+    SessionServer &operator=(const SessionServer &) = delete;
+
+    /**
+     * Stops the server and closes every session
+     */
+    ~SessionServer();
+
+    /**
+     * Create the socket at the path, replacing a stale one
+     * Returns: False when the socket cannot be created
+     */
+    bool listen(const std::string &path);
+
+    /**
+     * Serve connections until stop() is called
+     * Returns: False when not listening
+     */
+    bool run();
+
+    /**
+     * Make run() return, from any thread
+     */
+    void stop();
+
+    Statistics statistics() const;
+
+  private:
+    struct Session;
+    using SessionPointer = std::shared_ptr<Session>;
+
+    std::vector<uint8_t> program;
+    Settings settings;
+
+    int listener = -1;
+    std::string socket_path;
+    int epoll = -1;
+    // written to wake the I/O thread for sessions that finished
+    int wakeup = -1;
+    std::atomic<bool> stopping = false;
+
+    // sessions by socket, owned by the I/O thread
+    std::unordered_map<int, SessionPointer> sessions;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::deque<SessionPointer> run_queue;
+    bool workers_stopping = false;
+    std::vector<std::thread> workers;
+
+    // sessions that ended, for the I/O thread to close
+    std::mutex finished_mutex;
+    std::vector<SessionPointer> finished;
+
+    std::atomic<uint64_t> session_count = 0;
+    std::atomic<uint64_t> slices = 0;
+    std::atomic<uint64_t> cycles = 0;
+    std::atomic<uint64_t> parks = 0;
+    std::atomic<uint64_t> wakeups = 0;
+    std::atomic<uint64_t> busy_ns = 0;
+    std::atomic<uint64_t> open_count = 0;
+
+    void accept();
+    void receive(const SessionPointer &session, const bool hung_up);
+    // set the socket's events from the session's watching flags, with the
+    // session locked
+    static void watchSocket(const int epoll, const Session &session);
+    void sendPending(const SessionPointer &session);
+    void close(const SessionPointer &session);
+    void closeFinished();
+
+    void schedule(const SessionPointer &session, const bool woken);
+    void work();
+    void runSlice(const SessionPointer &session);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "shared_pages.h"
+#include "dirty_pages.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// FNV-1a, 64 bit
+uint64_t hash(const uint8_t *data, const std::size_t size) {
+    uint64_t value = 0xcbf29ce484222325;
+    for (std::size_t i = 0; i < size; ++i) {
+        value = (value ^ data[i]) * 0x100000001b3;
+    }
+    return value;
+}
+
+// /proc/self/pagemap entry bits
+constexpr uint64_t page_present = uint64_t(1) << 63;
+constexpr uint64_t page_swapped = uint64_t(1) << 62;
+constexpr uint64_t page_file = uint64_t(1) << 61;
+
+// the heap expects anonymous memory back, not a mapping of the pool
+void unshare(uint8_t *const memory) {
+    std::vector<uint8_t> contents(memory, memory + 0x10000);
+    mmap(memory, 0x10000, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    std::memcpy(memory, contents.data(), 0x10000);
+}
+
+} // namespace
+
+SharedPages::SharedPages() {
+    const long host_page = sysconf(_SC_PAGESIZE);
+    if (host_page <= 0 || 0x10000 % host_page != 0) {
+        return;
+    }
+    page_size = host_page;
+    file = memfd_create("emu8080-shared-pages", MFD_CLOEXEC);
+}
+
+SharedPages::~SharedPages() {
+    for (const auto &[memory, offsets] : attached) {
+        unshare(memory);
+    }
+    if (file >= 0) {
+        close(file);
+    }
+}
+
+bool SharedPages::share(Intel8080 &cpu) {
+    uint8_t *const memory = cpu.memory.data();
+    if (file < 0 || reinterpret_cast<uintptr_t>(memory) % page_size != 0 ||
+        DirtyPageTracker::isTracked(cpu)) {
+        return false;
+    }
+    std::vector<std::size_t> &mapped = attached[memory];
+    mapped.resize(0x10000 / page_size, SIZE_MAX);
+
+    for (std::size_t i = 0; i < mapped.size(); ++i) {
+        uint8_t *const page = memory + i * page_size;
+        const std::size_t offset = store(page);
+        if (offset == SIZE_MAX) {
+            return false;
+        }
+        // the new page is counted before the old one may be freed
+        ++references[offset / page_size];
+        if (mmap(page, page_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, file, offset) == MAP_FAILED) {
+            release(offset);
+            return false;
+        }
+        if (mapped[i] != SIZE_MAX) {
+            release(mapped[i]);
+        }
+        mapped[i] = offset;
+    }
+    return true;
+}
+
+bool SharedPages::detach(Intel8080 &cpu) {
+    uint8_t *const memory = cpu.memory.data();
+    const auto found = attached.find(memory);
+    if (found == attached.end()) {
+        return true;
+    }
+    if (DirtyPageTracker::isTracked(cpu)) {
+        return false;
+    }
+    unshare(memory);
+    for (const std::size_t offset : found->second) {
+        if (offset != SIZE_MAX) {
+            release(offset);
+        }
+    }
+    attached.erase(found);
+    return true;
+}
+
+SharedPages::Savings SharedPages::savings() const {
+    Savings savings = {};
+    savings.instances = attached.size();
+    savings.pool_pages = pool_pages;
+
+    const int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    std::vector<uint64_t> entries(0x10000 / page_size);
+    for (const auto &[memory, offsets] : attached) {
+        const off_t offset =
+            reinterpret_cast<uintptr_t>(memory) / page_size * sizeof(uint64_t);
+        const std::size_t size = entries.size() * sizeof(uint64_t);
+        if (pagemap < 0 ||
+            pread(pagemap, entries.data(), size, offset) != ssize_t(size)) {
+            // unknown, assume nothing was copied
+            std::fill(entries.begin(), entries.end(), 0);
+        }
+        for (const uint64_t entry : entries) {
+            const bool copied =
+                (entry & page_swapped) ||
+                ((entry & page_present) && !(entry & page_file));
+            ++(copied ? savings.private_pages : savings.shared_pages);
+        }
+    }
+    if (pagemap >= 0) {
+        close(pagemap);
+    }
+
+    savings.pages = savings.shared_pages + savings.private_pages;
+    const std::size_t used = savings.pool_pages + savings.private_pages;
+    savings.bytes_saved =
+        savings.pages > used ? (savings.pages - used) * page_size : 0;
+    return savings;
+}
+
+std::size_t SharedPages::store(const uint8_t *page) {
+    const uint64_t page_hash = hash(page, page_size);
+    std::vector<std::size_t> &candidates = pages_by_hash[page_hash];
+    std::vector<uint8_t> stored(page_size);
+    for (const std::size_t offset : candidates) {
+        if (pread(file, stored.data(), page_size, offset) ==
+                ssize_t(page_size) &&
+            std::memcmp(stored.data(), page, page_size) == 0) {
+            return offset;
+        }
+    }
+
+    std::size_t offset = references.size() * page_size;
+    if (!free_offsets.empty()) {
+        offset = free_offsets.back();
+    }
+    if (pwrite(file, page, page_size, offset) != ssize_t(page_size)) {
+        return SIZE_MAX;
+    }
+    if (free_offsets.empty()) {
+        page_hashes.push_back(page_hash);
+        references.push_back(0);
+    } else {
+        free_offsets.pop_back();
+        page_hashes[offset / page_size] = page_hash;
+    }
+    ++pool_pages;
+    candidates.push_back(offset);
+    return offset;
+}
+
+void SharedPages::release(const std::size_t offset) {
+    const std::size_t index = offset / page_size;
+    if (--references[index] != 0) {
+        return;
+    }
+    std::vector<std::size_t> &candidates = pages_by_hash[page_hashes[index]];
+    candidates.erase(std::find(candidates.begin(), candidates.end(), offset));
+    if (candidates.empty()) {
+        pages_by_hash.erase(page_hashes[index]);
+    }
+    // give the memory back, the page reads as zeros until it is reused
+    fallocate(file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset,
+              page_size);
+    free_offsets.push_back(offset);
+    --pool_pages;
+}
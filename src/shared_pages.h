@@ -0,0 +1,97 @@
+#ifndef INTEL_8080_SHARED_PAGES_H
+#define INTEL_8080_SHARED_PAGES_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.h"
+
+/**
+ * Shares identical pages of memory between CPUs, such as many instances
+ * booted from the same CP/M image.
+ *
+ * share() stores each host page of a CPU's memory in a pool, once per
+ * distinct content, and maps the CPU's page onto the pool's copy
+ * privately. Reads use the one copy; the first write to a page gives that
+ * CPU its own copy again, so sharing needs nothing on the store path.
+ * Calling share() again later shares pages that have become identical.
+ * Each pool page counts the CPU pages mapped onto it, and one no longer
+ * mapped is freed and its space reused, so the pool only holds pages
+ * some CPU still maps.
+ *
+ * Mapping a page drops any protection on it, so memory tracked by a
+ * DirtyPageTracker is neither shared nor detached: share() and detach()
+ * return false for it. Shared CPUs must be detached, or the pool
+ * destroyed, before they are. Not thread safe, but shared CPUs may run on
+ * any thread.
+ */
+class SharedPages {
+  public:
+    struct Savings {
+        std::size_t instances;
+        // host pages of memory in all shared CPUs
+        std::size_t pages;
+        // distinct pages stored in the pool and mapped by some CPU
+        std::size_t pool_pages;
+        // pages still mapped to the pool, and copied since by a write
+        std::size_t shared_pages;
+        std::size_t private_pages;
+        // memory used by the CPUs' pages less the pool and private pages
+        std::size_t bytes_saved;
+    };
+
+    SharedPages();
+    SharedPages(const SharedPages &) = delete;
+    SharedPages &operator=(const SharedPages &) = delete;
+
+    /**
+     * Detaches every shared CPU
+     */
+    ~SharedPages();
+
+    /**
+     * Returns: True when the pool could be created
+     */
+    bool isOpen() const { return file >= 0; }
+
+    /**
+     * Map the CPU's memory onto the pool, adding pages it does not have
+     * and freeing those it no longer maps
+     * Returns: False when the memory could not be shared
+     */
+    bool share(Intel8080 &cpu);
+
+    /**
+     * Give the CPU private memory with the same contents again
+     * Returns: False when the memory is tracked and stays shared
+     */
+    bool detach(Intel8080 &cpu);
+
+    /**
+     * Returns: What sharing saves now, from the host's page tables
+     */
+    Savings savings() const;
+
+  private:
+    int file = -1;
+    std::size_t page_size = 0;
+    std::size_t pool_pages = 0;
+
+    // pool offsets of the pages with each content hash
+    std::unordered_map<uint64_t, std::vector<std::size_t>> pages_by_hash;
+
+    // for each pool page, its content hash and how many CPU pages map it
+    std::vector<uint64_t> page_hashes;
+    std::vector<std::size_t> references;
+    // pool offsets of freed pages, reused before the pool grows
+    std::vector<std::size_t> free_offsets;
+
+    // the pool offset each page of a shared CPU's memory maps, or SIZE_MAX
+    std::unordered_map<uint8_t *, std::vector<std::size_t>> attached;
+
+    std::size_t store(const uint8_t *page);
+    void release(const std::size_t offset);
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "translation_cache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char magic[8] = {'E', 'M', 'U', '8', '0', '8', '0', 'T'};
+constexpr uint32_t version = 3;
+
+// records per set, replaced least recently used first
+constexpr std::size_t ways = 8;
+
+} // namespace
+
+struct TranslationCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    // advanced on every hit and store, the last use of each record
+    uint64_t clock;
+};
+
+struct TranslationCache::Record {
+    // hash of the identity and index, 0 for an empty record
+    uint64_t key;
+    uint64_t last_used;
+    // hash of everything below, catching records torn by a concurrent store
+    uint64_t checksum;
+    uint64_t image;
+    uint64_t context;
+    uint32_t size;
+    // this record's place in the result and the result's length
+    uint32_t index;
+    uint32_t count;
+    uint8_t entry[entry_size];
+
+    bool is(const Identity &identity, const uint32_t at) const {
+        return image == identity.image && context == identity.context &&
+               size == identity.size && index == at;
+    }
+
+    uint64_t sum() const {
+        return hash(&image, offsetof(Record, entry) + entry_size -
+                                offsetof(Record, image));
+    }
+};
+
+TranslationCache::TranslationCache(const std::string &path,
+                                   const std::size_t capacity) {
+    set_count = capacity < ways ? 1 : capacity / ways;
+    const std::size_t records_size = set_count * ways * sizeof(Record);
+    const std::size_t size = sizeof(Header) + records_size;
+
+    const int file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0) {
+        return;
+    }
+    struct stat status;
+    const bool sized = fstat(file, &status) == 0 &&
+                       std::size_t(status.st_size) == size;
+    if (!sized && ftruncate(file, size) != 0) {
+        close(file);
+        return;
+    }
+    void *mapping =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+
+    header = static_cast<Header *>(mapping);
+    records = reinterpret_cast<Record *>(header + 1);
+    mapped_size = size;
+
+    // a file from another layout starts over empty
+    if (!sized || std::memcmp(header->magic, magic, sizeof(magic)) != 0 ||
+        header->version != version || header->capacity != set_count * ways) {
+        std::memset(mapping, 0, size);
+        std::memcpy(header->magic, magic, sizeof(magic));
+        header->version = version;
+        header->capacity = set_count * ways;
+    }
+}
+
+TranslationCache::~TranslationCache() {
+    if (header) {
+        munmap(header, mapped_size);
+    }
+}
+
+bool TranslationCache::lookup(const uint8_t *image, const std::size_t size,
+                              const uint64_t context,
+                              std::vector<Entry> &entries) {
+    if (!header) {
+        ++stats.misses;
+        return false;
+    }
+    const Identity identity = identify(image, size, context);
+    const Record *first = find(identity, 0);
+    if (!first) {
+        ++stats.misses;
+        return false;
+    }
+
+    // a record evicted or torn since the store loses the whole result
+    const uint32_t count = first->count;
+    std::vector<Record *> found;
+    for (uint32_t i = 0; i < count; ++i) {
+        Record *record = find(identity, i);
+        if (!record || record->count != count) {
+            ++stats.misses;
+            return false;
+        }
+        found.push_back(record);
+    }
+
+    entries.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        found[i]->last_used = ++header->clock;
+        std::memcpy(entries[i].data(), found[i]->entry, entry_size);
+    }
+    ++stats.hits;
+    return true;
+}
+
+void TranslationCache::store(const uint8_t *image, const std::size_t size,
+                             const uint64_t context,
+                             const std::vector<Entry> &entries) {
+    if (!header || entries.empty() ||
+        entries.size() > set_count * ways) {
+        return;
+    }
+    const Identity identity = identify(image, size, context);
+    const uint32_t count = entries.size();
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t key = keyOf(identity, i);
+        Record *candidates = set(key);
+
+        // replace this record's older copy, else an empty or the oldest
+        Record *victim = &candidates[0];
+        for (std::size_t way = 0; way < ways; ++way) {
+            Record &record = candidates[way];
+            if (record.key == key && record.is(identity, i)) {
+                victim = &record;
+                break;
+            }
+            // empty records were last used at 0
+            if (record.last_used < victim->last_used) {
+                victim = &record;
+            }
+        }
+        if (victim->key != 0 && !victim->is(identity, i)) {
+            ++stats.evictions;
+        }
+
+        victim->key = key;
+        victim->image = identity.image;
+        victim->context = identity.context;
+        victim->size = identity.size;
+        victim->index = i;
+        victim->count = count;
+        std::memcpy(victim->entry, entries[i].data(), entry_size);
+        victim->checksum = victim->sum();
+        victim->last_used = ++header->clock;
+    }
+    ++stats.stores;
+}
+
+uint64_t TranslationCache::hash(const void *data, const std::size_t size,
+                                uint64_t value) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        value = (value ^ bytes[i]) * 0x100000001b3;
+    }
+    return value;
+}
+
+TranslationCache::Identity
+TranslationCache::identify(const uint8_t *image, const std::size_t size,
+                           const uint64_t context) {
+    return {hash(image, size), context, uint32_t(size)};
+}
+
+uint64_t TranslationCache::keyOf(const Identity &identity,
+                                 const uint32_t index) {
+    uint64_t value = hash(&identity.image, sizeof(identity.image));
+    value = hash(&identity.context, sizeof(identity.context), value);
+    value = hash(&identity.size, sizeof(identity.size), value);
+    value = hash(&index, sizeof(index), value);
+    // 0 marks an empty record
+    return value ? value : 1;
+}
+
+TranslationCache::Record *TranslationCache::find(const Identity &identity,
+                                                 const uint32_t index) const {
+    const uint64_t key = keyOf(identity, index);
+    Record *candidates = set(key);
+    for (std::size_t way = 0; way < ways; ++way) {
+        Record &record = candidates[way];
+        if (record.key == key && record.is(identity, index) &&
+            record.checksum == record.sum()) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+TranslationCache::Record *TranslationCache::set(const uint64_t key) const {
+    return records + (key % set_count) * ways;
+}
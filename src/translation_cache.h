@@ -0,0 +1,120 @@
+#ifndef INTEL_8080_TRANSLATION_CACHE_H
+#define INTEL_8080_TRANSLATION_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Persistent cache of per-image translation results, such as which bytes
+ * of a program decode as instructions, shared between processes through a
+ * memory-mapped file.
+ *
+ * Results are keyed by a hash of the whole image, its size and a context
+ * value for anything else they were derived from, such as how long the
+ * program was traced. A changed image or context is a miss. A result is a
+ * sequence of fixed size entries, each kept in its own record, and a
+ * lookup only hits when every entry of the result is still there.
+ *
+ * The file holds a fixed number of records, so its size is bounded. The
+ * records are grouped in sets by hash and the least recently used record
+ * of a full set is replaced. A cache that cannot be opened stays empty
+ * and ignores stores. Processes sharing the file do not lock it, so they
+ * may lose each other's stores, but every record carries a checksum and a
+ * torn one is treated as a miss.
+ */
+class TranslationCache {
+  public:
+    static constexpr std::size_t entry_size = 128;
+    static constexpr std::size_t default_capacity = 16384;
+
+    using Entry = std::array<uint8_t, entry_size>;
+
+    struct Counters {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t stores;
+        // records of other results replaced to make room for a store
+        uint64_t evictions;
+    };
+
+    /**
+     * Maps the cache file, creating it or resetting it when it was made
+     * with a different capacity or layout
+     * Parameters:
+     *     path - The cache file
+     *     capacity - The number of records the file holds
+     */
+    explicit TranslationCache(const std::string &path,
+                              const std::size_t capacity = default_capacity);
+    TranslationCache(const TranslationCache &) = delete;
+    TranslationCache &operator=(const TranslationCache &) = delete;
+    ~TranslationCache();
+
+    /**
+     * Returns: True when the cache file is mapped
+     */
+    bool isOpen() const { return header != nullptr; }
+
+    /**
+     * Find the result stored for an image
+     * Parameters:
+     *     image - The image's bytes
+     *     size - The number of bytes
+     *     context - The hash of everything else the result depends on
+     *     entries - Receives the stored entries
+     * Returns: True when a complete result was stored for exactly this
+     *          image and context
+     */
+    bool lookup(const uint8_t *image, const std::size_t size,
+                const uint64_t context, std::vector<Entry> &entries);
+
+    /**
+     * Store the result for an image, replacing any older one. Results
+     * with no entries or more than the cache holds are not stored.
+     */
+    void store(const uint8_t *image, const std::size_t size,
+               const uint64_t context, const std::vector<Entry> &entries);
+
+    /**
+     * Hash bytes with 64 bit FNV-1a, for building context values
+     * Parameters:
+     *     data - The bytes
+     *     size - The number of bytes
+     *     value (optional) - The hash to continue from
+     * Returns: The hash
+     */
+    static uint64_t hash(const void *data, const std::size_t size,
+                         uint64_t value = 0xcbf29ce484222325);
+
+    /**
+     * Returns: The counters of this process since the cache was opened
+     */
+    Counters counters() const { return stats; }
+
+  private:
+    struct Header;
+    struct Record;
+
+    // identifies one image and context, shared by its records
+    struct Identity {
+        uint64_t image;
+        uint64_t context;
+        uint32_t size;
+    };
+
+    Header *header = nullptr;
+    Record *records = nullptr;
+    std::size_t mapped_size = 0;
+    std::size_t set_count = 0;
+    Counters stats{};
+
+    static Identity identify(const uint8_t *image, const std::size_t size,
+                             const uint64_t context);
+    static uint64_t keyOf(const Identity &identity, const uint32_t index);
+    Record *find(const Identity &identity, const uint32_t index) const;
+    Record *set(const uint64_t key) const;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef INTEL_8080_VARIANT_H
+#define INTEL_8080_VARIANT_H
+
+#include <array>
+#include <cstddef>
+
+/**
+ * Compile-time CPU variant policies.
+ *
+ * The interpreter is instantiated once per policy, so timing tables,
+ * opcode semantics and the interrupt model are fixed at compile time and
+ * never checked per instruction.
+ */
+namespace variant {
+
+struct Intel8080 {
+    static constexpr bool is_8085 = false;
+
+    /**
+     * Number of clock cycles needed to execute each instruction.
+     * Conditional instructions list their not taken timing.
+     */
+    static constexpr std::array<std::size_t, 256> instruction_timing = {
+        4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,
+        4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,
+        4, 10, 16,  5,  5,  5,  7,  4,  4, 10, 16,  5,  5,  5,  7,  4,
+        4, 10, 13,  5, 10, 10, 10,  4,  4, 10, 13,  5,  5,  5,  7,  4,
+        5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
+        5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
+        5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
+        7,  7,  7,  7,  7,  7,  7,  7,  5,  5,  5,  5,  5,  5,  7,  5,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,
+        5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,
+        5, 10, 10, 18, 11, 11,  7, 11,  5,  5, 10,  5, 11, 17,  7, 11,
+        5, 10, 10,  4, 11, 11,  7, 11,  5,  5, 10,  4, 11, 17,  7, 11,
+    };
+
+    // extra clock cycles when a conditional instruction is taken
+    static constexpr std::size_t jump_taken_cycles = 0;
+    static constexpr std::size_t call_taken_cycles = 6;
+    static constexpr std::size_t return_taken_cycles = 6;
+};
+
+struct Intel8085 {
+    static constexpr bool is_8085 = true;
+
+    /**
+     * Number of clock cycles needed to execute each instruction,
+     * including the undocumented DSUB, ARHL, RDEL, LDHI, LDSI, RSTV,
+     * SHLX, JNK, LHLX and JK. Conditional instructions list their not
+     * taken timing.
+     */
+    static constexpr std::array<std::size_t, 256> instruction_timing = {
+        4, 10,  7,  6,  4,  4,  7,  4, 10, 10,  7,  6,  4,  4,  7,  4,
+        7, 10,  7,  6,  4,  4,  7,  4, 10, 10,  7,  6,  4,  4,  7,  4,
+        4, 10, 16,  6,  4,  4,  7,  4, 10, 10, 16,  6,  4,  4,  7,  4,
+        4, 10, 13,  6, 10, 10, 10,  4, 10, 10, 13,  6,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        7,  7,  7,  7,  7,  7,  5,  7,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+        6, 10,  7, 10,  9, 12,  7, 12,  6, 10,  7,  6,  9, 18,  7, 12,
+        6, 10,  7, 10,  9, 12,  7, 12,  6, 10,  7, 10,  9,  7,  7, 12,
+        6, 10,  7, 16,  9, 12,  7, 12,  6,  6,  7,  4,  9, 10,  7, 12,
+        6, 10,  7,  4,  9, 12,  7, 12,  6,  6,  7,  4,  9,  7,  7, 12,
+    };
+
+    // extra clock cycles when a conditional instruction is taken
+    static constexpr std::size_t jump_taken_cycles = 3;
+    static constexpr std::size_t call_taken_cycles = 9;
+    static constexpr std::size_t return_taken_cycles = 6;
+};
+
+} // namespace variant
+
+#endif
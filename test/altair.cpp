@@ -0,0 +1,59 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../src/altair.h"
+
+// give up on reaching the prompt after ten minutes of Altair time
+constexpr std::size_t cycle_limit = 600 * 2000000;
+constexpr std::size_t slice = 1000;
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        std::cout << "usage: altair [DISK] [BOOT ROM] [PROMPT]" << std::endl;
+        return 1;
+    }
+    const std::string prompt = argc == 4 ? argv[3] : "A>";
+
+    // too large for the stack
+    auto altair = std::make_unique<Altair8800>();
+    if (!altair->mount(0, argv[1])) {
+        std::cout << "cannot mount " << argv[1] << std::endl;
+        return 1;
+    }
+    const bool booted = argc > 2 && std::string(argv[2]) != "-"
+                            ? altair->loadBootRom(argv[2])
+                            : altair->boot();
+    if (!booted) {
+        std::cout << "cannot boot " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::string console;
+    altair->output = [&console](uint8_t byte) {
+        console += char(byte & 0x7f);
+        std::cout << char(byte & 0x7f) << std::flush;
+    };
+
+    // boot as fast as possible until the prompt appears
+    std::size_t cycles = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (!altair->cpu.halted && cycles < cycle_limit &&
+           !console.ends_with(prompt)) {
+        cycles += altair->cpu.execute(slice);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << std::endl;
+    if (!console.ends_with(prompt)) {
+        std::cout << "no prompt after " << cycles << " cycles" << std::endl;
+        return 1;
+    }
+    std::cout << "Boot to prompt: " << cycles << " cycles ("
+              << cycles / 2e6 * 1e3 << " ms at 2 MHz), " << seconds * 1e3
+              << " ms host, " << cycles / seconds / 1e6 << " MHz"
+              << std::endl;
+    return 0;
+}
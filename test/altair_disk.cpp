@@ -0,0 +1,240 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/altair.h"
+
+/**
+ * Checks Altair8800 with a synthetic two track disk: booting its
+ * interleaved boot sectors into a program that echoes the console
+ * through the 88-2SIO, and the 88-DCDD drive select, status, head load,
+ * stepping, sector rotation, reads and writes through to the mapped
+ * image.
+ */
+
+constexpr std::size_t track_size =
+    Altair8800::sectors * Altair8800::sector_size;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+const std::string directory =
+    "/tmp/emu8080-altair-" + std::to_string(getpid());
+
+uint8_t *sector(std::vector<uint8_t> &disk, const std::size_t track,
+                const std::size_t number) {
+    return &disk[(track * Altair8800::sectors + number) *
+                 Altair8800::sector_size];
+}
+
+/**
+ * Boot sectors hold the length to load at bytes 1 and 2, 128 bytes of
+ * code from byte 3, a stop byte of FFh and the checksum of the code
+ */
+void bootSector(uint8_t *data, const uint16_t length,
+                const std::vector<uint8_t> &code) {
+    data[1] = length;
+    data[2] = length >> 8;
+    std::copy(code.begin(), code.end(), data + 3);
+    uint8_t checksum = 0;
+    for (std::size_t i = 3; i < 131; ++i) {
+        checksum += data[i];
+    }
+    data[131] = 0xff;
+    data[132] = checksum;
+}
+
+std::vector<uint8_t> syntheticDisk() {
+    std::vector<uint8_t> disk(2 * track_size);
+    for (std::size_t i = 0; i < disk.size(); ++i) {
+        disk[i] = uint8_t(i * 13 + i / Altair8800::sector_size);
+    }
+    // IN 10h; RRC; JNC 0000h; IN 11h; OUT 11h; CPI '.'; JNZ 0000h; HLT
+    const std::vector<uint8_t> echo = {0xdb, 0x10, 0x0f, 0xd2, 0x00,
+                                       0x00, 0xdb, 0x11, 0xd3, 0x11,
+                                       0xfe, 0x2e, 0xc2, 0x00, 0x00,
+                                       0x76};
+    std::vector<uint8_t> code(128, 0);
+    std::copy(echo.begin(), echo.end(), code.begin());
+    bootSector(sector(disk, 0, 0), 256, code);
+
+    // the second 128 bytes come from sector 2, the next in the interleave
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        code[i] = uint8_t(0x80 + i);
+    }
+    bootSector(sector(disk, 0, 2), 256, code);
+    return disk;
+}
+
+void writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+    std::ofstream output(path, std::ios::out | std::ios::binary);
+    output.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+std::vector<uint8_t> readFile(const std::string &path) {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(input)),
+                                std::istreambuf_iterator<char>());
+}
+
+void testBoot(const std::vector<uint8_t> &disk) {
+    auto altair = std::make_unique<Altair8800>();
+    check(!altair->boot(), "no disk to boot");
+    check(altair->mount(0, directory + "/disk.dsk") && altair->boot(),
+          "boot");
+    check(altair->cpu.program_counter == 0 &&
+              std::equal(disk.begin() + 3, disk.begin() + 131,
+                         altair->cpu.memory.begin()) &&
+              altair->cpu.memory[128] == 0x80 &&
+              altair->cpu.memory[255] == 0xff,
+          "boot sectors interleaved");
+
+    // the 2SIO reports transmit empty, and receive full with input
+    std::string console;
+    altair->output = [&](uint8_t byte) { console += char(byte); };
+    check(altair->cpu.in(0x10) == 0x02 && altair->cpu.in(0x12) == 0x02,
+          "2SIO status without input");
+    altair->type("hi.");
+    check(altair->cpu.in(0x10) == 0x03, "2SIO status with input");
+    altair->cpu.execute(10000);
+    check(altair->cpu.halted && console == "hi." &&
+              altair->cpu.in(0x10) == 0x02 && altair->cpu.in(0x11) == 0,
+          "console echoed");
+
+    altair->sense_switches = 0x5a;
+    check(altair->cpu.in(0xff) == 0x5a, "sense switches");
+
+    // a boot sector with a bad checksum is refused
+    std::vector<uint8_t> corrupt = disk;
+    ++corrupt[3];
+    writeFile(directory + "/corrupt.dsk", corrupt);
+    check(altair->mount(0, directory + "/corrupt.dsk") && !altair->boot(),
+          "bad checksum refused");
+
+    // a PROM starts the CPU at boot_rom
+    writeFile(directory + "/boot.rom", {0xc3, 0x00, 0x00});
+    check(altair->loadBootRom(directory + "/boot.rom") &&
+              altair->cpu.program_counter == Altair8800::boot_rom &&
+              altair->cpu.memory[Altair8800::boot_rom] == 0xc3,
+          "boot PROM");
+}
+
+void testDisk(const std::vector<uint8_t> &disk) {
+    const std::string path = directory + "/disk.dsk";
+    auto altair = std::make_unique<Altair8800>();
+    Intel8080 &cpu = altair->cpu;
+    const auto status = [&] { return uint8_t(~cpu.in(0x08)); };
+
+    check(cpu.in(0x08) == 0xff && cpu.in(0x09) == 0xff, "no drive selected");
+    altair->mount(0, path);
+    cpu.out(0x08, 0x03);
+    check(cpu.in(0x08) == 0xff, "empty drive not selected");
+    cpu.out(0x08, 0x00);
+    // head movable, drive enabled, track 0
+    check(status() == 0x4a, "drive selected");
+    cpu.out(0x08, 0x80);
+    check(cpu.in(0x08) == 0xff, "drive deselected");
+
+    // the sector position is only valid with the head loaded
+    cpu.out(0x08, 0x00);
+    check(cpu.in(0x09) == 0xff, "no position before head load");
+    cpu.out(0x09, 0x04);
+    check(status() == (0x4a | 0x04 | 0x80), "head loaded");
+
+    // each position read is the next sector, with sector true low
+    bool rotated = true;
+    for (std::size_t i = 1; i <= Altair8800::sectors; ++i) {
+        rotated = rotated &&
+                  cpu.in(0x09) == (0xc0 | (i % Altair8800::sectors) << 1);
+    }
+    check(rotated, "sector rotation");
+
+    // sector 0 after a full turn, then sector 1 of track 1
+    std::vector<uint8_t> data = disk;
+    bool read = true;
+    for (std::size_t i = 0; i < Altair8800::sector_size; ++i) {
+        read = read && cpu.in(0x0a) == sector(data, 0, 0)[i];
+    }
+    check(read, "sector read");
+    cpu.out(0x09, 0x01);
+    check(!(status() & 0x40), "stepped in");
+    cpu.in(0x09);
+    read = true;
+    for (std::size_t i = 0; i < Altair8800::sector_size; ++i) {
+        read = read && cpu.in(0x0a) == sector(data, 1, 1)[i];
+    }
+    check(read, "sector read on track 1");
+
+    // stepping stops at the last track and at track 0
+    cpu.out(0x09, 0x01);
+    cpu.out(0x09, 0x02);
+    cpu.out(0x09, 0x02);
+    check(status() & 0x40, "stepped out to track 0");
+
+    cpu.out(0x09, 0x10);
+    check(status() & 0x20, "interrupts enabled");
+    cpu.out(0x09, 0x20);
+    check(!(status() & 0x20), "interrupts disabled");
+
+    // write sector 2 of track 0, then one byte too many
+    cpu.in(0x09);
+    cpu.out(0x09, 0x80);
+    check(status() & 0x01, "write enabled");
+    for (std::size_t i = 0; i < Altair8800::sector_size; ++i) {
+        cpu.out(0x0a, uint8_t(0xe0 ^ i));
+    }
+    check(!(status() & 0x01), "write done after a sector");
+    cpu.out(0x0a, 0x55);
+    for (std::size_t i = 0; i < Altair8800::sector_size; ++i) {
+        sector(data, 0, 2)[i] = uint8_t(0xe0 ^ i);
+    }
+    // the mapping is shared, so the file has the sector already
+    check(readFile(path) == data, "write reaches the image");
+    altair->unmount(0);
+    check(readFile(path) == data && cpu.in(0x08) == 0xff, "unmounted");
+
+    // a read only mount leaves the image alone
+    check(altair->mount(1, path, true), "read only mount");
+    cpu.out(0x08, 0x01);
+    cpu.out(0x09, 0x04);
+    cpu.in(0x09);
+    cpu.out(0x09, 0x80);
+    cpu.out(0x0a, 0x00);
+    altair->unmount(1);
+    check(readFile(path) == data, "read only image unchanged");
+
+    // images must be whole tracks
+    writeFile(directory + "/short.dsk", std::vector<uint8_t>(track_size - 1));
+    check(!altair->mount(0, directory + "/short.dsk") &&
+              !altair->mount(0, directory + "/missing.dsk") &&
+              !altair->mount(Altair8800::drive_count, path),
+          "bad images refused");
+}
+
+int main() {
+    std::filesystem::create_directory(directory);
+    const std::vector<uint8_t> disk = syntheticDisk();
+    writeFile(directory + "/disk.dsk", disk);
+
+    testBoot(disk);
+    testDisk(disk);
+    std::filesystem::remove_all(directory);
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All Altair checks passed" << std::endl;
+    return 0;
+}
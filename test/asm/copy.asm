@@ -0,0 +1,10 @@
+        .org	0x100
+        lxi     sp, 0xf000
+        call    show
+        call    0x8000
+        call    show
+        hlt
+        db      0, 0, 0
+show:   mvi     a, 1
+        out     0
+        ret
@@ -0,0 +1,19 @@
+        .org	0x100
+loop:   mvi     c, 1
+        call    5
+        cpi     3
+        rz
+        cpi     '!'
+        jnz     loop
+        lxi     b, 0
+busy:   mvi     a, 16
+inner:  dcr     a
+        jnz     inner
+        dcx     b
+        mov     a, b
+        ora     c
+        jnz     busy
+        mvi     c, 2
+        mvi     e, '*'
+        call    5
+        jmp     loop
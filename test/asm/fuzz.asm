@@ -0,0 +1,15 @@
+        .org	0x100
+        lxi     sp, 0x1000
+        in      2
+        cpi     '8'
+        jnz     0
+        in      2
+        cpi     '0'
+        jnz     0
+        in      2
+        cpi     '8'
+        jnz     0
+        in      2
+        cpi     '0'
+        jnz     0
+        hlt
@@ -0,0 +1,3 @@
+        .org	0x100
+        out     1
+loop:   jmp     loop
@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/async.h"
+#include "../src/i8085.h"
+
+/**
+ * Checks AsyncIntel8080: input supplied at once, later from the host and
+ * from another thread, input racing the suspension, awaiting from a
+ * coroutine, an Intel8085 run as an 8085, and the in callback restored.
+ */
+
+// IN 1; INR A; OUT 0; IN 2; OUT 0; HLT
+const std::vector<uint8_t> echo_program = {0xdb, 0x01, 0x3c, 0xd3, 0x00,
+                                           0xdb, 0x02, 0xd3, 0x00, 0x76};
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+template <class CPU = Intel8080>
+std::unique_ptr<CPU> load(const std::vector<uint8_t> &program,
+                          std::vector<uint8_t> &output) {
+    auto cpu = std::make_unique<CPU>();
+    cpu->memory.fill(0);
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    cpu->out = [&output](uint8_t, uint8_t value) { output.push_back(value); };
+    return cpu;
+}
+
+void testImmediateInput() {
+    std::vector<uint8_t> output;
+    auto cpu = load(echo_program, output);
+    AsyncIntel8080 async(*cpu);
+    async.input_requested = [&](uint8_t port) {
+        async.completeInput(port * 10);
+    };
+    AsyncIntel8080::Execution execution = async.execute();
+    execution.start();
+    check(execution.done() && execution.cycles() == 52,
+          "input at once runs to HLT");
+    check(output == std::vector<uint8_t>({11, 20}), "input at once");
+}
+
+void testLaterInput() {
+    std::vector<uint8_t> output;
+    auto cpu = load(echo_program, output);
+    AsyncIntel8080 async(*cpu);
+    AsyncIntel8080::Execution execution = async.execute();
+    execution.start();
+    check(!execution.done() && async.waitingForInput() &&
+              async.inputPort() == 1,
+          "suspended on IN 1");
+    async.completeInput(4);
+    check(async.waitingForInput() && async.inputPort() == 2 &&
+              output == std::vector<uint8_t>({5}),
+          "resumed to IN 2");
+    async.completeInput(9);
+    check(execution.done() && output == std::vector<uint8_t>({5, 9}),
+          "input later");
+}
+
+void testOtherThread() {
+    std::vector<uint8_t> output;
+    auto cpu = load(echo_program, output);
+    AsyncIntel8080 async(*cpu);
+    AsyncIntel8080::Execution execution = async.execute();
+    execution.start();
+
+    // another thread supplies the input and the CPU runs on it
+    std::thread::id resumed_on;
+    cpu->out = [&](uint8_t, uint8_t value) {
+        output.push_back(value);
+        resumed_on = std::this_thread::get_id();
+    };
+    std::thread::id completer;
+    std::thread host([&] {
+        completer = std::this_thread::get_id();
+        async.completeInput(1);
+        async.completeInput(2);
+    });
+    host.join();
+    check(execution.done() && output == std::vector<uint8_t>({2, 2}),
+          "input from another thread");
+    check(resumed_on == completer, "resumed on the completing thread");
+}
+
+void testRacingInput() {
+    // MVI B, 200; IN 1; OUT 0; DCR B; JNZ 0102h; HLT
+    constexpr int count = 200;
+    std::vector<uint8_t> output;
+    auto cpu = load({0x06, count, 0xdb, 0x01, 0xd3, 0x00, 0x05, 0xc2, 0x02,
+                     0x01, 0x76},
+                    output);
+    AsyncIntel8080 async(*cpu);
+    std::atomic<int> requests = 0;
+    async.input_requested = [&](uint8_t) { ++requests; };
+
+    // two threads take turns, so each input is completed by the thread
+    // the execution is not running on, while it may still be suspending
+    std::atomic<bool> stalled = false;
+    const auto completer = [&](const int first) {
+        const auto give_up =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        for (int i = first; i < count && !stalled; i += 2) {
+            while (requests <= i) {
+                if (std::chrono::steady_clock::now() > give_up) {
+                    stalled = true;
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            async.completeInput(i);
+        }
+    };
+    AsyncIntel8080::Execution execution = async.execute();
+    std::thread even(completer, 0);
+    std::thread odd(completer, 1);
+    execution.start();
+    even.join();
+    odd.join();
+
+    bool ordered = output.size() == count;
+    for (std::size_t i = 0; ordered && i < output.size(); ++i) {
+        ordered = output[i] == i;
+    }
+    check(!stalled && execution.done() && ordered, "input racing suspension");
+}
+
+void testRestore() {
+    std::vector<uint8_t> output;
+    auto cpu = load(echo_program, output);
+    cpu->in = [](uint8_t) -> uint8_t { return 0x5a; };
+    {
+        AsyncIntel8080 async(*cpu);
+        check(cpu->in(1) != 0x5a, "in callback replaced");
+    }
+    check(cpu->in && cpu->in(1) == 0x5a, "in callback restored");
+}
+
+AsyncIntel8080::Execution awaitTwice(AsyncIntel8080 &async) {
+    const std::size_t first = co_await async.execute(20);
+    const std::size_t rest = co_await async.execute();
+    co_return first + rest;
+}
+
+void testAwait() {
+    std::vector<uint8_t> output;
+    auto cpu = load(echo_program, output);
+    AsyncIntel8080 async(*cpu);
+    AsyncIntel8080::Execution outer = awaitTwice(async);
+    outer.start();
+    async.completeInput(6);
+    check(!outer.done() && async.inputPort() == 2, "first await done");
+    async.completeInput(3);
+    check(outer.done() && outer.cycles() == 52 &&
+              output == std::vector<uint8_t>({7, 3}),
+          "awaited executions");
+}
+
+void testIntel8085() {
+    // LXI H, 5; LXI B, 3; DSUB; MOV A, L; OUT 0; HLT, and at the TRAP
+    // vector IN 1; OUT 0; HLT
+    std::vector<uint8_t> output;
+    auto cpu = load<Intel8085>({0x21, 0x05, 0x00, 0x01, 0x03, 0x00, 0x08,
+                                0x7d, 0xd3, 0x00, 0x76},
+                               output);
+    const std::vector<uint8_t> trap = {0xdb, 0x01, 0xd3, 0x00, 0x76};
+    std::copy(trap.begin(), trap.end(), cpu->memory.begin() + 0x24);
+
+    AsyncIntel8080 async(*cpu);
+    async.input_requested = [&](uint8_t) { async.completeInput(42); };
+    AsyncIntel8080::Execution first = async.execute();
+    first.start();
+    check(first.done() && output == std::vector<uint8_t>({2}),
+          "8085 instructions");
+
+    // a halted 8085 takes the TRAP
+    cpu->trap();
+    AsyncIntel8080::Execution second = async.execute();
+    second.start();
+    check(second.done() && output == std::vector<uint8_t>({2, 42}),
+          "halted 8085 takes TRAP");
+}
+
+int main() {
+    testImmediateInput();
+    testLaterInput();
+    testOtherThread();
+    testRacingInput();
+    testAwait();
+    testIntel8085();
+    testRestore();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All async checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+"""Checks the Python module, see python/emu8080.cpp.
+
+usage: python3 test/bindings.py BUILD_DIR
+"""
+
+import os
+import sys
+import threading
+import time
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, sys.argv[1] if len(sys.argv) > 1 else "build")
+import emu8080  # noqa: E402
+
+# assembled test/BDOS.ASM file
+BDOS = bytes([
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00,
+])
+
+failures = 0
+
+
+def check(passed, name):
+    global failures
+    if not passed:
+        print("FAILED:", name)
+        failures += 1
+
+
+def raises(error, function, *args):
+    try:
+        function(*args)
+    except error:
+        return True
+    return False
+
+
+def read(name):
+    with open(os.path.join(TEST_DIR, "com", name), "rb") as file:
+        return file.read()
+
+
+def boot(program, cpu_type=emu8080.Intel8080):
+    """A CPU with the BDOS and program loaded through its memory view."""
+    cpu = cpu_type()
+    cpu.memory[:len(BDOS)] = BDOS
+    cpu.memory[0x100:0x100 + len(program)] = program
+    cpu.pc = 0x100
+    return cpu
+
+
+tst8080 = read("TST8080.COM")
+
+# run a program printing through a hook
+cpu = boot(tst8080)
+text = bytearray()
+cpu.hook_out(0, lambda port, value: text.append(value))
+cycles = cpu.execute()
+print(text.decode())
+check(cycles == 9066, "TST8080 cycles")
+check(b"CPU IS OPERATIONAL" in text, "program output")
+check(cpu.halted and cpu.pc == 0x0001, "halted in BDOS")
+
+# memory is shared with the CPU, not copied
+view = cpu.memory
+check(view.nbytes == 0x10000 and not view.readonly, "writable 64 KB view")
+cpu.load(0x4000, b"\x3a\x00\x50\x32\x01\x50\x76")  # LDA, STA, HLT
+view[0x5000] = 0x5a
+cpu.pc = 0x4000
+cpu.halted = False
+cpu.execute()
+check(view[0x5001] == 0x5a, "CPU writes visible through the view")
+check(bytes(cpu.memory[0x4000:0x4003]) == b"\x3a\x00\x50", "load")
+
+# registers
+cpu.psw = 0x12d7
+check(cpu.a == 0x12 and cpu.flags == 0xd7, "PSW sets A and flags")
+cpu.hl = 0xbeef
+check(cpu.h == 0xbe and cpu.l == 0xef, "HL sets H and L")
+check(raises(ValueError, setattr, cpu, "a", 0x100), "register range")
+check(raises(ValueError, cpu.load, 0xfffe, b"1234"), "load range")
+
+# ports without a hook read open_bus without calling into Python
+cpu.load(0x4000, b"\xdb\x10\x76")  # IN 10h, HLT
+cpu.open_bus = 0xa5
+cpu.pc = 0x4000
+cpu.halted = False
+cpu.execute()
+check(cpu.a == 0xa5, "open bus")
+cpu.hook_in(0x10, lambda port: port + 1)
+cpu.pc = 0x4000
+cpu.halted = False
+cpu.execute()
+check(cpu.a == 0x11, "input hook")
+cpu.hook_in(None, None)
+
+# an exception in a hook ends execution and is raised
+def broken(port, value):
+    raise KeyError(value)
+
+
+cpu.load(0x4000, b"\x3e\x07\xd3\x01\xc3\x00\x40")  # MVI A, 7; OUT 1; JMP
+cpu.hook_out(1, broken)
+cpu.pc = 0x4000
+cpu.halted = False
+try:
+    cpu.execute(1000000)
+    check(False, "hook exception raised")
+except KeyError as error:
+    check(error.args == (7,), "hook exception raised")
+check(cpu.pc == 0x4004 and not cpu.halted, "stopped after the hook")
+cpu.hook_out(None, None)
+
+# the 8085 keeps its K and V flags
+i8085 = emu8080.Intel8085()
+i8085.flags = 0x22
+check(isinstance(i8085, emu8080.Intel8080) and i8085.flags == 0x22,
+      "8085 flags")
+
+# many CPUs at once, on several threads without the GIL
+cpus = [boot(tst8080) for _ in range(64)]
+check(emu8080.execute_batch(cpus) == [9066] * 64, "batch cycles")
+check(all(cpu.halted for cpu in cpus), "batch halted")
+check(raises(RuntimeError, emu8080.execute_batch, [cpu, cpu]),
+      "duplicate CPU")
+check(raises(TypeError, emu8080.execute_batch, [cpu, 1]), "not a CPU")
+check(emu8080.execute_batch([]) == [], "empty batch")
+
+# hooks still run, taking the GIL back
+consoles = [bytearray() for _ in range(8)]
+cpus = [boot(tst8080) for _ in consoles]
+for cpu, console in zip(cpus, consoles):
+    cpu.hook_out(0, lambda port, value, console=console:
+                 console.append(value))
+emu8080.execute_batch(cpus, threads=4)
+check(all(console == text for console in consoles), "batch hooks")
+
+# execute releases the GIL, so Python threads run CPUs in parallel
+cputest = read("CPUTEST.COM")
+count = min(os.cpu_count() or 1, 4)
+
+
+def timed(function):
+    start = time.perf_counter()
+    function()
+    return time.perf_counter() - start
+
+
+cpus = [boot(cputest) for _ in range(count)]
+serial = timed(lambda: emu8080.execute_batch(cpus, threads=1))
+cpus = [boot(cputest) for _ in range(count)]
+workers = [threading.Thread(target=cpu.execute) for cpu in cpus]
+parallel = timed(lambda: ([worker.start() for worker in workers],
+                          [worker.join() for worker in workers]))
+check(all(cpu.halted for cpu in cpus), "threads halted")
+print(f"CPUTEST on {count} CPUs: {serial:.2f}s on one thread, "
+      f"{parallel:.2f}s on {count} Python threads")
+
+if failures:
+    print(f"{failures} checks failed")
+    sys.exit(1)
+print("All Python binding checks passed")
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../src/i8085.h"
+
+/**
+ * Checks the block copy and fill loops the interpreter runs natively
+ * against the same loops interpreted. The interpreted copy ends with
+ * MOV A, C; ORA B instead of MOV A, B; ORA C, which has the same effect
+ * and timing but is not recognized.
+ *
+ * After every step of the native CPU, the interpreted one steps until it
+ * reaches the same cycle count. Between iterations both must then have
+ * the same registers, flags and memory, with EMU8080_STATS the same
+ * counters and with EMU8080_COVERAGE the same edge coverage.
+ */
+
+constexpr uint16_t origin = 0x0100;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+struct Loop {
+    std::string name;
+    // the loop body, without DCX B; MOV A, B; ORA C; JNZ
+    std::vector<uint8_t> body;
+    uint16_t HL;
+    uint16_t DE;
+    uint16_t BC;
+    // steps of the native CPU to compare, 0 to run until HLT
+    std::size_t steps = 0;
+};
+
+std::vector<uint8_t> assemble(const Loop &loop, const bool recognized) {
+    std::vector<uint8_t> code = loop.body;
+    code.push_back(0x0b); // DCX B
+    if (recognized) {
+        code.push_back(0x78); // MOV A, B
+        code.push_back(0xb1); // ORA C
+    } else {
+        code.push_back(0x79); // MOV A, C
+        code.push_back(0xb0); // ORA B
+    }
+    code.push_back(0xc2); // JNZ origin
+    code.push_back(origin & 0xff);
+    code.push_back(origin >> 8);
+    code.push_back(0x76); // HLT
+    return code;
+}
+
+template <class CPU>
+std::unique_ptr<CPU> load(const Loop &loop, const bool recognized) {
+    auto cpu = std::make_unique<CPU>();
+    for (std::size_t i = 0; i < cpu->memory.size(); ++i) {
+        cpu->memory[i] = uint8_t(i * 7 + (i >> 8));
+    }
+    const std::vector<uint8_t> code = assemble(loop, recognized);
+    std::copy(code.begin(), code.end(), cpu->memory.begin() + origin);
+    cpu->register_HL = loop.HL;
+    cpu->register_DE = loop.DE;
+    cpu->register_BC = loop.BC;
+    cpu->register_A = 0;
+    cpu->flag_S = cpu->flag_Z = cpu->flag_A = cpu->flag_P = false;
+    cpu->flag_C = false;
+    cpu->program_counter = origin;
+    return cpu;
+}
+
+template <class CPU> bool same(const CPU &a, const CPU &b) {
+    if (a.register_PSW != b.register_PSW || a.register_BC != b.register_BC ||
+        a.register_DE != b.register_DE || a.register_HL != b.register_HL ||
+        a.program_counter != b.program_counter || a.halted != b.halted ||
+        a.cycle_count != b.cycle_count) {
+        return false;
+    }
+    if (a.flag_S != b.flag_S || a.flag_Z != b.flag_Z || a.flag_A != b.flag_A ||
+        a.flag_P != b.flag_P || a.flag_C != b.flag_C) {
+        return false;
+    }
+    if constexpr (std::is_same_v<CPU, Intel8085>) {
+        if (a.flag_K != b.flag_K || a.flag_V != b.flag_V) {
+            return false;
+        }
+    }
+    if constexpr (CPU::stats_enabled) {
+        const Intel8080::Statistics x = a.statistics();
+        const Intel8080::Statistics y = b.statistics();
+        if (x.instructions != y.instructions ||
+            x.branches_taken != y.branches_taken ||
+            x.branches_not_taken != y.branches_not_taken ||
+            x.cycles != y.cycles || x.writes_per_page != y.writes_per_page) {
+            return false;
+        }
+    }
+    if constexpr (CPU::coverage_enabled) {
+        if (!std::equal(a.coverage_map, a.coverage_map + CPU::coverage_size,
+                        b.coverage_map)) {
+            return false;
+        }
+    }
+    // the loops themselves differ
+    for (std::size_t i = 0; i < a.memory.size(); ++i) {
+        if ((i < origin || i >= origin + 16) && a.memory[i] != b.memory[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns: The native CPU, or null when the two differed
+ */
+template <class CPU>
+std::unique_ptr<CPU> compare(const Loop &loop, std::size_t &native_steps) {
+    auto native = load<CPU>(loop, true);
+    auto interpreted = load<CPU>(loop, false);
+    std::vector<uint8_t> native_coverage(CPU::coverage_size);
+    std::vector<uint8_t> interpreted_coverage(CPU::coverage_size);
+    native->coverage_map = native_coverage.data();
+    interpreted->coverage_map = interpreted_coverage.data();
+    native_steps = 0;
+    for (std::size_t i = 0; !native->halted && (!loop.steps || i < loop.steps);
+         ++i) {
+        // two or more iterations take over 64 cycles, one at most 50
+        native_steps += native->step() > 64;
+        while (!interpreted->halted &&
+               interpreted->cycle_count < native->cycle_count) {
+            interpreted->step();
+        }
+        // inside an iteration, A differs between the two
+        const uint16_t pc = native->program_counter;
+        if (pc > origin && pc < origin + loop.body.size() + 6) {
+            continue;
+        }
+        if (!same(*native, *interpreted)) {
+            std::cout << loop.name << ": differs at cycle "
+                      << native->cycle_count << std::endl;
+            return nullptr;
+        }
+    }
+    native->coverage_map = nullptr;
+    return native;
+}
+
+template <class CPU> void testLoops(const std::string &model) {
+    // MOV A, M; STAX D; INX H; INX D
+    const std::vector<uint8_t> copy = {0x7e, 0x12, 0x23, 0x13};
+    // LDAX D; MOV M, A; INX D; INX H
+    const std::vector<uint8_t> copy_back = {0x1a, 0x77, 0x13, 0x23};
+    // MVI M, 5Ah; INX H
+    const std::vector<uint8_t> fill = {0x36, 0x5a, 0x23};
+    // MOV M, E; INX H
+    const std::vector<uint8_t> fill_register = {0x73, 0x23};
+
+    const std::vector<std::pair<Loop, bool>> loops = {
+        {{"copy", copy, 0x2000, 0x4000, 1000}, true},
+        {{"copy other order", copy_back, 0x4000, 0x2000, 300}, true},
+        // a destination before the source is a memmove
+        {{"overlapping copy", copy, 0x3000, 0x2f80, 500}, true},
+        // a destination just after the source replicates the first byte
+        {{"replicating copy", copy, 0x3000, 0x3001, 500}, false},
+        {{"fill", fill, 0x5000, 0, 1000}, true},
+        {{"fill from register", fill_register, 0x6000, 0x0033, 700}, true},
+        // the native part only starts once HL has wrapped
+        {{"wrapping fill", fill, 0xffc0, 0, 0x80}, true},
+        {{"one iteration", copy, 0x2000, 0x4000, 1}, false},
+    };
+    for (const auto &[loop, fused] : loops) {
+        std::size_t native_steps;
+        const bool matched = compare<CPU>(loop, native_steps) != nullptr;
+        check(matched, model + " " + loop.name);
+        check(matched && (native_steps != 0) == fused,
+              model + " " + loop.name + " run natively");
+    }
+
+    // BC of 0 copies 65536 bytes, four native steps take 512 of them
+    std::size_t native_steps;
+    const auto wrapped =
+        compare<CPU>({"65536 byte copy", copy, 0x2000, 0x8000, 0, 4},
+                     native_steps);
+    check(wrapped && native_steps == 4 && wrapped->register_BC == 0xfe00,
+          model + " BC of 0");
+}
+
+int main() {
+    testLoops<Intel8080>("8080");
+    testLoops<Intel8085>("8085");
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All block transfer checks passed" << std::endl;
+    return 0;
+}
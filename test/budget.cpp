@@ -0,0 +1,303 @@
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../src/i8085.h"
+#include "../src/pacer.h"
+#include "../src/profiler.h"
+#include "../src/recompiled.h"
+
+/**
+ * Checks runs to cycle deadlines: overshoot carried between slices, block
+ * transfer loops stopped at the deadline, exit requests from I/O
+ * callbacks and other threads, runs sliced by the Profiler and the
+ * Pacer, and the same for recompiled code.
+ */
+
+// generated from test/com by tools/recompile
+extern const RecompiledProgram program_cputest;
+extern const RecompiledProgram program_spin;
+
+// assembled test/BDOS.ASM file
+const std::array<uint8_t, 0x22> bdos = {
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00
+};
+
+// JMP 0100h
+const std::vector<uint8_t> spin_program = {0xc3, 0x00, 0x01};
+
+// OUT 0; JMP 0100h
+const std::vector<uint8_t> output_program = {0xd3, 0x00, 0xc3, 0x00, 0x01};
+
+// fills 32 KB from 0x2000 with a loop that runs as a block transfer
+const std::vector<uint8_t> fill_program = {
+    0x21, 0x00, 0x20, // LXI H, 2000h
+    0x01, 0x00, 0x80, // LXI B, 8000h
+    0x36, 0xaa,       // MVI M, 0AAh
+    0x23,             // INX H
+    0x0b,             // DCX B
+    0x78,             // MOV A, B
+    0xb1,             // ORA C
+    0xc2, 0x06, 0x01, // JNZ 0106h
+    0x76,             // HLT
+};
+
+// the cycles of one iteration of the fill loop
+constexpr std::size_t fill_iteration = 10 + 5 + 5 + 5 + 4 + 10;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+template <class CPU = Intel8080>
+std::unique_ptr<CPU> load(const std::vector<uint8_t> &program) {
+    auto cpu = std::make_unique<CPU>();
+    cpu->memory.fill(0);
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    return cpu;
+}
+
+void testCarriedOvershoot() {
+    auto cpu = load(spin_program);
+    // slices that are not a whole number of instructions
+    constexpr std::size_t slice = 997;
+    uint64_t deadline = 0;
+    uint64_t ran = 0;
+    for (int i = 0; i < 1000; ++i) {
+        deadline += slice;
+        ran += cpu->runUntil(deadline);
+        check(cpu->cycle_count >= deadline && cpu->cycle_count < deadline + 10,
+              "stops within an instruction of the deadline");
+    }
+    check(ran == cpu->cycle_count, "runs add up to the cycle count");
+
+    // a deadline already passed runs nothing
+    check(cpu->runUntil(deadline) == 0, "passed deadline");
+
+    // execute() counts too, and still returns the raw total
+    const uint64_t before = cpu->cycle_count;
+    const std::size_t executed = cpu->execute(15);
+    check(executed == 20 && cpu->cycle_count == before + 20,
+          "execute counts cycles");
+}
+
+void testBlockTransfer() {
+    auto whole = load(fill_program);
+    const std::size_t total = whole->execute();
+
+    auto sliced = load(fill_program);
+    sliced->runUntil(120);
+    check(sliced->cycle_count >= 120 &&
+              sliced->cycle_count < 120 + fill_iteration,
+          "block transfer stops at the deadline");
+
+    // any slicing leaves the same memory and takes the same cycles
+    uint64_t deadline = sliced->cycle_count;
+    while (!sliced->halted) {
+        deadline += 97;
+        sliced->runUntil(deadline);
+    }
+    check(sliced->cycle_count == total, "sliced fill takes the same cycles");
+    check(sliced->memory == whole->memory, "sliced fill writes the same");
+}
+
+void testExitRequests() {
+    // from an I/O callback, after the instruction that made it
+    auto cpu = load(output_program);
+    Intel8080 &running = *cpu;
+    cpu->out = [&](uint8_t, uint8_t) { running.requestExit(); };
+    check(cpu->execute() == 10 && cpu->program_counter == 0x102,
+          "exit from OUT");
+    check(cpu->runUntil(cpu->cycle_count + 15) == 20,
+          "a request ends only one run");
+
+    // one made between runs ends the next run at once
+    auto spin = load(spin_program);
+    spin->requestExit();
+    check(spin->execute(1000) == 0, "request before a run");
+    check(spin->execute(1000) >= 1000, "request consumed");
+
+    // from another thread
+    std::thread requester([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        spin->requestExit();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    spin->execute();
+    const auto waited = std::chrono::steady_clock::now() - start;
+    requester.join();
+    check(!spin->halted && waited < std::chrono::seconds(5),
+          "exit from another thread");
+}
+
+void testIntel8085() {
+    auto cpu = load<Intel8085>(spin_program);
+    check(cpu->runUntil(1000) >= 1000 && cpu->cycle_count < 1010,
+          "8085 deadline");
+
+    // an interrupt it takes counts its cycles
+    cpu->trap();
+    const uint64_t before = cpu->cycle_count;
+    check(cpu->runUntil(before + 1) == 12 && cpu->program_counter == 0x24,
+          "8085 interrupt cycles");
+
+    // a halted 8085 still takes pending interrupts
+    cpu->halted = true;
+    cpu->trap();
+    check(cpu->runUntil(cpu->cycle_count + 12) == 12, "8085 wakes up");
+}
+
+// a recompiled program and BDOS, printing to output
+template <class CPU>
+std::unique_ptr<CPU> load(const RecompiledProgram &program,
+                          std::string &output) {
+    std::unique_ptr<CPU> cpu;
+    if constexpr (std::is_same_v<CPU, RecompiledIntel8080>) {
+        cpu = std::make_unique<CPU>(program);
+    } else {
+        cpu = std::make_unique<CPU>();
+    }
+    cpu->memory.fill(0);
+    std::copy(bdos.begin(), bdos.end(), cpu->memory.begin());
+    std::copy(program.image, program.image + program.image_size,
+              cpu->memory.begin() + program.origin);
+    cpu->program_counter = program.origin;
+    cpu->out = [&output](uint8_t, uint8_t byte) { output += char(byte); };
+    return cpu;
+}
+
+void testRecompiled() {
+    std::string expected;
+    const std::size_t total =
+        load<Intel8080>(program_cputest, expected)->execute();
+
+    // runs to deadlines add up to one run, mostly in translated code
+    std::string output;
+    auto cpu = load<RecompiledIntel8080>(program_cputest, output);
+    uint64_t deadline = 0;
+    bool reached = true;
+    while (!cpu->halted) {
+        deadline += 99991;
+        cpu->runUntil(deadline);
+        reached &= cpu->halted || cpu->cycle_count >= deadline;
+    }
+    check(reached, "recompiled runs reach the deadline");
+    check(cpu->cycle_count == total && output == expected,
+          "recompiled runs to deadlines");
+    check(cpu->translated_cycles > total / 2, "deadline runs translated");
+
+    // a translated loop stops within a block of the deadline
+    auto spin = load<RecompiledIntel8080>(program_spin, output);
+    check(spin->runUntil(1005) >= 1005 && spin->cycle_count < 1015 &&
+              spin->translated_cycles == spin->cycle_count,
+          "translated loop deadline");
+
+    // from an I/O callback, after the instruction that made it
+    RecompiledIntel8080 &running = *spin;
+    spin->out = [&](uint8_t, uint8_t) { running.requestExit(); };
+    const uint64_t before = spin->cycle_count;
+    spin->program_counter = 0x100;
+    check(spin->execute() == 10 && spin->program_counter == 0x102 &&
+              spin->translated_cycles == spin->cycle_count,
+          "recompiled exit from OUT");
+
+    // from another thread, while translated code loops
+    std::thread requester([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        spin->requestExit();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    spin->execute();
+    const auto waited = std::chrono::steady_clock::now() - start;
+    requester.join();
+    check(waited < std::chrono::seconds(5) && spin->cycle_count > before + 10 &&
+              spin->translated_cycles == spin->cycle_count,
+          "recompiled exit from another thread");
+}
+
+void testProfiler() {
+    // an exit request ends the profiled run, not just its slice
+    auto cpu = load(output_program);
+    Intel8080 &running = *cpu;
+    cpu->out = [&](uint8_t, uint8_t) { running.requestExit(); };
+    Profiler profiler(*cpu, 100);
+    check(profiler.execute(1000) == 10 && cpu->program_counter == 0x102,
+          "exit from a profiled run");
+    check(profiler.samples() == 1, "profiled slices");
+
+    // the slices run the 8085's own execute(), which takes its interrupts
+    auto cpu_8085 = load<Intel8085>(spin_program);
+    Profiler profiler_8085(*cpu_8085, 100);
+    cpu_8085->trap();
+    check(profiler_8085.execute(1) == 12 && cpu_8085->program_counter == 0x24,
+          "profiled 8085 interrupt");
+
+    // HLT, with HLT at the TRAP vector: a halted 8085 runs only while it
+    // has an interrupt to take
+    auto halting = load<Intel8085>({0x76});
+    halting->memory[0x24] = 0x76;
+    Profiler profiler_halted(*halting, 100);
+    profiler_halted.execute(1000);
+    check(halting->halted && profiler_halted.execute(1000) == 0 &&
+              profiler_halted.samples() == 1,
+          "profiled 8085 stays halted");
+    halting->trap();
+    check(profiler_halted.execute(1000) == 12 + 5 &&
+              halting->program_counter == 0x25 &&
+              profiler_halted.samples() == 2,
+          "profiled halted 8085 takes TRAP");
+}
+
+void testPacer() {
+    // HLT, with OUT 1; HLT at the TRAP vector
+    auto cpu = load<Intel8085>({0x76});
+    cpu->memory[0x24] = 0xd3;
+    cpu->memory[0x25] = 0x01;
+    cpu->memory[0x26] = 0x76;
+    std::size_t outputs = 0;
+    cpu->out = [&](uint8_t, uint8_t) { ++outputs; };
+
+    // a halted 8085 wakes for a TRAP raised between slices
+    Pacer pacer(*cpu);
+    std::size_t slices = 0;
+    pacer.slice_done = [&](std::size_t) {
+        if (++slices == 2) {
+            cpu->trap();
+        }
+    };
+    pacer.run(10000);
+    check(outputs == 1 && cpu->halted && cpu->program_counter == 0x27,
+          "paced 8085 wakes from halt");
+}
+
+int main() {
+    testCarriedOvershoot();
+    testBlockTransfer();
+    testExitRequests();
+    testIntel8085();
+    testProfiler();
+    testPacer();
+    testRecompiled();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All execution budget checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/emu8080.h"
+
+#define CPU_COUNT 64
+#define SLICE 1000
+
+// assembled test/BDOS.ASM file
+static const uint8_t bdos[0x22] = {
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00
+};
+
+struct console {
+    char text[256];
+    size_t length;
+};
+
+static void print(void *user, uint8_t port, uint8_t value) {
+    struct console *console = user;
+    if (port == 0 && console->length + 1 < sizeof(console->text)) {
+        console->text[console->length++] = value;
+    }
+}
+
+static int failures = 0;
+
+static void check(const bool passed, const char *name) {
+    if (!passed) {
+        printf("FAILED: %s\n", name);
+        ++failures;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        printf("usage: test-capi [COM]\n");
+        return 1;
+    }
+    static uint8_t program[0x10000 - 0x100];
+    FILE *file = fopen(argv[1], "rb");
+    if (!file) {
+        printf("cannot read %s\n", argv[1]);
+        return 1;
+    }
+    const size_t size = fread(program, 1, sizeof(program), file);
+    fclose(file);
+
+    check(emu8080_abi_version() == EMU8080_ABI_VERSION, "ABI version");
+    check(!emu8080_create((emu8080_model)7), "unknown model");
+
+    // load every CPU with the program and BDOS in one call each
+    static emu8080_cpu *cpus[CPU_COUNT];
+    static struct console consoles[CPU_COUNT];
+    const emu8080_region regions[] = {
+        {0x0000, sizeof(bdos), (uint8_t *)bdos},
+        {0x0100, (uint32_t)size, program},
+    };
+    for (size_t i = 0; i < CPU_COUNT; ++i) {
+        cpus[i] = emu8080_create(EMU8080_MODEL_8080);
+        emu8080_set_io(cpus[i], NULL, print, &consoles[i]);
+        check(emu8080_write_regions(cpus[i], regions, 2) == 2,
+              "write regions");
+    }
+
+    // start them all at 0x100 with one call
+    const emu8080_register start[] = {EMU8080_REG_PC, EMU8080_REG_SP};
+    static uint16_t values[CPU_COUNT * 2];
+    for (size_t i = 0; i < CPU_COUNT; ++i) {
+        values[2 * i] = 0x100;
+        values[2 * i + 1] = 0;
+    }
+    emu8080_scatter_registers(cpus, CPU_COUNT, start, 2, values);
+
+    // run them in short slices, as a host stepping many CPUs would
+    static uint64_t cycles[CPU_COUNT];
+    uint64_t executed[CPU_COUNT];
+    size_t calls = 0;
+    while (emu8080_run_batch(cpus, CPU_COUNT, SLICE, executed)) {
+        for (size_t i = 0; i < CPU_COUNT; ++i) {
+            cycles[i] += executed[i];
+        }
+        ++calls;
+    }
+    for (size_t i = 0; i < CPU_COUNT; ++i) {
+        cycles[i] += executed[i];
+    }
+
+    const emu8080_register state[] = {EMU8080_REG_HALTED, EMU8080_REG_PC};
+    emu8080_gather_registers(cpus, CPU_COUNT, state, 2, values);
+    for (size_t i = 0; i < CPU_COUNT; ++i) {
+        check(values[2 * i] == 1 && values[2 * i + 1] == 0x0001,
+              "halted in BDOS");
+        check(strstr(consoles[i].text, "CPU IS OPERATIONAL") != NULL,
+              "program output");
+        check(cycles[i] == cycles[0], "same cycles on every CPU");
+    }
+    printf("%s\n", consoles[0].text);
+    printf("%d CPUs, %llu cycles each, %zu batch calls\n", CPU_COUNT,
+           (unsigned long long)cycles[0], calls);
+
+    // registers and memory round trip
+    emu8080_cpu *cpu = cpus[0];
+    emu8080_set_register(cpu, EMU8080_REG_PSW, 0x12d7);
+    check(emu8080_get_register(cpu, EMU8080_REG_A) == 0x12, "PSW sets A");
+    check(emu8080_get_register(cpu, EMU8080_REG_FLAGS) == 0xd7,
+          "PSW sets flags");
+    emu8080_set_register(cpu, EMU8080_REG_HL, 0xbeef);
+    check(emu8080_get_register(cpu, EMU8080_REG_H) == 0xbe, "HL sets H");
+    uint8_t bytes[4];
+    const emu8080_region out_of_range = {0xfffe, 4, bytes};
+    check(emu8080_read_regions(cpu, &out_of_range, 1) == 0,
+          "region past the end of memory");
+    check(emu8080_store(cpu, 0x0000, bytes, 4) && bytes[0] == 0x76,
+          "store memory");
+
+    // an 8085 keeps its K and V flags
+    emu8080_cpu *i8085 = emu8080_create(EMU8080_MODEL_8085);
+    emu8080_set_register(i8085, EMU8080_REG_FLAGS, 0x22);
+    check(emu8080_get_register(i8085, EMU8080_REG_FLAGS) == 0x22,
+          "8085 flags");
+    emu8080_destroy(i8085);
+
+    for (size_t i = 0; i < CPU_COUNT; ++i) {
+        emu8080_destroy(cpus[i]);
+    }
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All C interface checks passed\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../src/console.h"
+
+/**
+ * Checks the SpscRing queue and the Console device: output, input, the
+ * status port and the counters.
+ */
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+// an output stream that holds every write until it is opened
+class GateBuffer : public std::streambuf {
+  public:
+    std::atomic<bool> open = false;
+    std::atomic<bool> writing = false;
+    std::string text;
+
+  protected:
+    std::streamsize xsputn(const char *data, std::streamsize count) override {
+        writing = true;
+        while (!open) {
+            std::this_thread::yield();
+        }
+        text.append(data, count);
+        return count;
+    }
+
+    int overflow(int byte) override {
+        const char c = byte;
+        return xsputn(&c, 1) == 1 ? byte : traits_type::eof();
+    }
+};
+
+void testRing() {
+    SpscRing<4> ring;
+    check(ring.empty() && !ring.full(), "new ring empty");
+    for (uint8_t i = 0; i < 4; ++i) {
+        check(ring.push(i), "push");
+    }
+    check(ring.full() && !ring.push(4), "ring full");
+    uint8_t byte;
+    check(ring.pop(byte) && byte == 0 && !ring.full(), "pop");
+    check(ring.push(4), "push after pop");
+
+    uint8_t bytes[8];
+    check(ring.pop(bytes, 8) == 4 && bytes[0] == 1 && bytes[3] == 4,
+          "pop many");
+    check(ring.empty() && !ring.pop(byte), "ring empty");
+}
+
+void testRingThreads() {
+    // bytes arrive in order while the indices wrap many times
+    SpscRing<64> ring;
+    constexpr std::size_t count = 1000000;
+    std::thread producer([&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            while (!ring.push(uint8_t(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    bool ordered = true;
+    for (std::size_t i = 0; i < count;) {
+        uint8_t byte;
+        if (ring.pop(byte)) {
+            ordered &= byte == uint8_t(i);
+            ++i;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    check(ordered, "ordered across threads");
+}
+
+void testConsole() {
+    std::ostringstream output;
+    Intel8080 cpu;
+    {
+        Console console(output);
+        console.attach(cpu, 0, 1);
+        // the data and status ports are 0 and 1
+        cpu.out(0, 'h');
+        cpu.out(0, 'i');
+        console.flush();
+        check(output.str() == "hi", "output");
+
+        check(cpu.in(1) == Console::output_ready, "status without input");
+        check(cpu.in(0) == 0, "data without input");
+        check(console.type("ab", 2) == 2, "typed");
+        check(cpu.in(1) == (Console::input_ready | Console::output_ready),
+              "status with input");
+        check(cpu.in(0) == 'a' && cpu.in(0) == 'b', "input");
+
+        const std::string flood(Console::queue_size + 10, 'x');
+        check(console.type(flood.data(), flood.size()) == Console::queue_size,
+              "input queue bounded");
+        const Console::Counters counters = console.counters();
+        check(counters.output_bytes == 2 && counters.input_bytes == 2 &&
+                  counters.input_underruns == 1 && counters.input_drops == 10,
+              "counters");
+        console.write('!');
+    }
+    check(output.str() == "hi!", "output written on destruction");
+}
+
+void testOutputFull() {
+    GateBuffer gate;
+    std::ostream output(&gate);
+    Console console(output);
+
+    // the flusher takes one byte and is held writing it
+    console.write('a');
+    while (!gate.writing) {
+        std::this_thread::yield();
+    }
+    for (std::size_t i = 0; i < Console::queue_size; ++i) {
+        console.write('b');
+    }
+    check(!(console.status() & Console::output_ready),
+          "not ready while the queue is full");
+
+    gate.open = true;
+    console.flush();
+    check(console.status() & Console::output_ready, "ready once drained");
+    check(gate.text.size() == Console::queue_size + 1, "all output written");
+}
+
+int main() {
+    testRing();
+    testRingThreads();
+    testConsole();
+    testOutputFull();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All console checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <vector>
+
+#include "../src/dirty_pages.h"
+
+/**
+ * Checks DirtyPageTracker: the pages written by the host and by a
+ * program, reset(), several trackers at once, and that faults outside
+ * tracked memory reach the handler installed before, which is restored
+ * after the last tracker.
+ */
+
+// LXI SP, 0F000h; MVI A, 55h; STA 8000h; PUSH PSW; HLT
+const std::vector<uint8_t> store_program = {0x31, 0x00, 0xf0, 0x3e, 0x55,
+                                            0x32, 0x00, 0x80, 0xf5, 0x76};
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+std::unique_ptr<Intel8080> load(const std::vector<uint8_t> &program) {
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    return cpu;
+}
+
+/**
+ * Returns: The bit of the page holding an address, and when memory is
+ *          not page aligned its neighbours, which may be marked with it
+ */
+uint32_t pages(const DirtyPageTracker &tracker, const Intel8080 &cpu,
+               const uint16_t address) {
+    const std::size_t page = address / tracker.pageSize();
+    uint32_t bits = uint32_t(1) << page;
+    if (reinterpret_cast<uintptr_t>(cpu.memory.data()) % tracker.pageSize()) {
+        bits |= uint32_t(1) << (page + 1) | uint32_t(1) << page >> 1;
+    }
+    return bits;
+}
+
+void testCollect() {
+    auto cpu = load(store_program);
+    DirtyPageTracker tracker(*cpu);
+    check(tracker.isActive(), "tracker active");
+    if (!tracker.isActive()) {
+        return;
+    }
+    const uint32_t untracked = tracker.dirtyPages();
+    check(!tracker.isDirty(0x4321), "clean after start");
+
+    cpu->memory[0x4321] = 1;
+    check(tracker.isDirty(0x4321) && cpu->memory[0x4321] == 1,
+          "host write marked");
+    const uint32_t written = tracker.dirtyPages() & ~untracked;
+    check((written & ~pages(tracker, *cpu, 0x4321)) == 0,
+          "only the written page marked");
+
+    check(tracker.reset() & pages(tracker, *cpu, 0x4321),
+          "reset returns the written page");
+    check(tracker.dirtyPages() == untracked, "clean after reset");
+
+    // the page is protected again
+    cpu->memory[0x4322] = 2;
+    check(tracker.isDirty(0x4321), "written again after reset");
+    tracker.reset();
+
+    cpu->execute();
+    const uint32_t expected =
+        pages(tracker, *cpu, 0x8000) | pages(tracker, *cpu, 0xeffe);
+    check(cpu->memory[0x8000] == 0x55 && cpu->memory[0xefff] == 0x55,
+          "program stores");
+    check(tracker.isDirty(0x8000) && tracker.isDirty(0xeffe),
+          "program writes marked");
+    check((tracker.dirtyPages() & ~untracked & ~expected) == 0,
+          "only the program's pages marked");
+    check(!tracker.isDirty(0x100) || (untracked & 1),
+          "fetches and reads not marked");
+}
+
+void testSeveral() {
+    auto first = load({});
+    auto second = load({});
+    DirtyPageTracker first_tracker(*first);
+    DirtyPageTracker second_tracker(*second);
+    check(first_tracker.isActive() && second_tracker.isActive(),
+          "two trackers active");
+
+    first->memory[0x2000] = 1;
+    second->memory[0x9000] = 1;
+    check(first_tracker.isDirty(0x2000) && !first_tracker.isDirty(0x9000),
+          "first tracker's writes");
+    check(second_tracker.isDirty(0x9000) && !second_tracker.isDirty(0x2000),
+          "second tracker's writes");
+
+    {
+        // a second tracker of the same memory would miss faults
+        DirtyPageTracker again(*first);
+        check(!again.isActive() && again.dirtyPages() == ~uint32_t(0),
+              "second tracker of the same memory inactive");
+    }
+    first->memory[0x5000] = 1;
+    check(first_tracker.isDirty(0x5000), "first tracker still tracking");
+}
+
+// a page the test handler makes writable when it faults
+uint8_t *guard = nullptr;
+int guard_faults = 0;
+
+void guardHandler(int, siginfo_t *info, void *) {
+    uint8_t *const address = static_cast<uint8_t *>(info->si_addr);
+    if (address >= guard && address < guard + 4096) {
+        mprotect(guard, 4096, PROT_READ | PROT_WRITE);
+        ++guard_faults;
+    } else {
+        std::signal(SIGSEGV, SIG_DFL);
+    }
+}
+
+void laterHandler(int signal, siginfo_t *info, void *context) {
+    guardHandler(signal, info, context);
+}
+
+// the SIGSEGV handler is the given one
+bool installed(const struct sigaction &handler) {
+    struct sigaction current;
+    if (sigaction(SIGSEGV, nullptr, &current) != 0 ||
+        (current.sa_flags & SA_SIGINFO) != (handler.sa_flags & SA_SIGINFO)) {
+        return false;
+    }
+    return current.sa_flags & SA_SIGINFO
+               ? current.sa_sigaction == handler.sa_sigaction
+               : current.sa_handler == handler.sa_handler;
+}
+
+void testHandlers() {
+    void *mapping = mmap(nullptr, 4096, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+    check(mapping != MAP_FAILED, "guard page mapped");
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+    guard = static_cast<uint8_t *>(mapping);
+
+    struct sigaction original;
+    sigaction(SIGSEGV, nullptr, &original);
+    {
+        // with no handler of its own the process gets the original back
+        auto cpu = load({});
+        DirtyPageTracker tracker(*cpu);
+        check(!installed(original), "tracker handler installed");
+    }
+    check(installed(original), "original handler restored");
+
+    struct sigaction action = {};
+    action.sa_sigaction = guardHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, nullptr);
+    {
+        auto cpu = load({});
+        DirtyPageTracker tracker(*cpu);
+        auto other = load({});
+        DirtyPageTracker other_tracker(*other);
+
+        // a fault outside tracked memory goes to the handler before
+        *static_cast<volatile uint8_t *>(guard) = 1;
+        check(guard_faults == 1 && guard[0] == 1, "fault passed on");
+        cpu->memory[0x3000] = 1;
+        check(tracker.isDirty(0x3000) && guard_faults == 1,
+              "tracked fault kept");
+    }
+    check(installed(action), "earlier handler restored");
+
+    // a handler installed over the trackers' stays
+    struct sigaction later = action;
+    later.sa_sigaction = laterHandler;
+    {
+        auto cpu = load({});
+        DirtyPageTracker tracker(*cpu);
+        sigaction(SIGSEGV, &later, nullptr);
+    }
+    check(installed(later), "later handler kept");
+
+    sigaction(SIGSEGV, &original, nullptr);
+    munmap(mapping, 4096);
+}
+
+int main() {
+    testCollect();
+    testSeveral();
+    testHandlers();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All dirty page checks passed" << std::endl;
+    return 0;
+}
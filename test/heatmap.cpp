@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/cpu.h"
+#include "../src/heatmap.h"
+
+/**
+ * Checks MemoryHeatmap fed by a CPU running a small self-modifying
+ * program: page and byte counts, code/data overlap, the modified code
+ * sites, working set windows and the CSV and PPM output.
+ *
+ * Needs a build with EMU8080_HEATMAP.
+ */
+
+using WorkingSet = MemoryHeatmap::WorkingSet;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * Three passes of a loop that counts at 0200h, pushes and pops through
+ * page 2 and stores the count into the operand of its own MVI C at 0110h.
+ * The first store comes before the MVI has run, the other two modify it.
+ */
+const std::vector<uint8_t> program = {
+    0x31, 0x00, 0x03, // 0100: LXI SP, 0300h
+    0x06, 0x03,       // 0103: MVI B, 3
+    0x3a, 0x00, 0x02, // 0105: LDA 0200h
+    0x3c,             // 0108: INR A
+    0x32, 0x00, 0x02, // 0109: STA 0200h
+    0x32, 0x11, 0x01, // 010C: STA 0111h
+    0x00,             // 010F: NOP
+    0x0e, 0x00,       // 0110: MVI C, 0
+    0xc5,             // 0112: PUSH B
+    0xd1,             // 0113: POP D
+    0x05,             // 0114: DCR B
+    0xc2, 0x05, 0x01, // 0115: JNZ 0105h
+    0x76              // 0118: HLT
+};
+
+// LXI SP and MVI B, the loop three times and HLT
+constexpr std::size_t loop_cycles =
+    13 + 5 + 13 + 13 + 4 + 7 + 11 + 10 + 5 + 10;
+constexpr std::size_t program_cycles = 10 + 7 + 3 * loop_cycles + 7;
+
+std::unique_ptr<Intel8080> run(MemoryHeatmap &heatmap) {
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    cpu->heatmap = &heatmap;
+    cpu->execute();
+    return cpu;
+}
+
+bool sameWindows(const std::vector<WorkingSet> &windows,
+                 const std::vector<WorkingSet> &expected) {
+    return std::equal(windows.begin(), windows.end(), expected.begin(),
+                      expected.end(),
+                      [](const WorkingSet &a, const WorkingSet &b) {
+                          return a.cycles == b.cycles && a.read == b.read &&
+                                 a.written == b.written &&
+                                 a.executed == b.executed &&
+                                 a.touched == b.touched;
+                      });
+}
+
+void testCounts() {
+    MemoryHeatmap heatmap(true, 50);
+    const auto cpu = run(heatmap);
+    check(cpu->halted && cpu->register_C == 3 && cpu->memory[0x111] == 3 &&
+              cpu->cycle_count == program_cycles &&
+              heatmap.cycles() == program_cycles,
+          "program ran");
+
+    // page 1 holds the code and its operand, page 2 the count and stack
+    const std::array<MemoryHeatmap::Page, MemoryHeatmap::pages> &pages =
+        heatmap.pageCounts();
+    check(pages[1].reads == 0 && pages[1].writes == 3 &&
+              pages[1].executes == 3 + 2 + 3 * 19 + 1,
+          "code page counts");
+    check(pages[2].reads == 3 + 3 * 2 && pages[2].writes == 3 + 3 * 2 &&
+              pages[2].executes == 0,
+          "data page counts");
+    bool untouched = true;
+    for (std::size_t page = 0; page < MemoryHeatmap::pages; ++page) {
+        if (page != 1 && page != 2) {
+            untouched = untouched && pages[page].reads == 0 &&
+                        pages[page].writes == 0 && pages[page].executes == 0;
+        }
+    }
+    check(untouched, "other pages untouched");
+
+    // every byte of the loop runs three times, the rest once
+    const std::vector<uint32_t> &executes =
+        heatmap.byteCounts(MemoryHeatmap::execute);
+    bool executed = true;
+    for (uint16_t address = 0x100; address < 0x119; ++address) {
+        const bool in_loop = address >= 0x105 && address < 0x118;
+        executed = executed && executes[address] == (in_loop ? 3u : 1u);
+    }
+    check(executed && executes[0x119] == 0 && executes[0xff] == 0,
+          "byte executes");
+    const std::vector<uint32_t> &reads =
+        heatmap.byteCounts(MemoryHeatmap::read);
+    const std::vector<uint32_t> &writes =
+        heatmap.byteCounts(MemoryHeatmap::write);
+    check(reads[0x200] == 3 && reads[0x2fe] == 3 && reads[0x2ff] == 3 &&
+              reads[0x201] == 0 && reads[0x111] == 0,
+          "byte reads");
+    check(writes[0x200] == 3 && writes[0x2fe] == 3 && writes[0x2ff] == 3 &&
+              writes[0x111] == 3 && writes[0x110] == 0,
+          "byte writes");
+
+    // only the MVI operand is both code and data, and two of its three
+    // stores came after it ran
+    check(heatmap.overlapBytes() == 1, "overlap");
+    const std::vector<MemoryHeatmap::ModifiedCode> sites =
+        heatmap.modifiedCode();
+    check(sites.size() == 1 && sites[0].address == 0x111 &&
+              sites[0].instruction == 0x10c && sites[0].writes == 2,
+          "modified code site");
+
+    // windows close on the first instruction to reach each 50 cycles, the
+    // fifth only writes and the last is still open
+    const std::vector<WorkingSet> expected = {
+        {61, 1, 2, 1, 2},  {108, 1, 1, 1, 2}, {152, 1, 2, 1, 2},
+        {212, 1, 1, 1, 2}, {254, 0, 2, 1, 2}, {297, 1, 1, 1, 2}};
+    check(sameWindows(heatmap.workingSet(), expected), "working set");
+
+    // without byte counts the pages are the same
+    MemoryHeatmap by_page(false, 50);
+    run(by_page);
+    check(by_page.byteCounts(MemoryHeatmap::read).empty() &&
+              by_page.pageCounts()[1].executes == pages[1].executes &&
+              by_page.pageCounts()[2].reads == pages[2].reads &&
+              by_page.overlapBytes() == 1 &&
+              by_page.modifiedCode().size() == 1,
+          "page counts without byte counts");
+}
+
+void testWindows() {
+    MemoryHeatmap heatmap(false, 10);
+    check(heatmap.workingSet().empty(), "no windows before any cycles");
+
+    heatmap.load(0x1000, 1);
+    heatmap.step(4);
+    heatmap.fetch(0x20ff, 2);
+    heatmap.step(5);
+    check(heatmap.workingSet().size() == 1 &&
+              heatmap.workingSet()[0].touched == 3,
+          "window open below its end");
+
+    // a long step closes just one window, and the next ends at the next
+    // multiple of the window
+    heatmap.store(0x3000, 1);
+    heatmap.step(26);
+    heatmap.store(0x4000, 1);
+    heatmap.step(1);
+    check(sameWindows(heatmap.workingSet(),
+                      {{35, 1, 1, 2, 4}, {36, 0, 1, 0, 1}}),
+          "long step ends one window");
+    heatmap.step(4);
+    check(sameWindows(heatmap.workingSet(),
+                      {{35, 1, 1, 2, 4}, {40, 0, 1, 0, 1}}),
+          "window ends on a multiple");
+
+    // a window with no accesses is still recorded
+    heatmap.step(10);
+    check(sameWindows(heatmap.workingSet(),
+                      {{35, 1, 1, 2, 4}, {40, 0, 1, 0, 1}, {50, 0, 0, 0, 0}}),
+          "empty window");
+
+    // accesses wrap around memory
+    heatmap.fetch(0xffff, 2);
+    check(heatmap.pageCounts()[0xff].executes == 1 &&
+              heatmap.pageCounts()[0].executes == 1,
+          "accesses wrap");
+
+    heatmap.reset();
+    check(heatmap.cycles() == 0 && heatmap.workingSet().empty() &&
+              heatmap.pageCounts()[0x10].reads == 0 &&
+              heatmap.overlapBytes() == 0,
+          "reset");
+}
+
+void testOutput() {
+    MemoryHeatmap heatmap(true, 50);
+    run(heatmap);
+
+    std::ostringstream pages;
+    heatmap.writePages(pages);
+    const std::string page_csv = pages.str();
+    check(std::count(page_csv.begin(), page_csv.end(), '\n') ==
+                  1 + MemoryHeatmap::pages &&
+              page_csv.starts_with("page,address,reads,writes,executes\n"
+                                   "0,0,0,0,0\n"
+                                   "1,256,0,3,63\n"
+                                   "2,512,9,9,0\n"
+                                   "3,768,0,0,0\n") &&
+              page_csv.ends_with("\n255,65280,0,0,0\n"),
+          "pages CSV");
+
+    // only touched bytes are written
+    std::string expected = "address,reads,writes,executes\n";
+    for (uint16_t address = 0x100; address < 0x119; ++address) {
+        const bool in_loop = address >= 0x105 && address < 0x118;
+        expected += std::to_string(address) + ",0," +
+                    (address == 0x111 ? "3," : "0,") +
+                    (in_loop ? "3\n" : "1\n");
+    }
+    expected += "512,3,3,0\n766,3,3,0\n767,3,3,0\n";
+    std::ostringstream bytes;
+    heatmap.writeBytes(bytes);
+    check(bytes.str() == expected, "bytes CSV");
+
+    std::ostringstream working_set;
+    heatmap.writeWorkingSet(working_set);
+    check(working_set.str() == "cycles,read,written,executed,touched\n"
+                               "61,1,2,1,2\n108,1,1,1,2\n152,1,2,1,2\n"
+                               "212,1,1,1,2\n254,0,2,1,2\n297,1,1,1,2\n",
+          "working set CSV");
+
+    // red, green and blue are writes, reads and executes, each scaled so
+    // its largest count is 255
+    const std::string header = "P6\n256 256\n255\n";
+    std::ostringstream image;
+    heatmap.writeImage(image);
+    const std::string ppm = image.str();
+    const auto pixel = [&](const std::string &data, const uint16_t address) {
+        const std::size_t at = header.size() + 3 * std::size_t(address);
+        return std::vector<uint8_t>(data.begin() + at, data.begin() + at + 3);
+    };
+    check(ppm.size() == header.size() + 3 * 0x10000 &&
+              ppm.starts_with(header),
+          "PPM size");
+    check(pixel(ppm, 0x111) == std::vector<uint8_t>{255, 0, 255} &&
+              pixel(ppm, 0x200) == std::vector<uint8_t>{255, 255, 0} &&
+              pixel(ppm, 0x201) == std::vector<uint8_t>{0, 0, 0} &&
+              pixel(ppm, 0x000) == std::vector<uint8_t>{0, 0, 0},
+          "PPM pixels");
+
+    // without byte counts every byte of a page has its page's colour
+    MemoryHeatmap by_page(false, 50);
+    run(by_page);
+    std::ostringstream page_image;
+    by_page.writeImage(page_image);
+    const std::string page_ppm = page_image.str();
+    const uint8_t code_writes =
+        uint8_t(std::lround(std::log1p(3.0) * 255 / std::log1p(9.0)));
+    check(pixel(page_ppm, 0x1ff) ==
+                  std::vector<uint8_t>{code_writes, 0, 255} &&
+              pixel(page_ppm, 0x280) == std::vector<uint8_t>{255, 255, 0} &&
+              pixel(page_ppm, 0x300) == std::vector<uint8_t>{0, 0, 0},
+          "PPM pixels by page");
+}
+
+int main() {
+    if constexpr (!Intel8080::heatmap_enabled) {
+        std::cerr << "test-heatmap needs a build with EMU8080_HEATMAP"
+                  << std::endl;
+        return 1;
+    }
+    testCounts();
+    testWindows();
+    testOutput();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All heatmap checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/i8085.h"
+
+/**
+ * Checks the Intel8085: RESET, the RIM and SIM masks and serial pins, the
+ * priority of TRAP and RST 7.5, 6.5 and 5.5, RST 7.5 edge latching, and
+ * the undocumented instructions with their timing and V and K flags.
+ */
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+std::unique_ptr<Intel8085> load(const std::vector<uint8_t> &program) {
+    auto cpu = std::make_unique<Intel8085>();
+    cpu->memory.fill(0);
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    cpu->stack_pointer = 0xf000;
+    cpu->interrupts_enabled = false;
+    return cpu;
+}
+
+/**
+ * Step the CPU
+ * Returns: The clock cycles of the steps
+ */
+std::size_t run(Intel8085 &cpu, const std::size_t steps = 1) {
+    std::size_t cycles = 0;
+    for (std::size_t i = 0; i < steps; ++i) {
+        cycles += cpu.step();
+    }
+    return cycles;
+}
+
+void testReset() {
+    // RIM
+    auto cpu = load({0x20});
+    cpu->interrupts_enabled = true;
+    cpu->rst75();
+    cpu->trap();
+    cpu->reset();
+    cpu->memory[0] = 0x20;
+    check(!cpu->interrupts_enabled && cpu->program_counter == 0 &&
+              !cpu->interruptPending(),
+          "reset disables interrupts");
+    run(*cpu);
+    check(cpu->register_A == 0x07 && cpu->program_counter == 1,
+          "reset masks every RST");
+}
+
+void testMasks() {
+    // MVI A, 0Dh; SIM; RIM; MVI A, 02h; SIM; RIM
+    auto cpu = load({0x3e, 0x0d, 0x30, 0x20, 0x3e, 0x02, 0x30, 0x20});
+    check(run(*cpu, 3) == 7 + 4 + 4 && cpu->register_A == 0x05,
+          "SIM sets the masks");
+    // without mask set enable the masks stay
+    run(*cpu, 3);
+    check(cpu->register_A == 0x05, "SIM without MSE");
+
+    // pending inputs and INTE read through their masks
+    cpu->program_counter = 0x103;
+    cpu->interrupts_enabled = true;
+    cpu->rst75();
+    cpu->setRst55(true);
+    cpu->serial_input = true;
+    check(!cpu->interruptPending(), "masked inputs not pending");
+    run(*cpu);
+    check(cpu->register_A == (0x80 | 0x50 | 0x08 | 0x05), "RIM pending");
+
+    // MVI A, 10h; SIM; RIM resets RST 7.5, then MVI A, 0C0h; SIM sets
+    // SOD and MVI A, 40h; SIM clears it
+    cpu = load({0x3e, 0x10, 0x30, 0x20, 0x3e, 0xc0, 0x30, 0x3e, 0x40, 0x30});
+    cpu->rst75();
+    run(*cpu, 3);
+    check(cpu->register_A == 0x07, "SIM resets RST 7.5");
+    run(*cpu, 2);
+    check(cpu->serial_output, "SIM sets SOD");
+    run(*cpu, 2);
+    check(!cpu->serial_output, "SIM clears SOD");
+}
+
+void testPriority() {
+    // MVI A, 08h; SIM unmasks every RST
+    auto cpu = load({0x3e, 0x08, 0x30});
+    run(*cpu, 2);
+    cpu->setRst55(true);
+    cpu->setRst65(true);
+    cpu->rst75();
+    cpu->trap();
+
+    // TRAP is taken with interrupts disabled
+    check(run(*cpu) == 12 && cpu->program_counter == 0x24 &&
+              cpu->stack_pointer == 0xeffe && cpu->memory[0xeffe] == 0x03,
+          "TRAP first");
+    check(!cpu->interruptPending(), "others wait for EI");
+
+    // each taken interrupt disables the others until EI
+    const auto take = [&](const uint16_t vector, const std::string &name) {
+        cpu->interrupts_enabled = true;
+        check(run(*cpu) == 12 && cpu->program_counter == vector &&
+                  !cpu->interrupts_enabled,
+              name);
+    };
+    take(0x3c, "RST 7.5 second");
+    take(0x34, "RST 6.5 third");
+    take(0x34, "RST 6.5 taken while its level is high");
+    cpu->setRst65(false);
+    take(0x2c, "RST 5.5 last");
+
+    // a masked input waits, and the one below it is taken
+    cpu = load({0x3e, 0x0c, 0x30});
+    run(*cpu, 2);
+    cpu->interrupts_enabled = true;
+    cpu->rst75();
+    cpu->setRst55(true);
+    run(*cpu);
+    check(cpu->program_counter == 0x2c, "masked RST 7.5 skipped");
+}
+
+void testEdgeLatch() {
+    // MVI A, 08h; SIM; NOP
+    auto cpu = load({0x3e, 0x08, 0x30, 0x00});
+    run(*cpu, 2);
+
+    // an edge while interrupts are disabled is kept
+    cpu->rst75();
+    run(*cpu);
+    check(cpu->program_counter == 0x104, "RST 7.5 held while disabled");
+    cpu->interrupts_enabled = true;
+    run(*cpu);
+    check(cpu->program_counter == 0x3c && !cpu->interruptPending(),
+          "latched RST 7.5 taken once");
+
+    // a level dropped before it is taken is not
+    cpu->setRst65(true);
+    cpu->setRst65(false);
+    cpu->interrupts_enabled = true;
+    check(!cpu->interruptPending(), "RST 6.5 is a level");
+
+    // a halted CPU wakes for the latched edge
+    cpu->halted = true;
+    cpu->interrupts_enabled = true;
+    cpu->rst75();
+    check(cpu->execute(12) == 12 && cpu->program_counter == 0x3c &&
+              !cpu->halted,
+          "halted 8085 wakes for RST 7.5");
+}
+
+void testUndocumented() {
+    // LXI H, 1234h; LXI B, 0235h; DSUB
+    auto cpu = load({0x21, 0x34, 0x12, 0x01, 0x35, 0x02, 0x08});
+    run(*cpu, 2);
+    check(run(*cpu) == 10 && cpu->register_HL == 0x0fff && !cpu->flag_C &&
+              !cpu->flag_V && !cpu->flag_Z,
+          "DSUB");
+    cpu->register_HL = 0x8000;
+    cpu->register_BC = 0x0001;
+    cpu->program_counter = 0x106;
+    run(*cpu);
+    check(cpu->register_HL == 0x7fff && !cpu->flag_C && cpu->flag_V &&
+              cpu->flag_K,
+          "DSUB overflow");
+    cpu->register_HL = 0x0001;
+    cpu->register_BC = 0x0002;
+    cpu->program_counter = 0x106;
+    run(*cpu);
+    check(cpu->register_HL == 0xffff && cpu->flag_C, "DSUB borrow");
+
+    // ARHL; RDEL
+    cpu = load({0x10, 0x18});
+    cpu->register_HL = 0x8003;
+    cpu->register_DE = 0x8001;
+    check(run(*cpu) == 7 && cpu->register_HL == 0xc001 && cpu->flag_C,
+          "ARHL");
+    cpu->flag_C = false;
+    check(run(*cpu) == 10 && cpu->register_DE == 0x0002 && cpu->flag_C &&
+              cpu->flag_V,
+          "RDEL");
+
+    // LDHI 10h; LDSI 05h; SHLX; LHLX
+    cpu = load({0x28, 0x10, 0x38, 0x05, 0xd9, 0xed});
+    cpu->register_HL = 0x1000;
+    check(run(*cpu) == 10 && cpu->register_DE == 0x1010, "LDHI");
+    cpu->stack_pointer = 0x2ffb;
+    check(run(*cpu) == 10 && cpu->register_DE == 0x3000, "LDSI");
+    cpu->register_HL = 0xbeef;
+    check(run(*cpu) == 10 && cpu->memory[0x3000] == 0xef &&
+              cpu->memory[0x3001] == 0xbe,
+          "SHLX");
+    cpu->register_HL = 0;
+    check(run(*cpu) == 10 && cpu->register_HL == 0xbeef, "LHLX");
+}
+
+void testFlags() {
+    // MVI A, 7Fh; ADI 1; PUSH PSW
+    auto cpu = load({0x3e, 0x7f, 0xc6, 0x01, 0xf5});
+    run(*cpu, 2);
+    check(cpu->register_A == 0x80 && cpu->flag_V && cpu->flag_S &&
+              !cpu->flag_K,
+          "V and K from ADD");
+    run(*cpu);
+    check(cpu->memory[0xeffe] == (0x80 | 0x10 | 0x02), "V and K in PSW");
+
+    // LXI D, 0FFFFh; INX D; JK 0200h; and at 0200h DCX D; JNK 0300h
+    cpu = load({0x11, 0xff, 0xff, 0x13, 0xfd, 0x00, 0x02});
+    cpu->memory[0x200] = 0x1b;
+    cpu->memory[0x201] = 0xdd;
+    cpu->memory[0x202] = 0x00;
+    cpu->memory[0x203] = 0x03;
+    run(*cpu, 2);
+    check(cpu->register_DE == 0 && cpu->flag_K, "INX wrap sets K");
+    check(run(*cpu) == 10 && cpu->program_counter == 0x200, "JK taken");
+    run(*cpu);
+    check(cpu->register_DE == 0xffff && cpu->flag_K, "DCX wrap sets K");
+    check(run(*cpu) == 7 && cpu->program_counter == 0x204, "JNK not taken");
+
+    // RSTV, with V clear and set
+    cpu = load({0xcb, 0xcb});
+    check(run(*cpu) == 6 && cpu->program_counter == 0x101, "RSTV not taken");
+    cpu->flag_V = true;
+    check(run(*cpu) == 12 && cpu->program_counter == 0x40 &&
+              cpu->memory[0xeffe] == 0x02 && cpu->memory[0xefff] == 0x01,
+          "RSTV taken");
+}
+
+void testIntel8080() {
+    // the same opcodes are NOPs and alternate jumps on the 8080
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    const std::vector<uint8_t> program = {0x08, 0x10, 0x18, 0x20, 0x28,
+                                          0x30, 0x38, 0xcb, 0x00, 0x02};
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    cpu->register_HL = 0x8003;
+    std::size_t cycles = 0;
+    for (int i = 0; i < 8; ++i) {
+        cycles += cpu->step();
+    }
+    check(cycles == 7 * 4 + 10 && cpu->program_counter == 0x200 &&
+              cpu->register_HL == 0x8003,
+          "8080 NOPs and JMP");
+}
+
+int main() {
+    testReset();
+    testMasks();
+    testPriority();
+    testEdgeLatch();
+    testUndocumented();
+    testFlags();
+    testIntel8080();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All 8085 checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../src/invaders.h"
+
+// a frame is dumped once a second of game time
+constexpr std::size_t dump_interval = SpaceInvaders::frame_rate;
+
+// scripted controls: insert a coin, start a game and keep firing
+void play(SpaceInvaders &machine, const std::size_t frame) {
+    machine.setInput(SpaceInvaders::coin, frame >= 60 && frame < 66);
+    machine.setInput(SpaceInvaders::player_1_start,
+                     frame >= 120 && frame < 126);
+    machine.setInput(SpaceInvaders::player_1_shot, frame % 40 < 4);
+    machine.setInput(SpaceInvaders::player_1_left, frame % 240 < 120);
+    machine.setInput(SpaceInvaders::player_1_right, frame % 240 >= 120);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        std::cout << "usage: space-invaders [ROM] [FRAMES] [DUMP DIRECTORY]"
+                  << std::endl;
+        return 1;
+    }
+    const std::size_t frames = argc > 2 ? std::stoull(argv[2]) : 3600;
+
+    // too large for the stack
+    auto machine = std::make_unique<SpaceInvaders>();
+    if (!machine->loadRom(argv[1])) {
+        std::cout << "cannot read the ROM from " << argv[1] << std::endl;
+        return 1;
+    }
+    auto renderer = std::make_unique<InvadersRenderer>();
+
+    // unthrottled, as fast as the host can go
+    std::size_t cycles = 0;
+    std::size_t lines = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+        play(*machine, frame);
+        cycles += machine->runFrame();
+        lines += renderer->render(machine->videoRam());
+
+        if (argc == 4 && frame % dump_interval == dump_interval - 1) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/frame%05zu.ppm", frame + 1);
+            renderer->writePpm(argv[3] + std::string(name));
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << frames << " frames in " << seconds << " s: "
+              << frames / seconds << " frames/s, "
+              << cycles / seconds / 1e6 << " MHz, "
+              << double(lines) / frames << " lines redrawn per frame"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/invaders.h"
+
+/**
+ * Checks SpaceInvaders with a synthetic ROM: loading from one file or
+ * four, the shift register, the input and sound ports and where in the
+ * frame RST 1 and RST 2 are taken. Checks InvadersRenderer, which uses
+ * AVX2 when built for it, against a scalar reference.
+ */
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+const std::string directory =
+    "/tmp/emu8080-invaders-" + std::to_string(getpid());
+
+// cycles of the interrupt handlers: SHLD, JMP, LXI H, EI and RET
+constexpr std::size_t handler_cycles = 16 + 10 + 10 + 4 + 10;
+// cycles of one pass of the main loop: INX H and JMP
+constexpr std::size_t loop_cycles = 5 + 10;
+
+void place(std::vector<uint8_t> &rom, const uint16_t address,
+           const std::vector<uint8_t> &code) {
+    std::copy(code.begin(), code.end(), rom.begin() + address);
+}
+
+/**
+ * The ROM tries the shift register at three offsets, reads IN 1 and 2,
+ * writes both sound ports and then counts in HL. RST 1 stores the count
+ * at 2000h and RST 2 at 2002h, and both start it over.
+ */
+std::vector<uint8_t> syntheticRom() {
+    std::vector<uint8_t> rom(SpaceInvaders::rom_size, 0);
+    // LXI SP, 2400h; JMP 0040h
+    place(rom, 0x0000, {0x31, 0x00, 0x24, 0xc3, 0x40, 0x00});
+    // RST 1: SHLD 2000h; JMP 0030h
+    place(rom, 0x0008, {0x22, 0x00, 0x20, 0xc3, 0x30, 0x00});
+    // RST 2: SHLD 2002h; JMP 0030h
+    place(rom, 0x0010, {0x22, 0x02, 0x20, 0xc3, 0x30, 0x00});
+    // LXI H, 0; EI; RET
+    place(rom, 0x0030, {0x21, 0x00, 0x00, 0xfb, 0xc9});
+
+    uint16_t address = 0x0040;
+    const auto emit = [&](const std::vector<uint8_t> &code) {
+        place(rom, address, code);
+        address += code.size();
+    };
+    // MVI A, 0ABh; OUT 4; MVI A, 0CDh; OUT 4
+    emit({0x3e, 0xab, 0xd3, 0x04, 0x3e, 0xcd, 0xd3, 0x04});
+    // MVI A, offset; OUT 2; IN 3; STA 2004h + i
+    const uint8_t offsets[] = {3, 7, 0};
+    for (uint8_t i = 0; i < 3; ++i) {
+        emit({0x3e, offsets[i], 0xd3, 0x02, 0xdb, 0x03, 0x32,
+              uint8_t(0x04 + i), 0x20});
+    }
+    // IN 1; STA 2007h; IN 2; STA 2008h
+    emit({0xdb, 0x01, 0x32, 0x07, 0x20, 0xdb, 0x02, 0x32, 0x08, 0x20});
+    // MVI A, 05h; OUT 3; MVI A, 0Ah; OUT 5
+    emit({0x3e, 0x05, 0xd3, 0x03, 0x3e, 0x0a, 0xd3, 0x05});
+    // LXI H, 0; EI; then INX H; JMP back to it
+    emit({0x21, 0x00, 0x00, 0xfb});
+    const uint16_t loop = address;
+    emit({0x23, 0xc3, uint8_t(loop), uint8_t(loop >> 8)});
+    return rom;
+}
+
+void writeFile(const std::string &path, const uint8_t *data,
+               const std::size_t size) {
+    std::ofstream output(path, std::ios::out | std::ios::binary);
+    output.write(reinterpret_cast<const char *>(data), size);
+}
+
+void testLoad(const std::vector<uint8_t> &rom) {
+    auto single = std::make_unique<SpaceInvaders>();
+    check(single->loadRom(directory + "/invaders.rom") &&
+              std::equal(rom.begin(), rom.end(), single->cpu.memory.begin()),
+          "ROM from one file");
+
+    // invaders.h, g, f and e hold 2 KB each, from 0000h up
+    const std::string parts = directory + "/parts";
+    std::filesystem::create_directory(parts);
+    const char *names[] = {"invaders.h", "invaders.g", "invaders.f",
+                           "invaders.e"};
+    for (std::size_t i = 0; i < 4; ++i) {
+        writeFile(parts + "/" + names[i], &rom[i * 0x800], 0x800);
+    }
+    auto split = std::make_unique<SpaceInvaders>();
+    check(split->loadRom(parts) &&
+              std::equal(rom.begin(), rom.end(), split->cpu.memory.begin()),
+          "ROM from four files");
+
+    // a short ROM is refused
+    std::filesystem::remove(parts + "/invaders.e");
+    check(!split->loadRom(parts), "short ROM refused");
+    check(!split->loadRom(directory + "/missing.rom"), "missing ROM refused");
+}
+
+void testMachine() {
+    auto machine = std::make_unique<SpaceInvaders>();
+    machine->loadRom(directory + "/invaders.rom");
+    machine->setInput(SpaceInvaders::coin, true);
+    machine->setInput(SpaceInvaders::player_1_shot, true);
+    machine->setInput(SpaceInvaders::player_2_left, true);
+    machine->setInput(SpaceInvaders::tilt, true);
+    machine->setInput(SpaceInvaders::tilt, false);
+    machine->dip_switches = 0x83;
+
+    // the first half of the first frame runs the port checks
+    std::vector<std::size_t> frame_cycles;
+    std::vector<uint16_t> first_halves;
+    std::vector<uint16_t> second_halves;
+    const auto count = [&](const uint16_t address) {
+        return uint16_t(machine->cpu.memory[address] |
+                        machine->cpu.memory[address + 1] << 8);
+    };
+    for (int frame = 0; frame < 5; ++frame) {
+        frame_cycles.push_back(machine->runFrame());
+        // RST 2 was just taken, its handler runs in the next frame
+        check(machine->cpu.program_counter == 0x0010, "RST 2 ends a frame");
+        first_halves.push_back(count(0x2000));
+        if (frame > 0) {
+            second_halves.push_back(count(0x2002));
+        }
+    }
+
+    const uint8_t *ram = &machine->cpu.memory[0x2000];
+    // 0CDABh shifted left by the offset, the high byte
+    check(ram[4] == 0x6d && ram[5] == 0xd5 && ram[6] == 0xcd,
+          "shift register");
+    check(ram[7] == (0x08 | 0x01 | 0x10), "IN 1");
+    check(ram[8] == (0x20 | 0x83), "IN 2");
+    check(machine->sound_1 == 0x05 && machine->sound_2 == 0x0a,
+          "sound latches");
+
+    // the halves are counted from the handler to the next interrupt
+    const auto near = [](const uint16_t counted, const std::size_t cycles) {
+        const std::size_t spent = counted * loop_cycles + handler_cycles;
+        return spent <= cycles + loop_cycles &&
+               cycles <= spent + 2 * loop_cycles;
+    };
+    constexpr std::size_t half = SpaceInvaders::cycles_per_frame / 2;
+    bool timed = true;
+    for (std::size_t i = 1; i < first_halves.size(); ++i) {
+        timed = timed && near(first_halves[i], half);
+    }
+    for (const uint16_t counted : second_halves) {
+        timed = timed && near(counted, SpaceInvaders::cycles_per_frame - half);
+    }
+    check(timed, "RST 1 mid-frame and RST 2 at the end");
+
+    // a frame that runs over is shortened by as much
+    constexpr std::size_t frame = SpaceInvaders::cycles_per_frame;
+    bool carried = true;
+    for (const std::size_t cycles : frame_cycles) {
+        carried = carried && cycles + loop_cycles > frame &&
+                  cycles < frame + loop_cycles;
+    }
+    const uint64_t total = machine->cpu.cycle_count;
+    check(carried && total >= 5 * frame && total < 5 * frame + loop_cycles,
+          "frame overshoot carried");
+}
+
+/**
+ * The monitor is turned a quarter counterclockwise: byte x * 32 + k of
+ * video RAM is column x, and bit b of it line 255 - (8k + b)
+ */
+std::vector<uint32_t> referenceFrame(const uint8_t *video_ram) {
+    const auto rgba = [](const uint8_t r, const uint8_t g, const uint8_t b) {
+        return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16 |
+               uint32_t(0xff) << 24;
+    };
+    std::vector<uint32_t> frame(InvadersRenderer::width *
+                                InvadersRenderer::height);
+    for (std::size_t y = 0; y < InvadersRenderer::height; ++y) {
+        for (std::size_t x = 0; x < InvadersRenderer::width; ++x) {
+            const std::size_t bit = InvadersRenderer::height - 1 - y;
+            const bool lit = video_ram[x * 32 + bit / 8] >> (bit % 8) & 1;
+            uint32_t color = rgba(0xff, 0xff, 0xff);
+            if (y >= 32 && y < 64) {
+                color = rgba(0xff, 0x20, 0x20);
+            } else if ((y >= 184 && y < 240) ||
+                       (y >= 240 && x >= 16 && x < 134)) {
+                color = rgba(0x20, 0xff, 0x20);
+            }
+            frame[y * InvadersRenderer::width + x] =
+                lit ? color : rgba(0, 0, 0);
+        }
+    }
+    return frame;
+}
+
+bool sameFrame(const InvadersRenderer &renderer, const uint8_t *video_ram) {
+    const std::vector<uint32_t> reference = referenceFrame(video_ram);
+    return std::equal(reinterpret_cast<const uint8_t *>(reference.data()),
+                      reinterpret_cast<const uint8_t *>(reference.data() +
+                                                        reference.size()),
+                      renderer.frame());
+}
+
+void testRenderer() {
+    std::vector<uint8_t> video_ram(SpaceInvaders::video_ram_size);
+    std::mt19937 generator(8080);
+    for (uint8_t &byte : video_ram) {
+        byte = generator();
+    }
+    auto renderer = std::make_unique<InvadersRenderer>();
+    check(renderer->render(video_ram.data()) == InvadersRenderer::height &&
+              sameFrame(*renderer, video_ram.data()),
+          "first render");
+    check(renderer->render(video_ram.data()) == 0, "unchanged render");
+
+    // one bit of column 100 is line 255 - (8 * 5 + 2) = 213; another in
+    // the last column, at bit 7 of byte 30, is line 8
+    video_ram[100 * 32 + 5] ^= 0x04;
+    video_ram[223 * 32 + 30] ^= 0x80;
+    check(renderer->render(video_ram.data()) == 2 &&
+              renderer->isDirty(213) && renderer->isDirty(8) &&
+              !renderer->isDirty(212),
+          "changed lines redrawn");
+    check(sameFrame(*renderer, video_ram.data()), "changed render");
+
+    // every line changing at once, including the bottom strip
+    for (uint8_t &byte : video_ram) {
+        byte = ~byte;
+    }
+    renderer->render(video_ram.data());
+    check(sameFrame(*renderer, video_ram.data()), "inverted render");
+
+    const std::string path = directory + "/frame.ppm";
+    check(renderer->writePpm(path) &&
+              std::filesystem::file_size(path) ==
+                  15 + InvadersRenderer::width * InvadersRenderer::height * 3,
+          "PPM written");
+}
+
+int main() {
+    std::filesystem::create_directory(directory);
+    const std::vector<uint8_t> rom = syntheticRom();
+    writeFile(directory + "/invaders.rom", rom.data(), rom.size());
+
+    testLoad(rom);
+    testMachine();
+    testRenderer();
+    std::filesystem::remove_all(directory);
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All Space Invaders checks passed" << std::endl;
+    return 0;
+}
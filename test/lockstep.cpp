@@ -0,0 +1,170 @@
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/lockstep.h"
+
+/**
+ * Checks LockstepIntel8080 against one Intel8080 per lane: the CPU tests
+ * with every lane alike, and a program whose lanes branch apart, drift
+ * out of the divergence window and meet again. Every lane's registers,
+ * flags, memory, output and cycles must match its own interpreter.
+ */
+
+// assembled test/BDOS.ASM file
+const std::array<uint8_t, 0x22> bdos = {
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00
+};
+
+// Reads a seed from IN 0, spins for 256 to 2048 iterations depending on
+// it, then repeatedly decrements odd values through a CALL and halves
+// them, storing each value from 2000h, and outputs the count on port 1
+const std::vector<uint8_t> divergent_program = {
+    0xdb, 0x00,       // 0100 IN 0
+    0x4f,             // 0102 MOV C, A
+    0xe6, 0x07,       // 0103 ANI 7
+    0x5f,             // 0105 MOV E, A
+    0x1c,             // 0106 INR E
+    0x16, 0x00,       // 0107 MVI D, 0
+    0x15,             // 0109 DCR D
+    0xc2, 0x09, 0x01, // 010A JNZ 0109h
+    0x1d,             // 010D DCR E
+    0xc2, 0x07, 0x01, // 010E JNZ 0107h
+    0x06, 0x00,       // 0111 MVI B, 0
+    0x21, 0x00, 0x20, // 0113 LXI H, 2000h
+    0x79,             // 0116 MOV A, C
+    0x77,             // 0117 MOV M, A
+    0x23,             // 0118 INX H
+    0x04,             // 0119 INR B
+    0xfe, 0x01,       // 011A CPI 1
+    0xca, 0x30, 0x01, // 011C JZ 0130h
+    0xda, 0x30, 0x01, // 011F JC 0130h
+    0xe6, 0x01,       // 0122 ANI 1
+    0xc4, 0x36, 0x01, // 0124 CNZ 0136h
+    0x79,             // 0127 MOV A, C
+    0x1f,             // 0128 RAR
+    0x4f,             // 0129 MOV C, A
+    0xc3, 0x16, 0x01, // 012A JMP 0116h
+    0x00, 0x00, 0x00, // 012D
+    0x78,             // 0130 MOV A, B
+    0xd3, 0x01,       // 0131 OUT 1
+    0x76,             // 0133 HLT
+    0x00, 0x00,       // 0134
+    0x0d,             // 0136 DCR C
+    0xc9,             // 0137 RET
+};
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+uint8_t seed(const std::size_t lane) { return uint8_t(lane * 37 + 5); }
+
+std::unique_ptr<Intel8080> load(const std::vector<uint8_t> &program) {
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(bdos.begin(), bdos.end(), cpu->memory.begin());
+    std::copy(program.begin(), program.end(), cpu->memory.begin() + 0x100);
+    cpu->register_PSW = cpu->register_BC = 0;
+    cpu->register_DE = cpu->register_HL = 0;
+    cpu->flag_S = cpu->flag_Z = cpu->flag_A = cpu->flag_P = false;
+    cpu->flag_C = false;
+    cpu->stack_pointer = 0xf000;
+    cpu->program_counter = 0x100;
+    return cpu;
+}
+
+bool same(const Intel8080 &a, const Intel8080 &b) {
+    return a.register_A == b.register_A && a.register_BC == b.register_BC &&
+           a.register_DE == b.register_DE && a.register_HL == b.register_HL &&
+           a.flag_S == b.flag_S && a.flag_Z == b.flag_Z &&
+           a.flag_A == b.flag_A && a.flag_P == b.flag_P &&
+           a.flag_C == b.flag_C && a.stack_pointer == b.stack_pointer &&
+           a.program_counter == b.program_counter && a.halted == b.halted &&
+           a.interrupts_enabled == b.interrupts_enabled &&
+           a.memory == b.memory;
+}
+
+/**
+ * Run a program on every lane and on an interpreter per lane
+ * Parameters:
+ *     target - The cycles to run each lane for, SIZE_MAX to halt
+ */
+template <std::size_t Lanes>
+void compare(const std::string &name, const std::vector<uint8_t> &program,
+             const std::size_t target = SIZE_MAX) {
+    auto lockstep = std::make_unique<LockstepIntel8080<Lanes>>();
+    std::array<std::string, Lanes> lane_output;
+    lockstep->in = [](std::size_t lane, uint8_t) { return seed(lane); };
+    lockstep->out = [&](std::size_t lane, uint8_t, uint8_t byte) {
+        lane_output[lane] += char(byte);
+    };
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        lockstep->load(lane, *load(program));
+    }
+    lockstep->execute(target);
+
+    std::size_t mismatched = 0;
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        auto cpu = load(program);
+        std::string output;
+        cpu->in = [lane](uint8_t) { return seed(lane); };
+        cpu->out = [&](uint8_t, uint8_t byte) { output += char(byte); };
+        const std::size_t cycles = cpu->execute(target);
+
+        auto result = std::make_unique<Intel8080>();
+        lockstep->store(lane, *result);
+        mismatched += !same(*cpu, *result) || output != lane_output[lane] ||
+                      cycles != lockstep->cycles[lane];
+    }
+    check(mismatched == 0, name + " on " + std::to_string(Lanes) + " lanes");
+}
+
+std::vector<uint8_t> readProgram(const std::string &path) {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        std::cout << "cannot read " << path << std::endl;
+        ++failures;
+    }
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(input)),
+                                std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cout << "usage: test-lockstep [TEST DIRECTORY]" << std::endl;
+        return 1;
+    }
+    const std::string directory = argv[1];
+
+    compare<8>("divergent program", divergent_program);
+    compare<16>("divergent program", divergent_program);
+    compare<32>("divergent program", divergent_program);
+    // stopped inside the spin and inside the halving loop
+    compare<8>("divergent program to 1000 cycles", divergent_program, 1000);
+    compare<32>("divergent program to 10000 cycles", divergent_program,
+                10000);
+
+    for (const char *test : {"TST8080.COM", "8080PRE.COM", "CPUTEST.COM"}) {
+        compare<8>(test, readProgram(directory + "/" + test));
+    }
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All lockstep checks passed" << std::endl;
+    return 0;
+}
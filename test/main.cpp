@@ -2,7 +2,9 @@
 #include <fstream>
 #include <string>
 
+#include "../src/console.h"
 #include "../src/cpu.h"
+#include "../src/profiler.h"
 
 // assembled test/BDOS.ASM file
 const std::array<uint8_t, 0x22> bdos = {
@@ -15,8 +17,9 @@ const std::array<uint8_t, 0x22> bdos = {
 
 int main(int argc, char **argv) {
     // check arguments
-    if (argc != 2) {
-        std::cout << "usage: test8080 [COM]" << std::endl;
+    if (argc != 2 && argc != 3) {
+        std::cout << "usage: test8080 [COM] [FOLDED STACKS OUTPUT]"
+                  << std::endl;
         return 1;
     }
 
@@ -29,19 +32,33 @@ int main(int argc, char **argv) {
     Intel8080 cpu;
     cpu.program_counter = 0x100;
     
-    // CPU out port callback
-    cpu.out = [](uint8_t port, uint8_t byte) {
-        if (port == 0) {
-            std::cout << byte;
-        }
-    };
+    // BDOS prints through the console on port 0
+    Console console;
+    console.attach(cpu);
 
     // load BDOS test file into RAM
     std::copy(bdos.begin(), bdos.end(), cpu.memory.begin());
 	test.read((char *) cpu.memory.data() + 0x100, cpu.memory.size() - 0x100);
     
-    std::size_t cycles = cpu.execute();
+    // optionally sample where the program spends its time
+    std::size_t cycles;
+    if (argc == 3) {
+        Profiler profiler(cpu);
+        cycles = profiler.execute();
+        std::ofstream folded(argv[2]);
+        profiler.writeFolded(folded);
+    } else {
+        cycles = cpu.execute();
+    }
+    console.flush();
     std::cout << std::endl << "Cycles executed: " << cycles << std::endl;
 
+    if constexpr (Intel8080::stats_enabled) {
+        const Intel8080::Statistics stats = cpu.statistics();
+        std::cout << "Instructions: " << stats.instructions << std::endl
+                  << "Branches taken: " << stats.branches_taken
+                  << ", not taken: " << stats.branches_not_taken << std::endl;
+    }
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/monitor.h"
+
+// counts in HL and stores each count at 0x2000, so the stored count is
+// HL or HL - 1 at every instruction boundary
+const std::vector<uint8_t> counter_program = {
+    0x21, 0x00, 0x00, // LXI H, 0000h
+    0x23,             // INX H
+    0x22, 0x00, 0x20, // SHLD 2000h
+    0xc3, 0x03, 0x01, // JMP 0103h
+};
+
+constexpr std::size_t slice = 10000;
+constexpr std::size_t total_cycles = 200000000;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+std::unique_ptr<Intel8080> counter() {
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(counter_program.begin(), counter_program.end(),
+              cpu->memory.begin() + 0x100);
+    cpu->program_counter = 0x100;
+    return cpu;
+}
+
+/**
+ * Run the counter, publishing after every slice when given a publisher
+ * Parameters:
+ *     slices - Receives the number of slices
+ * Returns: Host seconds taken
+ */
+double run(Intel8080 &cpu, StatePublisher *publisher, uint64_t &slices) {
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t cycles = 0;
+    for (slices = 0; cycles < total_cycles; ++slices) {
+        cycles += cpu.execute(slice);
+        if (publisher) {
+            publisher->publish(cpu, cycles);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void testSnapshot() {
+    auto cpu = counter();
+    StatePublisher publisher({{0x0100, 3}, {0x2000, 2}, {0xfff0, 16}});
+    check(publisher.watchedBytes() == 21, "watched bytes");
+
+    StatePublisher::Registers registers;
+    check(publisher.tryRead(registers) && registers.publishes == 0,
+          "nothing published");
+
+    cpu->stack_pointer = 0x1234;
+    cpu->register_A = 0xab;
+    cpu->flag_Z = true;
+    cpu->memory[0xffff] = 0x5a;
+    publisher.publish(*cpu, 42);
+    uint8_t bytes[21];
+    registers = publisher.read(bytes);
+    check(registers.publishes == 1 && registers.cycles == 42,
+          "publish count and cycles");
+    check(registers.A == 0xab && registers.flags == 0x42, "registers");
+    check(registers.stack_pointer == 0x1234 &&
+              registers.program_counter == 0x100,
+          "pointers");
+    check(!registers.halted && registers.interrupts_enabled, "state");
+    check(bytes[0] == 0x21 && bytes[3] == 0 && bytes[20] == 0x5a,
+          "watched regions back to back");
+
+    // the 8085 publishes its K and V flags
+    Intel8085 i8085;
+    i8085.flag_K = true;
+    i8085.flag_V = true;
+    i8085.flag_C = true;
+    publisher.publish(i8085, 0);
+    check(publisher.read().flags == 0x23, "8085 flags");
+}
+
+void testConcurrentReads() {
+    auto cpu = counter();
+    StatePublisher publisher({{0x2000, 2}});
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> reads = 0;
+    std::atomic<uint64_t> retries = 0;
+    std::atomic<uint64_t> torn = 0;
+
+    // monitoring threads check that every read is one instruction boundary
+    std::vector<std::thread> monitors;
+    for (int i = 0; i < 2; ++i) {
+        monitors.emplace_back([&] {
+            uint64_t last = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                StatePublisher::Registers registers;
+                uint8_t stored[2];
+                if (!publisher.tryRead(registers, stored)) {
+                    retries.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                const uint16_t count = registers.H << 8 | registers.L;
+                const uint16_t behind = count - (stored[1] << 8 | stored[0]);
+                if (behind > 1 || registers.publishes < last) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+                last = registers.publishes;
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    uint64_t slices;
+    run(*cpu, &publisher, slices);
+    done = true;
+    for (std::thread &monitor : monitors) {
+        monitor.join();
+    }
+    check(torn == 0, "consistent reads");
+    check(publisher.read().publishes == slices, "every slice published");
+    std::cout << reads << " reads while executing, " << retries
+              << " retried" << std::endl;
+}
+
+// the cost of publishing, measured without monitors competing for cores
+void testOverhead() {
+    auto cpu = counter();
+    StatePublisher publisher({{0x2000, 2}});
+    uint64_t slices;
+    const double published = run(*cpu, &publisher, slices);
+    const double bare = run(*counter(), nullptr, slices);
+    std::cout << total_cycles / published / 1e6 << " MHz publishing every "
+              << slice << " cycles, " << total_cycles / bare / 1e6
+              << " MHz without" << std::endl;
+}
+
+int main() {
+    testSnapshot();
+    testConcurrentReads();
+    testOverhead();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All monitor checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/multiprocessor.h"
+
+// counts in HL in private memory and, every 256 counts, increments the
+// byte at 0x8000 in shared memory without any locking
+const std::vector<uint8_t> counter_program = {
+    0x21, 0x00, 0x00, // LXI H, 0000h
+    0x23,             // INX H
+    0x22, 0x00, 0x20, // SHLD 2000h
+    0x7d,             // MOV A, L
+    0xb7,             // ORA A
+    0xc2, 0x03, 0x01, // JNZ 0103h
+    0x3a, 0x00, 0x80, // LDA 8000h
+    0x3c,             // INR A
+    0x32, 0x00, 0x80, // STA 8000h
+    0xc3, 0x03, 0x01, // JMP 0103h
+};
+
+// one 4 KB page of shared memory
+const std::vector<Multiprocessor::Region> shared = {{0x8000, 0x1000}};
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+void load(Multiprocessor &system) {
+    for (std::size_t i = 0; i < system.size(); ++i) {
+        Intel8080 &cpu = system.core(i);
+        std::copy(counter_program.begin(), counter_program.end(),
+                  cpu.memory.begin() + 0x100);
+        cpu.program_counter = 0x100;
+    }
+}
+
+// the state of every core and the shared byte after a run
+std::vector<uint64_t> state(Multiprocessor &system) {
+    std::vector<uint64_t> result = {system.core(0).memory[0x8000]};
+    for (std::size_t i = 0; i < system.size(); ++i) {
+        result.push_back(system.core(i).register_HL);
+        result.push_back(system.coreCycles(i));
+    }
+    return result;
+}
+
+void testSharedMemory() {
+    Multiprocessor system(3, shared);
+    check(system.isOpen(), "shared regions mapped");
+    system.core(1).memory[0x8123] = 0x42;
+    system.core(1).memory[0x2000] = 0x17;
+    check(system.core(0).memory[0x8123] == 0x42 &&
+              system.core(2).memory[0x8123] == 0x42,
+          "stores seen by every core");
+    check(system.core(0).memory[0x2000] == 0 &&
+              system.core(2).memory[0x2000] == 0,
+          "private memory");
+
+    check(!Multiprocessor(2, {{0x8001, 0x1000}}).isOpen(),
+          "unaligned region refused");
+    check(!Multiprocessor(2, {{0xf000, 0x2000}}).isOpen(),
+          "region past end of memory refused");
+}
+
+void testQuanta() {
+    Multiprocessor system(4, shared);
+    load(system);
+    system.quantum = 1000;
+    std::vector<uint64_t> ends;
+    system.quantum_done = [&](uint64_t clock) {
+        ends.push_back(clock);
+        // every core is within one instruction of the system clock
+        for (std::size_t i = 0; i < system.size(); ++i) {
+            const uint64_t cycles = system.coreCycles(i);
+            check(cycles >= clock && cycles < clock + 18, "cores in step");
+        }
+    };
+    check(system.runParallel(10500, 2) == 10500, "parallel clock");
+    check(ends.size() == 11 && ends.back() == 10500, "quantum ends");
+
+    // a halted core lets the quantum pass
+    system.core(3).halted = true;
+    system.runInterleaved(2000);
+    check(system.coreCycles(3) == 12500, "halted core keeps time");
+}
+
+void testDeterminism() {
+    // the shared byte depends on how the cores interleave, but the
+    // interleaved mode always interleaves them the same way
+    std::vector<std::vector<uint64_t>> results;
+    for (uint64_t quantum : {100, 100, 1000}) {
+        Multiprocessor system(4, shared);
+        load(system);
+        system.quantum = quantum;
+        system.runInterleaved(5000000);
+        results.push_back(state(system));
+    }
+    check(results[0] == results[1], "interleaved runs repeat");
+    check(results[0] != results[2], "quantum changes the interleaving");
+
+    // each core's private work does not depend on the interleaving
+    Multiprocessor system(4, shared);
+    load(system);
+    system.quantum = 100;
+    system.runParallel(5000000, 4);
+    const std::vector<uint64_t> parallel = state(system);
+    check(std::equal(parallel.begin() + 1, parallel.end(),
+                     results[0].begin() + 1),
+          "parallel private state");
+}
+
+double seconds(const std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+// aggregate emulated MHz with 1, 2, 4... cores on one thread per core
+void benchmark() {
+    constexpr uint64_t cycles = 100000000;
+    const unsigned int host = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << host << " host threads, " << cycles / 1000000
+              << "M cycles per core" << std::endl;
+    for (std::size_t count = 1; count <= std::max(host, 4u); count *= 2) {
+        std::cout << count << " cores:";
+        for (uint64_t quantum : {1000, 100000}) {
+            Multiprocessor system(count, shared);
+            load(system);
+            system.quantum = quantum;
+            const auto start = std::chrono::steady_clock::now();
+            system.runParallel(cycles, count);
+            const double parallel =
+                seconds(std::chrono::steady_clock::now() - start);
+            std::cout << " " << count * cycles / parallel / 1e6
+                      << " MHz parallel (quantum " << quantum << "),";
+        }
+        Multiprocessor system(count, shared);
+        load(system);
+        system.quantum = 1000;
+        const auto start = std::chrono::steady_clock::now();
+        system.runInterleaved(cycles);
+        const double interleaved =
+            seconds(std::chrono::steady_clock::now() - start);
+        std::cout << " " << count * cycles / interleaved / 1e6
+                  << " MHz interleaved" << std::endl;
+    }
+}
+
+int main() {
+    testSharedMemory();
+    testQuanta();
+    testDeterminism();
+    benchmark();
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All multiprocessor checks passed" << std::endl;
+    return 0;
+}
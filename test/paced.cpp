@@ -0,0 +1,71 @@
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../src/pacer.h"
+
+// assembled test/BDOS.ASM file
+const std::array<uint8_t, 0x22> bdos = {
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00
+};
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        std::cout << "usage: paced [COM] [MHZ] [SECONDS]" << std::endl;
+        return 1;
+    }
+    const double frequency = argc > 2 ? std::stod(argv[2]) * 1e6 : 2e6;
+    const double seconds = argc > 3 ? std::stod(argv[3]) : 5;
+
+    std::ifstream program(argv[1], std::ios::in | std::ios::binary);
+    if (program.fail()) {
+        std::cout << "cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(bdos.begin(), bdos.end(), cpu->memory.begin());
+    program.read(reinterpret_cast<char *>(cpu->memory.data() + 0x100),
+                 cpu->memory.size() - 0x100);
+    cpu->program_counter = 0x100;
+    cpu->out = [](uint8_t port, uint8_t byte) {
+        if (port == 0) {
+            std::cout << byte << std::flush;
+        }
+    };
+
+    // runs on past a HLT, which is idle time
+    Pacer pacer(*cpu, frequency);
+    const auto start = std::chrono::steady_clock::now();
+    const std::clock_t cpu_start = std::clock();
+    const std::size_t cycles = pacer.runFor(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double>(seconds)));
+    const std::clock_t cpu_end = std::clock();
+    const auto end = std::chrono::steady_clock::now();
+
+    const double wall = std::chrono::duration<double>(end - start).count();
+    const double used = double(cpu_end - cpu_start) / CLOCKS_PER_SEC;
+    const Pacer::Statistics stats = pacer.statistics();
+    std::cout << std::endl
+              << cycles << " cycles in " << wall << " s: "
+              << cycles / wall / 1e6 << " MHz" << std::endl
+              << stats.slices << " slices (" << stats.idle_slices
+              << " idle), " << stats.resyncs << " resyncs, last slice "
+              << stats.slice_ns / 1e3 << " us" << std::endl
+              << "Jitter: mean " << stats.jitter_mean_ns / 1e3
+              << " us, stddev " << stats.jitter_stddev_ns / 1e3
+              << " us, max " << stats.jitter_max_ns / 1e3 << " us"
+              << std::endl
+              << "Host CPU: " << 100 * used / wall << "% ("
+              << stats.sleep_ns / 1e6 << " ms sleeping, "
+              << stats.spin_ns / 1e6 << " ms spinning)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,384 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/i8085.h"
+#include "../src/peripherals.h"
+
+// ports the chips are attached at
+constexpr uint8_t pic_port = 0x20;
+constexpr uint8_t usart_port = 0x30;
+constexpr uint8_t pit_port = 0x40;
+constexpr uint8_t ppi_port = 0x50;
+
+// programs the 8259 and the 8253 to interrupt every 1000 timer clocks,
+// counting interrupts at 0x0200
+const std::vector<uint8_t> timer_program = {
+    0x31, 0x00, 0x01, // LXI SP, 0100h
+    0x3e, 0x16,       // MVI A, 16h  ; ICW1: single, interval 4
+    0xd3, 0x20,       // OUT 20h
+    0x3e, 0x10,       // MVI A, 10h  ; ICW2: vectors at 1000h
+    0xd3, 0x21,       // OUT 21h
+    0x3e, 0xfe,       // MVI A, FEh  ; OCW1: unmask IR0
+    0xd3, 0x21,       // OUT 21h
+    0x3e, 0x34,       // MVI A, 34h  ; counter 0, mode 2
+    0xd3, 0x43,       // OUT 43h
+    0x3e, 0xe8,       // MVI A, E8h  ; 1000
+    0xd3, 0x40,       // OUT 40h
+    0x3e, 0x03,       // MVI A, 03h
+    0xd3, 0x40,       // OUT 40h
+    0xfb,             // EI
+    0x76,             // HLT
+    0xc3, 0x1b, 0x00, // JMP 001Bh
+};
+
+// the IR0 service routine at 0x1000
+const std::vector<uint8_t> timer_handler = {
+    0xf5,             // PUSH PSW
+    0x3a, 0x00, 0x02, // LDA 0200h
+    0x3c,             // INR A
+    0x32, 0x00, 0x02, // STA 0200h
+    0x3e, 0x20,       // MVI A, 20h  ; non-specific EOI
+    0xd3, 0x20,       // OUT 20h
+    0xf1,             // POP PSW
+    0xc9,             // RET
+};
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+// a CPU running NOPs to move the bus clock, with the chips attached
+struct Board {
+    Intel8080 cpu;
+    PeripheralBus bus;
+    Intel8259 pic;
+    Intel8251 usart;
+    Intel8253 pit;
+    Intel8255 ppi;
+
+    Board() : bus(cpu) {
+        cpu.memory.fill(0);
+        bus.attach(pic, pic_port, 2);
+        bus.attach(usart, usart_port, 2);
+        bus.attach(pit, pit_port, 4);
+        bus.attach(ppi, ppi_port, 4);
+        bus.setInterruptController(pic);
+    }
+
+    // port accesses as the CPU makes them
+    uint8_t in(const uint8_t port) { return cpu.in(port); }
+    void out(const uint8_t port, const uint8_t value) { cpu.out(port, value); }
+};
+
+void testUsart() {
+    auto board = std::make_unique<Board>();
+    std::string sent;
+    std::vector<uint64_t> sent_at;
+    board->usart.transmit = [&](uint8_t byte) {
+        sent += char(byte);
+        sent_at.push_back(board->bus.now());
+    };
+
+    // x16 clock, 8 data bits, no parity, 1 stop bit: 160 cycles a frame
+    board->out(usart_port + 1, 0x4e);
+    board->out(usart_port + 1, 0x05);
+    board->out(usart_port, 'H');
+    check(board->in(usart_port + 1) & Intel8251::tx_ready,
+          "8251 buffer empties into the shift register");
+    board->out(usart_port, 'I');
+    check(!(board->in(usart_port + 1) & Intel8251::tx_ready),
+          "8251 buffer full while sending");
+    board->bus.run(100);
+    check(sent.empty(), "8251 character takes a frame to send");
+    board->bus.run(300);
+    check(sent == "HI", "8251 sends characters in order");
+    check(sent_at.size() == 2 && sent_at[1] - sent_at[0] >= 160,
+          "8251 sends one character per frame");
+    check(board->in(usart_port + 1) & Intel8251::tx_empty,
+          "8251 transmitter empty");
+
+    board->usart.receive('O');
+    board->usart.receive('K');
+    board->bus.run(1000);
+    check(board->in(usart_port + 1) & Intel8251::rx_ready,
+          "8251 receives a character");
+    check(board->in(usart_port) == 'O', "8251 receives the first character");
+    check(board->in(usart_port + 1) & Intel8251::rx_ready,
+          "8251 holds the next character until the first is read");
+    check(board->in(usart_port) == 'K', "8251 receives the second character");
+    check(!(board->in(usart_port + 1) &
+            (Intel8251::rx_ready | Intel8251::overrun_error)),
+          "8251 flow control prevents overruns");
+
+    board->usart.flow_control = false;
+    board->usart.receive('A');
+    board->usart.receive('B');
+    board->bus.run(1000);
+    check(board->in(usart_port + 1) & Intel8251::overrun_error,
+          "8251 overrun without flow control");
+    check(board->in(usart_port) == 'B', "8251 overrun keeps the last");
+    board->out(usart_port + 1, 0x15);
+    check(!(board->in(usart_port + 1) & Intel8251::overrun_error),
+          "8251 error reset");
+
+    board->out(usart_port + 1, 0x40);
+    board->out(usart_port + 1, 0x4e);
+    board->out(usart_port + 1, 0x00);
+    board->out(usart_port, 'X');
+    board->bus.run(1000);
+    check(sent == "HI", "8251 waits for transmit enable after reset");
+}
+
+void testTimer() {
+    auto board = std::make_unique<Board>();
+
+    // mode 0 on counter 1: OUT rises 101 clocks after writing 100
+    board->out(pit_port + 3, 0x70);
+    board->out(pit_port + 1, 100);
+    board->out(pit_port + 1, 0);
+    check(!board->pit.out(1), "8253 mode 0 output low while counting");
+    board->bus.run(40);
+    board->out(pit_port + 3, 0x40);
+    const uint8_t low = board->in(pit_port + 1);
+    const uint8_t high = board->in(pit_port + 1);
+    const uint16_t latched = low | high << 8;
+    check(latched > 50 && latched < 100, "8253 counter latch");
+    board->bus.run(80);
+    check(board->pit.out(1), "8253 mode 0 output high at terminal count");
+
+    // mode 3 on counter 2: 100 rising edges in 100 periods
+    std::size_t edges = 0;
+    board->pit.output[2] = [&edges](bool level) { edges += level; };
+    board->out(pit_port + 3, 0xb6);
+    board->out(pit_port + 2, 100);
+    board->out(pit_port + 2, 0);
+    board->bus.run(10000);
+    check(edges >= 99 && edges <= 101, "8253 mode 3 square wave");
+
+    // a low gate stops the square wave with its output high
+    board->pit.setGate(2, false);
+    const std::size_t stopped = edges;
+    board->bus.run(1000);
+    check(edges == stopped && board->pit.out(2), "8253 gate stops mode 3");
+    board->pit.setGate(2, true);
+    board->bus.run(1000);
+    check(edges > stopped, "8253 gate restarts mode 3");
+
+    // BCD counts on counter 0, and the 8254 read-back status
+    board->out(pit_port + 3, 0x31);
+    board->out(pit_port, 0x00);
+    board->out(pit_port, 0x10);
+    board->bus.run(100);
+    board->out(pit_port + 3, 0xc2);
+    const uint8_t status = board->in(pit_port);
+    const uint16_t bcd = board->in(pit_port) | board->in(pit_port) << 8;
+    check(status == 0x31, "8254 read-back status");
+    check(bcd > 0x0800 && bcd < 0x1000 && (bcd & 0x0f) <= 9,
+          "8253 BCD count");
+
+    // mode 1 waits for a rising edge on GATE
+    board->pit.setGate(1, false);
+    board->out(pit_port + 3, 0x72);
+    board->out(pit_port + 1, 50);
+    board->out(pit_port + 1, 0);
+    board->bus.run(100);
+    check(board->pit.out(1), "8253 mode 1 waits for its trigger");
+    board->pit.setGate(1, true);
+    board->bus.run(20);
+    check(!board->pit.out(1), "8253 mode 1 output low once triggered");
+    board->bus.run(60);
+    check(board->pit.out(1), "8253 mode 1 output high at terminal count");
+}
+
+void testParallel() {
+    auto board = std::make_unique<Board>();
+    std::vector<uint8_t> outputs[3];
+    for (std::size_t port = 0; port < 3; ++port) {
+        board->ppi.output[port] = [&outputs, port](uint8_t value) {
+            outputs[port].push_back(value);
+        };
+    }
+    board->ppi.input[2] = [] { return uint8_t(0xa5); };
+
+    // A and B outputs, C inputs
+    board->out(ppi_port + 3, 0x89);
+    board->out(ppi_port, 0x55);
+    check(outputs[0].size() == 2 && outputs[0].back() == 0x55,
+          "8255 port A output");
+    check(board->in(ppi_port + 2) == 0xa5, "8255 port C input");
+    check(board->in(ppi_port) == 0x55, "8255 reads back output latch");
+    check(outputs[2].empty(), "8255 input port drives no output");
+
+    // C upper output, C lower input, set and reset bits
+    board->out(ppi_port + 3, 0x81);
+    board->out(ppi_port + 3, 0x0f);
+    check(board->ppi.latch(2) == 0x80, "8255 bit set");
+    check(board->in(ppi_port + 2) == 0x85, "8255 port C halves");
+    board->out(ppi_port + 3, 0x0e);
+    check(outputs[2].back() == 0x00, "8255 bit reset");
+}
+
+void testInterruptController() {
+    auto board = std::make_unique<Board>();
+    Intel8259 &pic = board->pic;
+
+    // interval 8, vectors at 0x2000, all lines unmasked
+    board->out(pic_port, 0x12);
+    board->out(pic_port + 1, 0x20);
+    board->out(pic_port + 1, 0x00);
+
+    pic.setInput(3, true);
+    pic.setInput(1, true);
+    check(pic.interruptRequested(), "8259 requests an interrupt");
+    check(pic.acknowledge() == 0x2008, "8259 IR1 first");
+    check(!pic.interruptRequested(), "8259 IR3 waits for IR1 in service");
+    board->out(pic_port, 0x0b);
+    check(board->in(pic_port) == 0x02, "8259 reads ISR");
+    board->out(pic_port, 0x20);
+    check(pic.acknowledge() == 0x2018, "8259 IR3 after EOI");
+    board->out(pic_port, 0x63);
+    check(board->in(pic_port) == 0x00, "8259 specific EOI");
+
+    board->out(pic_port + 1, 0x20);
+    pic.setInput(5, true);
+    check(!pic.interruptRequested(), "8259 masked line");
+    check(board->in(pic_port + 1) == 0x20, "8259 reads IMR");
+    board->out(pic_port + 1, 0x00);
+    check(pic.interruptRequested(), "8259 unmasked line");
+    board->out(pic_port, 0x0c);
+    check(board->in(pic_port) == 0x85, "8259 poll");
+    board->out(pic_port, 0x20);
+
+    // IR2 lowest, so IR6 wins over IR1
+    board->out(pic_port, 0xc2);
+    pic.setInput(6, true);
+    pic.setInput(1, false);
+    pic.setInput(1, true);
+    check(pic.acknowledge() == 0x2030, "8259 rotated priority");
+}
+
+void testTimerInterrupts() {
+    auto board = std::make_unique<Board>();
+    std::copy(timer_program.begin(), timer_program.end(),
+              board->cpu.memory.begin());
+    std::copy(timer_handler.begin(), timer_handler.end(),
+              board->cpu.memory.begin() + 0x1000);
+    board->pit.cycles_per_clock = 2;
+    board->pit.output[0] = [&board](bool level) {
+        board->pic.setInput(0, level);
+    };
+
+    // one interrupt every 2000 cycles
+    board->bus.run(2000000);
+    const uint8_t count = board->cpu.memory[0x0200];
+    check(count == 1000 % 256 || count == 999 % 256,
+          "8253 interrupts through the 8259");
+}
+
+void testHalt() {
+    // HLT; MVI A, 42h: the bus waits for an interrupt instead
+    auto board = std::make_unique<Board>();
+    board->cpu.memory[0] = 0x76;
+    board->cpu.memory[1] = 0x3e;
+    board->cpu.memory[2] = 0x42;
+    board->cpu.register_A = 0;
+    check(board->bus.run(1000) == 1000 && board->cpu.halted &&
+              board->cpu.program_counter == 0x0001 &&
+              board->cpu.register_A == 0,
+          "HLT stops the CPU on the bus");
+
+    // EI; HLT, woken by the timer's one shot through the 8259, whose
+    // CALL to a HLT at 1000h takes 17 cycles
+    board = std::make_unique<Board>();
+    board->cpu.memory[0] = 0xfb;
+    board->cpu.memory[1] = 0x76;
+    board->cpu.memory[0x1000] = 0x76;
+    board->cpu.stack_pointer = 0x0100;
+    board->pit.output[0] = [&board](bool level) {
+        board->pic.setInput(0, level);
+    };
+    board->out(pic_port, 0x16);
+    board->out(pic_port + 1, 0x10);
+    board->out(pic_port + 1, 0xfe);
+    board->out(pit_port + 3, 0x30);
+    board->out(pit_port, 100);
+    board->out(pit_port, 0);
+    check(board->bus.run(1000) == 1000 && board->cpu.halted &&
+              board->cpu.program_counter == 0x1001 &&
+              board->cpu.memory[0x00fe] == 0x02,
+          "EI; HLT woken by the 8259");
+    check(board->cpu.cycle_count == 4 + 7 + 17 + 7, "8259 CALL cycles");
+
+    // a halted 8085 takes a TRAP raised by a chip, here to MVI A, 42h;
+    // HLT at 0024h
+    auto cpu = std::make_unique<Intel8085>();
+    cpu->memory.fill(0);
+    cpu->memory[0] = 0x76;
+    cpu->memory[0x24] = 0x3e;
+    cpu->memory[0x25] = 0x42;
+    cpu->memory[0x26] = 0x76;
+    cpu->interrupts_enabled = false;
+    PeripheralBus bus(*cpu);
+    Intel8253 pit;
+    bus.attach(pit, pit_port, 4);
+    pit.output[0] = [&cpu](bool level) {
+        if (level) {
+            cpu->trap();
+        }
+    };
+    cpu->out(pit_port + 3, 0x30);
+    cpu->out(pit_port, 100);
+    cpu->out(pit_port, 0);
+    check(bus.run(1000) == 1000 && cpu->halted &&
+              cpu->program_counter == 0x0027 && cpu->register_A == 0x42,
+          "halted 8085 takes TRAP from a chip");
+}
+
+// JMP to itself forever, with the timer interrupts masked
+double benchmark(const bool with_bus, const std::size_t cycles) {
+    auto board = std::make_unique<Board>();
+    const uint8_t loop[] = {0xf3, 0xc3, 0x01, 0x00};
+    std::copy(std::begin(loop), std::end(loop), board->cpu.memory.begin());
+    board->pit.output[0] = [&board](bool level) {
+        board->pic.setInput(0, level);
+    };
+    board->out(pit_port + 3, 0x34);
+    board->out(pit_port, 0xe8);
+    board->out(pit_port, 0x03);
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t ran =
+        with_bus ? board->bus.run(cycles) : board->cpu.execute(cycles);
+    const auto end = std::chrono::steady_clock::now();
+    return ran / std::chrono::duration<double>(end - start).count() / 1e6;
+}
+
+int main() {
+    testUsart();
+    testTimer();
+    testParallel();
+    testInterruptController();
+    testTimerInterrupts();
+    testHalt();
+
+    constexpr std::size_t cycles = 200000000;
+    std::cout << "CPU alone:      " << benchmark(false, cycles) << " MHz"
+              << std::endl;
+    std::cout << "With the timer: " << benchmark(true, cycles) << " MHz"
+              << std::endl;
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All peripheral checks passed" << std::endl;
+    return 0;
+}
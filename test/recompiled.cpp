@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../src/recompiled.h"
+
+// generated from test/com by tools/recompile
+extern const RecompiledProgram program_cputest;
+extern const RecompiledProgram program_8080exer;
+extern const RecompiledProgram program_copy;
+
+// assembled test/BDOS.ASM file
+const std::array<uint8_t, 0x22> bdos = {
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00
+};
+
+struct Result {
+    std::string output;
+    std::size_t cycles;
+    double seconds;
+};
+
+template <class CPU> Result run(CPU &cpu, const RecompiledProgram &program) {
+    std::copy(bdos.begin(), bdos.end(), cpu.memory.begin());
+    std::memcpy(cpu.memory.data() + program.origin, program.image,
+                program.image_size);
+    cpu.program_counter = program.origin;
+
+    Result result;
+    cpu.out = [&result](uint8_t port, uint8_t byte) {
+        if (port == 0) {
+            result.output += byte;
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    result.cycles = cpu.execute();
+    const auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return result;
+}
+
+/**
+ * Run COPY.COM, which calls a translated routine printing 1, then a copy
+ * loop at 8000h outside the image, then the routine again. The loop is
+ * interpreted and run as a native block copy over the routine, which must
+ * then print 2.
+ * Returns: True if the copied code ran
+ */
+bool copiesOverTranslated() {
+    // LXI D, 8100h or LXI H, 8100h, then the other to 0110h; LXI B, 2;
+    // LDAX D; MOV M, A or MOV A, M; STAX D, then INX H; INX D; DCX B;
+    // MOV A, B; ORA C; JNZ 8009h; RET
+    const std::array<std::array<uint8_t, 2>, 2> loads = {
+        {{0x11, 0x21}, {0x21, 0x11}}};
+    const std::array<std::array<uint8_t, 2>, 2> moves = {
+        {{0x1a, 0x77}, {0x7e, 0x12}}};
+    bool copied = true;
+    for (std::size_t i = 0; i < loads.size(); ++i) {
+        auto cpu = std::make_unique<RecompiledIntel8080>(program_copy);
+        const std::array<uint8_t, 20> loop = {
+            loads[i][0], 0x00, 0x81, loads[i][1], 0x10, 0x01, 0x01, 0x02,
+            0x00, moves[i][0], moves[i][1], 0x23, 0x13, 0x0b, 0x78, 0xb1,
+            0xc2, 0x09, 0x80, 0xc9};
+        std::copy(loop.begin(), loop.end(), cpu->memory.begin() + 0x8000);
+        // MVI A, 2
+        cpu->memory[0x8100] = 0x3e;
+        cpu->memory[0x8101] = 0x02;
+
+        const Result result = run(*cpu, program_copy);
+        copied &= result.output == std::string("\x01\x02") &&
+                  cpu->translated_cycles > 0;
+    }
+    return copied;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cout << "usage: test-recompiled [cputest|8080exer]" << std::endl;
+        return 1;
+    }
+
+    const std::string name = argv[1];
+    const RecompiledProgram *program = name == "cputest"    ? &program_cputest
+                                       : name == "8080exer" ? &program_8080exer
+                                                            : nullptr;
+    if (!program) {
+        std::cout << "unknown program " << name << std::endl;
+        return 1;
+    }
+
+    if (!copiesOverTranslated()) {
+        std::cout << "Block copy over translated code not seen" << std::endl;
+        return 1;
+    }
+
+    // the two are too large for the stack
+    auto interpreter = std::make_unique<Intel8080>();
+    auto recompiled = std::make_unique<RecompiledIntel8080>(*program);
+    const Result expected = run(*interpreter, *program);
+    const Result actual = run(*recompiled, *program);
+
+    std::cout << actual.output << std::endl;
+    std::cout << "Interpreter: " << expected.cycles << " cycles, "
+              << expected.cycles / expected.seconds / 1e6 << " MHz"
+              << std::endl;
+    std::cout << "Recompiled:  " << actual.cycles << " cycles, "
+              << actual.cycles / actual.seconds / 1e6 << " MHz ("
+              << recompiled->interpreted_cycles << " cycles interpreted)"
+              << std::endl;
+
+    if (actual.output != expected.output || actual.cycles != expected.cycles) {
+        std::cout << "MISMATCH" << std::endl;
+        return 1;
+    }
+    std::cout << "Output and cycles match" << std::endl;
+    return 0;
+}
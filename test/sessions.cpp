@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/session_server.h"
+
+/**
+ * Checks the session server and measures it with test/asm/echo.asm,
+ * which echoes what is typed and, for '!', computes for about 18M cycles
+ * before printing '*'.
+ *
+ * Interactive clients type a key ten times a second each and time the
+ * echo. Busy clients send '!' again whenever '*' arrives, keeping
+ * sessions runnable to show that quotas keep the echoes quick.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double keys_per_second = 10;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+int connectTo(const std::string &path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void send(const int fd, const std::string &text) {
+    if (write(fd, text.data(), text.size()) != ssize_t(text.size())) {
+        std::cout << "cannot write to session" << std::endl;
+    }
+}
+
+// read until the text has arrived, the session closes or a second passes
+std::string expect(const int fd, const std::size_t length) {
+    std::string text;
+    timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char buffer[256];
+    while (text.size() < length) {
+        const ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            break;
+        }
+        text.append(buffer, size);
+    }
+    return text;
+}
+
+void testSession(const std::string &path, SessionServer &server) {
+    const int fd = connectTo(path);
+    check(fd >= 0, "connect");
+    send(fd, "hi");
+    check(expect(fd, 2) == "hi", "echo");
+    send(fd, "!");
+    check(expect(fd, 2) == "!*", "compute");
+
+    // a waiting session is parked and uses no CPU
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint64_t busy = server.statistics().busy_ns;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(server.statistics().busy_ns == busy, "parked session idle");
+
+    // Ctrl-C returns to CP/M, which ends the session
+    send(fd, "\x03");
+    check(expect(fd, 2) == "\x03", "session ends");
+    close(fd);
+}
+
+/**
+ * Send as much as the socket takes within a tenth of a second
+ * Returns: The bytes sent
+ */
+std::size_t flood(const int fd, const std::size_t length) {
+    const std::string data(length, 'a');
+    std::size_t sent = 0;
+    const auto give_up = Clock::now() + std::chrono::milliseconds(100);
+    while (sent < length && Clock::now() < give_up) {
+        const ssize_t size = ::send(fd, data.data() + sent, length - sent,
+                                    MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (size > 0) {
+            sent += size;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return sent;
+}
+
+void testInputLimit(const std::string &path) {
+    SessionServer::Settings settings;
+    settings.max_input = 1024;
+
+    // JMP 0100h never reads, so the client is held back once the server
+    // has max_input bytes and the socket buffers are full
+    SessionServer spinning({0xc3, 0x00, 0x01}, settings);
+    check(spinning.listen(path), "listen with an input limit");
+    std::thread serving([&] { spinning.run(); });
+    int fd = connectTo(path);
+    const int buffer_size = 4096;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    const std::size_t sent = flood(fd, 1 << 20);
+    check(sent < 64 * 1024 && spinning.statistics().open_sessions == 1,
+          "input limited");
+    close(fd);
+    spinning.stop();
+    serving.join();
+
+    // MVI C, 1; CALL 5; JMP 0100h echoes everything, so reading resumes
+    // as the session takes its input
+    SessionServer echoing({0x0e, 0x01, 0xcd, 0x05, 0x00, 0xc3, 0x00, 0x01},
+                          settings);
+    echoing.listen(path);
+    serving = std::thread([&] { echoing.run(); });
+    fd = connectTo(path);
+    constexpr std::size_t length = 256 * 1024;
+    std::size_t written = 0;
+    std::size_t echoed = 0;
+    const auto give_up = Clock::now() + std::chrono::seconds(10);
+    char buffer[4096];
+    while (echoed < length && Clock::now() < give_up) {
+        if (written < length) {
+            written += flood(fd, std::min<std::size_t>(length - written, 4096));
+        }
+        const ssize_t size = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (size > 0) {
+            echoed += size;
+        }
+    }
+    check(echoed == length, "input read again once taken");
+    close(fd);
+    echoing.stop();
+    serving.join();
+}
+
+struct Client {
+    int fd;
+    bool busy;
+    bool waiting = false;
+    Clock::time_point sent = {};
+    std::size_t computed = 0;
+};
+
+/**
+ * Run interactive and busy sessions for a while
+ * Returns: The latencies of the echoes in microseconds
+ */
+std::vector<double> measure(const std::string &path, SessionServer &server,
+                            const std::size_t interactive,
+                            const std::size_t busy, const double seconds) {
+    std::vector<Client> clients;
+    const int epoll = epoll_create1(EPOLL_CLOEXEC);
+    for (std::size_t i = 0; i < interactive + busy; ++i) {
+        clients.push_back({connectTo(path), i >= interactive});
+    }
+    for (std::size_t i = 0; i < clients.size(); ++i) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, clients[i].fd, &event);
+        if (clients[i].busy) {
+            send(clients[i].fd, "!");
+        }
+    }
+
+    const SessionServer::Statistics before = server.statistics();
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1 / keys_per_second /
+                                      std::max<std::size_t>(interactive, 1)));
+    const auto start = Clock::now();
+    const auto end =
+        start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(seconds));
+    auto next_key = start;
+    std::size_t next_client = 0;
+    std::vector<double> latencies;
+    epoll_event events[64];
+    while (Clock::now() < end) {
+        // type keys spread evenly over the interactive sessions
+        for (auto now = Clock::now(); interactive && now >= next_key;
+             next_key += interval) {
+            Client &client = clients[next_client];
+            next_client = (next_client + 1) % interactive;
+            if (!client.waiting) {
+                client.waiting = true;
+                client.sent = now;
+                send(client.fd, "x");
+            }
+        }
+
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            next_key - Clock::now());
+        const int count =
+            epoll_wait(epoll, events, 64, std::max<int>(wait.count(), 0));
+        const auto now = Clock::now();
+        for (int i = 0; i < count; ++i) {
+            Client &client = clients[events[i].data.u64];
+            char buffer[256];
+            const ssize_t size = read(client.fd, buffer, sizeof(buffer));
+            for (ssize_t j = 0; j < size; ++j) {
+                if (buffer[j] == 'x' && client.waiting) {
+                    client.waiting = false;
+                    latencies.push_back(
+                        std::chrono::duration<double, std::micro>(
+                            now - client.sent)
+                            .count());
+                } else if (buffer[j] == '*') {
+                    ++client.computed;
+                    send(client.fd, "!");
+                }
+            }
+        }
+    }
+    const SessionServer::Statistics after = server.statistics();
+
+    // cores the pool spent running sessions, and what that serves
+    const double cores = (after.busy_ns - before.busy_ns) / 1e9 / seconds;
+    std::cout << interactive << " interactive and " << busy
+              << " busy sessions: " << cores << " cores busy";
+    if (!busy && cores > 0) {
+        std::cout << ", " << interactive / cores << " sessions per core";
+    }
+    std::cout << std::endl;
+    if (busy) {
+        std::size_t least = SIZE_MAX;
+        std::size_t most = 0;
+        for (const Client &client : clients) {
+            if (client.busy) {
+                least = std::min(least, client.computed);
+                most = std::max(most, client.computed);
+            }
+        }
+        std::cout << "    busy sessions computed " << least << " to " << most
+                  << " times" << std::endl;
+    }
+
+    for (const Client &client : clients) {
+        close(client.fd);
+    }
+    close(epoll);
+    return latencies;
+}
+
+void report(std::vector<double> latencies) {
+    if (latencies.empty()) {
+        std::cout << "    no echoes" << std::endl;
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto at = [&](const double fraction) {
+        return latencies[std::size_t(fraction * (latencies.size() - 1))];
+    };
+    std::cout << "    " << latencies.size() << " keys, echo latency "
+              << at(0.5) << " us median, " << at(0.99) << " us p99, "
+              << latencies.back() << " us max" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        std::cout << "usage: sessions [ECHO.COM] [SESSIONS] [SECONDS]"
+                  << std::endl;
+        return 1;
+    }
+    std::ifstream input(argv[1], std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        std::cout << "cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> program((std::istreambuf_iterator<char>(input)),
+                                 std::istreambuf_iterator<char>());
+    const std::size_t count = argc > 2 ? std::stoul(argv[2]) : 256;
+    const double seconds = argc > 3 ? std::stod(argv[3]) : 2;
+
+    const std::string path =
+        "/tmp/emu8080-sessions-" + std::to_string(getpid()) + ".sock";
+    SessionServer server(program);
+    if (!server.listen(path)) {
+        std::cout << "cannot listen on " << path << std::endl;
+        return 1;
+    }
+    std::thread serving([&] { server.run(); });
+
+    testSession(path, server);
+    testInputLimit(path + ".limit");
+
+    const unsigned int threads =
+        std::max(1u, std::thread::hardware_concurrency());
+    std::cout << threads << " threads" << std::endl;
+    const std::vector<double> idle = measure(path, server, count, 0, seconds);
+    report(idle);
+    check(!idle.empty(), "echoes");
+    report(measure(path, server, count, 2 * threads, seconds));
+
+    server.stop();
+    serving.join();
+    check(server.statistics().open_sessions == 0, "sessions closed");
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All session server checks passed" << std::endl;
+    return 0;
+}
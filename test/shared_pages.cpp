@@ -0,0 +1,132 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include "../src/dirty_pages.h"
+#include "../src/shared_pages.h"
+
+/**
+ * Checks SharedPages: identical pages stored once, writes kept private,
+ * pool pages freed and reused as CPUs change and detach, and that memory
+ * tracked by a DirtyPageTracker is left alone.
+ */
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+// memory filled with a pattern that differs between pages
+std::unique_ptr<Intel8080> image(const uint8_t seed) {
+    auto cpu = std::make_unique<Intel8080>();
+    for (std::size_t i = 0; i < cpu->memory.size(); ++i) {
+        cpu->memory[i] = uint8_t(seed + i / 4096 * 3);
+    }
+    return cpu;
+}
+
+bool same(const Intel8080 &a, const Intel8080 &b) {
+    return a.memory == b.memory;
+}
+
+void testSharing(SharedPages &pool, const std::size_t pages) {
+    auto first = image(1);
+    auto second = image(1);
+    auto expected = image(1);
+    check(pool.share(*first) && pool.share(*second), "shared");
+    SharedPages::Savings savings = pool.savings();
+    check(savings.instances == 2 && savings.pool_pages == pages,
+          "identical pages stored once");
+
+    second->memory[0x1234] = 0x99;
+    check(first->memory[0x1234] == expected->memory[0x1234],
+          "writes stay private");
+    expected->memory[0x1234] = 0x99;
+    check(same(*second, *expected), "written memory");
+
+    // re-sharing stores the written page, and the old one stays for first
+    check(pool.share(*second), "shared again");
+    check(pool.savings().pool_pages == pages + 1, "written page stored");
+    expected->memory[0x1234] = image(1)->memory[0x1234];
+    check(same(*first, *expected), "other CPU unchanged");
+
+    check(pool.detach(*first) && pool.detach(*second), "detached");
+    check(pool.savings().pool_pages == 0, "detached pages freed");
+    expected->memory[0x1234] = 0x99;
+    check(same(*second, *expected), "contents kept on detach");
+}
+
+void testReuse(SharedPages &pool, const std::size_t pages) {
+    // a CPU that keeps changing one page does not grow the pool
+    auto cpu = image(7);
+    auto other = image(7);
+    check(pool.share(*cpu) && pool.share(*other), "shared");
+    for (int i = 0; i < 1000; ++i) {
+        cpu->memory[0x2000] = uint8_t(i);
+        cpu->memory[0x2001] = uint8_t(i >> 8);
+        if (!pool.share(*cpu)) {
+            check(false, "shared while changing");
+            break;
+        }
+    }
+    check(pool.savings().pool_pages == pages + 1,
+          "changed pages freed and reused");
+    check(cpu->memory[0x2000] == uint8_t(999) &&
+              cpu->memory[0x2001] == uint8_t(999 >> 8) &&
+              other->memory[0x2000] == image(7)->memory[0x2000],
+          "contents after reuse");
+
+    // the pages other still maps are not freed with cpu's
+    auto expected = image(7);
+    check(pool.detach(*cpu) && same(*other, *expected),
+          "pages still mapped stay");
+    check(pool.detach(*other) && pool.savings().pool_pages == 0,
+          "all pages freed");
+}
+
+void testTracked(SharedPages &pool) {
+    auto cpu = image(3);
+    {
+        DirtyPageTracker tracker(*cpu);
+        check(!pool.share(*cpu), "tracked memory not shared");
+        cpu->memory[0x6000] = 1;
+        check(!tracker.isActive() || tracker.isDirty(0x6000),
+              "tracking kept");
+    }
+    check(pool.share(*cpu), "shared once untracked");
+    {
+        DirtyPageTracker tracker(*cpu);
+        check(!pool.detach(*cpu), "tracked memory not detached");
+        cpu->memory[0x6000] = 2;
+        check(!tracker.isActive() || tracker.isDirty(0x6000),
+              "tracking shared memory");
+    }
+    check(pool.detach(*cpu) && cpu->memory[0x6000] == 2, "detached");
+}
+
+int main() {
+    SharedPages pool;
+    const long page_size = sysconf(_SC_PAGESIZE);
+    auto probe = std::make_unique<Intel8080>();
+    if (reinterpret_cast<uintptr_t>(probe->memory.data()) % page_size) {
+        // built without EMU8080_PAGE_ALIGNED
+        check(!pool.share(*probe), "unaligned memory not shared");
+    } else {
+        check(pool.isOpen(), "pool created");
+        testSharing(pool, 0x10000 / page_size);
+        testReuse(pool, 0x10000 / page_size);
+        testTracked(pool);
+    }
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All shared page checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/translation_cache.h"
+
+/**
+ * Checks TranslationCache: lookups and stores of multi-entry results,
+ * misses for changed images and contexts, sharing through the file,
+ * least recently used eviction, torn records and layout resets.
+ */
+
+using Entry = TranslationCache::Entry;
+
+std::size_t failures = 0;
+
+void check(const bool passed, const std::string &name) {
+    if (!passed) {
+        std::cout << "FAILED: " << name << std::endl;
+        ++failures;
+    }
+}
+
+const std::string path =
+    "/tmp/emu8080-translation-cache-" + std::to_string(getpid());
+
+std::vector<uint8_t> image(const std::size_t size, const uint8_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        bytes[i] = seed + i * 7;
+    }
+    return bytes;
+}
+
+std::vector<Entry> result(const std::size_t count, const uint8_t fill) {
+    std::vector<Entry> entries(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        entries[i].fill(fill + i);
+    }
+    return entries;
+}
+
+void testLookup() {
+    unlink(path.c_str());
+    TranslationCache cache(path);
+    check(cache.isOpen(), "cache opened");
+
+    const std::vector<uint8_t> program = image(600, 1);
+    std::vector<Entry> found;
+    check(!cache.lookup(program.data(), program.size(), 5, found),
+          "empty cache misses");
+    cache.store(program.data(), program.size(), 5, result(3, 0x10));
+    check(cache.lookup(program.data(), program.size(), 5, found) &&
+              found == result(3, 0x10),
+          "stored result found");
+
+    // any change to the image or the context is another result
+    std::vector<uint8_t> changed = program;
+    changed[599] ^= 1;
+    check(!cache.lookup(changed.data(), changed.size(), 5, found),
+          "changed image misses");
+    check(!cache.lookup(program.data(), program.size() - 1, 5, found),
+          "prefix of the image misses");
+    check(!cache.lookup(program.data(), program.size(), 6, found),
+          "changed context misses");
+
+    // a store replaces the older result in place
+    cache.store(program.data(), program.size(), 5, result(3, 0x20));
+    check(cache.lookup(program.data(), program.size(), 5, found) &&
+              found == result(3, 0x20),
+          "result replaced");
+
+    const TranslationCache::Counters counters = cache.counters();
+    check(counters.hits == 2 && counters.misses == 4 &&
+              counters.stores == 2 && counters.evictions == 0,
+          "counters");
+
+    // another mapping of the file sees the stores
+    TranslationCache other(path);
+    check(other.lookup(program.data(), program.size(), 5, found) &&
+              found == result(3, 0x20),
+          "result shared through the file");
+}
+
+void testEviction() {
+    // one set of eight records
+    unlink(path.c_str());
+    TranslationCache cache(path, 8);
+    std::vector<std::vector<uint8_t>> programs;
+    for (uint8_t i = 0; i < 9; ++i) {
+        programs.push_back(image(100, i));
+    }
+    std::vector<Entry> found;
+    for (uint8_t i = 0; i < 8; ++i) {
+        cache.store(programs[i].data(), 100, 0, result(1, i));
+    }
+    check(cache.counters().evictions == 0, "set filled without eviction");
+
+    // using the first makes the second the least recently used
+    cache.lookup(programs[0].data(), 100, 0, found);
+    cache.store(programs[8].data(), 100, 0, result(1, 8));
+    check(cache.counters().evictions == 1, "full set evicts");
+    check(cache.lookup(programs[0].data(), 100, 0, found) &&
+              found == result(1, 0),
+          "recently used kept");
+    check(!cache.lookup(programs[1].data(), 100, 0, found),
+          "least recently used evicted");
+    check(cache.lookup(programs[8].data(), 100, 0, found) &&
+              found == result(1, 8),
+          "new result stored");
+
+    // losing one record of a result loses all of it
+    cache.store(programs[1].data(), 100, 0, result(2, 0x30));
+    for (uint8_t i = 2; i < 9; ++i) {
+        cache.store(programs[i].data(), 100, 0, result(1, i));
+    }
+    check(!cache.lookup(programs[1].data(), 100, 0, found),
+          "partly evicted result misses");
+
+    // a result larger than the cache is not stored
+    const std::size_t stores = cache.counters().stores;
+    cache.store(programs[0].data(), 100, 1, result(9, 0));
+    check(cache.counters().stores == stores &&
+              !cache.lookup(programs[0].data(), 100, 1, found),
+          "oversized result not stored");
+}
+
+void testTorn() {
+    unlink(path.c_str());
+    const std::vector<uint8_t> program = image(200, 3);
+    {
+        TranslationCache cache(path, 8);
+        cache.store(program.data(), program.size(), 0, result(1, 0xa5));
+    }
+
+    // change one byte of the stored entry, as a concurrent store would
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    const std::vector<char> entry(TranslationCache::entry_size, char(0xa5));
+    const auto at =
+        std::search(bytes.begin(), bytes.end(), entry.begin(), entry.end());
+    check(at != bytes.end(), "entry found in the file");
+    file.clear();
+    file.seekp(at - bytes.begin() + 17);
+    file.put(0x5a);
+    file.close();
+
+    TranslationCache cache(path, 8);
+    std::vector<Entry> found;
+    check(!cache.lookup(program.data(), program.size(), 0, found),
+          "torn record misses");
+}
+
+void testReset() {
+    unlink(path.c_str());
+    const std::vector<uint8_t> program = image(50, 4);
+    std::vector<Entry> found;
+    {
+        TranslationCache cache(path, 8);
+        cache.store(program.data(), program.size(), 0, result(1, 1));
+    }
+    {
+        TranslationCache cache(path, 8);
+        check(cache.lookup(program.data(), program.size(), 0, found),
+              "same layout kept");
+    }
+    TranslationCache cache(path, 16);
+    check(cache.isOpen() &&
+              !cache.lookup(program.data(), program.size(), 0, found),
+          "other capacity starts over");
+
+    // a cache that cannot be opened misses and ignores stores
+    TranslationCache closed("/nonexistent/emu8080.cache");
+    closed.store(program.data(), program.size(), 0, result(1, 1));
+    check(!closed.isOpen() &&
+              !closed.lookup(program.data(), program.size(), 0, found),
+          "unopened cache is empty");
+}
+
+int main() {
+    testLookup();
+    testEviction();
+    testTorn();
+    testReset();
+    unlink(path.c_str());
+
+    if (failures) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All translation cache checks passed" << std::endl;
+    return 0;
+}
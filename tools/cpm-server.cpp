@@ -0,0 +1,71 @@
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/session_server.h"
+
+/**
+ * Serves CP/M sessions running a COM program on a Unix domain socket,
+ * see src/session_server.h. Connect with, for example:
+ *
+ *     socat -,raw,echo=0 UNIX-CONNECT:SOCKET
+ *
+ * Runs until interrupted, then prints the server's counters.
+ */
+
+namespace {
+
+SessionServer *running = nullptr;
+
+void interrupted(int) {
+    if (running) {
+        running->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 5) {
+        std::cerr << "usage: cpm-server [SOCKET] [COM] [THREADS] [QUOTA]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[2], std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        std::cerr << "cannot open " << argv[2] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> program((std::istreambuf_iterator<char>(input)),
+                                 std::istreambuf_iterator<char>());
+
+    SessionServer::Settings settings;
+    if (argc > 3) {
+        settings.threads = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        settings.quota = std::stoul(argv[4]);
+    }
+    SessionServer server(program, settings);
+    if (!server.listen(argv[1])) {
+        std::cerr << "cannot listen on " << argv[1] << std::endl;
+        return 1;
+    }
+
+    running = &server;
+    std::signal(SIGINT, interrupted);
+    std::signal(SIGTERM, interrupted);
+    server.run();
+    running = nullptr;
+
+    const SessionServer::Statistics stats = server.statistics();
+    std::cout << stats.sessions << " sessions, " << stats.slices
+              << " slices, " << stats.cycles << " cycles in "
+              << stats.busy_ns / 1e9 << " s" << std::endl
+              << stats.parks << " parks, " << stats.wakeups << " wakeups"
+              << std::endl;
+    return 0;
+}
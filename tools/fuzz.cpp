@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/cpu.h"
+
+/**
+ * Coverage-guided fuzzer for COM programs that read their input with IN.
+ *
+ * The program runs until its first IN and that state is kept as a
+ * snapshot. Each execution restores the snapshot, answers every IN with
+ * the next byte of a mutated input and ends when the input runs out, the
+ * program warm boots by jumping to 0 or halts, or after a cycle limit.
+ * Inputs that reach an edge, or an edge hit count bucket, not seen before
+ * join the corpus. Inputs that halt or hit the cycle limit are reported.
+ *
+ * Needs a build with EMU8080_COVERAGE.
+ */
+
+namespace {
+
+constexpr uint16_t origin = 0x100;
+
+// an execution running longer than this is reported as a hang
+constexpr std::size_t cycle_limit = 1000000;
+constexpr std::size_t max_input = 256;
+
+const std::array<uint8_t, 9> interesting = {0x00, 0x01, 0x7f, 0x80, 0xff,
+                                            0x0a, 0x0d, 0x20, 0x30};
+
+enum class Outcome { exhausted, exited, halted, hung };
+
+class Fuzzer {
+  public:
+    explicit Fuzzer(const std::vector<uint8_t> &image);
+
+    /**
+     * Fuzz until the time is up, printing progress every second
+     */
+    void run(const double seconds);
+
+  private:
+    std::unique_ptr<Intel8080> cpu;
+    std::unique_ptr<Intel8080> snapshot;
+    std::vector<uint8_t> coverage =
+        std::vector<uint8_t>(Intel8080::coverage_size);
+    // hit count buckets seen in any execution so far, per edge
+    std::vector<uint8_t> seen =
+        std::vector<uint8_t>(Intel8080::coverage_size);
+
+    std::vector<std::vector<uint8_t>> corpus = {{}};
+    std::vector<uint8_t> input;
+    std::size_t position = 0;
+    std::mt19937_64 generator{0x8080};
+
+    std::size_t executions = 0;
+    std::size_t edges = 0;
+    std::size_t halts = 0;
+    std::size_t hangs = 0;
+
+    Outcome execute();
+    bool newCoverage();
+    void mutate();
+    void report(const char *finding) const;
+};
+
+Fuzzer::Fuzzer(const std::vector<uint8_t> &image)
+    : cpu(std::make_unique<Intel8080>()) {
+    cpu->memory.fill(0);
+    std::copy(image.begin(), image.end(), cpu->memory.begin() + origin);
+    // warm boot halts, BDOS calls return at once
+    cpu->memory[0x0000] = 0x76;
+    cpu->memory[0x0005] = 0xc9;
+    cpu->program_counter = origin;
+    cpu->in = [this](uint8_t) -> uint8_t {
+        if (position >= input.size()) {
+            // ends the execution, see execute()
+            cpu->halted = true;
+            position = input.size() + 1;
+            return 0;
+        }
+        return input[position++];
+    };
+    cpu->out = [](uint8_t, uint8_t) {};
+
+    // boot up to the first read of input
+    std::size_t cycles = 0;
+    while (!cpu->halted && cpu->memory[cpu->program_counter] != 0xdb &&
+           cycles < cycle_limit) {
+        cycles += cpu->step();
+    }
+    cpu->coverage_map = coverage.data();
+    snapshot = std::make_unique<Intel8080>(*cpu);
+}
+
+void Fuzzer::run(const double seconds) {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    auto next_report = start + std::chrono::seconds(1);
+
+    for (std::size_t round = 0;; ++round) {
+        // check the time every few executions
+        if (round % 256 == 0) {
+            const auto now = clock::now();
+            const double elapsed =
+                std::chrono::duration<double>(now - start).count();
+            if (now >= next_report || elapsed >= seconds) {
+                std::printf("%8.1f s  %10zu execs  %9.0f execs/s  %5zu corpus"
+                            "  %5zu edges  %zu halts  %zu hangs\n",
+                            elapsed, executions, executions / elapsed,
+                            corpus.size(), edges, halts, hangs);
+                next_report += std::chrono::seconds(1);
+            }
+            if (elapsed >= seconds) {
+                return;
+            }
+        }
+
+        input = corpus[generator() % corpus.size()];
+        mutate();
+        const Outcome outcome = execute();
+        const bool found = newCoverage();
+        if (outcome == Outcome::halted) {
+            ++halts;
+            if (found) {
+                report("halt");
+            }
+        } else if (outcome == Outcome::hung) {
+            ++hangs;
+            if (found) {
+                report("hang");
+            }
+        }
+        if (found) {
+            corpus.push_back(input);
+        }
+    }
+}
+
+Outcome Fuzzer::execute() {
+    *cpu = *snapshot;
+    position = 0;
+    ++executions;
+
+    std::size_t cycles = 0;
+    while (!cpu->halted && cycles < cycle_limit) {
+        cycles += cpu->step();
+    }
+    if (position > input.size()) {
+        return Outcome::exhausted;
+    }
+    if (!cpu->halted) {
+        return Outcome::hung;
+    }
+    return cpu->program_counter == 0x0001 ? Outcome::exited : Outcome::halted;
+}
+
+bool Fuzzer::newCoverage() {
+    // clears the map for the next execution as it goes
+    bool found = false;
+    for (std::size_t i = 0; i < coverage.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, &coverage[i], sizeof(word));
+        if (word == 0) {
+            continue;
+        }
+        for (std::size_t j = i; j < i + sizeof(uint64_t); ++j) {
+            if (coverage[j] == 0) {
+                continue;
+            }
+            // hit counts bucketed as 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+            const uint8_t hits = coverage[j];
+            const uint8_t bucket = hits <= 3    ? 1 << (hits - 1)
+                                   : hits < 8   ? 0x08
+                                   : hits < 16  ? 0x10
+                                   : hits < 32  ? 0x20
+                                   : hits < 128 ? 0x40
+                                                : 0x80;
+            if (!(seen[j] & bucket)) {
+                edges += seen[j] == 0;
+                seen[j] |= bucket;
+                found = true;
+            }
+        }
+        std::memset(&coverage[i], 0, sizeof(word));
+    }
+    return found;
+}
+
+void Fuzzer::mutate() {
+    const std::size_t count = 1 + generator() % 4;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t at = input.empty() ? 0 : generator() % input.size();
+        switch (input.empty() ? 4 : generator() % 7) {
+        case 0: // flip a bit
+            input[at] ^= 1 << (generator() % 8);
+            break;
+        case 1: // random byte
+            input[at] = generator();
+            break;
+        case 2: // interesting byte
+            input[at] = interesting[generator() % interesting.size()];
+            break;
+        case 3: // small addition or subtraction
+            input[at] += int(generator() % 35) - 17;
+            break;
+        case 4: // insert a byte
+            if (input.size() < max_input) {
+                input.insert(input.begin() + (input.empty() ? 0 : at),
+                             uint8_t(generator()));
+            }
+            break;
+        case 5: // delete a byte
+            input.erase(input.begin() + at);
+            break;
+        case 6: { // splice in part of another input
+            const std::vector<uint8_t> &other =
+                corpus[generator() % corpus.size()];
+            if (!other.empty()) {
+                const std::size_t from = generator() % other.size();
+                const std::size_t length =
+                    std::min(other.size() - from, max_input - at);
+                input.resize(std::max(input.size(), at + length));
+                std::copy_n(other.begin() + from, length, input.begin() + at);
+            }
+            break;
+        }
+        }
+    }
+}
+
+void Fuzzer::report(const char *finding) const {
+    std::printf("%s at 0x%04x after %zu execs, input:", finding,
+                cpu->program_counter, executions);
+    for (const uint8_t byte : input) {
+        std::printf(" %02x", byte);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "usage: fuzz [COM] [SECONDS]" << std::endl;
+        return 1;
+    }
+    if constexpr (!Intel8080::coverage_enabled) {
+        std::cerr << "fuzz needs a build with EMU8080_COVERAGE" << std::endl;
+        return 1;
+    }
+    const double seconds = argc == 3 ? std::stod(argv[2]) : 10;
+
+    std::ifstream input(argv[1], std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(input)),
+                               std::istreambuf_iterator<char>());
+    image.resize(std::min<std::size_t>(image.size(), 0x10000 - origin));
+
+    Fuzzer fuzzer(image);
+    fuzzer.run(seconds);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/cpu.h"
+#include "../src/heatmap.h"
+
+/**
+ * Runs a COM program with the BDOS of the test harness and records how
+ * it touches memory, see src/heatmap.h. Writes PREFIX-pages.csv,
+ * PREFIX-bytes.csv, PREFIX-working-set.csv and PREFIX.ppm, and prints a
+ * summary with the self-modifying code sites.
+ *
+ * Needs a build with EMU8080_HEATMAP.
+ */
+
+namespace {
+
+// assembled test/BDOS.ASM file
+const std::array<uint8_t, 0x22> bdos = {
+    0x76, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x02, 0xb9,
+    0xca, 0x14, 0x00, 0x3e, 0x09, 0xb9, 0xca, 0x18,
+    0x00, 0xc3, 0x00, 0x00, 0x7b, 0xd3, 0x00, 0xc9,
+    0x1a, 0xfe, 0x24, 0xc8, 0xd3, 0x00, 0x13, 0xc3,
+    0x18, 0x00
+};
+
+// the most self-modifying code sites printed
+constexpr std::size_t sites_shown = 16;
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "usage: heatmap [COM] [OUTPUT PREFIX] [WINDOW CYCLES]"
+                  << std::endl;
+        return 1;
+    }
+    if constexpr (!Intel8080::heatmap_enabled) {
+        std::cerr << "heatmap needs a build with EMU8080_HEATMAP"
+                  << std::endl;
+        return 1;
+    }
+    const std::string prefix = argv[2];
+    const uint64_t window = argc > 3 ? std::stoull(argv[3]) : 100000;
+
+    std::ifstream program(argv[1], std::ios::in | std::ios::binary);
+    if (program.fail()) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(bdos.begin(), bdos.end(), cpu->memory.begin());
+    program.read(reinterpret_cast<char *>(cpu->memory.data() + 0x100),
+                 cpu->memory.size() - 0x100);
+    cpu->program_counter = 0x100;
+    cpu->out = [](uint8_t port, uint8_t byte) {
+        if (port == 0) {
+            std::cout << byte;
+        }
+    };
+
+    MemoryHeatmap heatmap(true, window);
+    cpu->heatmap = &heatmap;
+    const std::size_t cycles = cpu->execute();
+    std::cout << std::endl << "Cycles executed: " << cycles << std::endl;
+
+    std::size_t read = 0;
+    std::size_t written = 0;
+    std::size_t executed = 0;
+    for (const MemoryHeatmap::Page &page : heatmap.pageCounts()) {
+        read += page.reads != 0;
+        written += page.writes != 0;
+        executed += page.executes != 0;
+    }
+    std::size_t peak = 0;
+    double mean = 0;
+    const std::vector<MemoryHeatmap::WorkingSet> windows = heatmap.workingSet();
+    for (const MemoryHeatmap::WorkingSet &set : windows) {
+        peak = std::max<std::size_t>(peak, set.touched);
+        mean += set.touched;
+    }
+    mean /= std::max<std::size_t>(windows.size(), 1);
+    std::cout << "Pages read: " << read << ", written: " << written
+              << ", executed: " << executed << std::endl
+              << "Working set per " << window << " cycles: " << mean
+              << " pages mean, " << peak << " peak" << std::endl
+              << "Bytes executed and written: " << heatmap.overlapBytes()
+              << std::endl;
+
+    const std::vector<MemoryHeatmap::ModifiedCode> sites =
+        heatmap.modifiedCode();
+    std::cout << "Self-modifying code sites: " << sites.size() << std::endl;
+    for (std::size_t i = 0; i < std::min(sites.size(), sites_shown); ++i) {
+        std::cout << std::hex << "    " << sites[i].address << " written by "
+                  << sites[i].instruction << std::dec << ", "
+                  << sites[i].writes << " times" << std::endl;
+    }
+
+    std::ofstream pages(prefix + "-pages.csv");
+    heatmap.writePages(pages);
+    std::ofstream bytes(prefix + "-bytes.csv");
+    heatmap.writeBytes(bytes);
+    std::ofstream working_set(prefix + "-working-set.csv");
+    heatmap.writeWorkingSet(working_set);
+    std::ofstream image(prefix + ".ppm", std::ios::binary);
+    heatmap.writeImage(image);
+    return 0;
+}
@@ -0,0 +1,584 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/cpu.h"
+#include "../src/opcodes.h"
+#include "../src/translation_cache.h"
+
+/**
+ * Ahead-of-time recompiler: translates a COM file to C++ for
+ * RecompiledIntel8080 (src/recompiled.h).
+ *
+ * Code is found by following control flow from 0x100 through jumps, calls
+ * and restarts. PCHL and RET can go anywhere, so the program is also run
+ * in the interpreter for a while and every address it executes becomes an
+ * entry point too, which finds code such as that after inline data a
+ * subroutine skips by adjusting its return address. Code found neither
+ * way is left to the interpreter at run time.
+ *
+ * With --cache, what was found is kept in a TranslationCache under the
+ * whole image and the trace length, since walking and tracing follow code
+ * across the program, and an image found there is not walked or traced
+ * again.
+ */
+
+namespace {
+
+constexpr uint16_t origin = 0x100;
+
+// long enough to get through the setup code of most programs
+constexpr std::size_t default_trace_cycles = 100000000;
+
+const char *const registers[] = {"cpu.register_B", "cpu.register_C",
+                                 "cpu.register_D", "cpu.register_E",
+                                 "cpu.register_H", "cpu.register_L",
+                                 "cpu.memory[cpu.register_HL]",
+                                 "cpu.register_A"};
+const char *const pairs[] = {"cpu.register_BC", "cpu.register_DE",
+                             "cpu.register_HL", "cpu.stack_pointer"};
+const char *const conditions[] = {"!cpu.flag_Z", "cpu.flag_Z", "!cpu.flag_C",
+                                  "cpu.flag_C",  "!cpu.flag_P", "cpu.flag_P",
+                                  "!cpu.flag_S", "cpu.flag_S"};
+const char *const operations[] = {"add", "adc", "sub", "sbb",
+                                  "ana", "xra", "ora", "cmp"};
+const char *const rotations[] = {"rlc", "rrc", "ral", "rar"};
+
+std::string hex(const unsigned value, const int digits) {
+    char text[8];
+    std::snprintf(text, sizeof(text), "0x%0*x", digits, value);
+    return text;
+}
+
+class Translator {
+  public:
+    explicit Translator(std::vector<uint8_t> image) : image(std::move(image)) {}
+
+    /**
+     * Find the code and split it into blocks
+     * Parameters:
+     *     trace_cycles - How long to run the program to find entry points
+     */
+    void discover(const std::size_t trace_cycles);
+
+    /**
+     * Find the code as discover() does, reusing what an earlier run with
+     * the same image and trace length stored
+     * Returns: True when the image was found in the cache
+     */
+    bool discover(const std::size_t trace_cycles, TranslationCache &cache);
+
+    void write(std::ostream &output, const std::string &name) const;
+
+  private:
+    enum Byte : uint8_t { unknown, instruction, operand };
+
+    std::vector<uint8_t> image;
+    std::vector<Byte> decoded = std::vector<Byte>(0x10000, unknown);
+    std::set<uint16_t> leaders;
+
+    struct Block {
+        uint16_t start;
+        uint16_t length;
+    };
+    std::vector<Block> blocks;
+
+    bool inImage(const std::size_t address) const {
+        return address >= origin && address < origin + image.size();
+    }
+    // memory outside the image reads as 0, as in trace()
+    uint8_t byte(const uint16_t address) const {
+        return inImage(address) ? image[address - origin] : 0;
+    }
+    uint16_t word(const uint16_t address) const {
+        return byte(address + 1) | byte(address + 2) << 8;
+    }
+    bool isBlock(const uint16_t address) const {
+        return decoded[address] == instruction && leaders.count(address);
+    }
+
+    void walk(uint16_t address, std::vector<uint16_t> &pending);
+    void split();
+    std::vector<uint16_t> trace(const std::size_t cycles) const;
+    void translate(std::ostream &output, const uint16_t address,
+                   bool &uses_dispatch) const;
+    std::string jump(const uint16_t target) const;
+};
+
+void Translator::discover(const std::size_t trace_cycles) {
+    std::vector<uint16_t> pending = {origin};
+    leaders.insert(origin);
+    while (!pending.empty()) {
+        const uint16_t address = pending.back();
+        pending.pop_back();
+        walk(address, pending);
+    }
+
+    // code only reached through computed branches, walked after the
+    // static control flow so it cannot displace it
+    for (const uint16_t address : trace(trace_cycles)) {
+        if (decoded[address] == unknown && leaders.insert(address).second) {
+            pending.push_back(address);
+            while (!pending.empty()) {
+                const uint16_t next = pending.back();
+                pending.pop_back();
+                walk(next, pending);
+            }
+        }
+    }
+
+    // targets that turned out to be inside another instruction are left
+    // to the interpreter
+    for (auto leader = leaders.begin(); leader != leaders.end();) {
+        leader = decoded[*leader] == instruction ? std::next(leader)
+                                                 : leaders.erase(leader);
+    }
+    split();
+}
+
+bool Translator::discover(const std::size_t trace_cycles,
+                          TranslationCache &cache) {
+    // bitmaps of instructions, operands and leaders, a page per entry
+    using Entry = TranslationCache::Entry;
+    constexpr std::size_t page_size = 256;
+    constexpr std::size_t bitmap = page_size / 8;
+    static_assert(3 * bitmap <= sizeof(Entry));
+
+    const uint64_t traced = trace_cycles;
+    const uint64_t context = TranslationCache::hash(&traced, sizeof(traced));
+    const std::size_t pages = (image.size() + page_size - 1) / page_size;
+
+    std::vector<Entry> entries;
+    if (cache.lookup(image.data(), image.size(), context, entries) &&
+        entries.size() == pages) {
+        for (std::size_t i = 0; i < image.size(); ++i) {
+            const Entry &entry = entries[i / page_size];
+            const std::size_t bit = i % page_size;
+            const auto set = [&](const std::size_t map) {
+                return entry[map * bitmap + bit / 8] >> (bit % 8) & 1;
+            };
+            decoded[origin + i] = set(0) ? instruction
+                                  : set(1) ? operand
+                                           : unknown;
+            if (set(2)) {
+                leaders.insert(origin + i);
+            }
+        }
+        split();
+        return true;
+    }
+
+    discover(trace_cycles);
+    entries.assign(pages, Entry{});
+    for (std::size_t i = 0; i < image.size(); ++i) {
+        Entry &entry = entries[i / page_size];
+        const std::size_t bit = i % page_size;
+        const uint16_t address = origin + i;
+        const uint8_t mask = 1 << (bit % 8);
+        if (decoded[address] == instruction) {
+            entry[bit / 8] |= mask;
+        } else if (decoded[address] == operand) {
+            entry[bitmap + bit / 8] |= mask;
+        }
+        if (leaders.count(address)) {
+            entry[2 * bitmap + bit / 8] |= mask;
+        }
+    }
+    cache.store(image.data(), image.size(), context, entries);
+    return false;
+}
+
+void Translator::split() {
+    for (const uint16_t start : leaders) {
+        uint16_t address = start;
+        for (;;) {
+            const opcodes::Descriptor &descriptor =
+                opcodes::descriptors[byte(address)];
+            address += descriptor.length;
+            const bool ends = (descriptor.effects & opcodes::halt) ||
+                              ((descriptor.effects &
+                                (opcodes::jump | opcodes::ret)) &&
+                               !(descriptor.effects & opcodes::conditional));
+            if (ends || !inImage(address) || decoded[address] != instruction ||
+                leaders.count(address)) {
+                break;
+            }
+        }
+        blocks.push_back({start, uint16_t(address - start)});
+    }
+}
+
+void Translator::walk(uint16_t address, std::vector<uint16_t> &pending) {
+    const auto follow = [&](const uint16_t target) {
+        if (inImage(target) && leaders.insert(target).second) {
+            pending.push_back(target);
+        }
+    };
+
+    while (inImage(address) && decoded[address] == unknown) {
+        const opcodes::Descriptor &descriptor =
+            opcodes::descriptors[byte(address)];
+        for (std::size_t i = 0; i < descriptor.length; ++i) {
+            if (!inImage(address + i) || decoded[address + i] != unknown) {
+                return;
+            }
+        }
+        decoded[address] = instruction;
+        for (std::size_t i = 1; i < descriptor.length; ++i) {
+            decoded[address + i] = operand;
+        }
+
+        const uint8_t opcode = byte(address);
+        const uint16_t next = address + descriptor.length;
+        const bool conditional = descriptor.effects & opcodes::conditional;
+        if (descriptor.effects & opcodes::call) {
+            follow(descriptor.length == 3 ? word(address) : opcode & 0x38);
+            // returns come back through the dispatch switch
+            leaders.insert(next);
+        } else if (descriptor.effects & opcodes::jump) {
+            if (descriptor.effects & opcodes::indirect) {
+                return;
+            }
+            follow(word(address));
+            if (!conditional) {
+                return;
+            }
+        } else if (descriptor.effects & (opcodes::ret | opcodes::halt)) {
+            if (!conditional) {
+                return;
+            }
+        }
+        address = next;
+    }
+
+    // joined code decoded by an earlier walk
+    if (inImage(address) && decoded[address] == instruction) {
+        leaders.insert(address);
+    }
+}
+
+std::vector<uint16_t> Translator::trace(const std::size_t cycles) const {
+    auto cpu = std::make_unique<Intel8080>();
+    cpu->memory.fill(0);
+    std::copy(image.begin(), image.end(), cpu->memory.begin() + origin);
+    // warm boot halts, BDOS calls return at once
+    cpu->memory[0x0000] = 0x76;
+    cpu->memory[0x0005] = 0xc9;
+    cpu->program_counter = origin;
+    cpu->stack_pointer = 0x0000;
+    cpu->in = [](uint8_t) -> uint8_t { return 0; };
+    cpu->out = [](uint8_t, uint8_t) {};
+
+    std::vector<bool> seen(0x10000, false);
+    std::vector<uint16_t> executed;
+    std::size_t elapsed = 0;
+    while (!cpu->halted && elapsed < cycles) {
+        const uint16_t address = cpu->program_counter;
+        if (inImage(address) && decoded[address] == unknown && !seen[address]) {
+            seen[address] = true;
+            executed.push_back(address);
+        }
+        elapsed += cpu->step();
+    }
+    return executed;
+}
+
+std::string Translator::jump(const uint16_t target) const {
+    if (isBlock(target)) {
+        return "goto L_" + hex(target, 4).substr(2) + ";";
+    }
+    return "{ pc = " + hex(target, 4) + "; goto leave; }";
+}
+
+void Translator::translate(std::ostream &output, const uint16_t address,
+                           bool &uses_dispatch) const {
+    const uint8_t opcode = byte(address);
+    const opcodes::Descriptor &descriptor = opcodes::descriptors[opcode];
+    const uint16_t next = address + descriptor.length;
+    const std::string d8 = descriptor.length > 1 ? hex(byte(address + 1), 2) : "";
+    const std::string d16 = descriptor.length > 2 ? hex(word(address), 4) : "";
+    const std::string leave_next =
+        "if (cpu.code_written) { pc = " + hex(next, 4) + "; goto leave; }";
+    // the I/O callbacks may request an exit
+    const std::string leave_exited = "if (cpu.pastDeadline(cycles)) { pc = " +
+                                     hex(next, 4) + "; goto leave; }";
+
+    const int y = (opcode >> 3) & 7;
+    const int z = opcode & 7;
+    const int p = y >> 1;
+
+    output << "    // " << hex(address, 4) << " " << descriptor.mnemonic
+           << "\n    cycles += " << int(descriptor.cycles) << ";\n";
+    std::ostringstream code;
+
+    if (opcode == 0x76) { // HLT
+        code << "cpu.halted = true;\n"
+             << "    pc = " << hex(next, 4) << ";\n    goto leave;";
+    } else if ((opcode & 0xc0) == 0x40) { // MOV
+        if (y == 6) {
+            code << "cpu.store(cpu.register_HL, " << registers[z] << ");\n    "
+                 << leave_next;
+        } else {
+            code << registers[y] << " = " << registers[z] << ";";
+        }
+    } else if ((opcode & 0xc0) == 0x80) { // ALU r
+        code << operations[y] << "(cpu, " << registers[z] << ");";
+    } else if ((opcode & 0xc7) == 0xc6) { // ALU d8
+        code << operations[y] << "(cpu, " << d8 << ");";
+    } else if ((opcode & 0xc7) == 0x04 || (opcode & 0xc7) == 0x05) {
+        const char *operation = z == 4 ? "inr" : "dcr";
+        if (y == 6) {
+            code << "cpu.store(cpu.register_HL, " << operation
+                 << "(cpu, cpu.memory[cpu.register_HL]));\n    " << leave_next;
+        } else {
+            code << registers[y] << " = " << operation << "(cpu, "
+                 << registers[y] << ");";
+        }
+    } else if ((opcode & 0xc7) == 0x06) { // MVI
+        if (y == 6) {
+            code << "cpu.store(cpu.register_HL, " << d8 << ");\n    "
+                 << leave_next;
+        } else {
+            code << registers[y] << " = " << d8 << ";";
+        }
+    } else if ((opcode & 0xcf) == 0x01) { // LXI
+        code << pairs[p] << " = " << d16 << ";";
+    } else if ((opcode & 0xcf) == 0x03) { // INX
+        code << "++" << pairs[p] << ";";
+    } else if ((opcode & 0xcf) == 0x0b) { // DCX
+        code << "--" << pairs[p] << ";";
+    } else if ((opcode & 0xcf) == 0x09) { // DAD
+        code << "dad(cpu, " << pairs[p] << ");";
+    } else if ((opcode & 0xc7) == 0x00) { // NOP
+        code << "";
+    } else if ((opcode & 0xe7) == 0x07) { // rotates
+        code << rotations[y] << "(cpu);";
+    } else if ((opcode & 0xc7) == 0xc2) { // Jcc
+        code << "if (" << conditions[y] << ") " << jump(word(address));
+    } else if ((opcode & 0xc7) == 0xc4 || (opcode & 0xc7) == 0xc7 ||
+               (descriptor.effects & opcodes::call)) { // Ccc, CALL, RST
+        const uint16_t target =
+            (opcode & 0xc7) == 0xc7 ? opcode & 0x38 : word(address);
+        std::string taken = "push(cpu, " + hex(next, 4) + ");\n" +
+                            "        if (cpu.code_written) { pc = " +
+                            hex(target, 4) + "; goto leave; }\n        " +
+                            jump(target);
+        if (descriptor.effects & opcodes::conditional) {
+            code << "if (" << conditions[y] << ") {\n        cycles += "
+                 << descriptor.taken_cycles - descriptor.cycles << ";\n        "
+                 << taken << "\n    }";
+        } else {
+            code << "{\n        " << taken << "\n    }";
+        }
+    } else if ((opcode & 0xc7) == 0xc0) { // Rcc
+        uses_dispatch = true;
+        code << "if (" << conditions[y] << ") {\n        cycles += "
+             << descriptor.taken_cycles - descriptor.cycles
+             << ";\n        pc = pop(cpu);\n        goto dispatch;\n    }";
+    } else if ((opcode & 0xcf) == 0xc1) { // POP
+        code << (p == 3 ? "cpu.register_PSW = pop(cpu);\n    "
+                          "loadFlags(cpu);"
+                        : std::string(pairs[p]) + " = pop(cpu);");
+    } else if ((opcode & 0xcf) == 0xc5) { // PUSH
+        if (p == 3) {
+            code << "storeFlags(cpu);\n    push(cpu, cpu.register_PSW);";
+        } else {
+            code << "push(cpu, " << pairs[p] << ");";
+        }
+        code << "\n    " << leave_next;
+    } else {
+        switch (opcode) {
+        case 0x02: // STAX B
+        case 0x12: // STAX D
+            code << "cpu.store(" << pairs[p] << ", cpu.register_A);\n    "
+                 << leave_next;
+            break;
+        case 0x0a: // LDAX B
+        case 0x1a: // LDAX D
+            code << "cpu.register_A = cpu.memory[" << pairs[p] << "];";
+            break;
+        case 0x22: // SHLD
+            code << "store16(cpu, " << d16 << ", cpu.register_HL);\n    "
+                 << leave_next;
+            break;
+        case 0x2a: // LHLD
+            code << "cpu.register_HL = load16(cpu, " << d16 << ");";
+            break;
+        case 0x27: // DAA
+            code << "daa(cpu);";
+            break;
+        case 0x2f: // CMA
+            code << "cpu.register_A = ~cpu.register_A;";
+            break;
+        case 0x32: // STA
+            code << "cpu.store(" << d16 << ", cpu.register_A);\n    "
+                 << leave_next;
+            break;
+        case 0x3a: // LDA
+            code << "cpu.register_A = cpu.memory[" << d16 << "];";
+            break;
+        case 0x37: // STC
+            code << "cpu.flag_C = true;";
+            break;
+        case 0x3f: // CMC
+            code << "cpu.flag_C = !cpu.flag_C;";
+            break;
+        case 0xc3: // JMP
+        case 0xcb: // *JMP
+            code << jump(word(address));
+            break;
+        case 0xc9: // RET
+        case 0xd9: // *RET
+            uses_dispatch = true;
+            code << "pc = pop(cpu);\n    goto dispatch;";
+            break;
+        case 0xd3: // OUT
+            code << "cpu.out(" << d8 << ", cpu.register_A);\n    "
+                 << leave_exited;
+            break;
+        case 0xdb: // IN
+            code << "cpu.register_A = cpu.in(" << d8 << ");\n    "
+                 << leave_exited;
+            break;
+        case 0xe3: // XTHL
+            code << "{\n        const uint16_t word = load16(cpu, "
+                    "cpu.stack_pointer);\n"
+                 << "        store16(cpu, cpu.stack_pointer, "
+                    "cpu.register_HL);\n"
+                 << "        cpu.register_HL = word;\n    }\n    "
+                 << leave_next;
+            break;
+        case 0xe9: // PCHL
+            uses_dispatch = true;
+            code << "pc = cpu.register_HL;\n    goto dispatch;";
+            break;
+        case 0xeb: // XCHG
+            code << "std::swap(cpu.register_HL, cpu.register_DE);";
+            break;
+        case 0xf3: // DI
+            code << "cpu.interrupts_enabled = false;";
+            break;
+        case 0xf9: // SPHL
+            code << "cpu.stack_pointer = cpu.register_HL;";
+            break;
+        case 0xfb: // EI
+            code << "cpu.interrupts_enabled = true;";
+            break;
+        }
+    }
+
+    if (!code.str().empty()) {
+        output << "    " << code.str() << "\n";
+    }
+}
+
+void Translator::write(std::ostream &output, const std::string &name) const {
+    output << "// Generated by tools/recompile, do not edit\n"
+           << "#include <utility>\n\n#include \"recompiled.h\"\n\n"
+           << "namespace {\n\nconst uint8_t image[] = {";
+    for (std::size_t i = 0; i < image.size(); ++i) {
+        output << (i % 12 ? " " : "\n    ") << hex(image[i], 2) << ",";
+    }
+    output << "\n};\n\nconst RecompiledProgram::Block blocks[] = {\n";
+    for (const Block &block : blocks) {
+        output << "    {" << hex(block.start, 4) << ", " << block.length
+               << "},\n";
+    }
+    output << "};\n\n";
+
+    std::ostringstream body;
+    bool uses_dispatch = false;
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        const Block &block = blocks[i];
+        body << "L_" << hex(block.start, 4).substr(2) << ":\n"
+             << "    if (cpu.isStale(" << i << ") || cpu.pastDeadline(cycles)) {\n"
+             << "        pc = " << hex(block.start, 4) << ";\n"
+             << "        goto leave;\n    }\n";
+        uint16_t address = block.start;
+        uint16_t last = address;
+        while (address < block.start + block.length) {
+            translate(body, address, uses_dispatch);
+            last = address;
+            address += opcodes::descriptors[byte(address)].length;
+        }
+
+        // falling through into anything but the next block needs a jump
+        const opcodes::Descriptor &descriptor =
+            opcodes::descriptors[byte(last)];
+        const bool ends = (descriptor.effects & opcodes::halt) ||
+                          ((descriptor.effects &
+                            (opcodes::jump | opcodes::ret)) &&
+                           !(descriptor.effects & opcodes::conditional));
+        const bool next_follows =
+            i + 1 < blocks.size() && blocks[i + 1].start == address;
+        if (!ends && !next_follows) {
+            body << "    " << jump(address) << "\n";
+        }
+        body << "\n";
+    }
+
+    output << "std::size_t run(RecompiledIntel8080 &cpu) {\n"
+           << "    using namespace recompiled;\n"
+           << "    std::size_t cycles = 0;\n"
+           << "    uint16_t pc = cpu.program_counter;\n\n";
+    if (uses_dispatch) {
+        output << "dispatch:\n";
+    }
+    output << "    switch (pc) {\n";
+    for (const Block &block : blocks) {
+        output << "    case " << hex(block.start, 4) << ":\n        goto L_"
+               << hex(block.start, 4).substr(2) << ";\n";
+    }
+    output << "    default:\n        goto leave;\n    }\n\n"
+           << body.str() << "leave:\n"
+           << "    cpu.program_counter = pc;\n    return cycles;\n}\n\n"
+           << "} // namespace\n\n"
+           << "extern const RecompiledProgram " << name << " = {\n"
+           << "    " << hex(origin, 4) << ", image, sizeof(image),\n"
+           << "    blocks, sizeof(blocks) / sizeof(blocks[0]), run,\n};\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::unique_ptr<TranslationCache> cache;
+    if (argc > 2 && std::string(argv[1]) == "--cache") {
+        cache = std::make_unique<TranslationCache>(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc != 4 && argc != 5) {
+        std::cerr << "usage: recompile [--cache FILE] [COM] [NAME] [OUTPUT] "
+                     "[TRACE CYCLES]"
+                  << std::endl;
+        return 1;
+    }
+    const std::size_t trace_cycles =
+        argc == 5 ? std::stoull(argv[4]) : default_trace_cycles;
+
+    std::ifstream input(argv[1], std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(input)),
+                               std::istreambuf_iterator<char>());
+    image.resize(std::min<std::size_t>(image.size(), 0x10000 - origin));
+
+    Translator translator(std::move(image));
+    if (cache) {
+        translator.discover(trace_cycles, *cache);
+    } else {
+        translator.discover(trace_cycles);
+    }
+
+    std::ofstream output(argv[3]);
+    translator.write(output, argv[2]);
+    return output.good() ? 0 : 1;
+}